@@ -24,4 +24,11 @@ int xen_noc_dma_req_lin_xfer(struct noc_dma_channel *c,
 			     uint16_t elem, enum noc_dma_elem_size elem_size,
 			     enum noc_dma_priority dma_priority, uint16_t mtu);
 
+int xen_noc_dma_start_lin_xfer(struct noc_dma_channel *c,
+			       void *src, void *dst,
+			       uint16_t elem, enum noc_dma_elem_size elem_size,
+			       enum noc_dma_priority dma_priority, uint16_t mtu);
+
+void xen_noc_dma_wait(struct noc_dma_channel *c);
+
 #endif /* _DSP_XENTIUM_DMA_H_ */
@@ -0,0 +1,32 @@
+/**
+ * @file dsp/xentium/include/prefetch.h
+ * @ingroup xen
+ */
+
+#ifndef _DSP_XENTIUM_PREFETCH_H_
+#define _DSP_XENTIUM_PREFETCH_H_
+
+#include <stddef.h>
+#include <kernel/xentium_io.h>
+
+
+/**
+ * the state of the task data prefetch into a pair of TCM banks
+ */
+
+struct xen_prefetch {
+	struct proc_task *t;	/*!< the task in the prefetch bank */
+	size_t n;		/*!< the number of words prefetched */
+	size_t bank[2];		/*!< the indices of the TCM banks to use */
+	size_t idx;		/*!< the prefetch bank */
+};
+
+
+void xen_prefetch_init(struct xen_prefetch *p, size_t bank0, size_t bank1);
+
+void *xen_prefetch_task(struct xen_prefetch *p, struct xen_msg_data *m,
+			size_t *n);
+
+void *xen_prefetch_ext(struct xen_msg_data *m, void *buf);
+
+#endif /* _DSP_XENTIUM_PREFETCH_H_ */
@@ -48,5 +48,7 @@ void xen_wait_dma(void);
 
 void *xen_get_base_addr(size_t xen_id);
 
+void xen_kmem_init(struct xen_msg_data *m);
+
 
 #endif /* _DSP_XENTIUM_XEN_H_ */
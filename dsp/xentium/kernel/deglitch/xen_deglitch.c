@@ -11,6 +11,7 @@
 
 #include <xen.h>
 #include <dma.h>
+#include <prefetch.h>
 #include <xen_printf.h>
 #include <data_proc_net.h>
 #include <kernel/kmem.h>
@@ -18,6 +19,11 @@
 
 #define DMA_MTU	256	/* arbitrary DMA packet size */
 
+/* input and output are transferred in tiles of this many elements, so the
+ * transfer of one tile overlaps the processing of another
+ */
+#define TILE_ELEM	(16 * DMA_MTU / sizeof(int))
+
 /* this kernel's properties */
 #define KERN_NAME		"deglitch"
 #define KERN_STORAGE_BYTES	0
@@ -32,71 +38,122 @@ struct xen_kernel_cfg _xen_kernel_param = {
 
 
 /**
- * @brief determine the median of 3 values
+ * @brief get a plain pointer to a location in the local TCM
+ *
+ * @note The local TCM starts at 0x0, so clang (in this case incorrectly)
+ *	 detects accesses via a known TCM address as NULL pointer dereferences,
+ *	 unless they are volatile. The address is instead passed through a
+ *	 volatile variable, so it is opaque to the compiler, while the accesses
+ *	 themselves may be optimised (i.e. vectorised).
+ */
+
+static int *tcm_ptr(volatile void *addr)
+{
+	int *volatile p = (int *) addr;
+
+
+	return p;
+}
+
+
+/**
+ * @brief get the minimum of two values
  */
 
-static int median3(int a, int b, int c)
+static inline int imin(int a, int b)
 {
-        int t;
+	return (a < b) ? a : b;
+}
 
-        if (a > b) {
-                t = a;
-                a = b;
-                b = t;
 
-        } else if (b > c) {
-                t = b;
-                b = c;
-                c = t;
+/**
+ * @brief get the maximum of two values
+ */
 
-        } else if (a > b) {
-                t = a;
-                a = b;
-                b = t;
-        }
+static inline int imax(int a, int b)
+{
+	return (a > b) ? a : b;
+}
+
+
+/**
+ * @brief determine the median of 3 values
+ *
+ * @note this is a min/max sorting network, which the compiler turns into
+ *	 conditional selects rather than branches
+ */
 
-        return b;
+static inline int median3(int a, int b, int c)
+{
+	return imax(imin(a, b), imin(imax(a, b), c));
 }
 
+
 /**
  * @brief get the absolute of a value
  */
 
-static int abs(int a)
+static inline int iabs(int a)
 {
-	if (a >= 0)
-		return a;
+	int s = a >> (sizeof(int) * 8 - 1);
 
-	return -a;
+	return (a ^ s) - s;
 }
 
+
 /**
- * @brief apply a median filter of lenght 3 to data
+ * @brief apply a median filter of length 3 to a range of an array
  *
  * @param in  the input array
  * @param out the output array
+ * @param i   the first element of the range
+ * @param end the end of the range (exclusive)
  * @param len the number of elements in the array
  * @param threshold the input value above which to apply the filter
+ *
+ * @note every output element only depends on its input window and the
+ *	 comparisons are selects, so the loop is vectorised by the compiler
  */
 
-static void median3filter(volatile int *in, int *out, size_t len, unsigned int threshold)
+static void median3filter(const int *__restrict in, int *__restrict out,
+			  size_t i, size_t end, size_t len,
+			  unsigned int threshold)
 {
-	int i, m;
+	size_t j;
+	size_t n;
 
+	int b;
+	int m;
 
-	out[0] = in[0];
 
-	for (i = 1; i < (len-1); i++) {
+	if (i >= end)
+		return;
 
-		m = median3(in[i-1], in[i], in[i+1]);
+	/* the first and last element are not filtered */
+	if (!i) {
+		out[0] = in[0];
+		i = 1;
+	}
 
-		if (abs(m - in[i]) > threshold)
-			out[i] = m;
-		else
-			out[i] = in[i];
+	if (end == len) {
+		out[len - 1] = in[len - 1];
+		end = len - 1;
 	}
 
-	out[len-1] = in[len-1];
+	if (i >= end)
+		return;
+
+	n   = end - i;
+	in  = &in[i];
+	out = &out[i];
+
+	for (j = 0; j < n; j++) {
+
+		b = in[j];
+		m = median3(in[j - 1], b, in[j + 1]);
+
+		out[j] = ((unsigned int) iabs(m - b) > threshold) ? m : b;
+	}
 }
 
 
@@ -137,7 +194,7 @@ static int isqrt(int num)
  * @returns sigma as integer
  */
 __attribute__((unused))
-static int get_int_sigma(volatile int *in, size_t len)
+static int get_int_sigma(const int *in, size_t len)
 {
 	size_t i;
 
@@ -155,7 +212,7 @@ static int get_int_sigma(volatile int *in, size_t len)
 	for (i = 0; i < len; i++)
 		mean += in[i];
 
-	mean /= len;
+	mean /= (int) len;
 
 
 	for (i = 0; i < len; i++) {
@@ -169,59 +226,44 @@ static int get_int_sigma(volatile int *in, size_t len)
 
 
 /**
- * @brief get average residual in L1 norm E(abs(X - E(X)))
- *
- * this works better than non-iterative clipping
+ * @brief get the sum of an integer array
  */
 
-static int get_int_L1_residual(volatile int *in, size_t len)
+static int get_int_sum(const int *in, size_t len)
 {
 	size_t i;
 
-	int tmp;
-	int mean = 0;
-/**
- * Some implementation dependent op info passed by whatever created the task
- * this could also just exist in the <data> buffer as a interpretable structure.
- * This is really up to the user...
- * Note: the xentium kernel processing a task must know the same structure
- */
-	unsigned int residual = 0;
+	int sum = 0;
 
 
 	for (i = 0; i < len; i++)
-		mean += in[i];
-
-	mean /= len;
-
-	for (i = 0; i < len; i++) {
-		tmp = (in[i] - mean);
-		residual += abs(tmp);
-	}
+		sum += in[i];
 
-
-	return residual / len;
+	return sum;
 }
 
 
 /**
- * @brief apply a clipped median filter to an array
+ * @brief get average residual in L1 norm E(abs(X - E(X)))
+ *
+ * this works better than non-iterative clipping
  *
+ * @param in the input array
+ * @param len the number of elements in the array
+ * @param mean the mean of the array, see get_int_sum()
  */
 
-static void median_filter_cipped(volatile int *in, int *out, size_t len, unsigned int clip)
+static int get_int_L1_residual(const int *in, size_t len, int mean)
 {
-	unsigned int threshold;
+	size_t i;
 
+	unsigned int residual = 0;
 
-	/* this is not iterative */
-#if 0
-	threshold = clip * get_int_sigma(in, len);
-#else
-	threshold = clip * get_int_L1_residual(in, len);
-#endif
 
-	median3filter(in, out, len, threshold);
+	for (i = 0; i < len; i++)
+		residual += iabs(in[i] - mean);
+
+	return residual / len;
 }
 
 
@@ -229,19 +271,27 @@ static void median_filter_cipped(volatile int *in, int *out, size_t len, unsigne
  * here we do the work
  */
 
-static void process_task(struct xen_msg_data *m)
+static void process_task(struct xen_msg_data *m, struct xen_prefetch *pf)
 {
+	size_t i;
 	size_t n;
 	size_t len;
+	size_t tile;
 
 	int *p;
+	int sum;
+
+	size_t n_in;
+
+	void *in;
 
-	volatile int *b1;
-	volatile int *b3;
+	unsigned int threshold;
 
-	struct xen_tcm *tcm_ext;
+	int *b1;
+	int *b3;
 
-	struct xen_tcm *tcm_ext_out;
+	int *tcm_ext;
+	int *tcm_ext_out;
 
 	struct deglitch_op_info *op_info;
 
@@ -252,14 +302,9 @@ static void process_task(struct xen_msg_data *m)
 		return;
 	}
 
-	/* These refers to the TCM banks. Note that at least b1 must be
-	 * volatile, or clang soils itself because the local TCM starts at 0x0
-	 * and (in this case incorrectly) detects that as a NULL pointer
-	 * dereference.
-	 */
-
-	b1 = (volatile int *) xen_tcm_local->bank1;
-	b3 = (volatile int *) xen_tcm_local->bank3;
+	/* These refers to the TCM banks, see tcm_ptr() */
+	b1 = tcm_ptr(xen_tcm_local->bank1);
+	b3 = tcm_ptr(xen_tcm_local->bank3);
 
 
 	/* determine our TCM's external address, so we can program DMA
@@ -300,17 +345,58 @@ static void process_task(struct xen_msg_data *m)
 	/* the data buffer of this task */
 	p = (int *) pt_get_data(m->t);
 
-	/* retrieve data to TCM */
-	xen_noc_dma_req_lin_xfer(m->dma, p, tcm_ext, n, WORD, LOW, DMA_MTU);
+	/* inputs that fit a single bank are double-buffered in banks 1 & 2,
+	 * larger inputs are retrieved to TCM here
+	 */
+	in = xen_prefetch_task(pf, m, &n_in);
+
+	if (!n) {
+		m->cmd = TASK_SUCCESS;
+		return;
+	}
+
+	if (in) {
+		b1  = in;
+		sum = get_int_sum(b1, n);
+	} else {
+		/* sum up each tile while the next one is in transit */
+		for (i = 0, sum = 0; i < n; i += TILE_ELEM) {
+
+			tile = (n - i < TILE_ELEM) ? (n - i) : TILE_ELEM;
+
+			xen_noc_dma_start_lin_xfer(m->dma, &p[i], &tcm_ext[i],
+						   tile, WORD, LOW, DMA_MTU);
+			if (i)
+				sum += get_int_sum(&b1[i - TILE_ELEM],
+						   TILE_ELEM);
+		}
+
+		i -= TILE_ELEM;
+
+		xen_noc_dma_wait(m->dma);
+
+		sum += get_int_sum(&b1[i], n - i);
+	}
 
+	/* this is not iterative */
+	threshold = op_info->sigclip * get_int_L1_residual(b1, n,
+							   sum / (int) n);
 
-	/* process input in banks 1 & 2 into output banks 3 & 4
-	 * larger inputs are not implemented at this time
+	/* process input in banks 1 & 2 into output banks 3 & 4 and copy
+	 * each tile back to the data buffer while the next one is processed
 	 */
-	median_filter_cipped(b1, (int *) b3, n, op_info->sigclip);
+	for (i = 0; i < n; i += TILE_ELEM) {
+
+		tile = (n - i < TILE_ELEM) ? (n - i) : TILE_ELEM;
 
-	/* copy result back to data buffer */
-	xen_noc_dma_req_lin_xfer(m->dma, tcm_ext_out, p, n, WORD, LOW, DMA_MTU);
+		median3filter(b1, b3, i, i + tile, n, threshold);
+
+		xen_noc_dma_start_lin_xfer(m->dma, &tcm_ext_out[i], &p[i],
+					   tile, WORD, LOW, DMA_MTU);
+	}
+
+	/* the host may release the data buffer once we report back */
+	xen_noc_dma_wait(m->dma);
 
 	/* number of elements did not change */
 
@@ -327,6 +413,10 @@ int main(void)
 {
 	struct xen_msg_data *m;
 
+	struct xen_prefetch pf;
+
+
+	xen_prefetch_init(&pf, 0, 1);
 
 	while (1) {
 		m = xen_wait_cmd();
@@ -346,7 +436,7 @@ int main(void)
 			break;
 		}
 
-		process_task(m);
+		process_task(m, &pf);
 
 		xen_send_msg(m);
 	}
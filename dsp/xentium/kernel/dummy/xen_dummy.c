@@ -7,6 +7,7 @@
 
 #include <xen.h>
 #include <dma.h>
+#include <prefetch.h>
 #include <xen_printf.h>
 #include <data_proc_net.h>
 
@@ -26,19 +27,16 @@ struct xen_kernel_cfg _xen_kernel_param = {
 
 
 
-static void process_task(struct xen_msg_data *m)
+static void process_task(struct xen_msg_data *m, struct xen_prefetch *pf)
 {
 	size_t n;
 
 	unsigned int *p;
-	volatile unsigned int *b1;
+	void *buf;
 
 	struct xen_tcm *tcm_ext;
 
 
-	b1 = (volatile unsigned int *) xen_tcm_local;
-
-
 
 	if (!m->t) {
 		m->cmd = TASK_DESTROY;
@@ -47,21 +45,24 @@ static void process_task(struct xen_msg_data *m)
 
 	tcm_ext = xen_get_base_addr(m->xen_id);
 
-
-	n = pt_get_nmemb(m->t);
 	p = pt_get_data(m->t);
 
+	/* retrieve data to TCM, unless it was prefetched already */
+	buf = xen_prefetch_task(pf, m, &n);
 
-	if (n > XEN_TCM_BANK_SIZE / sizeof(unsigned int))
+	if (!buf) {
 		n = XEN_TCM_BANK_SIZE / sizeof(unsigned int);
-
-	/* retrieve data to TCM */
-	xen_noc_dma_req_lin_xfer(m->dma, p, tcm_ext, n, WORD, LOW, DMA_MTU);
+		xen_noc_dma_req_lin_xfer(m->dma, p, tcm_ext, n, WORD, LOW,
+					 DMA_MTU);
+		buf = (void *) xen_tcm_local;
+	}
 
 	/* no processing */
 
 	/* back to main memory  */
-	xen_noc_dma_req_lin_xfer(m->dma, tcm_ext, p, n, WORD, LOW, DMA_MTU);
+	if (n)
+		xen_noc_dma_req_lin_xfer(m->dma, xen_prefetch_ext(m, buf), p,
+					 n, WORD, LOW, DMA_MTU);
 
 
 	m->cmd = TASK_SUCCESS;
@@ -73,6 +74,12 @@ int main(void)
 {
 	struct xen_msg_data *m;
 
+	struct xen_prefetch pf;
+
+
+	/* alternate between banks 1 and 2 */
+	xen_prefetch_init(&pf, 0, 1);
+
 	while (1) {
 		m = xen_wait_cmd();
 
@@ -84,7 +91,7 @@ int main(void)
 		default:
 			break;
 		}
-		process_task(m);
+		process_task(m, &pf);
 
 		xen_send_msg(m);
 	}
@@ -10,7 +10,7 @@
  *	- command exchange with the host processor
  *	- access to processing tasks
  *	- complex DMA transfer
- *	- kmalloc/kfree via the host processor
+ *	- kmalloc/kfree from the local arena (see lib/kmem.c)
  *	- integration of custom (really seariously very superfast) assembly for
  *	  the actual processing
  *
@@ -42,10 +42,10 @@ struct xen_kernel_cfg _xen_kernel_param = {
 
 
 
-/* prototype of our assembly function */
-int FastIntFixedRampFitBuffer(long *bank1, long *bank2,
+/* prototype of our assembly function, the samples are 32 bit words */
+int FastIntFixedRampFitBuffer(int32_t *bank1, int32_t *bank2,
 			      unsigned int n_samples, unsigned int ramplen,
-			      long *slopes);
+			      int32_t *slopes);
 
 /**
  * here we do the work
@@ -57,12 +57,12 @@ static void process_task(struct xen_msg_data *m)
 	size_t len;
 	size_t n_ramps;
 
-	long *p;
-	long *slopes;
+	int32_t *p;
+	int32_t *slopes;
 
-	volatile long *b1;
-	volatile long *b2;
-	volatile long *b3;
+	volatile int32_t *b1;
+	volatile int32_t *b2;
+	volatile int32_t *b3;
 
 	struct xen_tcm *tcm_ext;
 
@@ -80,9 +80,9 @@ static void process_task(struct xen_msg_data *m)
 	 * dereference.
 	 */
 
-	b1 = (volatile long *) xen_tcm_local->bank1;
-	b2 = (volatile long *) xen_tcm_local->bank2;
-	b3 = (volatile long *) xen_tcm_local->bank3;
+	b1 = (volatile int32_t *) xen_tcm_local->bank1;
+	b2 = (volatile int32_t *) xen_tcm_local->bank2;
+	b3 = (volatile int32_t *) xen_tcm_local->bank3;
 
 
 	/* determine our TCM's external address, so we can program DMA
@@ -102,8 +102,8 @@ static void process_task(struct xen_msg_data *m)
 	/* number of elements to process */
 	n = pt_get_nmemb(m->t);
 
-	if (n > len / sizeof(long)) {
-		n = len / sizeof(long);
+	if (n > len / sizeof(int32_t)) {
+		n = len / sizeof(int32_t);
 	}
 
 	if (n & 0x3) {
@@ -117,11 +117,11 @@ static void process_task(struct xen_msg_data *m)
 	 * (Don't do this if you want fast accesses/reads!)
 	 */
 	n_ramps = n / op_info->ramplen;
-	slopes = kzalloc(n_ramps * sizeof(long));
+	slopes = kzalloc(n_ramps * sizeof(int32_t));
 
 
 	/* the data buffer of this task */
-	p = (long *) pt_get_data(m->t);
+	p = (int32_t *) pt_get_data(m->t);
 
 	/* retrieve data to TCM
 	 * XXX no retval handling
@@ -167,8 +167,8 @@ static void process_task(struct xen_msg_data *m)
 			     2, 1, LOW, DMA_MTU);
 
 	/* process the ramps*/
-	n_ramps = FastIntFixedRampFitBuffer((long *) b1,
-				  (long *) b3,
+	n_ramps = FastIntFixedRampFitBuffer((int32_t *) b1,
+				  (int32_t *) b3,
 				  n, op_info->ramplen, slopes);
 
 	/* Now copy the resulting slopes to the data buffer and free the
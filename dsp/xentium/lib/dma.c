@@ -9,6 +9,7 @@
  */
 
 #include <errno.h>
+#include <xen.h>
 #include <dma.h>
 
 
@@ -195,6 +196,8 @@ static void noc_dma_set_dst(struct noc_dma_channel *chan, void *dst)
  * @param chan a struct noc_dma_channel
  *
  * @returns 0 on success, -EBUSY if channel is active
+ *
+ * @note this does not wait for the transfer to complete
  */
 
 static int noc_dma_start_transfer(struct noc_dma_channel *chan)
@@ -204,11 +207,6 @@ static int noc_dma_start_transfer(struct noc_dma_channel *chan)
 
 	iowrite32(NOC_DMA_CHANNEL_START, &chan->start);
 
-	/* XXX remove once we figure out how to properly use the Xentium's
-	 * DMA status bits
-	 */
-	while (noc_dma_channel_busy(chan));
-
 	return 0;
 }
 
@@ -286,36 +284,59 @@ static int noc_dma_init_transfer(struct noc_dma_channel  *c,
 
 
 /**
- * @brief request an arbitrary DMA transfer
- *
- * @param c the DMA channel to use
- *
- * @param src  the source address
- * @param dst the destination address
- *
- * @param x_elem the number of elements in x
- * @param y_elem the number of elements in y
- * @param size the element size (BYTE, HALFWORD, WORD, DOUBLEWORD)
+ * @brief wait for the transfer on a DMA channel to complete
  *
- * @param x_stride_src the width of stride in source x
- * @param x_stride_dst the width of stride in destination x
+ * @param c the DMA channel to wait for
+ */
+
+void xen_noc_dma_wait(struct noc_dma_channel *c)
+{
+	/* XXX remove once we figure out how to properly use the Xentium's
+	 * DMA status bits
+	 */
+	while (noc_dma_channel_busy(c));
+}
+
+
+/**
+ * @brief account for the bytes of a DMA transfer
  *
- * @param y_stride_src the width of stride in source y
- * @param y_stride_dst the width of stride in destination y
+ * @param bytes the number of bytes requested for transfer
  *
- * @param mtu the maximum transfer unit of a NoC packet
+ * @note The count is kept in the current command message rather than in a
+ *	 static variable, as the same kernel program may run on several
+ *	 Xentiums at once. It is reported to the host with the next message
+ *	 and reset with the next command, see xen_wait_cmd().
+ */
+
+static void xen_noc_dma_account(unsigned long bytes)
+{
+	struct xen_msg_data *m;
+
+
+	m = (struct xen_msg_data *) xen_get_mail(XEN_CMD_MBOX);
+	if (!m)
+		return;
+
+	m->dma_bytes += bytes;
+}
+
+
+/**
+ * @brief set up an arbitrary DMA transfer
  *
  * @returns <0 on error
  */
 
-int xen_noc_dma_req_xfer(struct noc_dma_channel *c,
-			 void *src, void *dst, uint16_t x_elem, uint16_t y_elem,
-			 enum noc_dma_elem_size elem_size,
-			 int16_t x_stride_src, int16_t x_stride_dst,
-			 int16_t y_stride_src, int16_t y_stride_dst,
-			 enum noc_dma_priority dma_priority, uint16_t mtu)
+static int xen_noc_dma_init_xfer(struct noc_dma_channel *c,
+				 void *src, void *dst,
+				 uint16_t x_elem, uint16_t y_elem,
+				 enum noc_dma_elem_size elem_size,
+				 int16_t x_stride_src, int16_t x_stride_dst,
+				 int16_t y_stride_src, int16_t y_stride_dst,
+				 enum noc_dma_priority dma_priority,
+				 uint16_t mtu)
 {
-	int ret;
 	struct noc_dma_transfer t;
 
 
@@ -353,12 +374,65 @@ int xen_noc_dma_req_xfer(struct noc_dma_channel *c,
 
 	t.priority = dma_priority;
 
+	xen_noc_dma_account(((unsigned long) x_elem * y_elem) << elem_size);
+
+
+	return noc_dma_init_transfer(c, &t);
+}
+
+
+/**
+ * @brief request an arbitrary DMA transfer
+ *
+ * @param c the DMA channel to use
+ *
+ * @param src  the source address
+ * @param dst the destination address
+ *
+ * @param x_elem the number of elements in x
+ * @param y_elem the number of elements in y
+ * @param size the element size (BYTE, HALFWORD, WORD, DOUBLEWORD)
+ *
+ * @param x_stride_src the width of stride in source x
+ * @param x_stride_dst the width of stride in destination x
+ *
+ * @param y_stride_src the width of stride in source y
+ * @param y_stride_dst the width of stride in destination y
+ *
+ * @param mtu the maximum transfer unit of a NoC packet
+ *
+ * @returns <0 on error
+ *
+ * @note this waits for any previously started transfer on the channel and
+ *	 returns once the requested transfer is complete
+ */
+
+int xen_noc_dma_req_xfer(struct noc_dma_channel *c,
+			 void *src, void *dst, uint16_t x_elem, uint16_t y_elem,
+			 enum noc_dma_elem_size elem_size,
+			 int16_t x_stride_src, int16_t x_stride_dst,
+			 int16_t y_stride_src, int16_t y_stride_dst,
+			 enum noc_dma_priority dma_priority, uint16_t mtu)
+{
+	int ret;
+
 
-	ret = noc_dma_init_transfer(c, &t);
+	xen_noc_dma_wait(c);
+
+	ret = xen_noc_dma_init_xfer(c, src, dst, x_elem, y_elem, elem_size,
+				    x_stride_src, x_stride_dst,
+				    y_stride_src, y_stride_dst,
+				    dma_priority, mtu);
 	if (ret)
 		return ret;
 
-	return noc_dma_start_transfer(c);
+	ret = noc_dma_start_transfer(c);
+	if (ret)
+		return ret;
+
+	xen_noc_dma_wait(c);
+
+	return 0;
 }
 
 
@@ -386,3 +460,42 @@ int xen_noc_dma_req_lin_xfer(struct noc_dma_channel *c,
 	return xen_noc_dma_req_xfer(c, src, dst, elem, 1, elem_size,
 				    1, 1, 1, 1, LOW, mtu);
 }
+
+
+/**
+ * @brief start a linear array DMA transfer in the background
+ *
+ * @param c the DMA channel to use
+ *
+ * @param src  the source address
+ * @param dst the destination address
+ *
+ * @param elem the number of elements
+ * @param size the element size (BYTE, HALFWORD, WORD, DOUBLEWORD)
+ *
+ * @param mtu the maximum transfer unit of a NoC packet
+ *
+ * @returns <0 on error
+ *
+ * @note the caller must xen_noc_dma_wait() on the channel before it accesses
+ *	 the destination buffer; any subsequent transfer requested on the
+ *	 channel will wait for this transfer to complete
+ */
+
+int xen_noc_dma_start_lin_xfer(struct noc_dma_channel *c,
+			       void *src, void *dst,
+			       uint16_t elem, enum noc_dma_elem_size elem_size,
+			       enum noc_dma_priority dma_priority, uint16_t mtu)
+{
+	int ret;
+
+
+	xen_noc_dma_wait(c);
+
+	ret = xen_noc_dma_init_xfer(c, src, dst, elem, 1, elem_size,
+				    1, 1, 1, 1, dma_priority, mtu);
+	if (ret)
+		return ret;
+
+	return noc_dma_start_transfer(c);
+}
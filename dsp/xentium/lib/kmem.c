@@ -3,91 +3,320 @@
  *
  * @ingroup xen
  *
- * @brief kmalloc/kfree via host processor for added convenience...
+ * @brief kmalloc/kfree from a local arena, via host processor as fallback
  *
+ *
+ * Each Xentium is handed a chunk of DMA-capable memory by the host along
+ * with every command message (see struct xen_msg_data). Allocations are served
+ * first-fit from an address-ordered free list of this arena, so no mailbox
+ * round-trip or host interrupt is needed. Only if the arena is exhausted (or
+ * was not supplied), the request is passed to the host processor.
+ *
+ * The arena is set up with the first command a kernel program receives, i.e.
+ * all arena allocations are implicitly released when the kernel program exits.
+ * Arena memory must hence never be passed on to the host or another kernel.
+ *
+ * Multiple Xentiums may execute the same kernel program image, so its .bss is
+ * shared between them. The allocator hence keeps no state of its own, but
+ * stores the free list in the command message of the Xentium, which the host
+ * allocates for every start of a kernel program. Requests to the host are sent
+ * via the same message.
  */
 
 
 #include <xen.h>
 #include <kernel/kmem.h>
 
-	
-/* make sure this exists in actual memory, i.e. in .bss */
-static struct xen_msg_data msg_data;
 
+/* arena allocations are aligned to this boundary */
+#define XEN_KMEM_ALIGN		8
 
+#define XEN_KMEM_ROUND(x)	(((x) + XEN_KMEM_ALIGN - 1) & \
+				 ~((size_t) XEN_KMEM_ALIGN - 1))
 
+/* the header of an arena chunk */
+struct xen_kmem_chunk {
+	size_t size;			/* usable bytes following the header */
+	struct xen_kmem_chunk *next;	/* the next free chunk */
+};
 
+#define XEN_KMEM_HDR		XEN_KMEM_ROUND(sizeof(struct xen_kmem_chunk))
 
 
 /**
- * @brief perform memory allocation via host processor
+ * @brief get the command message of this Xentium
+ */
+
+static struct xen_msg_data *xen_kmem_get_msg(void)
+{
+	return (struct xen_msg_data *) xen_get_mail(XEN_CMD_MBOX);
+}
+
+
+/**
+ * @brief set up the local allocation arena
+ *
+ * @param m the command message carrying the arena
+ *
+ * @note the arena is not reset if it is already in use
+ */
+
+void xen_kmem_init(struct xen_msg_data *m)
+{
+	size_t size;
+
+	char *p;
+
+
+	if (!m)
+		return;
+
+	if (m->arena_ready)
+		return;
+
+	m->arena_ready = 1;
+	m->arena_free  = NULL;
+
+	if (!m->arena)
+		return;
+
+	p    = (char *) XEN_KMEM_ROUND((unsigned long) m->arena);
+	size = m->arena_size;
+
+	/* too small to be of any use */
+	if (size < XEN_KMEM_HDR + 2 * XEN_KMEM_ALIGN)
+		return;
+
+	size -= p - (char *) m->arena;
+
+	m->arena_free = (struct xen_kmem_chunk *) p;
+	m->arena_free->size = (size - XEN_KMEM_HDR) & ~(XEN_KMEM_ALIGN - 1);
+	m->arena_free->next = NULL;
+}
+
+
+/**
+ * @brief check if a pointer was allocated from the arena
+ */
+
+static int xen_kmem_in_arena(struct xen_msg_data *m, void *ptr)
+{
+	char *p = ptr;
+
+
+	if (!m->arena)
+		return 0;
+
+	if (p < (char *) m->arena)
+		return 0;
+
+	if (p >= (char *) m->arena + m->arena_size)
+		return 0;
+
+	return 1;
+}
+
+
+/**
+ * @brief allocate from the arena
+ *
+ * @returns a pointer to the allocated memory or NULL if no space is left
+ */
+
+static void *xen_kmem_alloc(struct xen_msg_data *m, size_t size)
+{
+	struct xen_kmem_chunk *c;
+	struct xen_kmem_chunk *n;
+	struct xen_kmem_chunk **prev;
+
+
+	size = XEN_KMEM_ROUND(size);
+
+	for (prev = &m->arena_free; (c = *prev); prev = &c->next) {
+
+		if (c->size < size)
+			continue;
+
+		/* split the chunk if the remainder is usable */
+		if (c->size >= size + XEN_KMEM_HDR + XEN_KMEM_ALIGN) {
+			n = (struct xen_kmem_chunk *)
+				((char *) c + XEN_KMEM_HDR + size);
+
+			n->size = c->size - size - XEN_KMEM_HDR;
+			n->next = c->next;
+
+			c->size = size;
+			*prev   = n;
+		} else {
+			*prev = c->next;
+		}
+
+		c->next = NULL;
+
+		return (char *) c + XEN_KMEM_HDR;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief return a chunk to the arena and merge it with adjacent free chunks
+ */
+
+static void xen_kmem_release(struct xen_msg_data *m, void *ptr)
+{
+	struct xen_kmem_chunk *c;
+	struct xen_kmem_chunk *p = NULL;
+	struct xen_kmem_chunk *n;
+
+
+	c = (struct xen_kmem_chunk *) ((char *) ptr - XEN_KMEM_HDR);
+
+	/* the free list is ordered by address */
+	for (n = m->arena_free; n && n < c; n = n->next)
+		p = n;
+
+	c->next = n;
+
+	if (p)
+		p->next = c;
+	else
+		m->arena_free = c;
+
+	if (n && ((char *) c + XEN_KMEM_HDR + c->size == (char *) n)) {
+		c->size += XEN_KMEM_HDR + n->size;
+		c->next  = n->next;
+	}
+
+	if (p && ((char *) p + XEN_KMEM_HDR + p->size == (char *) c)) {
+		p->size += XEN_KMEM_HDR + c->size;
+		p->next  = c->next;
+	}
+}
+
+
+/**
+ * @brief pass a kmem request to the host processor
+ *
+ * @note the command of the message is restored, as the kernel program may
+ *	 already have set its reply
  *
  * @todo no error checking/handling
  */
 
+static void xen_kmem_host_req(struct xen_msg_data *m, enum xen_cmd cmd)
+{
+	enum xen_cmd tmp;
+
+
+	tmp = m->cmd;
+
+	m->cmd = cmd;
+
+	xen_send_msg(m);
+
+	xen_wait_cmd();
+
+	m->cmd = tmp;
+}
+
+
+/**
+ * @brief perform memory allocation via host processor
+ */
+
+static void *xen_kmem_host_alloc(struct xen_msg_data *m, size_t size,
+				 enum xen_cmd cmd)
+{
+	m->size = size;
+
+	xen_kmem_host_req(m, cmd);
+
+	return m->ptr;
+}
+
+
+/**
+ * @brief perform memory allocation and clear the buffer
+ */
+
 void *kzalloc(size_t size)
 {
-	struct xen_msg_data *m = &msg_data;
+	size_t i;
+	char *p;
+
+	struct xen_msg_data *m;
+
 
 	if (!size)
 		return NULL;
 
-	m->size = size;
-	m->cmd = TASK_KZALLOC;
+	m = xen_kmem_get_msg();
+	if (!m)
+		return NULL;
 
-	xen_send_msg(m);
-	
-	m = xen_wait_cmd();
+	p = xen_kmem_alloc(m, size);
+	if (!p)
+		return xen_kmem_host_alloc(m, size, TASK_KZALLOC);
 
-	return m->ptr;
+	for (i = 0; i < size; i++)
+		p[i] = 0;
+
+	return p;
 }
 
 
 /**
- * @brief perform memory allocation via host processor
- *
- * @todo no error checking/handling
+ * @brief perform memory allocation
  */
 
 void *kmalloc(size_t size)
 {
-	struct xen_msg_data *m = &msg_data;
+	void *p;
+
+	struct xen_msg_data *m;
+
 
 	if (!size)
 		return NULL;
 
-	m->size = size;
-	m->cmd = TASK_KMALLOC;
+	m = xen_kmem_get_msg();
+	if (!m)
+		return NULL;
 
-	xen_send_msg(m);
-	
-	m = xen_wait_cmd();
+	p = xen_kmem_alloc(m, size);
+	if (!p)
+		return xen_kmem_host_alloc(m, size, TASK_KMALLOC);
 
-	return m->ptr;
+	return p;
 }
 
 
 /**
- * @brief perform memory deallocation via host processor
+ * @brief perform memory deallocation
  *
  * @todo no error checking/handling
  */
 
 void kfree(void *ptr)
 {
-	struct xen_msg_data *m = &msg_data;
+	struct xen_msg_data *m;
 
 
 	if (!ptr)
 		return;
 
-	m->ptr = ptr;
-	m->cmd = TASK_KFREE;
+	m = xen_kmem_get_msg();
+	if (!m)
+		return;
 
-	xen_send_msg(m);
-	
-	xen_wait_cmd();
+	if (xen_kmem_in_arena(m, ptr)) {
+		xen_kmem_release(m, ptr);
+		return;
+	}
+
+	m->ptr = ptr;
 
-	return;
+	xen_kmem_host_req(m, TASK_KFREE);
 }
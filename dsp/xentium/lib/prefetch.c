@@ -0,0 +1,186 @@
+/**
+ * @file dsp/xentium/lib/prefetch.c
+ *
+ * @ingroup xen
+ *
+ * @brief double-buffered prefetch of task data into the local TCM
+ *
+ * The host passes the next task of a node along with the current one
+ * (see struct xen_msg_data). While a kernel processes the data of the current
+ * task in one TCM bank, the data of the next task is transferred into a
+ * second bank in the background, so the Xentium does not have to wait for the
+ * input DMA when it receives the next task.
+ *
+ * A kernel sets up the pair of banks to alternate between when it starts
+ *
+ * @code{.c}
+ *	struct xen_prefetch p;
+ *
+ *	xen_prefetch_init(&p, 0, 1);
+ * @endcode
+ *
+ * and retrieves the data of each task via
+ *
+ * @code{.c}
+ *	buf = xen_prefetch_task(&p, m, &n);
+ * @endcode
+ *
+ * The task data are interpreted as an array of 32 bit words of length
+ * pt_get_nmemb(), clipped to the size of the data buffer.
+ *
+ * @note the prefetch state must not be static, as parallel instances of a
+ *	 kernel execute the same image, so keep it on the stack of main()
+ *
+ * @note Any transfer requested via xen_noc_dma_req_xfer() waits for the
+ *	 prefetch to complete, since it uses the same DMA channel. Kernels
+ *	 must not modify the prefetch bank.
+ */
+
+#include <xen.h>
+#include <dma.h>
+#include <prefetch.h>
+#include <data_proc_task.h>
+
+
+#define PREFETCH_MTU	256	/* arbitrary DMA packet size */
+
+
+/**
+ * @brief get the number of words to transfer for a task
+ */
+
+static size_t xen_prefetch_words(struct proc_task *t)
+{
+	size_t n;
+
+
+	n = pt_get_nmemb(t);
+
+	if (n > pt_get_size(t) / sizeof(uint32_t))
+		n = pt_get_size(t) / sizeof(uint32_t);
+
+	return n;
+}
+
+
+/**
+ * @brief get the local address of a TCM bank
+ */
+
+static void *xen_prefetch_bank_local(size_t bank)
+{
+	return (void *) ((char *) xen_tcm_local + bank * XEN_TCM_BANK_SIZE);
+}
+
+
+/**
+ * @brief get the external address of a TCM bank for DMA transfers
+ */
+
+static void *xen_prefetch_bank_ext(struct xen_msg_data *m, size_t bank)
+{
+	return (void *) ((char *) xen_get_base_addr(m->xen_id)
+			 + bank * XEN_TCM_BANK_SIZE);
+}
+
+
+/**
+ * @brief get the external address of a location in the local TCM
+ *
+ * @param m the message received from the host
+ * @param buf a local TCM address, e.g. as returned by xen_prefetch_task()
+ *
+ * @returns the address to use in DMA transfers
+ */
+
+void *xen_prefetch_ext(struct xen_msg_data *m, void *buf)
+{
+	return (void *) ((char *) xen_get_base_addr(m->xen_id)
+			 + ((char *) buf - (char *) xen_tcm_local));
+}
+
+
+/**
+ * @brief initialise the prefetch state
+ *
+ * @param p a struct xen_prefetch
+ * @param bank0 the index of the first TCM bank to use
+ * @param bank1 the index of the second TCM bank to use
+ */
+
+void xen_prefetch_init(struct xen_prefetch *p, size_t bank0, size_t bank1)
+{
+	p->t       = NULL;
+	p->n       = 0;
+	p->bank[0] = bank0;
+	p->bank[1] = bank1;
+	p->idx     = 0;
+}
+
+
+/**
+ * @brief get the data of the current task and prefetch the next one
+ *
+ * @param p a struct xen_prefetch
+ * @param m the message received from the host
+ * @param n a pointer to store the number of words of the task data to
+ *
+ * @returns the local address of the task data or NULL if the data of the
+ *	    current task do not fit into a single bank
+ *
+ * @note if NULL is returned, the kernel must transfer the task data itself,
+ *	 no prefetch is started in this case
+ */
+
+void *xen_prefetch_task(struct xen_prefetch *p, struct xen_msg_data *m,
+			size_t *n)
+{
+	size_t cur;
+
+	const size_t max = XEN_TCM_BANK_SIZE / sizeof(uint32_t);
+
+
+	if (!m->t)
+		return NULL;
+
+	/* the previous prefetch, if any, must be complete */
+	xen_noc_dma_wait(m->dma);
+
+	if (p->t && p->t == m->t) {
+		/* hit, the data are already in place */
+		cur  = p->idx;
+		(*n) = p->n;
+	} else {
+		cur  = p->idx ^ 1;
+		(*n) = xen_prefetch_words(m->t);
+
+		p->t = NULL;
+
+		if ((*n) > max)
+			return NULL;
+
+		if (*n)
+			xen_noc_dma_req_lin_xfer(m->dma, pt_get_data(m->t),
+						 xen_prefetch_bank_ext(m, p->bank[cur]),
+						 (*n), WORD, LOW, PREFETCH_MTU);
+	}
+
+	/* start the transfer of the next task into the other bank */
+	p->t   = NULL;
+	p->idx = cur ^ 1;
+
+	if (m->t_next) {
+
+		p->n = xen_prefetch_words(m->t_next);
+
+		if (p->n && p->n <= max) {
+			if (!xen_noc_dma_start_lin_xfer(m->dma,
+					pt_get_data(m->t_next),
+					xen_prefetch_bank_ext(m, p->bank[p->idx]),
+					p->n, WORD, LOW, PREFETCH_MTU))
+				p->t = m->t_next;
+		}
+	}
+
+	return xen_prefetch_bank_local(p->bank[cur]);
+}
@@ -8,6 +8,7 @@
  */
 
 #include <xen.h>
+#include <dma.h>
 #include <xentium_intrinsics.h>
 
 
@@ -66,6 +67,12 @@ struct xen_msg_data *xen_wait_cmd(void)
 
 	m = (struct xen_msg_data *) xen_get_mail(XEN_CMD_MBOX);
 
+	/* the first command of a kernel program carries the kmem arena */
+	xen_kmem_init(m);
+
+	/* DMA transfers are counted from here to the next message */
+	m->dma_bytes = 0;
+
 	return m;
 }
 
@@ -32,7 +32,7 @@ struct proc_net;
 
 
 int pt_track_execute_next(struct proc_tracker *pt);
-void pn_input_task(struct proc_net *pn, struct proc_task *t);
+int pn_input_task(struct proc_net *pn, struct proc_task *t);
 void pn_queue_critical_trackers(struct proc_net *pn);
 struct proc_tracker *pn_get_next_pending_tracker(struct proc_net *pn);
 struct proc_task *pn_get_next_pending_task(struct proc_tracker *pt);
@@ -46,10 +46,21 @@ int pn_eval_task_status(struct proc_net *pn, struct proc_tracker *pt,
 int pn_process_next(struct proc_net *pn);
 int pn_process_inputs(struct proc_net *pn);
 int pn_process_outputs(struct proc_net *pn);
+int pn_process_outputs_seq(struct proc_net *pn, unsigned long seq_lim);
+int pn_get_outputs(struct proc_net *pn, struct list_head *list);
+int pn_get_outputs_seq(struct proc_net *pn, unsigned long seq_lim,
+		       struct list_head *list);
+int pn_process_output_list(struct proc_net *pn, struct list_head *list);
+int pn_get_seq_min(struct proc_net *pn, unsigned long *seq);
 
 int pn_create_output_node(struct proc_net *pn, op_func_t op);
+int pn_create_input_ring(struct proc_net *pn, size_t ring_size, size_t n_lanes);
 int pn_add_node(struct proc_net *pn, struct proc_tracker *pt);
 struct proc_net *pn_create(void);
 void pn_destroy(struct proc_net *pn);
 
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+int pn_sysctl_add(struct proc_net *pn, const char *name);
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
 #endif /* _DATA_PROC_NET_H_ */
@@ -7,6 +7,7 @@
 
 #include <kernel/types.h>
 #include <list.h>
+#include <kernel/time.h>
 
 
 struct proc_step {
@@ -33,6 +34,16 @@ struct proc_task {
 	unsigned long type;
 	unsigned long seq;
 	struct list_head node;	/* to be used for external tracking */
+
+	struct proc_task *parent;	/* the parent of a split task */
+	size_t n_child;			/* number of children of a split task */
+	size_t n_child_done;		/* number of children merged */
+	size_t n_child_err;		/* number of children destroyed */
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	ktime t_in;		/* time of entry into a processing network */
+	ktime t_track;		/* time of entry into the current tracker */
+#endif
 };
 
 
@@ -55,6 +66,10 @@ void *pt_get_pend_step_op_info(struct proc_task *t);
 int pt_add_step(struct proc_task *t,
 		       unsigned long op_code, void *op_info);
 
+size_t pt_count_pend_steps(struct proc_task *t, unsigned long last);
+int pt_copy_pend_steps(struct proc_task *dst, struct proc_task *src,
+		       unsigned long last);
+
 
 size_t pt_get_nmemb(struct proc_task *t);
 size_t pt_get_size(struct proc_task *t);
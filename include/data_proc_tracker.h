@@ -9,6 +9,8 @@
 
 #include <kernel/types.h>
 #include <list.h>
+#include <kernel/time.h>
+#include <kernel/sysctl.h>
 #include <data_proc_task.h>
 
 /**
@@ -16,6 +18,54 @@
  */
 typedef int (*op_func_t)(unsigned long op_code, struct proc_task *);
 
+/**
+ * the batched operator function type associated with a processing tracker;
+ * it is handed an array of n tasks and must store the op return code
+ * of each task in the corresponding element of ret, it returns the number of
+ * tasks processed
+ */
+typedef int (*op_batch_func_t)(unsigned long op_code, struct proc_task **tasks,
+			       size_t n, int *ret);
+
+/* tracker node types */
+#define PT_NODE_DEFAULT	0	/* executes its op function on tasks */
+#define PT_NODE_SPLIT	1	/* splits tasks into child tasks */
+#define PT_NODE_MERGE	2	/* merges child tasks into their parent */
+
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+/**
+ * @struct the tracker statistics block
+ */
+struct proc_tracker_stats {
+	unsigned long tasks_in;		/*!< tasks added to the tracker */
+	unsigned long tasks_out;	/*!< tasks removed from the tracker */
+	unsigned long n_tasks_max;	/*!< queue depth high-watermark */
+
+	unsigned long op_calls;		/*!< number of op function calls */
+	ktime op_time;			/*!< cumulative op function time */
+
+	unsigned long lat_cnt;		/*!< number of latency samples */
+	ktime lat_min;			/*!< minimum end-to-end task latency */
+	ktime lat_max;			/*!< maximum end-to-end task latency */
+	ktime lat_sum;			/*!< cumulative end-to-end latency */
+
+	struct sysobj sobj;		/*!< the sysctl object of the tracker */
+};
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
+
+/**
+ * @struct a single-producer/single-consumer task ring lane
+ */
+struct proc_tracker_ring {
+	struct proc_task **slot;	/*!< the task slots, power of two */
+	uint32_t mask;			/*!< the slot index mask */
+	uint32_t head;			/*!< written by the producer only */
+	uint32_t tail;			/*!< written by the consumer only */
+};
+
+
 /**
  * @struct the data processing tracker structure
  */
@@ -29,9 +79,29 @@ struct proc_tracker {
 
 	op_func_t op;		/*!< the operator function of this tracker */
 
+	op_batch_func_t op_batch;	/*!< the batched operator function,
+					     NULL if not a batch tracker */
+	size_t batch_size;	/*!< the maximum number of tasks per batch */
+	struct proc_task **batch;	/*!< the batch task gather buffer */
+	int *batch_ret;		/*!< the batch return code buffer */
+
+	int node_type;		/*!< the node type of the tracker */
+	size_t n_split;		/*!< the number of children per split task */
+	unsigned long merge_op_code;	/*!< the op code of the merge node
+					     of a split node */
+
+	struct proc_tracker_ring *ring;	/*!< the lock-free ring lanes,
+					     NULL if list-backed */
+	size_t n_lanes;		/*!< the number of ring lanes */
+	size_t lane_next;	/*!< the next lane to be polled by the
+				     consumer */
 
 	struct list_head node;	/*!< may be used for external tracking of this
 				   tracker */
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	struct proc_tracker_stats stats;	/*!< usage statistics */
+#endif
 };
 
 
@@ -48,16 +118,58 @@ int pt_track_put(struct proc_tracker *pt, struct proc_task *t);
 
 int pt_track_put_force(struct proc_tracker *pt, struct proc_task *t);
 
+int pt_track_put_head(struct proc_tracker *pt, struct proc_task *t);
+
 int pt_track_pending(struct proc_tracker *pt);
 
 struct proc_task *pt_track_get(struct proc_tracker *pt);
 
+size_t pt_track_get_batch(struct proc_tracker *pt);
+
+int pt_track_is_batch(struct proc_tracker *pt);
+
+int pt_track_is_ring(struct proc_tracker *pt);
+
 void pt_track_sort_seq(struct proc_tracker *pt);
 
+int pt_track_get_seq_min(struct proc_tracker *pt, unsigned long *seq);
+
+struct proc_task *pt_track_peek(struct proc_tracker *pt);
+
 struct proc_tracker *pt_track_create(op_func_t op, unsigned long op_code,
 				     size_t n_tasks_crit);
 
+struct proc_tracker *pt_track_create_batch(op_batch_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit,
+					   size_t batch_size);
+
+struct proc_tracker *pt_track_create_ring(op_func_t op,
+					  unsigned long op_code,
+					  size_t n_tasks_crit,
+					  size_t ring_size,
+					  size_t n_lanes);
+
 void pt_track_destroy(struct proc_tracker *pt);
 
+struct proc_tracker *pt_track_create_split(op_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit,
+					   size_t n_split,
+					   unsigned long merge_op_code);
+
+struct proc_tracker *pt_track_create_merge(op_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit);
+
+int pt_track_get_node_type(struct proc_tracker *pt);
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+void pt_track_stats_op_time(struct proc_tracker *pt, ktime start);
+void pt_track_stats_latency(struct proc_tracker *pt, struct proc_task *t);
+int pt_track_sysctl_add(struct proc_tracker *pt, struct sysset *sset,
+			const char *name);
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
 
 #endif /* _DATA_PROC_TRACKER_H_ */
@@ -24,6 +24,8 @@
 #include <compiler.h>
 #include <kernel/types.h>
 #include <kernel/sysctl.h>
+#include <kernel/time.h>
+#include <data_proc_task.h>
 
 /**
  * core addresses and IRQs in the GR712
@@ -276,6 +278,9 @@
 /* Maximum number of RX Descriptors */
 #define GRSPW2_RX_DESCRIPTORS				  128
 
+/* Maximum number of ports of a software router, see grspw2_router_init() */
+#define GRSPW2_ROUTER_PORTS				    6
+
 #define GRSPW2_RX_DESC_SIZE				    8
 #define GRSPW2_TX_DESC_SIZE				   16
 
@@ -320,6 +325,18 @@
 #define GRSPW2_TX_DESC_WR	0x00002000
 /* packet interrupt enabled    */
 #define GRSPW2_TX_DESC_IE	0x00004000
+/* append header CRC           */
+#define GRSPW2_TX_DESC_HC	0x00010000
+/* append data CRC             */
+#define GRSPW2_TX_DESC_DC	0x00020000
+
+/* leading header bytes excluded from the header CRC */
+#define GRSPW2_TX_DESC_NON_CRC_BIT	8
+#define GRSPW2_TX_DESC_NON_CRC_MASK	0x00000F00
+#define GRSPW2_TX_DESC_HDR_SIZE_MASK	0x000000FF
+
+/* the data size field of the second descriptor word */
+#define GRSPW2_TX_DESC_DATA_SIZE_MASK	0x00FFFFFF
 
 
 
@@ -333,17 +350,29 @@ struct grspw2_dma_regs {
 	uint32_t rx_max_pkt_len;
 	union {
 		struct {
+#if defined(__BIG_ENDIAN_BITFIELD)
 			uint32_t tx_desc_base_addr:22;
 			uint32_t tx_desc_sel:6;
 			uint32_t reserved0:4;
+#else
+			uint32_t reserved0:4;
+			uint32_t tx_desc_sel:6;
+			uint32_t tx_desc_base_addr:22;
+#endif
 		};
 		uint32_t tx_desc_table_addr;
 	};
 	union {
 		struct {
+#if defined(__BIG_ENDIAN_BITFIELD)
 			uint32_t rx_desc_base_addr:22;
 			uint32_t rx_desc_sel:7;
 			uint32_t reserved1:3;
+#else
+			uint32_t reserved1:3;
+			uint32_t rx_desc_sel:7;
+			uint32_t rx_desc_base_addr:22;
+#endif
 		};
 		uint32_t rx_desc_table_addr;
 	};
@@ -366,12 +395,17 @@ struct grspw2_regs {
 
 /**
  * GRSPW2 RX descriptor word layout, see GR712-UM, p. 112
+ *
+ * @note the bit field order of the register and descriptor layouts is
+ *	 reversed on little endian hosts, so the fields match the bit masks
+ *	 above when the driver is run in the host emulation
  */
 
 __extension__
 struct grspw2_rx_desc {
 	union {
 		struct {
+#if defined(__BIG_ENDIAN_BITFIELD)
 			uint32_t truncated       : 1;
 			uint32_t crc_error_data  : 1;
 			uint32_t crc_error_header: 1;
@@ -380,6 +414,16 @@ struct grspw2_rx_desc {
 			uint32_t wrap            : 1;
 			uint32_t enable          : 1;
 			uint32_t pkt_size        :25;
+#else
+			uint32_t pkt_size        :25;
+			uint32_t enable          : 1;
+			uint32_t wrap            : 1;
+			uint32_t interrupt_enable: 1;
+			uint32_t EEP_termination : 1;
+			uint32_t crc_error_header: 1;
+			uint32_t crc_error_data  : 1;
+			uint32_t truncated       : 1;
+#endif
 		};
 		uint32_t pkt_ctrl;
 	};
@@ -403,6 +447,7 @@ __extension__
 struct grspw2_tx_desc {
 	union {
 		struct {
+#if defined(__BIG_ENDIAN_BITFIELD)
 			uint32_t reserved1        :14;
 			uint32_t append_data_crc  : 1;
 			uint32_t append_header_crc: 1;
@@ -412,6 +457,17 @@ struct grspw2_tx_desc {
 			uint32_t enable           : 1;
 			uint32_t non_crc_bytes    : 4;
 			uint32_t hdr_size         : 8;
+#else
+			uint32_t hdr_size         : 8;
+			uint32_t non_crc_bytes    : 4;
+			uint32_t enable           : 1;
+			uint32_t wrap             : 1;
+			uint32_t interrupt_enable : 1;
+			uint32_t link_error       : 1;
+			uint32_t append_header_crc: 1;
+			uint32_t append_data_crc  : 1;
+			uint32_t reserved1        :14;
+#endif
 		};
 		uint32_t pkt_ctrl;
 	};
@@ -420,8 +476,13 @@ struct grspw2_tx_desc {
 
 	union {
 		struct {
+#if defined(__BIG_ENDIAN_BITFIELD)
 			uint32_t reserved2      : 8;
 			uint32_t data_size      :24;
+#else
+			uint32_t data_size      :24;
+			uint32_t reserved2      : 8;
+#endif
 		};
 		uint32_t data_size_reg;
 	};
@@ -451,10 +512,258 @@ struct grspw2_rx_desc_ring_elem {
 struct grspw2_tx_desc_ring_elem {
 	struct grspw2_tx_desc	*desc;
 	struct list_head	 node;
+
+	/* zero-copy transmission, see grspw2_add_pkt_ref() */
+	bool			 ref;		/* references caller buffers */
+	bool			 notify;	/* run the tx_done callback */
+	void			*cookie;	/* passed to the tx_done callback */
+	uint32_t		 hdr_addr;	/* the descriptor's own buffers */
+	uint32_t		 data_addr;
+};
+
+
+struct grspw2_core_cfg;
+
+/**
+ * called once the core is done with the buffers of a packet added via
+ * grspw2_add_pkt_ref(), so they may be reused or released
+ */
+
+typedef void (*grspw2_tx_done_t)(struct grspw2_core_cfg *cfg,
+				 void *cookie, void *userdata);
+
+
+
+/**
+ * a packet receive buffer, see grspw2_get_pkts()
+ */
+
+struct grspw2_pkt_buf {
+	uint8_t *pkt;
+	uint32_t size;	/* size of the buffer */
+	uint32_t len;	/* size of the received packet */
+};
+
+
+/**
+ * a packet to transmit, see grspw2_add_pkts()
+ */
+
+struct grspw2_pkt_vec {
+	const void *hdr;
+	uint32_t    hdr_size;
+	const void *data;
+	uint32_t    data_size;
+};
+
+
+
+/**
+ * a packet buffer forwarded without copying, see grspw2_router_route_port()
+ */
+
+struct grspw2_router_ref {
+	struct grspw2_core_cfg *src;	/* the core the buffer was loaned from */
+	void *pkt;
+};
+
+
+/**
+ * a software router port
+ */
+
+struct grspw2_router;
+
+struct grspw2_router_port {
+	struct grspw2_router *rt;
+	struct grspw2_core_cfg *cfg;
+
+	/* buffers loaned to the TX descriptors of this port, since these
+	 * complete in order, this is used as a ring
+	 */
+	struct grspw2_router_ref ref[GRSPW2_TX_DESCRIPTORS];
+	uint32_t ref_idx;
+
+	/* the input ports stalled on this output, by bit */
+	uint32_t waiting;
+};
+
+
+/**
+ * a software SpaceWire router
+ */
+
+struct grspw2_router {
+
+	uint32_t n_ports;
+	struct grspw2_router_port port[GRSPW2_ROUTER_PORTS];
+
+	/* logical address routing table; port 0 (the configuration port)
+	 * is unused, so packets with unrouted logical addresses are dropped
+	 */
+	struct {
+		uint8_t port;
+		uint8_t strip;	/* delete the address byte */
+	} lut[256];
+
+	int irq;
+
+	uint32_t routed;
+	uint32_t dropped;
+	uint32_t stalled;
 };
 
 
 
+/**
+ * RMAP protocol definitions, see ECSS-E-ST-50-52C
+ */
+
+#define GRSPW2_RMAP_PROTOCOL_ID		0x01
+
+/* instruction field */
+#define GRSPW2_RMAP_INS_CMD		0x40
+#define GRSPW2_RMAP_INS_WRITE		0x20
+#define GRSPW2_RMAP_INS_VERIFY		0x10
+#define GRSPW2_RMAP_INS_REPLY		0x08
+#define GRSPW2_RMAP_INS_INC		0x04
+#define GRSPW2_RMAP_INS_RAL_MASK	0x03
+
+/* command header size without the reply address, including the CRC */
+#define GRSPW2_RMAP_CMD_HDR_SIZE	16
+
+/* reply header sizes, excluding the CRC */
+#define GRSPW2_RMAP_WRITE_REPLY_SIZE	 7
+#define GRSPW2_RMAP_READ_REPLY_SIZE	11
+
+/* status codes */
+#define GRSPW2_RMAP_SUCCESS		 0
+#define GRSPW2_RMAP_ERR_GENERAL		 1
+#define GRSPW2_RMAP_ERR_UNUSED		 2
+#define GRSPW2_RMAP_ERR_KEY		 3
+#define GRSPW2_RMAP_ERR_DATA_CRC	 4
+#define GRSPW2_RMAP_ERR_EOP		 5
+#define GRSPW2_RMAP_ERR_TOO_MUCH_DATA	 6
+#define GRSPW2_RMAP_ERR_EEP		 7
+#define GRSPW2_RMAP_ERR_VERIFY		 9
+#define GRSPW2_RMAP_ERR_AUTH		10
+#define GRSPW2_RMAP_ERR_RMW_LEN		11
+#define GRSPW2_RMAP_ERR_TLA		12
+
+
+/* access rules of an RMAP target memory window */
+#define GRSPW2_RMAP_ACC_READ		0x1
+#define GRSPW2_RMAP_ACC_WRITE		0x2
+#define GRSPW2_RMAP_ACC_RMW		0x4
+#define GRSPW2_RMAP_ACC_WORD		0x8	/* word-aligned accesses only */
+
+#define GRSPW2_RMAP_WINDOWS		8
+
+/* reply address, read reply header and RMW reply data of a reply */
+#define GRSPW2_RMAP_REPLY_SIZE		32
+#define GRSPW2_RMAP_REPLY_DATA		24
+
+
+struct grspw2_rmap_window;
+
+/**
+ * called after a window was modified by an RMAP write or RMW command
+ */
+
+typedef void (*grspw2_rmap_written_t)(struct grspw2_rmap_window *win,
+				      uint32_t offset, uint32_t len,
+				      void *userdata);
+
+/**
+ * a memory window of an RMAP target
+ */
+
+struct grspw2_rmap_window {
+	uint8_t  ext;		/* extended address */
+	uint32_t addr;		/* first RMAP address of the window */
+	uint32_t size;
+	uint8_t  *mem;		/* the local memory backing the window */
+	uint32_t acc;		/* access rules */
+
+	grspw2_rmap_written_t written;
+	void *userdata;
+};
+
+
+/**
+ * a software RMAP target
+ */
+
+struct grspw2_rmap_target {
+	struct grspw2_core_cfg *cfg;
+
+	uint8_t tla;		/* target logical address */
+	uint8_t key;
+
+	uint32_t n_win;
+	struct grspw2_rmap_window win[GRSPW2_RMAP_WINDOWS];
+
+	/* reply headers; the TX descriptors complete in order, so this is
+	 * used as a ring
+	 */
+	uint8_t reply[GRSPW2_TX_DESCRIPTORS][GRSPW2_RMAP_REPLY_SIZE];
+	uint32_t reply_idx;
+
+	int irq;
+	int waiting;	/* stalled on the TX ring in interrupt mode */
+
+	uint32_t reads;
+	uint32_t writes;
+	uint32_t rmws;
+	uint32_t errors;	/* commands answered with an error status */
+	uint32_t discarded;	/* commands with a corrupt header */
+	uint32_t stalled;
+};
+
+
+
+/**
+ * per-link statistics, cleared by grspw2_core_init() or by writing to the
+ * respective sysctl attribute
+ */
+
+struct grspw2_stats {
+	uint32_t rx_pkts;		/* packets taken from the RX ring */
+	uint32_t tx_pkts;		/* packets added to the TX ring */
+	uint32_t rx_dropped;		/* packets dropped by the user */
+	uint32_t rx_auto_dropped;	/* packets dropped in auto-drop mode */
+	uint32_t rx_eep;		/* packets terminated by an EEP */
+	uint32_t rx_truncated;		/* packets longer than the MTU */
+
+	uint32_t err_credit;
+	uint32_t err_parity;
+	uint32_t err_escape;
+	uint32_t err_disconnect;
+	uint32_t err_invalid_addr;
+
+	uint32_t tx_desc_unavail;	/* packets refused for lack of a
+					 * free TX descriptor
+					 */
+
+	uint32_t rx_desc_hwm;		/* max. packets pending in RX ring */
+	uint32_t tx_desc_hwm;		/* max. descriptors used in TX ring */
+};
+
+
+/**
+ * the geometry of the descriptor rings and buffers of a link, see
+ * grspw2_core_alloc()
+ */
+
+struct grspw2_ring_cfg {
+	uint32_t rx_desc;		/* number of RX descriptors */
+	uint32_t tx_desc;		/* number of TX descriptors */
+	uint32_t rx_mtu;		/* size of an RX packet buffer */
+	uint32_t tx_mtu;		/* size of a TX data buffer */
+	uint32_t tx_hdr_size;		/* size of a TX header buffer */
+};
+
+
 /**
  * grspw2 core configuration structure
  * since we are not able to malloc(), it's easiest to create our lists on
@@ -479,11 +788,27 @@ struct grspw2_core_cfg {
 	uint32_t rx_bytes;
 	uint32_t tx_bytes;
 
+	struct grspw2_stats stats;
+
 	/* irq-driven packet drop mode */
 	int auto_drop;
 	int n_drop;
 	uint8_t idx_drop;
 
+	/* irq-driven reception, see grspw2_rx_irq_enable() */
+	struct {
+		int enabled;
+		uint32_t coalesce;	/* packets per interrupt */
+		uint32_t timeout_us;	/* max. wait for a partial batch */
+		volatile uint32_t n;	/* packets completed at last irq */
+	} rx_irq;
+
+	/* kernel time discipline, see grspw2_time_sync_enable() */
+	struct {
+		int enabled;		/* 2 once a time code was received */
+		uint32_t timecnt;	/* last received time counter */
+	} time_sync;
+
 	struct sysobj sobj;
 
 	/* routing node, we currently support only one device and only
@@ -502,6 +827,12 @@ struct grspw2_core_cfg {
 	uint32_t rx_n_desc;
 	uint32_t tx_n_desc;
 
+	/* the current ring geometry; the memory is set if the tables and
+	 * buffers were allocated via grspw2_core_alloc()
+	 */
+	struct grspw2_ring_cfg ring;
+	void *ring_mem;
+
 	/**
 	 * we use two list heads for each descriptor type to manage active and
 	 * inactive descriptors
@@ -515,6 +846,24 @@ struct grspw2_core_cfg {
 	struct list_head		tx_desc_ring_used;
 	struct list_head		tx_desc_ring_free;
 
+	/* zero-copy transmit completion notification */
+	struct {
+		grspw2_tx_done_t cb;
+		void *userdata;
+	} tx_done;
+
+	/**
+	 * spare packet buffers used to replenish the RX ring while the
+	 * original descriptor buffers are loaned out in zero-copy mode
+	 */
+	struct {
+		uint32_t *buf;		/* stack of spare buffer addresses */
+		uint32_t n;		/* number of spare buffers available */
+		uint32_t n_max;		/* number of spare buffers in total */
+		uint32_t *loan;		/* buffers currently loaned out */
+		uint32_t n_loan;	/* number of buffers loaned out */
+	} rx_spare;
+
 	struct  {
 		uint32_t *rx_desc_tbl;
 		uint32_t *tx_desc_tbl;
@@ -549,12 +898,30 @@ uint32_t grspw2_get_num_free_tx_desc_avail(struct grspw2_core_cfg *cfg);
 uint32_t grspw2_get_num_free_rx_desc_avail(struct grspw2_core_cfg *cfg);
 
 uint32_t grspw2_get_pkt(struct grspw2_core_cfg *cfg, uint8_t *pkt);
+
+int32_t grspw2_rx_spare_pool_init(struct grspw2_core_cfg *cfg,
+				  uint8_t *pkt_buf, uint32_t pkt_size,
+				  uint32_t n_pkt);
+void *grspw2_loan_pkt(struct grspw2_core_cfg *cfg, uint32_t *pkt_size);
+int32_t grspw2_return_pkt(struct grspw2_core_cfg *cfg, void *pkt);
+struct proc_task *grspw2_get_pkt_task(struct grspw2_core_cfg *cfg,
+				      size_t steps, unsigned long type,
+				      unsigned long seq);
 uint32_t grspw2_drop_pkt(struct grspw2_core_cfg *cfg);
 uint32_t grspw2_get_next_pkt_size(struct grspw2_core_cfg *cfg);
 int grspw2_get_next_pkt_eep(struct grspw2_core_cfg *cfg);
 int grspw2_auto_drop_enable(struct grspw2_core_cfg *cfg, uint8_t n_drop);
 int grspw2_auto_drop_disable(struct grspw2_core_cfg *cfg);
 
+int32_t grspw2_get_pkts(struct grspw2_core_cfg *cfg,
+			struct grspw2_pkt_buf *buf, uint32_t n);
+
+int32_t grspw2_rx_irq_enable(struct grspw2_core_cfg *cfg,
+			     uint32_t coalesce, uint32_t timeout_us);
+int32_t grspw2_rx_irq_disable(struct grspw2_core_cfg *cfg);
+uint32_t grspw2_recv(struct grspw2_core_cfg *cfg, uint8_t *pkt,
+		     uint32_t timeout_us);
+
 void grspw2_tick_in(struct grspw2_core_cfg *cfg);
 uint32_t grspw2_get_timecnt(struct grspw2_core_cfg *cfg);
 uint32_t grspw2_get_link_status(struct grspw2_core_cfg *cfg);
@@ -562,16 +929,39 @@ uint32_t grspw2_get_link_status(struct grspw2_core_cfg *cfg);
 void grspw2_tick_out_interrupt_enable(struct grspw2_core_cfg *cfg);
 void grspw2_set_time_rx(struct grspw2_core_cfg *cfg);
 
+#ifdef CONFIG_TIME_SYNC
+int32_t grspw2_time_sync_enable(struct grspw2_core_cfg *cfg, ktime period);
+int32_t grspw2_time_sync_disable(struct grspw2_core_cfg *cfg);
+#endif /* CONFIG_TIME_SYNC */
+
 int32_t grspw2_add_pkt(struct grspw2_core_cfg *cfg,
 			const void *hdr,  uint32_t hdr_size,
 			const void *data, uint32_t data_size);
 
+int32_t grspw2_add_pkts(struct grspw2_core_cfg *cfg,
+			const struct grspw2_pkt_vec *iov, uint32_t n);
+
+int32_t grspw2_add_pkt_ref(struct grspw2_core_cfg *cfg,
+			   const void *hdr,  uint32_t hdr_size,
+			   const void *data, uint32_t data_size,
+			   void *cookie);
+
+void grspw2_set_tx_done_callback(struct grspw2_core_cfg *cfg,
+				 grspw2_tx_done_t cb, void *userdata);
+
+uint32_t grspw2_tx_reclaim(struct grspw2_core_cfg *cfg);
+
 int32_t grspw2_add_rmap(struct grspw2_core_cfg *cfg,
 			const void *hdr,  uint32_t hdr_size,
 			const uint8_t non_crc_bytes,
 			const void *data, uint32_t data_size);
 
 void grspw2_core_start(struct grspw2_core_cfg *cfg, int link_start, int auto_start);
+void grspw2_core_stop(struct grspw2_core_cfg *cfg);
+
+int32_t grspw2_core_alloc(struct grspw2_core_cfg *cfg,
+			  const struct grspw2_ring_cfg *ring);
+void grspw2_core_free(struct grspw2_core_cfg *cfg);
 
 
 int32_t grspw2_core_init(struct grspw2_core_cfg *cfg, uint32_t core_addr,
@@ -590,6 +980,28 @@ int32_t grspw2_route(void *userdata);
 
 int32_t grspw2_disable_routing(struct grspw2_core_cfg *cfg);
 
+void grspw2_router_init(struct grspw2_router *rt);
+int32_t grspw2_router_add_port(struct grspw2_router *rt,
+			       struct grspw2_core_cfg *cfg);
+int32_t grspw2_router_set_route(struct grspw2_router *rt, uint8_t addr,
+				uint8_t port, uint8_t strip);
+uint32_t grspw2_router_route_port(struct grspw2_router_port *port);
+uint32_t grspw2_router_poll(struct grspw2_router *rt);
+int32_t grspw2_router_enable_irq(struct grspw2_router *rt);
+int32_t grspw2_router_disable_irq(struct grspw2_router *rt);
+
+int32_t grspw2_rmap_target_init(struct grspw2_rmap_target *tgt,
+				struct grspw2_core_cfg *cfg,
+				uint8_t tla, uint8_t key);
+int32_t grspw2_rmap_target_add_window(struct grspw2_rmap_target *tgt,
+				      uint8_t ext, uint32_t addr,
+				      void *mem, uint32_t size, uint32_t acc,
+				      grspw2_rmap_written_t written,
+				      void *userdata);
+uint32_t grspw2_rmap_target_poll(struct grspw2_rmap_target *tgt);
+int32_t grspw2_rmap_target_enable_irq(struct grspw2_rmap_target *tgt);
+int32_t grspw2_rmap_target_disable_irq(struct grspw2_rmap_target *tgt);
+
 void set_gr712_spw_clock(void);
 
 
@@ -611,6 +1023,9 @@ void grspw2_spw_hardreset(struct grspw2_regs *regs);
 #define GRSPW2_OP_GET_NEXT_PKT_EEP	7
 #define GRSPW2_OP_AUTO_DROP_ENABLE	8
 #define GRSPW2_OP_AUTO_DROP_DISABLE	9
+#define GRSPW2_OP_ADD_PKTS		10
+#define GRSPW2_OP_RECV			11
+#define GRSPW2_OP_GET_PKTS		12
 
 
 /* a spacewire core configuration */
@@ -634,6 +1049,10 @@ struct grspw2_data {
 	uint32_t data_size;
 	uint8_t *pkt;
 	uint8_t n_drop;
+	struct grspw2_pkt_vec *iov;
+	uint32_t n_pkts;
+	uint32_t timeout_us;
+	struct grspw2_pkt_buf *buf;
 };
 
 
@@ -34,6 +34,10 @@ struct sched_attr {
 	ktime			wcet __attribute__ ((aligned (8)));		/* max runtime per period*/
 	ktime			deadline_rel __attribute__ ((aligned (8)));	/* time to deadline from begin of wakeup */
 
+	/* release periods in phase with the external tick (CONFIG_TIME_SYNC) */
+	bool			tick_sync;
+	ktime			tick_phase __attribute__ ((aligned (8)));	/* release offset to the tick */
+
 }  __attribute__ ((aligned (8)));
 
 
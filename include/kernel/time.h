@@ -52,6 +52,28 @@ typedef int64_t ktime;
 struct timekeeper {
 	struct clocksource *clock;
 	uint32_t readout_ns;	/* readout time overhead in ns */
+
+#ifdef CONFIG_TIME_SYNC
+	/* discipline of the kernel time to an external periodic tick */
+	struct {
+		volatile uint32_t seq;	/* odd while being updated */
+
+		ktime raw_base;		/* clock readout at last update */
+		ktime base;		/* kernel time at last update */
+		int32_t rate;		/* applied rate correction in ppb */
+		int32_t drift;		/* estimated clock drift in ppb */
+		ktime slew;		/* raw interval of rate, then drift */
+
+		ktime period;		/* nominal tick period, 0 if disabled */
+		ktime tick;		/* kernel time of the last tick edge */
+		ktime tick_raw;		/* clock readout at the last tick */
+		int64_t err;		/* phase error at the last tick */
+
+		uint32_t n_lock;	/* consecutive ticks within lock */
+		unsigned long ticks;	/* ticks since the reference was set */
+		unsigned long resets;	/* number of reference resets */
+	} sync;
+#endif /* CONFIG_TIME_SYNC */
 };
 
 
@@ -95,4 +117,15 @@ double difftime_ns(const struct timespec time1, const struct timespec time0);
 
 void time_init(struct clocksource *clock);
 
+#ifdef CONFIG_TIME_SYNC
+void time_sync_enable(ktime period);
+void time_sync_disable(void);
+void time_sync_tick(unsigned long ticks);
+bool time_sync_locked(void);
+ktime time_sync_get_period(void);
+ktime time_sync_next_tick(ktime t);
+int time_sync_check_period(ktime period);
+ktime time_sync_align(ktime t, ktime period, ktime phase, bool next);
+#endif /* CONFIG_TIME_SYNC */
+
 #endif /* _KERNEL_KTIME_H_ */
@@ -17,6 +17,12 @@
 #define __BIG_ENDIAN_BITFIELD __BIG_ENDIAN_BITFIELD
 #endif
 
+#if !defined(__BIG_ENDIAN_BITFIELD) && defined(__BYTE_ORDER__)
+#if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define __BIG_ENDIAN_BITFIELD __BIG_ENDIAN_BITFIELD
+#endif
+#endif
+
 
 /* BCC is at least 4.4.2 */
 #if defined(GCC_VERSION) && (GCC_VERSION >= 40402)
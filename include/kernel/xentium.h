@@ -14,6 +14,10 @@
 #include <kernel/xentium_dev.h>
 #include <kernel/xentium_io.h>
 
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+#include <kernel/time.h>
+#include <kernel/sysctl.h>
+#endif /* CONFIG_XENTIUM_STATS_COLLECT */
 
 
 /**
@@ -25,9 +29,36 @@ struct xen_kern_section {
 	char *name;
 	unsigned long addr;
 	size_t size;
+	uint32_t type;			/* the ELF section type */
+	void *img;			/* cached contents, NULL if zero-filled */
 };
 
 
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+/**
+ * usage statistics of a Xentium or of a xentium kernel program
+ */
+
+struct xen_stats {
+	unsigned long starts;		/* number of kernel program starts */
+	unsigned long tasks;		/* tasks processed */
+	unsigned long cmds;		/* mailbox round-trips */
+	unsigned long allocs;		/* host allocation requests */
+	unsigned long dispatched;	/* tasks taken from a tracker */
+	uint64_t dma_bytes;		/* bytes moved via DMA */
+
+	ktime busy;			/* time spent executing kernels */
+	ktime idle;			/* time spent idle (Xentiums only) */
+	ktime wait;			/* time tasks waited in trackers */
+	ktime wait_max;			/* the longest wait of a task */
+
+	ktime t_state;			/* the last busy/idle transition */
+
+	struct sysobj sobj;		/* the sysctl object */
+};
+#endif /* CONFIG_XENTIUM_STATS_COLLECT */
+
+
 /**
  * tracks a single xentium kernel program
  */
@@ -44,6 +75,14 @@ struct xen_kernel {
 
 	struct xen_kern_section *sec;	/* the (ELF) section of the kernel */
 	size_t num_sec;			/* the number of sections */
+
+	unsigned long lo;		/* start address of the kernel image */
+	unsigned long hi;		/* end address of the kernel image */
+	int resident;			/* the image is in place */
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	struct xen_stats stats;		/* the usage statistics */
+#endif
 };
 
 
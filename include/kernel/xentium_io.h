@@ -56,6 +56,7 @@ enum xen_cmd {
 struct xen_msg_data {
 
 	struct proc_task *t;
+	struct proc_task *t_next;	/*!< the next task, may be prefetched */
 	unsigned long xen_id;		/*!< the Xentium's id */
 
 	struct noc_dma_channel *dma;	/*!< the reserved DMA channel */
@@ -65,6 +66,13 @@ struct xen_msg_data {
 
 	void *ptr;			/*!< kmem pointers */
 	size_t size;			/*!< kmem size request */
+
+	void *arena;			/*!< the local kmem arena */
+	size_t arena_size;		/*!< the size of the kmem arena */
+	struct xen_kmem_chunk *arena_free;	/*!< the arena free list */
+	unsigned long arena_ready;	/*!< the free list was set up */
+
+	unsigned long dma_bytes;	/*!< bytes moved by DMA since last msg */
 };
 
 
@@ -393,6 +393,16 @@ static inline int list_empty(struct list_head *head)
 	return head->next == head;
 }
 
+/**
+ * @brief tests whether a list has exactly one element
+ * @param head: the list to test.
+ */
+
+static inline int list_is_singular(struct list_head *head)
+{
+	return !list_empty(head) && (head->next == head->prev);
+}
+
 /**
  * @brief tests whether there is at least one element in the list
  * @param head: the list to test.
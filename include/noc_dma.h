@@ -8,6 +8,7 @@
 
 #include <noc.h>
 #include <kernel/types.h>
+#include <kernel/time.h>
 #include <list.h>
 
 
@@ -21,6 +22,7 @@
 
 #define NOC_DMA_PRIORITY_LOW	0x0
 #define NOC_DMA_PRIORITY_HIGH	0x1
+#define NOC_DMA_PRIORITIES	2
 
 #define NOC_DMA_IRQ_FWD_NONE	0x0
 #define NOC_DMA_IRQ_FWD_IN	0x1
@@ -57,6 +59,18 @@
 #define NOC_DMA_TRANSFER_QUEUE_SIZE 32
 #endif
 
+#ifdef CONFIG_NOC_DMA_HIGH_PRIO_CHANNELS
+#define NOC_DMA_HIGH_PRIO_CHANNELS CONFIG_NOC_DMA_HIGH_PRIO_CHANNELS
+#else
+#define NOC_DMA_HIGH_PRIO_CHANNELS 2
+#endif
+
+#ifdef CONFIG_NOC_DMA_COMPLETION_RING_SIZE
+#define NOC_DMA_COMPLETION_RING_SIZE CONFIG_NOC_DMA_COMPLETION_RING_SIZE
+#else
+#define NOC_DMA_COMPLETION_RING_SIZE 32
+#endif
+
 enum noc_dma_elem_size {BYTE       = NOC_DMA_ACCESS_SIZE_8,
 			HALFWORD   = NOC_DMA_ACCESS_SIZE_16,
 			WORD       = NOC_DMA_ACCESS_SIZE_32,
@@ -70,6 +84,22 @@ enum noc_dma_irq_fwd {OFF  = NOC_DMA_IRQ_FWD_NONE,
 		      OUT  = NOC_DMA_IRQ_FWD_OUT,
 		      BOTH = NOC_DMA_IRQ_FWD_BOTH};
 
+/* a segment of a scatter-gather transfer */
+struct noc_dma_sg {
+
+	void *src;
+	void *dst;
+
+	uint16_t x_elem;		/* number of elements in x */
+	uint16_t y_elem;		/* number of elements in y */
+
+	int16_t  x_stride_src;		/* width of stride in source x */
+	int16_t  y_stride_src;		/* width of stride in source y */
+
+	int16_t  x_stride_dst;		/* width of stride in destination x */
+	int16_t  y_stride_dst;		/* width of stride in destination y */
+};
+
 struct noc_dma_transfer {
 
 	void *src;
@@ -96,6 +126,13 @@ struct noc_dma_transfer {
 	int (*callback)(void *);
 	void *userdata;
 
+	/* the segments of a scatter-gather transfer, NULL otherwise */
+	struct noc_dma_sg *sg;
+	size_t sg_n;			/* number of segments */
+	size_t sg_idx;			/* the segment in progress */
+
+	ktime queued;			/* time of submission */
+
 	struct list_head node;
 };
 
@@ -114,5 +151,10 @@ int noc_dma_req_lin_xfer(void *src, void *dst,
 			 enum noc_dma_priority dma_priority, uint16_t mtu,
 			 int (*callback)(void *), void *userdata);
 
+int noc_dma_req_sg_xfer(struct noc_dma_sg *sg, size_t n,
+			enum noc_dma_elem_size elem_size,
+			enum noc_dma_priority dma_priority, uint16_t mtu,
+			int (*callback)(void *), void *userdata);
+
 
 #endif /* _NOC_DMA_H_ */
@@ -24,6 +24,7 @@
 #define COMPR_BUF_ELEM	(1024 * 256)
 
 #define CRIT_LEVEL	10
+#define BATCH_SIZE	CRIT_LEVEL
 
 #define OP_PREPROC_NLC		0x1234
 #define OP_DECORR_DIFF		0x1235
@@ -1523,49 +1524,61 @@ int op_preproc_nlc(unsigned long op_code, struct proc_task *t)
 
 
 
-int op_decorr_diff(unsigned long op_code, struct proc_task *t)
+int op_decorr_diff(unsigned long op_code, struct proc_task **tasks, size_t n,
+		   int *ret)
 {
-	ssize_t n;
+	size_t i;
 
 	struct ProcData *p;
 
 
-	n = pt_get_nmemb(t);
-	if (!n)
-		return PN_TASK_SUCCESS;
+	for (i = 0; i < n; i++) {
 
+		ret[i] = PN_TASK_SUCCESS;
 
-	p = (struct ProcData *) pt_get_data(t);
-	if (!p)	/* we have elements but data is NULL, error*/
-		return PN_TASK_DESTROY;
+		if (!pt_get_nmemb(tasks[i]))
+			continue;
 
+		p = (struct ProcData *) pt_get_data(tasks[i]);
+		if (!p) { /* we have elements but data is NULL, error*/
+			ret[i] = PN_TASK_DESTROY;
+			continue;
+		}
 
-	Delta32(  (int *) p->source.data, p->source.nelements);
-	Map2Pos32((int *) p->source.data, p->source.nelements);
+		Delta32(  (int *) p->source.data, p->source.nelements);
+		Map2Pos32((int *) p->source.data, p->source.nelements);
+	}
 
-	return PN_TASK_SUCCESS;
+	return n;
 }
 
 
-int op_lossy3_round2(unsigned long op_code, struct proc_task *t)
+int op_lossy3_round2(unsigned long op_code, struct proc_task **tasks, size_t n,
+		     int *ret)
 {
-	ssize_t n;
+	size_t i;
 
 	struct ProcData *p;
 
 
-	n = pt_get_nmemb(t);
-	if (!n)
-		return PN_TASK_SUCCESS;
+	for (i = 0; i < n; i++) {
 
+		ret[i] = PN_TASK_SUCCESS;
 
-	p = (struct ProcData *) pt_get_data(t);
-	if (!p)	/* we have elements but data is NULL, error*/
-		return PN_TASK_DESTROY;
+		if (!pt_get_nmemb(tasks[i]))
+			continue;
 
-	BitRounding32u((unsigned int *)(p->source.data), 2, p->source.nelements);
+		p = (struct ProcData *) pt_get_data(tasks[i]);
+		if (!p) { /* we have elements but data is NULL, error*/
+			ret[i] = PN_TASK_DESTROY;
+			continue;
+		}
 
-	return PN_TASK_SUCCESS;
+		BitRounding32u((unsigned int *)(p->source.data), 2,
+			       p->source.nelements);
+	}
+
+	return n;
 }
 
 int op_llc_ari1(unsigned long op_code, struct proc_task *t)
@@ -1607,11 +1620,13 @@ int pn_prepare_nodes(struct proc_net *pn)
 	BUG_ON(!pt);
 	BUG_ON(pn_add_node(pn, pt));
 
-	pt = pt_track_create(op_decorr_diff, OP_DECORR_DIFF, CRIT_LEVEL);
+	pt = pt_track_create_batch(op_decorr_diff, OP_DECORR_DIFF, CRIT_LEVEL,
+				   BATCH_SIZE);
 	BUG_ON(!pt);
 	BUG_ON(pn_add_node(pn, pt));
 
-	pt = pt_track_create(op_lossy3_round2, OP_LOSSY3_ROUND2, CRIT_LEVEL);
+	pt = pt_track_create_batch(op_lossy3_round2, OP_LOSSY3_ROUND2,
+				   CRIT_LEVEL, BATCH_SIZE);
 	BUG_ON(!pt);
 	BUG_ON(pn_add_node(pn, pt));
 
@@ -1672,7 +1687,7 @@ void pn_new_input_task(struct proc_net *pn)
 
 
 	p->start = ktime_get();
-	pn_input_task(pn, t);
+	BUG_ON(pn_input_task(pn, t));
 }
 
 
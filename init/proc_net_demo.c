@@ -204,7 +204,7 @@ void pn_new_input_task(struct proc_net *pn, size_t n)
 	pt_set_nmemb(t, n);
 
 
-	pn_input_task(pn, t);
+	BUG_ON(pn_input_task(pn, t));
 }
 
 
@@ -100,6 +100,42 @@
  * as well to allow the same level of control as with TX descriptors.
  *
  *
+ * ### Batched transmission
+ *
+ * Every call to grspw2_add_pkt() reclaims completed TX descriptors, flushes the
+ * data cache and notifies the core. To reduce this overhead at high packet
+ * rates, multiple packets may be passed to grspw2_add_pkts() as an array of
+ * struct grspw2_pkt_vec, which does all of the above only once per batch.
+ *
+ *
+ * ### Zero-copy transmission
+ *
+ * Packets added via grspw2_add_pkt_ref() are not copied into the buffers of
+ * the TX descriptor, rather the descriptor references the header and data
+ * buffers of the caller for the duration of the transfer. Once the core is done
+ * with the descriptor and it is reclaimed, the descriptor's own buffers are
+ * restored and the callback configured via grspw2_set_tx_done_callback() is
+ * executed with the cookie of the packet, after which the caller may reuse its
+ * buffers. Reclaiming happens whenever a packet is added or on demand via
+ * grspw2_tx_reclaim().
+ *
+ *
+ * ### Interrupt-driven reception
+ *
+ * Instead of polling grspw2_get_num_pkts_avail() or grspw2_get_pkt(), a thread
+ * may call grspw2_recv(), which yields the CPU until a packet is available.
+ * If interrupt-driven reception is enabled via grspw2_rx_irq_enable(), the RX
+ * interrupt flag is set on every n-th descriptor, so the core raises one
+ * interrupt per n received packets. The interrupt handler records the number
+ * of completed descriptors, which is all a waiting thread needs to check.
+ * Packets of a partially filled batch are picked up once the configured
+ * coalescing timeout expires.
+ *
+ * Pending packets may be retrieved in bulk via grspw2_get_pkts(), which fills
+ * an array of packet buffers, so a user space application can drain the RX
+ * descriptors with a single system call.
+ *
+ *
  * ### Routing mode
  *
  * There is support for direct routing of packets between SpW cores. Since
@@ -120,6 +156,64 @@
  * of RX packets exceed the supply of TX descriptors.
  *
  *
+ * ### Software router
+ *
+ * For more than one route, a struct grspw2_router may be set up with up to
+ * GRSPW2_ROUTER_PORTS cores via grspw2_router_add_port(), which are numbered
+ * from 1 in the order they are added. Packets are routed by their leading
+ * address byte as in a SpaceWire router: path addresses (1-31) select the
+ * output port directly and are deleted from the packet, logical addresses
+ * (32-254) are looked up in the routing table configured via
+ * grspw2_router_set_route(), which also selects whether the address byte is
+ * deleted. Packets with an unrouted address are dropped.
+ *
+ * The TX descriptor ring of each port serves as its output queue. If the
+ * queue of a port is full, routing of the input port stops at the packet for
+ * that port, so the RX descriptors of the input fill up and the link applies
+ * flow control to the sender. Stalled packets are retried on the next call to
+ * grspw2_router_poll() or, in interrupt mode (grspw2_router_enable_irq()), on
+ * the next packet received by the input port or when the output port
+ * completes a transmission. For the latter, the TX interrupt of an output
+ * port is only enabled while an input is stalled on it.
+ *
+ * If the input port has a spare buffer pool configured (see "Zero-copy
+ * reception" below), packets are forwarded without copying: the buffer of the
+ * RX descriptor is replaced by a spare buffer and referenced by a TX
+ * descriptor of the output port, which returns it to the spare pool once
+ * the packet was sent. Otherwise, the packet is copied into the buffers of the
+ * TX descriptor. Note that the router takes over the TX completion callback
+ * (see grspw2_set_tx_done_callback()) of all its ports.
+ *
+ *
+ * ### Zero-copy reception
+ *
+ * If a pool of spare packet buffers is configured via
+ * grspw2_rx_spare_pool_init(), packets may be retrieved without copying them
+ * via grspw2_loan_pkt() or grspw2_get_pkt_task(). The packet buffer of a
+ * completed RX descriptor is then handed to the caller and replaced by a
+ * buffer from the spare pool, so the descriptor may be re-activated
+ * immediately. Loaned buffers are returned to the spare pool via
+ * grspw2_return_pkt().
+ *
+ *
+ * ### RMAP target
+ *
+ * A struct grspw2_rmap_target serves RMAP commands addressed to its target
+ * logical address from local memory, which is mapped into the RMAP address
+ * space via grspw2_rmap_target_add_window() with individual access rights.
+ * This replaces the hardware target of the core, which is disabled, and
+ * allows the application to be notified of writes. The header and data CRCs
+ * are checked and generated by the core, which is therefore required to
+ * support them. Commands are executed by grspw2_rmap_target_poll() or, in
+ * interrupt mode (grspw2_rmap_target_enable_irq()), as they are received.
+ *
+ * Write, read and read-modify-write commands with incrementing addresses are
+ * supported; writes are executed only after the whole packet was checked, so
+ * verified and unverified writes are the same. Read data is sent directly
+ * from the window. Processing stops at the first packet that is not a command
+ * for the target, which may then be retrieved via grspw2_get_pkt().
+ *
+ *
  * ## Error Handling
  *
  * Configuration errors are indicated during setup. If an operational error
@@ -128,20 +222,58 @@
  * errors periodically.
  *
  *
+ * ## Statistics
+ *
+ * Each link counts its packets, drops, EEP-terminated and truncated packets,
+ * link errors and the packets refused for lack of a TX descriptor in a
+ * struct grspw2_stats. The counters are exported next to rx_bytes/tx_bytes in
+ * the sysctl object of the link (/sys/driver/spw<n>), writing to an attribute
+ * clears it.
+ *
+ * The high-watermarks of the descriptor rings help to size them: tx_desc_hwm
+ * is the maximum number of TX descriptors in use when a packet was added,
+ * rx_desc_hwm is the maximum number of pending RX packets observed by
+ * grspw2_get_num_pkts_avail() or the auto-drop interrupt. If either reaches
+ * the size of its ring, the link was saturated.
+ *
+ *
+ * ## Ring Configuration
+ *
+ * The descriptor tables and buffers may be supplied by the caller via
+ * grspw2_rx_desc_table_init() and grspw2_tx_desc_table_init(), or allocated by
+ * the driver via grspw2_core_alloc() from the DMA-capable memory pool. The
+ * latter takes a struct grspw2_ring_cfg with the number of RX and TX
+ * descriptors (up to the 128 and 64 a table holds), the RX MTU and the sizes
+ * of the TX data and header buffers of the link. High-rate links may thus use
+ * deep rings while housekeeping links stay small.
+ *
+ * The geometry is exported as rx_desc, tx_desc, rx_mtu, tx_mtu and
+ * tx_hdr_size in the sysctl object of the link. Writing to one of these
+ * reallocates the rings, which is refused unless the core was stopped via
+ * grspw2_core_stop() (or not yet started); the core is then restarted via
+ * grspw2_core_start().
+ *
+ *
+ * ## Time Synchronisation
+ *
+ * If the kernel is configured with TIME_SYNC, grspw2_time_sync_enable() makes
+ * the tick-outs of a link discipline the kernel time (see kernel/time.c). The
+ * 6-bit time counter is extended to the number of elapsed tick periods, so
+ * single missed time codes do not disturb the drift estimate. Only one link
+ * should be used as the time source at any time. EDF tasks may then request
+ * releases in phase with the time codes.
+ *
+ *
  * ## Notes
  *
  * - there is currently support for only one DMA channel, as the core is not
  *   implemented with more channels on the GR712RC
  * - if more 64 TX or 128 RX packet slots are needed, descriptor table switching
  *   must be implemented
- * - routing is implemented inefficiently, since incoming packets are always
- *   copied to the output. The conceivably much faster zero-copy method of
- *   exchanging descriptors is not possible due to the differing descriptor
- *   layouts. Another solution would be the exchange of data buffer references,
- *   but this requires one of either:
- *	- the use of the MMU with a functioning malloc/free system
- *	- a pointer tracking system within the driver
- *	.
+ * - the single-route mode always copies incoming packets to the output.
+ *   The zero-copy method of exchanging descriptors is not possible due to the
+ *   differing descriptor layouts, so the software router exchanges data buffer
+ *   references instead, which requires a spare buffer pool on the input.
  *   In CHEOPS, the routing functionality is needed only for testing and
  *   calibration purposes on ground, so the copy implementation is sufficient.
  *
@@ -163,6 +295,7 @@
 #include <kernel/kmem.h>
 
 #include <kernel/time.h>
+#include <kernel/sched.h>
 #include <kernel/string.h>
 #include <kernel/printk.h>
 
@@ -191,12 +324,6 @@ static ssize_t rxtx_show(__attribute__((unused)) struct sysobj *sobj,
 	if (!strcmp(sattr->name, "tx_bytes"))
 		return sprintf(buf, UINT32_T_FORMAT, cfg->tx_bytes);
 
-	if (!strcmp(sattr->name, "rx_desc"))
-		return sprintf(buf, UINT32_T_FORMAT, cfg->rx_n_desc);
-
-	if (!strcmp(sattr->name, "tx_desc"))
-		return sprintf(buf, UINT32_T_FORMAT, cfg->tx_n_desc);
-
 	if (!strcmp(sattr->name, "rx_desc_avail"))
 		return sprintf(buf, UINT32_T_FORMAT,
 			       grspw2_get_num_free_rx_desc_avail(cfg));
@@ -233,6 +360,163 @@ static ssize_t rxtx_store(__attribute__((unused)) struct sysobj *sobj,
 	return 0;
 }
 
+/**
+ * @brief look up a ring geometry parameter by its attribute name
+ */
+
+static uint32_t *grspw2_ring_param(struct grspw2_ring_cfg *ring,
+				   const char *name)
+{
+	if (!strcmp(name, "rx_desc"))
+		return &ring->rx_desc;
+
+	if (!strcmp(name, "tx_desc"))
+		return &ring->tx_desc;
+
+	if (!strcmp(name, "rx_mtu"))
+		return &ring->rx_mtu;
+
+	if (!strcmp(name, "tx_mtu"))
+		return &ring->tx_mtu;
+
+	if (!strcmp(name, "tx_hdr_size"))
+		return &ring->tx_hdr_size;
+
+	return NULL;
+}
+
+__extension__
+static ssize_t ring_show(__attribute__((unused)) struct sysobj *sobj,
+			 __attribute__((unused)) struct sobj_attribute *sattr,
+			 char *buf)
+{
+	uint32_t *param;
+	struct grspw2_core_cfg *cfg;
+
+
+	cfg = container_of(sobj, struct grspw2_core_cfg, sobj);
+
+	param = grspw2_ring_param(&cfg->ring, sattr->name);
+	if (!param)
+		return 0;
+
+	return sprintf(buf, UINT32_T_FORMAT, (*param));
+}
+
+/* reallocates the rings, the core must be stopped */
+__extension__
+static ssize_t ring_store(__attribute__((unused)) struct sysobj *sobj,
+			  __attribute__((unused)) struct sobj_attribute *sattr,
+			  __attribute__((unused)) const char *buf,
+			  __attribute__((unused)) size_t len)
+{
+	uint32_t *param;
+	struct grspw2_ring_cfg ring;
+	struct grspw2_core_cfg *cfg;
+
+
+	cfg = container_of(sobj, struct grspw2_core_cfg, sobj);
+
+	ring = cfg->ring;
+
+	param = grspw2_ring_param(&ring, sattr->name);
+	if (!param)
+		return -1;
+
+	(*param) = strtol(buf, NULL, 0);
+
+	return grspw2_core_alloc(cfg, &ring);
+}
+
+/**
+ * @brief look up a statistics counter by its attribute name
+ */
+
+static uint32_t *grspw2_stats_cnt(struct grspw2_stats *st, const char *name)
+{
+	if (!strcmp(name, "rx_pkts"))
+		return &st->rx_pkts;
+
+	if (!strcmp(name, "tx_pkts"))
+		return &st->tx_pkts;
+
+	if (!strcmp(name, "rx_dropped"))
+		return &st->rx_dropped;
+
+	if (!strcmp(name, "rx_auto_dropped"))
+		return &st->rx_auto_dropped;
+
+	if (!strcmp(name, "rx_eep"))
+		return &st->rx_eep;
+
+	if (!strcmp(name, "rx_truncated"))
+		return &st->rx_truncated;
+
+	if (!strcmp(name, "err_credit"))
+		return &st->err_credit;
+
+	if (!strcmp(name, "err_parity"))
+		return &st->err_parity;
+
+	if (!strcmp(name, "err_escape"))
+		return &st->err_escape;
+
+	if (!strcmp(name, "err_disconnect"))
+		return &st->err_disconnect;
+
+	if (!strcmp(name, "err_invalid_addr"))
+		return &st->err_invalid_addr;
+
+	if (!strcmp(name, "tx_desc_unavail"))
+		return &st->tx_desc_unavail;
+
+	if (!strcmp(name, "rx_desc_hwm"))
+		return &st->rx_desc_hwm;
+
+	if (!strcmp(name, "tx_desc_hwm"))
+		return &st->tx_desc_hwm;
+
+	return NULL;
+}
+
+__extension__
+static ssize_t stats_show(__attribute__((unused)) struct sysobj *sobj,
+			  __attribute__((unused)) struct sobj_attribute *sattr,
+			  char *buf)
+{
+	uint32_t *cnt;
+	struct grspw2_core_cfg *cfg;
+
+
+	cfg = container_of(sobj, struct grspw2_core_cfg, sobj);
+
+	cnt = grspw2_stats_cnt(&cfg->stats, sattr->name);
+	if (!cnt)
+		return 0;
+
+	return sprintf(buf, UINT32_T_FORMAT, (*cnt));
+}
+
+/* any write clears the counter */
+__extension__
+static ssize_t stats_store(__attribute__((unused)) struct sysobj *sobj,
+			   __attribute__((unused)) struct sobj_attribute *sattr,
+			   __attribute__((unused)) const char *buf,
+			   __attribute__((unused)) size_t len)
+{
+	uint32_t *cnt;
+	struct grspw2_core_cfg *cfg;
+
+
+	cfg = container_of(sobj, struct grspw2_core_cfg, sobj);
+
+	cnt = grspw2_stats_cnt(&cfg->stats, sattr->name);
+	if (cnt)
+		(*cnt) = 0;
+
+	return 0;
+}
+
 __extension__
 static struct sobj_attribute rx_bytes_attr = __ATTR(rx_bytes,
 						    rxtx_show,
@@ -242,9 +526,106 @@ static struct sobj_attribute tx_bytes_attr = __ATTR(tx_bytes,
 						    rxtx_show,
 						    rxtx_store);
 
+__extension__
+static struct sobj_attribute rx_desc_attr = __ATTR(rx_desc,
+						   ring_show,
+						   ring_store);
+__extension__
+static struct sobj_attribute tx_desc_attr = __ATTR(tx_desc,
+						   ring_show,
+						   ring_store);
+__extension__
+static struct sobj_attribute rx_mtu_attr = __ATTR(rx_mtu,
+						  ring_show,
+						  ring_store);
+__extension__
+static struct sobj_attribute tx_mtu_attr = __ATTR(tx_mtu,
+						  ring_show,
+						  ring_store);
+__extension__
+static struct sobj_attribute tx_hdr_size_attr = __ATTR(tx_hdr_size,
+						       ring_show,
+						       ring_store);
+
+__extension__
+static struct sobj_attribute rx_pkts_attr = __ATTR(rx_pkts,
+						   stats_show,
+						   stats_store);
+__extension__
+static struct sobj_attribute tx_pkts_attr = __ATTR(tx_pkts,
+						   stats_show,
+						   stats_store);
+__extension__
+static struct sobj_attribute rx_dropped_attr = __ATTR(rx_dropped,
+						      stats_show,
+						      stats_store);
+__extension__
+static struct sobj_attribute rx_auto_dropped_attr = __ATTR(rx_auto_dropped,
+							   stats_show,
+							   stats_store);
+__extension__
+static struct sobj_attribute rx_eep_attr = __ATTR(rx_eep,
+						  stats_show,
+						  stats_store);
+__extension__
+static struct sobj_attribute rx_truncated_attr = __ATTR(rx_truncated,
+							stats_show,
+							stats_store);
+__extension__
+static struct sobj_attribute err_credit_attr = __ATTR(err_credit,
+						      stats_show,
+						      stats_store);
+__extension__
+static struct sobj_attribute err_parity_attr = __ATTR(err_parity,
+						      stats_show,
+						      stats_store);
+__extension__
+static struct sobj_attribute err_escape_attr = __ATTR(err_escape,
+						      stats_show,
+						      stats_store);
+__extension__
+static struct sobj_attribute err_disconnect_attr = __ATTR(err_disconnect,
+							  stats_show,
+							  stats_store);
+__extension__
+static struct sobj_attribute err_invalid_addr_attr = __ATTR(err_invalid_addr,
+							    stats_show,
+							    stats_store);
+__extension__
+static struct sobj_attribute tx_desc_unavail_attr = __ATTR(tx_desc_unavail,
+							   stats_show,
+							   stats_store);
+__extension__
+static struct sobj_attribute rx_desc_hwm_attr = __ATTR(rx_desc_hwm,
+						       stats_show,
+						       stats_store);
+__extension__
+static struct sobj_attribute tx_desc_hwm_attr = __ATTR(tx_desc_hwm,
+						       stats_show,
+						       stats_store);
+
 __extension__
 static struct sobj_attribute *grspw2_attributes[] = {&rx_bytes_attr,
 						    &tx_bytes_attr,
+						    &rx_desc_attr,
+						    &tx_desc_attr,
+						    &rx_mtu_attr,
+						    &tx_mtu_attr,
+						    &tx_hdr_size_attr,
+						    &rx_pkts_attr,
+						    &tx_pkts_attr,
+						    &rx_dropped_attr,
+						    &rx_auto_dropped_attr,
+						    &rx_eep_attr,
+						    &rx_truncated_attr,
+						    &err_credit_attr,
+						    &err_parity_attr,
+						    &err_escape_attr,
+						    &err_disconnect_attr,
+						    &err_invalid_addr_attr,
+						    &tx_desc_unavail_attr,
+						    &rx_desc_hwm_attr,
+						    &tx_desc_hwm_attr,
 						    NULL};
 #endif /* CONFIG_SYSCTL */
 
@@ -300,6 +681,32 @@ static irqreturn_t grspw2_dma_error(unsigned int irq, void *userdata)
 }
 
 
+/**
+ * @brief pass a received time code to the kernel time discipline
+ */
+
+static void grspw2_time_sync_tick(struct grspw2_core_cfg *cfg)
+{
+#ifdef CONFIG_TIME_SYNC
+	uint32_t cnt;
+
+
+	if (!cfg->time_sync.enabled)
+		return;
+
+	cnt = grspw2_get_timecnt(cfg);
+
+	/* the first time code only sets the reference */
+	if (cfg->time_sync.enabled > 1)
+		time_sync_tick((cnt - cfg->time_sync.timecnt)
+			       & GRSPW2_TIME_TIMECNT);
+
+	cfg->time_sync.enabled = 2;
+	cfg->time_sync.timecnt = cnt;
+#endif /* CONFIG_TIME_SYNC */
+}
+
+
 /**
  * @brief link error interrupt callback
  */
@@ -323,32 +730,11 @@ static irqreturn_t grspw2_link_error(unsigned int irq, void *userdata)
 	if (!tmp)
 		return 0;
 
-	if (status & GRSPW2_STATUS_TO) {
-
-		static ktime p;
-
-		ktime c;
-		static ktime drift;
-		static ktime cnt;
-
-		if (!p) {
-			p = ktime_get();
-			goto exit;
-		}
-
-		c = ktime_get();
-		drift = c - p - cnt * 1000000000ULL - 1000000000ULL;
-		cnt++;
-
-
-		status &= GRSPW2_STATUS_TO;
-#if 0
-		printk("abs:: %lld ns;\n", drift);
-#endif
-	}
-exit:
+	if (status & GRSPW2_STATUS_TO)
+		grspw2_time_sync_tick(cfg);
 
 	if (status & GRSPW2_STATUS_IA) {
+		cfg->stats.err_invalid_addr++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_INVALID_ADDR_ERROR;
 		grspw2_handle_error(MEDIUM);
@@ -356,6 +742,7 @@ exit:
 	}
 
 	if (status & GRSPW2_STATUS_PE) {
+		cfg->stats.err_parity++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_PARITY_ERROR;
 		grspw2_handle_error(MEDIUM);
@@ -363,6 +750,7 @@ exit:
 	}
 
 	if (status & GRSPW2_STATUS_DE) {
+		cfg->stats.err_disconnect++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_DISCONNECT_ERROR;
 		grspw2_handle_error(MEDIUM);
@@ -370,6 +758,7 @@ exit:
 	}
 
 	if (status & GRSPW2_STATUS_ER) {
+		cfg->stats.err_escape++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_ESCAPE_ERROR;
 		grspw2_handle_error(MEDIUM);
@@ -377,6 +766,7 @@ exit:
 	}
 
 	if (status & GRSPW2_STATUS_CE) {
+		cfg->stats.err_credit++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_CREDIT_ERROR;
 		grspw2_handle_error(MEDIUM);
@@ -792,7 +1182,6 @@ static void grspw2_rx_interrupt_disable(struct grspw2_core_cfg *cfg)
  * @brief set Transmit Interrupt enable bit in the DMA register
  */
 
-__attribute__((unused))
 static void grspw2_tx_interrupt_enable(struct grspw2_core_cfg *cfg)
 {
 	uint32_t flags;
@@ -809,7 +1198,6 @@ static void grspw2_tx_interrupt_enable(struct grspw2_core_cfg *cfg)
  * @brief clear Transmit Interrupt enable bit in the DMA register
  */
 
-__attribute__((unused))
 static void grspw2_tx_interrupt_disable(struct grspw2_core_cfg *cfg)
 {
 	uint32_t flags;
@@ -837,6 +1225,63 @@ void grspw2_tick_out_interrupt_enable(struct grspw2_core_cfg *cfg)
 }
 
 
+#ifdef CONFIG_TIME_SYNC
+/**
+ * @brief discipline the kernel time to the time codes received on a link
+ *
+ * @param cfg a struct grspw2_core_cfg
+ * @param period the nominal period of the time codes in nanoseconds
+ *
+ * @returns 0 on success, -EINVAL on error
+ */
+
+int32_t grspw2_time_sync_enable(struct grspw2_core_cfg *cfg, ktime period)
+{
+	if (!cfg)
+		return -EINVAL;
+
+	if (period < (ktime) NSEC_PER_MSEC)
+		return -EINVAL;
+
+	cfg->time_sync.enabled = 1;
+
+	time_sync_enable(period);
+
+	grspw2_set_time_rx(cfg);
+	grspw2_tick_out_interrupt_enable(cfg);
+
+	return 0;
+}
+
+
+/**
+ * @brief stop disciplining the kernel time to the time codes of a link
+ */
+
+int32_t grspw2_time_sync_disable(struct grspw2_core_cfg *cfg)
+{
+	uint32_t ctrl;
+
+
+	if (!cfg)
+		return -EINVAL;
+
+	if (!cfg->time_sync.enabled)
+		return 0;
+
+	ctrl  = ioread32be(&cfg->regs->ctrl);
+	ctrl &= ~GRSPW2_CTRL_TQ;
+	iowrite32be(ctrl, &cfg->regs->ctrl);
+
+	cfg->time_sync.enabled = 0;
+
+	time_sync_disable();
+
+	return 0;
+}
+#endif /* CONFIG_TIME_SYNC */
+
+
 /**
  * @brief set SpW clock divisor
  *
@@ -973,6 +1418,9 @@ int32_t grspw2_rx_desc_table_init(struct grspw2_core_cfg *cfg,
 			      &cfg->rx_desc_ring_free);
 	}
 
+	cfg->ring.rx_desc = cfg->rx_n_desc;
+	cfg->ring.rx_mtu  = pkt_size;
+
 	return 0;
 }
 
@@ -1037,10 +1485,16 @@ int32_t grspw2_tx_desc_table_init(struct grspw2_core_cfg *cfg,
 		 */
 		cfg->tx_desc_ring[i].desc->pkt_ctrl  = 0;
 
+		cfg->tx_desc_ring[i].ref = false;
+
 		list_add_tail(&cfg->tx_desc_ring[i].node,
 			      &cfg->tx_desc_ring_free);
 	}
 
+	cfg->ring.tx_desc     = cfg->tx_n_desc;
+	cfg->ring.tx_mtu      = data_size;
+	cfg->ring.tx_hdr_size = hdr_size;
+
 	return 0;
 }
 
@@ -1097,13 +1551,37 @@ static void grspw2_tx_desc_move_free(struct grspw2_core_cfg *cfg,
 }
 
 
+/**
+ * @brief	restore the buffers of a tx descriptor that referenced caller
+ *		buffers and notify the owner of the latter
+ */
+
+static void grspw2_tx_desc_release_ref(struct grspw2_core_cfg *cfg,
+				       struct grspw2_tx_desc_ring_elem *p_elem)
+{
+	p_elem->desc->hdr_addr  = p_elem->hdr_addr;
+	p_elem->desc->data_addr = p_elem->data_addr;
+
+	p_elem->ref = false;
+
+	if (!p_elem->notify)
+		return;
+
+	if (cfg->tx_done.cb)
+		cfg->tx_done.cb(cfg, p_elem->cookie, cfg->tx_done.userdata);
+}
+
+
 /**
  * @brief	move all inactive tx descriptors to the free ring
+ *
+ * @return	the number of descriptors moved
  */
 
-__attribute__((unused))
-static void grspw2_tx_desc_move_free_all(struct grspw2_core_cfg *cfg)
+static uint32_t grspw2_tx_desc_move_free_all(struct grspw2_core_cfg *cfg)
 {
+	uint32_t n = 0;
+
 	struct grspw2_tx_desc_ring_elem *p_elem;
 	struct grspw2_tx_desc_ring_elem *p_tmp;
 
@@ -1113,8 +1591,15 @@ static void grspw2_tx_desc_move_free_all(struct grspw2_core_cfg *cfg)
 		if (p_elem->desc->pkt_ctrl & GRSPW2_TX_DESC_EN)
 			break;
 
+		if (p_elem->ref)
+			grspw2_tx_desc_release_ref(cfg, p_elem);
+
 		grspw2_tx_desc_move_free(cfg, p_elem);
+
+		n++;
 	}
+
+	return n;
 }
 
 
@@ -1332,7 +1817,6 @@ static void grspw2_rx_desc_set_irq(struct grspw2_rx_desc_ring_elem *p_elem)
  *	  to have them actually fire
  */
 
-__attribute__((unused))
 static void grspw2_tx_desc_set_irq(struct grspw2_tx_desc_ring_elem *p_elem)
 {
 	p_elem->desc->pkt_ctrl |= GRSPW2_TX_DESC_IE;
@@ -1354,7 +1838,6 @@ static void grspw2_rx_desc_clear_irq(struct grspw2_rx_desc_ring_elem *p_elem)
  * @brief clear per-packet interrupt; enable tx irq in dma control register
  *	  to have them actually fire
  */
-__attribute__((unused))
 static void grspw2_tx_desc_clear_irq(struct grspw2_tx_desc_ring_elem *p_elem)
 {
 	p_elem->desc->pkt_ctrl &= ~GRSPW2_TX_DESC_IE;
@@ -1511,72 +1994,194 @@ static int32_t grspw2_rx_desc_add_custom(struct grspw2_core_cfg *cfg,
 /**
  * @brief	release and try to reactivate a descriptor
  * @return	0 on success, -1 if no descriptor is available
+ *
+ * @note	all received packets pass through here, so this is where they
+ *		are accounted for
  */
 
 static int32_t grspw2_rx_desc_readd(struct grspw2_core_cfg *cfg,
 			     struct grspw2_rx_desc_ring_elem *p_elem)
 {
+	uint32_t ctrl;
+
+
+	ctrl = p_elem->desc->pkt_ctrl;
+
+	cfg->stats.rx_pkts++;
+
+	if (unlikely(ctrl & GRSPW2_RX_DESC_EP))
+		cfg->stats.rx_eep++;
+
+	if (unlikely(ctrl & GRSPW2_RX_DESC_TR))
+		cfg->stats.rx_truncated++;
+
 	grspw2_rx_desc_move_free(cfg, p_elem);
 
 	return grspw2_rx_desc_add(cfg);
 }
 
+
 /**
- * @brief	try to activate a free descriptor and copy the data from the
- *		supplied buffer
- *
- * @return	0 on success, -1 on failure
- *
- * @note	USE WITH CARE: does not perform any size checks on the buffers
+ * @brief	loan the packet buffer of a descriptor and replace it with one
+ *		from the spare pool
+ * @return	the loaned packet buffer
  *
+ * @note	the spare pool must not be empty; we always set the packet
+ *		address before the descriptor is re-enabled
  */
-#include <asm/leon.h>
-static int32_t grspw2_tx_desc_add_pkt(struct grspw2_core_cfg *cfg,
-				      bool rmap_pkt,
-				      const void *hdr_buf,
-				      uint32_t hdr_size,
-				      uint8_t non_crc_bytes,
-				      const void *data_buf,
-				      uint32_t data_size)
+
+static uint32_t grspw2_rx_spare_swap(struct grspw2_core_cfg *cfg,
+				     struct grspw2_rx_desc_ring_elem *p_elem)
 {
-	struct grspw2_tx_desc_ring_elem *p_elem;
+	uint32_t addr;
 
 
-	/* this is a little excessive, remove on your own risk */
+	addr = p_elem->desc->pkt_addr;
 
-	if (hdr_size && !hdr_buf) {
-#if 0		/* XXX kalarm() */
-		errno = EINVAL;
-#endif
-		return -1;
-	}
+	cfg->rx_spare.loan[cfg->rx_spare.n_loan++] = addr;
 
-	if (data_size && !data_buf) {
-#if 0		/* XXX kalarm() */
+	p_elem->desc->pkt_addr = cfg->rx_spare.buf[--cfg->rx_spare.n];
+
+	return addr;
+}
+
+/**
+ * @brief	copy a packet into the buffers of a tx descriptor
+ *
+ * @note	USE WITH CARE: does not perform any size checks on the buffers
+ */
+
+static void grspw2_tx_desc_fill(struct grspw2_tx_desc_ring_elem *p_elem,
+				bool rmap_pkt,
+				const void *hdr_buf,
+				uint32_t hdr_size,
+				uint8_t non_crc_bytes,
+				const void *data_buf,
+				uint32_t data_size)
+{
+	/* XXX need extra sanity checks somewhere in the interface,
+	 * could be that no headers are alloced! or data size is too small! */
+	if (hdr_buf != NULL)
+		memcpy((void *) p_elem->desc->hdr_addr,  hdr_buf,  hdr_size);
+
+	if (data_buf != NULL)
+		memcpy((void *) p_elem->desc->data_addr, data_buf, data_size);
+
+	p_elem->desc->hdr_size  = hdr_size;
+	p_elem->desc->data_size = data_size;
+
+	/* the descriptors are reused, so always update the CRC flags */
+	p_elem->desc->append_header_crc = 0;
+	p_elem->desc->append_data_crc   = 0;
+	p_elem->desc->non_crc_bytes     = 0;
+
+	if (rmap_pkt) {
+		if (hdr_size)
+			p_elem->desc->append_header_crc = 1;
+		if (data_size)
+			p_elem->desc->append_data_crc = 1;
+		if (non_crc_bytes)
+			p_elem->desc->non_crc_bytes = non_crc_bytes & 0xF;
+	}
+}
+
+
+/**
+ * @brief	activate a filled tx descriptor and move it to the busy ring
+ *
+ * @note	the core is not notified, see grspw2_tx_desc_new_avail()
+ */
+
+static void grspw2_tx_desc_commit(struct grspw2_core_cfg *cfg,
+				  struct grspw2_tx_desc_ring_elem *p_elem)
+{
+	uint32_t used;
+
+	struct grspw2_tx_desc_ring_elem *p_head;
+
+
+	/* set wrap bit on last */
+	if (grspw2_tx_desc_is_last(cfg, p_elem))
+		grspw2_tx_desc_set_wrap(p_elem);
+
+	grspw2_tx_desc_set_active(p_elem);
+
+	grspw2_tx_desc_move_busy(cfg, p_elem);
+
+	/* descriptors are used in ring order, so the distance to the oldest
+	 * busy descriptor is the ring occupancy
+	 */
+	p_head = list_first_entry(&cfg->tx_desc_ring_used,
+				  struct grspw2_tx_desc_ring_elem, node);
+
+	used = p_elem - p_head + 1;
+	if (p_elem < p_head)
+		used += cfg->tx_n_desc;
+
+	if (used > cfg->stats.tx_desc_hwm)
+		cfg->stats.tx_desc_hwm = used;
+
+	cfg->stats.tx_pkts++;
+}
+
+
+/**
+ * @brief	try to activate a free descriptor and copy the data from the
+ *		supplied buffer
+ *
+ * @return	0 on success, -1 on failure
+ *
+ * @note	USE WITH CARE: does not perform any size checks on the buffers
+ *
+ */
+#include <asm/leon.h>
+static int32_t grspw2_tx_desc_add_pkt(struct grspw2_core_cfg *cfg,
+				      bool rmap_pkt,
+				      const void *hdr_buf,
+				      uint32_t hdr_size,
+				      uint8_t non_crc_bytes,
+				      const void *data_buf,
+				      uint32_t data_size)
+{
+	struct grspw2_tx_desc_ring_elem *p_elem;
+
+
+	/* this is a little excessive, remove on your own risk */
+
+	if (hdr_size && !hdr_buf) {
+#if 0		/* XXX kalarm() */
+		errno = EINVAL;
+#endif
+		return -1;
+	}
+
+	if (data_size && !data_buf) {
+#if 0		/* XXX kalarm() */
 		errno = EINVAL;
 #endif
 		return -1;
 	}
 
+	/* the packet is copied into the buffers of the descriptor */
+	if ((hdr_size > cfg->ring.tx_hdr_size)
+	    || (data_size > cfg->ring.tx_mtu))
+		return -1;
+
 	grspw2_tx_desc_move_free_all(cfg);
 
 	p_elem = grspw2_tx_desc_get_next_free(cfg);
 
 
 	if (unlikely(!p_elem)) {
+		cfg->stats.tx_desc_unavail++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_NO_TX_DESC_AVAIL;
 #endif
 		return -1;
 	}
 
-	/* XXX need extra sanity checks somewhere in the interface,
-	 * could be that no headers are alloced! or data size is too small! */
-	if (hdr_buf != NULL) 
-		memcpy((void *) p_elem->desc->hdr_addr,  hdr_buf,  hdr_size);
-
-	if (data_buf != NULL)
-		memcpy((void *) p_elem->desc->data_addr, data_buf, data_size);
+	grspw2_tx_desc_fill(p_elem, rmap_pkt, hdr_buf, hdr_size,
+			    non_crc_bytes, data_buf, data_size);
 
 	/* XXX why is this needed? seems to be an issue with the SXI DPU
 	 * apparently sometimes parts of old packets (longer ones)
@@ -1587,30 +2192,147 @@ static int32_t grspw2_tx_desc_add_pkt(struct grspw2_core_cfg *cfg,
 	 */
 	leon3_flush_dcache();
 
-	p_elem->desc->hdr_size  = hdr_size;
-	p_elem->desc->data_size = data_size;
+	grspw2_tx_desc_commit(cfg, p_elem);
 
-	if (rmap_pkt) {
-		if (hdr_size)
-			p_elem->desc->append_header_crc = 1;
-		if (data_size)
-			p_elem->desc->append_data_crc = 1;
-		if (non_crc_bytes)
-			p_elem->desc->non_crc_bytes = non_crc_bytes & 0xF;
+	grspw2_tx_desc_new_avail(cfg);
+
+	return 0;
+
+}
+
+
+/**
+ * @brief	try to activate a free descriptor which references the supplied
+ *		buffers directly
+ *
+ * @param	notify execute the tx_done callback with the cookie once the
+ *		descriptor is reclaimed
+ *
+ * @return	0 on success, -1 on failure
+ *
+ * @note	the descriptor's own buffers are restored once the descriptor
+ *		is reclaimed, see grspw2_tx_desc_move_free_all()
+ */
+
+static int32_t grspw2_tx_desc_add_ref(struct grspw2_core_cfg *cfg,
+				      bool rmap_pkt,
+				      const void *hdr_buf,
+				      uint32_t hdr_size,
+				      uint8_t non_crc_bytes,
+				      const void *data_buf,
+				      uint32_t data_size,
+				      void *cookie,
+				      bool notify)
+{
+	struct grspw2_tx_desc_ring_elem *p_elem;
+
+
+	if (hdr_size && !hdr_buf)
+		return -1;
+
+	if (data_size && !data_buf)
+		return -1;
+
+	grspw2_tx_desc_move_free_all(cfg);
+
+	p_elem = grspw2_tx_desc_get_next_free(cfg);
+
+	if (unlikely(!p_elem)) {
+		cfg->stats.tx_desc_unavail++;
+#if 0		/* XXX kalarm() */
+		errno = E_SPW_NO_TX_DESC_AVAIL;
+#endif
+		return -1;
 	}
 
-	/* set wrap bit on last */
-	if (grspw2_tx_desc_is_last(cfg, p_elem))
-		grspw2_tx_desc_set_wrap(p_elem);
+	p_elem->hdr_addr  = p_elem->desc->hdr_addr;
+	p_elem->data_addr = p_elem->desc->data_addr;
+	p_elem->cookie    = cookie;
+	p_elem->notify    = notify;
+	p_elem->ref       = true;
 
-	grspw2_tx_desc_set_active(p_elem);
+	p_elem->desc->hdr_addr  = (uint32_t) hdr_buf;
+	p_elem->desc->data_addr = (uint32_t) data_buf;
 
-	grspw2_tx_desc_move_busy(cfg, p_elem);
+	grspw2_tx_desc_fill(p_elem, rmap_pkt, NULL, hdr_size, non_crc_bytes,
+			    NULL, data_size);
+
+	/* see grspw2_tx_desc_add_pkt() */
+	leon3_flush_dcache();
+
+	grspw2_tx_desc_commit(cfg, p_elem);
 
 	grspw2_tx_desc_new_avail(cfg);
 
 	return 0;
+}
+
+
+/**
+ * @brief	copy a batch of packets into free descriptors and activate them
+ *
+ * @param	cfg the core configuration
+ * @param	iov an array of packet vectors
+ * @param	n the number of packets in the array
+ *
+ * @return	the number of packets added, -1 on error
+ *
+ * @note	Completed descriptors are reclaimed, the data cache is flushed
+ *		and the core is notified only once per batch. The LEON3 cannot
+ *		flush individual cache lines, so the whole data cache is
+ *		flushed.
+ *
+ * @note	The descriptors are filled in the free ring first and only
+ *		activated after the flush, in order.
+ */
+
+static int32_t grspw2_tx_desc_add_pkts(struct grspw2_core_cfg *cfg,
+				       const struct grspw2_pkt_vec *iov,
+				       uint32_t n)
+{
+	uint32_t i;
+	uint32_t cnt = 0;
+
+	struct grspw2_tx_desc_ring_elem *p_elem;
+
+
+	for (i = 0; i < n; i++) {
+		if (iov[i].hdr_size && !iov[i].hdr)
+			return -1;
+
+		if (iov[i].data_size && !iov[i].data)
+			return -1;
+
+		if ((iov[i].hdr_size > cfg->ring.tx_hdr_size)
+		    || (iov[i].data_size > cfg->ring.tx_mtu))
+			return -1;
+	}
+
+	grspw2_tx_desc_move_free_all(cfg);
+
+	list_for_each_entry(p_elem, &cfg->tx_desc_ring_free, node) {
+
+		if (cnt == n)
+			break;
+
+		grspw2_tx_desc_fill(p_elem, false,
+				    iov[cnt].hdr,  iov[cnt].hdr_size, 0,
+				    iov[cnt].data, iov[cnt].data_size);
+		cnt++;
+	}
+
+	if (!cnt)
+		return 0;
 
+	/* see grspw2_tx_desc_add_pkt() */
+	leon3_flush_dcache();
+
+	for (i = 0; i < cnt; i++)
+		grspw2_tx_desc_commit(cfg, grspw2_tx_desc_get_next_free(cfg));
+
+	grspw2_tx_desc_new_avail(cfg);
+
+	return cnt;
 }
 
 
@@ -1635,6 +2357,7 @@ static int32_t grspw2_tx_desc_add_custom(struct grspw2_core_cfg *cfg,
 	p_elem = grspw2_tx_desc_get_next_free(cfg);
 
 	if (unlikely(!p_elem)) {
+		cfg->stats.tx_desc_unavail++;
 #if 0		/* XXX kalarm() */
 		errno = E_SPW_NO_TX_DESC_AVAIL;
 #endif
@@ -1778,6 +2501,10 @@ int32_t grspw2_enable_routing(struct grspw2_core_cfg *cfg,
 	uint32_t n_desc;
 
 
+	/* the packets are copied into the TX buffers of the output */
+	if (route->ring.tx_mtu < cfg->ring.rx_mtu)
+		return -1;
+
 	cfg->route[0] = route;
 
 	irq_request(cfg->core_irq, ISR_PRIORITY_NOW, grspw2_route_call, (void *)cfg);
@@ -1847,315 +2574,1838 @@ int32_t grspw2_disable_routing(struct grspw2_core_cfg *cfg)
 
 
 /**
- * @brief retrieve number of packets available
+ * @brief return a buffer forwarded by the router to its input port
  */
 
-uint32_t grspw2_get_num_pkts_avail(struct grspw2_core_cfg *cfg)
+static void grspw2_router_tx_done(struct grspw2_core_cfg *cfg,
+				  void *cookie, void *userdata)
 {
-	uint32_t i = 0;
+	struct grspw2_router_ref *ref;
 
-	struct grspw2_rx_desc_ring_elem *p_elem;
-	struct grspw2_rx_desc_ring_elem *p_tmp;
 
-	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_used, node) {
-		if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
-			break;
-		i++;
-	}
+	ref = (struct grspw2_router_ref *) cookie;
 
-	return i;
+	grspw2_return_pkt(ref->src, ref->pkt);
 }
 
 
 /**
- * @brief get number of available free tx descriptors
+ * @brief initialise a software router
  */
 
-uint32_t grspw2_get_num_free_tx_desc_avail(struct grspw2_core_cfg *cfg)
+void grspw2_router_init(struct grspw2_router *rt)
 {
-	uint32_t i = 0;
-
-	struct grspw2_tx_desc_ring_elem *p_elem;
-	struct grspw2_tx_desc_ring_elem *p_tmp;
-
-	list_for_each_entry_safe(p_elem, p_tmp, &cfg->tx_desc_ring_free, node) {
-		i++;
-	}
-
-	return i;
+	memset(rt, 0, sizeof(struct grspw2_router));
 }
 
 
 /**
- * @brief get number of available rx descriptors
+ * @brief add a core as a port of a software router
+ *
+ * @returns the port number or -1 on error
+ *
+ * @note the core's descriptor tables must already be configured and it must
+ *	 not be in use by any of the other operating modes
  */
 
-uint32_t grspw2_get_num_free_rx_desc_avail(struct grspw2_core_cfg *cfg)
+int32_t grspw2_router_add_port(struct grspw2_router *rt,
+			       struct grspw2_core_cfg *cfg)
 {
-	uint32_t i = 0;
+	struct grspw2_router_port *port;
 
-	struct grspw2_rx_desc_ring_elem *p_elem;
-	struct grspw2_rx_desc_ring_elem *p_tmp;
 
-	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_free, node) {
-		i++;
-	}
+	if (!rt)
+		return -1;
 
-	return i;
+	if (!cfg)
+		return -1;
+
+	if (rt->irq)
+		return -1;
+
+	if (rt->n_ports >= GRSPW2_ROUTER_PORTS)
+		return -1;
+
+	if (cfg->auto_drop || cfg->route[0] || cfg->rx_irq.enabled)
+		return -1;
+
+	port = &rt->port[rt->n_ports];
+
+	port->rt      = rt;
+	port->cfg     = cfg;
+	port->ref_idx = 0;
+
+	grspw2_set_tx_done_callback(cfg, grspw2_router_tx_done, (void *) rt);
+	grspw2_set_promiscuous(cfg);
+
+	rt->n_ports++;
+
+	return rt->n_ports;
 }
 
 
 /**
- * @brief check the EEP status of the next packet
+ * @brief configure the route of a logical address
  *
- * @returns 1 if EEP is present, 0 otherwise
+ * @param addr the logical address (32-254)
+ * @param port the output port, 0 to drop the packets
+ * @param strip delete the address byte from the packet if set
+ *
+ * @returns 0 on success, -1 on error
  */
 
-int grspw2_get_next_pkt_eep(struct grspw2_core_cfg *cfg)
+int32_t grspw2_router_set_route(struct grspw2_router *rt, uint8_t addr,
+				uint8_t port, uint8_t strip)
 {
-	struct grspw2_rx_desc_ring_elem *p_elem;
-
+	if (!rt)
+		return -1;
 
-	p_elem = grspw2_rx_desc_get_next_used(cfg);
-	if (!p_elem)
-		return 0;
+	if (addr < 32 || addr == 255)
+		return -1;
 
-	/* still active */
-	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
-		return 0;
+	if (port > GRSPW2_ROUTER_PORTS)
+		return -1;
 
-	/* EEP is set */
-	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EP)
-		return 1;
+	rt->lut[addr].port  = port;
+	rt->lut[addr].strip = strip;
 
 	return 0;
 }
 
 
+/**
+ * @brief look up the output port of a packet
+ *
+ * @param[out] skip the number of leading bytes to delete from the packet
+ *
+ * @returns the output port or NULL if the packet is to be dropped
+ */
 
-static irqreturn_t grspw2_auto_drop_call(unsigned int irq, void *userdata)
+static struct grspw2_router_port *grspw2_router_lookup(struct grspw2_router *rt,
+							const uint8_t *pkt,
+							uint32_t pkt_size,
+							uint32_t *skip)
+{
+	uint8_t addr;
+	uint8_t port;
+
+
+	if (!pkt_size)
+		return NULL;
+
+	addr = pkt[0];
+
+	if (addr < 32) {
+		port  = addr;
+		(*skip) = 1;
+	} else {
+		port  = rt->lut[addr].port;
+		(*skip) = rt->lut[addr].strip ? 1 : 0;
+	}
+
+	/* port 0 is the (non-existent) configuration port */
+	if (!port || port > rt->n_ports)
+		return NULL;
+
+	if (pkt_size <= (*skip))
+		return NULL;
+
+	return &rt->port[port - 1];
+}
+
+
+/**
+ * @brief enable the TX interrupt to be notified of a free TX descriptor
+ *
+ * @returns 1 if a descriptor became available in the meantime, 0 otherwise
+ *
+ * @note a descriptor that completed before the interrupt was enabled is not
+ *	 signalled, so the ring is checked once more
+ */
+
+static int grspw2_tx_desc_notify_free(struct grspw2_core_cfg *cfg)
+{
+	grspw2_tx_interrupt_enable(cfg);
+
+	grspw2_tx_desc_move_free_all(cfg);
+
+	return !list_empty(&cfg->tx_desc_ring_free);
+}
+
+
+/**
+ * @brief check whether a router output has a free TX descriptor
+ *
+ * @param port the input port
+ * @param out the output port
+ *
+ * @returns 1 if a descriptor is available, 0 otherwise
+ *
+ * @note a stalled input is recorded at the output and counted only once,
+ *	 not on every poll while the stall lasts; in polling mode, the stall
+ *	 ends once a descriptor is available again
+ *
+ * @note in interrupt mode, the TX interrupt of the output is enabled, so
+ *	 routing of the input resumes once a descriptor completes, see
+ *	 grspw2_router_resume()
+ */
+
+static int grspw2_router_tx_avail(struct grspw2_router_port *port,
+				  struct grspw2_router_port *out)
+{
+	uint32_t bit;
+
+	struct grspw2_core_cfg *cfg = out->cfg;
+
+
+	bit = 1UL << (port - port->rt->port);
+
+	grspw2_tx_desc_move_free_all(cfg);
+	if (!list_empty(&cfg->tx_desc_ring_free)) {
+		if (!port->rt->irq)
+			out->waiting &= ~bit;
+		return 1;
+	}
+
+	if (!(out->waiting & bit)) {
+		cfg->stats.tx_desc_unavail++;
+		port->rt->stalled++;
+	}
+
+	out->waiting |= bit;
+
+	if (!port->rt->irq)
+		return 0;
+
+	return grspw2_tx_desc_notify_free(cfg);
+}
+
+
+/**
+ * @brief forward the received packets of a router port
+ *
+ * @returns the number of packets forwarded
+ *
+ * @note routing of the port stops at the first packet for an output port
+ *	 that has no free TX descriptor left
+ */
+
+uint32_t grspw2_router_route_port(struct grspw2_router_port *port)
+{
+	int32_t ret;
+
+	uint8_t *pkt;
+	uint32_t pkt_size;
+	uint32_t skip = 0;
+	uint32_t n = 0;
+
+	struct grspw2_router *rt;
+	struct grspw2_core_cfg *cfg;
+	struct grspw2_router_port *out;
+	struct grspw2_router_ref *ref;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+	struct grspw2_rx_desc_ring_elem *p_tmp;
+
+
+	rt  = port->rt;
+	cfg = port->cfg;
+
+	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_used, node) {
+
+		if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+			break;
+
+		pkt      = (uint8_t *) p_elem->desc->pkt_addr;
+		pkt_size = p_elem->desc->pkt_size;
+
+		out = grspw2_router_lookup(rt, pkt, pkt_size, &skip);
+		if (!out) {
+			grspw2_rx_desc_readd(cfg, p_elem);
+			rt->dropped++;
+			continue;
+		}
+
+		/* backpressure: leave the packet in the RX ring */
+		if (!grspw2_router_tx_avail(port, out))
+			break;
+
+		cfg->rx_bytes += pkt_size;
+
+		if (!cfg->rx_spare.n) {
+			ret = grspw2_tx_desc_add_pkt(out->cfg, false, NULL, 0, 0,
+						     pkt + skip, pkt_size - skip);
+			grspw2_rx_desc_readd(cfg, p_elem);
+		} else {
+			ref = &out->ref[out->ref_idx];
+
+			out->ref_idx = (out->ref_idx + 1) % GRSPW2_TX_DESCRIPTORS;
+
+			ref->src = cfg;
+			ref->pkt = pkt + cfg->strip_hdr_bytes;
+
+			grspw2_rx_spare_swap(cfg, p_elem);
+			grspw2_rx_desc_readd(cfg, p_elem);
+
+			ret = grspw2_tx_desc_add_ref(out->cfg, false, NULL, 0, 0,
+						     pkt + skip, pkt_size - skip,
+						     (void *) ref, true);
+			if (unlikely(ret))
+				grspw2_return_pkt(cfg, ref->pkt);
+		}
+
+		if (unlikely(ret)) {
+			rt->dropped++;
+			continue;
+		}
+
+		out->cfg->tx_bytes += pkt_size - skip;
+
+		rt->routed++;
+		n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief forward the received packets of all router ports
+ *
+ * @returns the number of packets forwarded
+ */
+
+uint32_t grspw2_router_poll(struct grspw2_router *rt)
+{
+	uint32_t i;
+	uint32_t n = 0;
+
+
+	if (!rt)
+		return 0;
+
+	for (i = 0; i < rt->n_ports; i++)
+		n += grspw2_router_route_port(&rt->port[i]);
+
+	return n;
+}
+
+
+/**
+ * @brief resume routing of the input ports stalled on an output port
+ */
+
+static void grspw2_router_resume(struct grspw2_router_port *out)
+{
+	uint32_t i;
+	uint32_t waiting;
+
+
+	waiting = out->waiting;
+	if (!waiting)
+		return;
+
+	out->waiting = 0;
+
+	for (i = 0; i < out->rt->n_ports; i++) {
+		if (waiting & (1UL << i))
+			grspw2_router_route_port(&out->rt->port[i]);
+	}
+
+	/* no input stalled again */
+	if (!out->waiting)
+		grspw2_tx_interrupt_disable(out->cfg);
+}
+
+
+static irqreturn_t grspw2_router_call(unsigned int irq, void *userdata)
+{
+	struct grspw2_router_port *port;
+
+
+	port = (struct grspw2_router_port *) userdata;
+
+	grspw2_router_route_port(port);
+	grspw2_router_resume(port);
+
+	return 0;
+}
+
+
+/**
+ * @brief stop routing packets of a router port as they are received
+ */
+
+static void grspw2_router_port_disable_irq(struct grspw2_router_port *port)
+{
+	uint32_t i;
+
+	struct grspw2_core_cfg *cfg = port->cfg;
+
+
+	grspw2_rx_interrupt_disable(cfg);
+	grspw2_tx_interrupt_disable(cfg);
+
+	for (i = 0; i < cfg->rx_n_desc; i++)
+		grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[i]);
+
+	for (i = 0; i < cfg->tx_n_desc; i++)
+		grspw2_tx_desc_clear_irq(&cfg->tx_desc_ring[i]);
+
+	port->waiting = 0;
+
+	irq_free(cfg->core_irq, grspw2_router_call, (void *) port);
+}
+
+
+/**
+ * @brief route packets of all router ports as they are received
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note if the interrupt of a port cannot be registered, the ports already
+ *	 set up are reverted to polling mode
+ */
+
+int32_t grspw2_router_enable_irq(struct grspw2_router *rt)
+{
+	uint32_t i;
+	uint32_t j;
+
+	struct grspw2_core_cfg *cfg;
+
+
+	if (!rt)
+		return -1;
+
+	if (rt->irq)
+		return -1;
+
+	for (i = 0; i < rt->n_ports; i++) {
+
+		cfg = rt->port[i].cfg;
+
+		if (irq_request(cfg->core_irq, ISR_PRIORITY_NOW,
+				grspw2_router_call, (void *) &rt->port[i]))
+			goto unwind;
+
+		for (j = 0; j < cfg->rx_n_desc; j++)
+			grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[j]);
+
+		/* the TX interrupt is enabled on demand */
+		for (j = 0; j < cfg->tx_n_desc; j++)
+			grspw2_tx_desc_set_irq(&cfg->tx_desc_ring[j]);
+
+		rt->port[i].waiting = 0;
+
+		grspw2_rx_interrupt_enable(cfg);
+	}
+
+	rt->irq = 1;
+
+	return 0;
+
+unwind:
+	while (i--)
+		grspw2_router_port_disable_irq(&rt->port[i]);
+
+	return -1;
+}
+
+
+/**
+ * @brief stop routing packets of the router ports as they are received
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+int32_t grspw2_router_disable_irq(struct grspw2_router *rt)
+{
+	uint32_t i;
+
+
+	if (!rt)
+		return -1;
+
+	if (!rt->irq)
+		return -1;
+
+	for (i = 0; i < rt->n_ports; i++)
+		grspw2_router_port_disable_irq(&rt->port[i]);
+
+	rt->irq = 0;
+
+	return 0;
+}
+
+
+/**
+ * @brief initialise a software RMAP target
+ *
+ * @param tgt the target
+ * @param cfg the core configuration of the link to serve
+ * @param tla the target logical address
+ * @param key the key expected in the commands
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note the hardware RMAP target of the core is disabled, as it would
+ *	 otherwise take all commands addressed to the node
+ */
+
+int32_t grspw2_rmap_target_init(struct grspw2_rmap_target *tgt,
+				struct grspw2_core_cfg *cfg,
+				uint8_t tla, uint8_t key)
+{
+	if (!tgt)
+		return -1;
+
+	if (!cfg)
+		return -1;
+
+	/* the replies rely on the CRC generation of the core */
+	if (!(ioread32be(&cfg->regs->ctrl) & GRSPW2_CTRL_RC))
+		return -1;
+
+	memset(tgt, 0, sizeof(struct grspw2_rmap_target));
+
+	tgt->cfg = cfg;
+	tgt->tla = tla;
+	tgt->key = key;
+
+	grspw2_clear_rmap(cfg);
+
+	return 0;
+}
+
+
+/**
+ * @brief map local memory into the address space of an RMAP target
+ *
+ * @param tgt the target
+ * @param ext the extended address of the window
+ * @param addr the first RMAP address of the window
+ * @param mem the memory backing the window
+ * @param size the size of the window
+ * @param acc the permitted accesses (GRSPW2_RMAP_ACC_*)
+ * @param written a function to call after the window was modified (optional)
+ * @param userdata an arbitrary pointer passed to the function
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note in interrupt mode, the written() function is executed in interrupt
+ *	 context
+ */
+
+int32_t grspw2_rmap_target_add_window(struct grspw2_rmap_target *tgt,
+				      uint8_t ext, uint32_t addr,
+				      void *mem, uint32_t size, uint32_t acc,
+				      grspw2_rmap_written_t written,
+				      void *userdata)
+{
+	struct grspw2_rmap_window *win;
+
+
+	if (!tgt)
+		return -1;
+
+	if (!mem)
+		return -1;
+
+	if (!size)
+		return -1;
+
+	/* wraps the 32 bit address space */
+	if (addr + (size - 1) < addr)
+		return -1;
+
+	if (tgt->n_win >= GRSPW2_RMAP_WINDOWS)
+		return -1;
+
+	win = &tgt->win[tgt->n_win];
+
+	win->ext      = ext;
+	win->addr     = addr;
+	win->size     = size;
+	win->mem      = (uint8_t *) mem;
+	win->acc      = acc;
+	win->written  = written;
+	win->userdata = userdata;
+
+	tgt->n_win++;
+
+	return 0;
+}
+
+
+/**
+ * @brief find the window of an RMAP target which permits an access
+ *
+ * @returns the window or NULL if the access is not authorised
+ */
+
+static struct grspw2_rmap_window
+	*grspw2_rmap_target_lookup(struct grspw2_rmap_target *tgt,
+				   uint8_t ext, uint32_t addr, uint32_t len,
+				   uint32_t acc)
+{
+	uint32_t i;
+
+	struct grspw2_rmap_window *win;
+
+
+	for (i = 0; i < tgt->n_win; i++) {
+
+		win = &tgt->win[i];
+
+		if (win->ext != ext)
+			continue;
+
+		if (addr < win->addr)
+			continue;
+
+		if (addr - win->addr >= win->size)
+			continue;
+
+		if (len > win->size - (addr - win->addr))
+			continue;
+
+		if ((win->acc & acc) != acc)
+			continue;
+
+		if (win->acc & GRSPW2_RMAP_ACC_WORD)
+			if ((addr | len) & 0x3)
+				continue;
+
+		return win;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief check the data of a write or RMW command
+ *
+ * @param n the number of bytes following the header
+ * @param dlen the data length specified in the header
+ *
+ * @returns an RMAP status code
+ */
+
+static uint8_t grspw2_rmap_target_check_data(uint32_t ctrl, uint32_t n,
+					     uint32_t dlen)
+{
+	if (ctrl & GRSPW2_RX_DESC_EP)
+		return GRSPW2_RMAP_ERR_EEP;
+
+	/* the data is followed by its CRC */
+	if (n < dlen + 1)
+		return GRSPW2_RMAP_ERR_EOP;
+
+	if (n > dlen + 1)
+		return GRSPW2_RMAP_ERR_TOO_MUCH_DATA;
+
+	if (ctrl & GRSPW2_RX_DESC_DC)
+		return GRSPW2_RMAP_ERR_DATA_CRC;
+
+	return GRSPW2_RMAP_SUCCESS;
+}
+
+
+/**
+ * @brief check whether a TX descriptor is available for an RMAP reply
+ *
+ * @returns 1 if a descriptor is available, 0 otherwise
+ *
+ * @note in interrupt mode, the TX interrupt is enabled while the target is
+ *	 stalled, so processing resumes once a descriptor completes
+ */
+
+static int grspw2_rmap_target_tx_avail(struct grspw2_rmap_target *tgt)
+{
+	struct grspw2_core_cfg *cfg = tgt->cfg;
+
+
+	grspw2_tx_desc_move_free_all(cfg);
+	if (!list_empty(&cfg->tx_desc_ring_free))
+		return 1;
+
+	if (!tgt->irq)
+		return 0;
+
+	tgt->waiting = 1;
+
+	return grspw2_tx_desc_notify_free(cfg);
+}
+
+
+/**
+ * @brief execute an RMAP command
+ *
+ * @param pkt the command packet
+ * @param len the size of the packet
+ * @param ctrl the control word of the RX descriptor of the packet
+ *
+ * @returns 1 if the packet was consumed, 0 if it is not a command for the
+ *	    target, -1 if no TX descriptor is available for the reply
+ *
+ * @note The header and data CRCs are checked by the core as the packet is
+ *	 received and indicated in the RX descriptor. Commands are executed
+ *	 only after the complete packet was checked, so verified and
+ *	 unverified writes are the same.
+ */
+
+static int32_t grspw2_rmap_target_cmd(struct grspw2_rmap_target *tgt,
+				      uint8_t *pkt, uint32_t len,
+				      uint32_t ctrl)
+{
+	uint8_t ins;
+	uint8_t cmd;
+	uint8_t ext;
+	uint8_t status;
+
+	uint8_t *hdr;
+	uint8_t *rep;
+	uint8_t *mem = NULL;
+	uint8_t *data;
+
+	uint32_t i;
+	uint32_t ral;
+	uint32_t hlen;
+	uint32_t addr;
+	uint32_t dlen;
+	uint32_t size = 0;
+	uint32_t n_path;
+	uint32_t rep_size;
+
+	struct grspw2_core_cfg *cfg;
+	struct grspw2_rmap_window *win = NULL;
+
+
+	cfg = tgt->cfg;
+
+	if (len < 3)
+		return 0;
+
+	if (pkt[0] != tgt->tla)
+		return 0;
+
+	if (pkt[1] != GRSPW2_RMAP_PROTOCOL_ID)
+		return 0;
+
+	/* a reply, which is for an initiator */
+	ins = pkt[2];
+	if (!(ins & GRSPW2_RMAP_INS_CMD))
+		return 0;
+
+	ral  = (ins & GRSPW2_RMAP_INS_RAL_MASK) * 4;
+	hlen = GRSPW2_RMAP_CMD_HDR_SIZE + ral;
+
+	/* there is no trustworthy reply address, drop silently */
+	if ((len < hlen) || (ctrl & GRSPW2_RX_DESC_HC)) {
+		tgt->discarded++;
+		return 1;
+	}
+
+	/* the reply must be queued before the command is executed */
+	if (ins & GRSPW2_RMAP_INS_REPLY) {
+		if (!grspw2_rmap_target_tx_avail(tgt)) {
+			cfg->stats.tx_desc_unavail++;
+			tgt->stalled++;
+			return -1;
+		}
+	}
+
+	/* initiator logical address onwards */
+	hdr  = &pkt[4 + ral];
+	ext  = hdr[3];
+	addr = (hdr[4] << 24) | (hdr[5] << 16) | (hdr[6] << 8) | hdr[7];
+	dlen = (hdr[8] << 16) | (hdr[9] << 8) | hdr[10];
+	data = &pkt[hlen];
+
+	cmd = ins & (GRSPW2_RMAP_INS_WRITE | GRSPW2_RMAP_INS_VERIFY
+		     | GRSPW2_RMAP_INS_REPLY | GRSPW2_RMAP_INS_INC);
+
+	if (cmd & GRSPW2_RMAP_INS_WRITE)
+		win = grspw2_rmap_target_lookup(tgt, ext, addr, dlen,
+						GRSPW2_RMAP_ACC_WRITE);
+	else if ((cmd & ~GRSPW2_RMAP_INS_INC) == GRSPW2_RMAP_INS_REPLY)
+		win = grspw2_rmap_target_lookup(tgt, ext, addr, dlen,
+						GRSPW2_RMAP_ACC_READ);
+	else if (cmd == (GRSPW2_RMAP_INS_VERIFY | GRSPW2_RMAP_INS_REPLY
+			 | GRSPW2_RMAP_INS_INC))
+		win = grspw2_rmap_target_lookup(tgt, ext, addr, dlen / 2,
+						GRSPW2_RMAP_ACC_RMW);
+	else
+		cmd = 0;
+
+	if (!cmd)
+		status = GRSPW2_RMAP_ERR_UNUSED;
+	else if (pkt[3] != tgt->key)
+		status = GRSPW2_RMAP_ERR_KEY;
+	/* FIFO (non-incrementing) accesses are not implemented */
+	else if (!win || !(cmd & GRSPW2_RMAP_INS_INC))
+		status = GRSPW2_RMAP_ERR_AUTH;
+	else
+		status = GRSPW2_RMAP_SUCCESS;
+
+	/* RMW: data and mask of up to 4 bytes each */
+	if (!(cmd & GRSPW2_RMAP_INS_WRITE) && (cmd & GRSPW2_RMAP_INS_VERIFY)) {
+		size = dlen / 2;
+		if ((dlen & 0x1) || (size > 4))
+			if (status == GRSPW2_RMAP_SUCCESS)
+				status = GRSPW2_RMAP_ERR_RMW_LEN;
+	}
+
+	if (status == GRSPW2_RMAP_SUCCESS) {
+		if (cmd & (GRSPW2_RMAP_INS_WRITE | GRSPW2_RMAP_INS_VERIFY))
+			status = grspw2_rmap_target_check_data(ctrl, len - hlen,
+							       dlen);
+		else if (ctrl & GRSPW2_RX_DESC_EP)
+			status = GRSPW2_RMAP_ERR_EEP;
+		else if (len > hlen)	/* a read has no data */
+			status = GRSPW2_RMAP_ERR_TOO_MUCH_DATA;
+	}
+
+	if (status != GRSPW2_RMAP_SUCCESS) {
+		tgt->errors++;
+	} else if (cmd & GRSPW2_RMAP_INS_WRITE) {
+		mem = &win->mem[addr - win->addr];
+		memcpy(mem, data, dlen);
+		tgt->writes++;
+	} else if (cmd & GRSPW2_RMAP_INS_VERIFY) {
+		/* the original data is returned in the reply */
+		mem = &win->mem[addr - win->addr];
+		rep = &tgt->reply[tgt->reply_idx][GRSPW2_RMAP_REPLY_DATA];
+		for (i = 0; i < size; i++) {
+			rep[i] = mem[i];
+			mem[i] = (data[i] & data[size + i])
+				 | (mem[i] & ~data[size + i]);
+		}
+		tgt->rmws++;
+	} else {
+		mem = &win->mem[addr - win->addr];
+		tgt->reads++;
+	}
+
+	if ((status == GRSPW2_RMAP_SUCCESS) && win->written
+	    && (cmd & (GRSPW2_RMAP_INS_WRITE | GRSPW2_RMAP_INS_VERIFY)))
+		win->written(win, addr - win->addr, size ? size : dlen,
+			     win->userdata);
+
+	if (!(ins & GRSPW2_RMAP_INS_REPLY))
+		return 1;
+
+	rep = tgt->reply[tgt->reply_idx];
+
+	tgt->reply_idx = (tgt->reply_idx + 1) % GRSPW2_TX_DESCRIPTORS;
+
+	/* leading zeros of the reply address are skipped, the remainder is
+	 * the path to the initiator and excluded from the header CRC
+	 */
+	for (i = 0; (i < ral) && !pkt[4 + i]; i++);
+
+	n_path = ral - i;
+	memcpy(rep, &pkt[4 + i], n_path);
+
+	rep[n_path + 0] = hdr[0];
+	rep[n_path + 1] = GRSPW2_RMAP_PROTOCOL_ID;
+	rep[n_path + 2] = ins & ~GRSPW2_RMAP_INS_CMD;
+	rep[n_path + 3] = status;
+	rep[n_path + 4] = tgt->tla;
+	rep[n_path + 5] = hdr[1];
+	rep[n_path + 6] = hdr[2];
+
+	if (cmd & GRSPW2_RMAP_INS_WRITE) {
+		rep_size = n_path + GRSPW2_RMAP_WRITE_REPLY_SIZE;
+		mem      = NULL;
+		dlen     = 0;
+	} else {
+		/* read or RMW reply, without data on error */
+		if (status != GRSPW2_RMAP_SUCCESS)
+			dlen = 0;
+		else if (cmd & GRSPW2_RMAP_INS_VERIFY)
+			dlen = size;
+
+		if (cmd & GRSPW2_RMAP_INS_VERIFY)
+			mem = &rep[GRSPW2_RMAP_REPLY_DATA];
+
+		rep[n_path +  7] = 0;
+		rep[n_path +  8] = (dlen >> 16) & 0xFF;
+		rep[n_path +  9] = (dlen >>  8) & 0xFF;
+		rep[n_path + 10] =  dlen        & 0xFF;
+
+		rep_size = n_path + GRSPW2_RMAP_READ_REPLY_SIZE;
+	}
+
+	/* Read data is sent directly from the window. A TX descriptor was
+	 * available above, so this does not fail.
+	 */
+	grspw2_tx_desc_add_ref(cfg, true, rep, rep_size, n_path, mem, dlen,
+			       NULL, false);
+
+	return 1;
+}
+
+
+/**
+ * @brief execute the pending RMAP commands of a target
+ *
+ * @returns the number of packets processed
+ *
+ * @note Processing stops at the first packet which is not an RMAP command
+ *	 for the target, so it remains in order with any other traffic on the
+ *	 link for retrieval via grspw2_get_pkt(). The next call processes the
+ *	 commands following it. Processing also stops if no TX descriptor is
+ *	 available for a reply, the command is then retried on the next call.
+ *	 In interrupt mode, this happens once a TX descriptor completes.
+ */
+
+uint32_t grspw2_rmap_target_poll(struct grspw2_rmap_target *tgt)
+{
+	int32_t ret;
+	uint32_t n = 0;
+
+	struct grspw2_core_cfg *cfg;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+	struct grspw2_rx_desc_ring_elem *p_tmp;
+
+
+	if (!tgt)
+		return 0;
+
+	cfg = tgt->cfg;
+
+	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_used, node) {
+
+		if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+			break;
+
+		ret = grspw2_rmap_target_cmd(tgt,
+					     (uint8_t *) p_elem->desc->pkt_addr,
+					     p_elem->desc->pkt_size,
+					     p_elem->desc->pkt_ctrl);
+		if (ret <= 0)
+			break;
+
+		cfg->rx_bytes += p_elem->desc->pkt_size;
+
+		grspw2_rx_desc_readd(cfg, p_elem);
+
+		n++;
+	}
+
+	return n;
+}
+
+
+static irqreturn_t grspw2_rmap_target_call(unsigned int irq, void *userdata)
+{
+	struct grspw2_rmap_target *tgt;
+
+
+	tgt = (struct grspw2_rmap_target *) userdata;
+
+	tgt->waiting = 0;
+
+	grspw2_rmap_target_poll(tgt);
+
+	/* the TX interrupt is only needed while a reply is stalled */
+	if (!tgt->waiting)
+		grspw2_tx_interrupt_disable(tgt->cfg);
+
+	return 0;
+}
+
+
+/**
+ * @brief execute the RMAP commands of a target as they are received
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note not available while the link is in auto-drop, routing or
+ *	 interrupt-driven reception mode
+ */
+
+int32_t grspw2_rmap_target_enable_irq(struct grspw2_rmap_target *tgt)
+{
+	uint32_t i;
+
+	struct grspw2_core_cfg *cfg;
+
+
+	if (!tgt)
+		return -1;
+
+	if (tgt->irq)
+		return -1;
+
+	cfg = tgt->cfg;
+
+	if (cfg->auto_drop || cfg->route[0] || cfg->rx_irq.enabled)
+		return -1;
+
+	if (irq_request(cfg->core_irq, ISR_PRIORITY_NOW,
+			grspw2_rmap_target_call, (void *) tgt))
+		return -1;
+
+	for (i = 0; i < cfg->rx_n_desc; i++)
+		grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[i]);
+
+	/* the TX interrupt is enabled on demand */
+	for (i = 0; i < cfg->tx_n_desc; i++)
+		grspw2_tx_desc_set_irq(&cfg->tx_desc_ring[i]);
+
+	grspw2_rx_interrupt_enable(cfg);
+
+	tgt->irq     = 1;
+	tgt->waiting = 0;
+
+	/* pick up what arrived before */
+	grspw2_rmap_target_poll(tgt);
+
+	return 0;
+}
+
+
+/**
+ * @brief stop executing the RMAP commands of a target as they are received
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+int32_t grspw2_rmap_target_disable_irq(struct grspw2_rmap_target *tgt)
+{
+	uint32_t i;
+
+	struct grspw2_core_cfg *cfg;
+
+
+	if (!tgt)
+		return -1;
+
+	if (!tgt->irq)
+		return -1;
+
+	cfg = tgt->cfg;
+
+	grspw2_rx_interrupt_disable(cfg);
+	grspw2_tx_interrupt_disable(cfg);
+
+	for (i = 0; i < cfg->rx_n_desc; i++)
+		grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[i]);
+
+	for (i = 0; i < cfg->tx_n_desc; i++)
+		grspw2_tx_desc_clear_irq(&cfg->tx_desc_ring[i]);
+
+	irq_free(cfg->core_irq, grspw2_rmap_target_call, (void *) tgt);
+
+	tgt->irq     = 0;
+	tgt->waiting = 0;
+
+	return 0;
+}
+
+
+/**
+ * @brief retrieve number of packets available
+ */
+
+uint32_t grspw2_get_num_pkts_avail(struct grspw2_core_cfg *cfg)
+{
+	uint32_t i = 0;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+	struct grspw2_rx_desc_ring_elem *p_tmp;
+
+	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_used, node) {
+		if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+			break;
+		i++;
+	}
+
+	if (i > cfg->stats.rx_desc_hwm)
+		cfg->stats.rx_desc_hwm = i;
+
+	return i;
+}
+
+
+/**
+ * @brief get number of available free tx descriptors
+ */
+
+uint32_t grspw2_get_num_free_tx_desc_avail(struct grspw2_core_cfg *cfg)
+{
+	uint32_t i = 0;
+
+	struct grspw2_tx_desc_ring_elem *p_elem;
+	struct grspw2_tx_desc_ring_elem *p_tmp;
+
+	list_for_each_entry_safe(p_elem, p_tmp, &cfg->tx_desc_ring_free, node) {
+		i++;
+	}
+
+	return i;
+}
+
+
+/**
+ * @brief get number of available rx descriptors
+ */
+
+uint32_t grspw2_get_num_free_rx_desc_avail(struct grspw2_core_cfg *cfg)
+{
+	uint32_t i = 0;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+	struct grspw2_rx_desc_ring_elem *p_tmp;
+
+	list_for_each_entry_safe(p_elem, p_tmp, &cfg->rx_desc_ring_free, node) {
+		i++;
+	}
+
+	return i;
+}
+
+
+/**
+ * @brief check the EEP status of the next packet
+ *
+ * @returns 1 if EEP is present, 0 otherwise
+ */
+
+int grspw2_get_next_pkt_eep(struct grspw2_core_cfg *cfg)
+{
+	struct grspw2_rx_desc_ring_elem *p_elem;
+
+
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
+	if (!p_elem)
+		return 0;
+
+	/* still active */
+	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+		return 0;
+
+	/* EEP is set */
+	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EP)
+		return 1;
+
+	return 0;
+}
+
+
+
+static irqreturn_t grspw2_auto_drop_call(unsigned int irq, void *userdata)
+{
+	int i;
+	int idx;
+	uint32_t used;
+
+	struct grspw2_core_cfg *cfg;
+	struct grspw2_rx_desc_ring_elem *p_elem;
+
+
+
+	cfg = (struct grspw2_core_cfg *) userdata;
+
+	/* all packets up to the IE descriptor are pending */
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
+	if (p_elem) {
+		used = &cfg->rx_desc_ring[cfg->idx_drop] - p_elem + 1;
+		if (&cfg->rx_desc_ring[cfg->idx_drop] < p_elem)
+			used += cfg->rx_n_desc;
+
+		if (used > cfg->stats.rx_desc_hwm)
+			cfg->stats.rx_desc_hwm = used;
+	}
+
+
+	/* clear irq on the previous IE descriptor  */
+	grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[cfg->idx_drop]);
+
+	/* move IE flag forward */
+	idx = cfg->idx_drop + cfg->n_drop;
+	if (idx >= cfg->rx_n_desc)
+		idx = idx - cfg->rx_n_desc;
+
+	/* set flag on new */
+	grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
+	cfg->idx_drop = idx;
+
+	/* drop the stale packets */
+	for (i = 0; i < cfg->n_drop; i++) {
+
+		p_elem = grspw2_rx_desc_get_next_used(cfg);
+		if (!p_elem)
+			break; /* should never happen */
+
+		cfg->rx_bytes += p_elem->desc->pkt_size;
+		cfg->stats.rx_auto_dropped++;
+		/* re-add the descriptor of the packet we just dropped */
+		grspw2_rx_desc_readd(cfg, p_elem);
+	}
+
+
+
+	return 0;
+}
+
+
+/**
+ * @brief enable auto-drop of the oldest packet from the descriptor table
+ *	  in situations where the RX table runs full
+ *
+ * @param n_drop the number of packets to drop at once
+ *
+ * @note the actual number of packets to be dropped depends on the configured
+ *	 number of RX descriptors for the particular link; if n_drop is larger
+ *	 or equal the number of descriptors, it will be clamped to (n_drop - 1)
+ *
+ * @warn There is no guard against setting n_drop too low; in situations where
+ *	 CONFIG_IRQ_RATE_PROTECT is enabled and CONFIG_IRQ_MIN_INTER_US is
+ *	 set too low this could lead to IRQs being lost when n_drop is set too
+ *	 low as well. This does not actually interfere with the proper SpW
+ *	 operation and will self-correct as long as packets are fetched by
+ *	 calling grspw2_get_pkt(). Note that this feature was only introduced
+ *	 as a mitigation of malfunctioning HW such as the SMILE FEE which
+ *	 appears to permanently stop functioning without the ability to recover
+ *	 during the acquisition cycle in certain modes where the packet
+ *	 generation rate is at the limit of its own SpW device and all of its
+ *	 packet buffers are full.
+ *
+ * @returns the number of n_drop, < 0 on error
+ */
+
+int grspw2_auto_drop_enable(struct grspw2_core_cfg *cfg, uint8_t n_drop)
+{
+	int ret;
+	uintptr_t idx;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+
+
+	if (!cfg)
+		return -1;
+
+	if (cfg->auto_drop)
+		return -1;
+
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
+
+	/* clamp, we want to have at least one useable slot */
+	if ((uint32_t)n_drop >= cfg->rx_n_desc)
+		n_drop = (uint8_t)(cfg->rx_n_desc - 1);
+	cfg->n_drop = (int)n_drop;
+
+	/* set IE bit relative to current  head of the list */
+	idx = (uintptr_t)p_elem->desc - (uintptr_t)cfg->rx_desc_ring[0].desc;
+	idx /= sizeof(struct grspw2_rx_desc);
+	idx += cfg->n_drop;
+	if (idx >= cfg->rx_n_desc)
+		idx = idx - cfg->rx_n_desc;
+
+
+	cfg->auto_drop = 1;
+	cfg->idx_drop = idx;
+	grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
+
+	ret = irq_request(cfg->core_irq, ISR_PRIORITY_NOW, grspw2_auto_drop_call, (void *)cfg);
+	grspw2_rx_interrupt_enable(cfg);
+
+	return ret;
+}
+
+
+/**
+ * @brief disable auto-drop of the oldest packet from the descriptor table
+ *	  in situations where the table runs full
+ *
+ * @returns 0 on success, otherwise error
+ */
+
+int grspw2_auto_drop_disable(struct grspw2_core_cfg *cfg)
+{
+	if (!cfg)
+		return -1;
+
+	if (!cfg->auto_drop)
+		return -1;
+
+	grspw2_rx_interrupt_disable(cfg);
+
+	cfg->auto_drop = 0;
+
+	return irq_free(cfg->core_irq, grspw2_auto_drop_call, (void *)cfg);
+}
+
+
+/**
+ * @brief move the auto-drop IE flag forward by one after a packet was
+ *	  picked up by the user
+ */
+
+static void grspw2_auto_drop_advance(struct grspw2_core_cfg *cfg)
 {
-	int i;
 	int idx;
 
-	struct grspw2_core_cfg *cfg;
+
+	idx = cfg->idx_drop + 1;
+	if (idx >= cfg->rx_n_desc)
+		idx = idx - cfg->rx_n_desc;
+
+	grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[cfg->idx_drop]);
+	cfg->idx_drop = idx;
+	grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
+}
+
+
+/**
+ * @brief retrieve the size of the next packet
+ */
+
+uint32_t grspw2_get_next_pkt_size(struct grspw2_core_cfg *cfg)
+{
+	uint32_t pkt_size;
+
 	struct grspw2_rx_desc_ring_elem *p_elem;
 
 
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
 
-	cfg = (struct grspw2_core_cfg *) userdata;
+	if (!p_elem)
+		return 0;
 
+	/* still active */
+	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+		return 0;
 
-	/* clear irq on the previous IE descriptor  */
-	grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[cfg->idx_drop]);
+	pkt_size = p_elem->desc->pkt_size - cfg->strip_hdr_bytes;
 
-	/* move IE flag forward */
-	idx = cfg->idx_drop + cfg->n_drop;
-	if (idx >= cfg->rx_n_desc)
-		idx = idx - cfg->rx_n_desc;
+	return pkt_size;
+}
 
-	/* set flag on new */
-	grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
-	cfg->idx_drop = idx;
 
-	/* drop the stale packets */
-	for (i = 0; i < cfg->n_drop; i++) {
 
-		p_elem = grspw2_rx_desc_get_next_used(cfg);
-		if (!p_elem)
-			break; /* should never happen */
+/**
+ * @brief retrieve a packet
+ *
+ * @param pkt if the packet return buffer
+ *	  if NULL, the size of the pending packet is returned
+ */
 
-		cfg->rx_bytes += p_elem->desc->pkt_size;
-		/* re-add the descriptor of the packet we just dropped */
-		grspw2_rx_desc_readd(cfg, p_elem);
+uint32_t grspw2_get_pkt(struct grspw2_core_cfg *cfg, uint8_t *pkt)
+{
+	uint32_t pkt_size = 0;
+
+	struct grspw2_rx_desc_ring_elem *p_elem;
+
+
+	/*
+	 * XXX we have no locks at this time, so there is a non-zero possibility
+	 * of interference between the IRL and a user call when auto_drop is
+	 * enable
+	 * for now we just disable the RX interrupt here in case we are
+	 * preempted
+	 */
+	if (cfg->auto_drop)
+		grspw2_rx_interrupt_disable(cfg);
+
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
+	if (!p_elem)
+		goto exit;
+
+	/* still active */
+	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
+		goto exit;
+
+	pkt_size = p_elem->desc->pkt_size - cfg->strip_hdr_bytes;
+	if (!pkt)
+		goto exit;
+
+	cfg->rx_bytes += p_elem->desc->pkt_size;
+
+	memcpy((void *) pkt,
+	       (void *) (p_elem->desc->pkt_addr + cfg->strip_hdr_bytes),
+	       pkt_size);
+
+	grspw2_rx_desc_readd(cfg, p_elem);
+
+
+	if (cfg->auto_drop)
+		grspw2_auto_drop_advance(cfg);
+
+exit:
+	if (cfg->auto_drop)
+		grspw2_rx_interrupt_enable(cfg);
+
+	return pkt_size;
+}
+
+
+/**
+ * @brief retrieve a batch of packets
+ *
+ * @param cfg the core configuration
+ * @param buf an array of packet buffers
+ * @param n the number of buffers in the array
+ *
+ * @returns the number of packets retrieved or -1 on error
+ *
+ * @note the size of each packet is returned in the len field of its buffer;
+ *	 the call returns early if no further packet is available or if the
+ *	 next packet does not fit the next buffer, in which case the packet
+ *	 remains pending
+ *
+ * @note if interrupt-driven reception is enabled, the RX interrupt is masked
+ *	 and the number of pending packets is updated as in grspw2_recv()
+ */
+
+int32_t grspw2_get_pkts(struct grspw2_core_cfg *cfg,
+			struct grspw2_pkt_buf *buf, uint32_t n)
+{
+	uint32_t i;
+	uint32_t pkt_size;
+
+
+	if (!cfg)
+		return -1;
+
+	if (!buf)
+		return -1;
+
+	/* the interrupt handler must not walk the descriptor table while
+	 * we move descriptors
+	 */
+	if (cfg->rx_irq.enabled)
+		grspw2_rx_interrupt_disable(cfg);
+
+	for (i = 0; i < n; i++) {
+
+		if (!buf[i].pkt)
+			break;
+
+		pkt_size = grspw2_get_next_pkt_size(cfg);
+		if (!pkt_size)
+			break;
+
+		if (pkt_size > buf[i].size)
+			break;
+
+		buf[i].len = grspw2_get_pkt(cfg, buf[i].pkt);
+		if (!buf[i].len)
+			break;
+	}
+
+	if (cfg->rx_irq.enabled) {
+		cfg->rx_irq.n = grspw2_get_num_pkts_avail(cfg);
+		grspw2_rx_interrupt_enable(cfg);
 	}
 
+	return (int32_t) i;
+}
+
+
+/**
+ * @brief RX interrupt handler, harvests completed descriptors
+ */
+
+static irqreturn_t grspw2_rx_irq_call(unsigned int irq, void *userdata)
+{
+	struct grspw2_core_cfg *cfg;
+
+
+	cfg = (struct grspw2_core_cfg *) userdata;
 
+	cfg->rx_irq.n = grspw2_get_num_pkts_avail(cfg);
 
 	return 0;
 }
 
 
 /**
- * @brief enable auto-drop of the oldest packet from the descriptor table
- *	  in situations where the RX table runs full
+ * @brief enable interrupt-driven reception
  *
- * @param n_drop the number of packets to drop at once
+ * @param cfg the core configuration
+ * @param coalesce the number of packets to receive per interrupt
+ * @param timeout_us the maximum time a blocked reader waits for a partially
+ *	  filled batch of packets, 0 to only wake on complete batches
  *
- * @note the actual number of packets to be dropped depends on the configured
- *	 number of RX descriptors for the particular link; if n_drop is larger
- *	 or equal the number of descriptors, it will be clamped to (n_drop - 1)
+ * @returns 0 on success, -1 on error
  *
- * @warn There is no guard against setting n_drop too low; in situations where
- *	 CONFIG_IRQ_RATE_PROTECT is enabled and CONFIG_IRQ_MIN_INTER_US is
- *	 set too low this could lead to IRQs being lost when n_drop is set too
- *	 low as well. This does not actually interfere with the proper SpW
- *	 operation and will self-correct as long as packets are fetched by
- *	 calling grspw2_get_pkt(). Note that this feature was only introduced
- *	 as a mitigation of malfunctioning HW such as the SMILE FEE which
- *	 appears to permanently stop functioning without the ability to recover
- *	 during the acquisition cycle in certain modes where the packet
- *	 generation rate is at the limit of its own SpW device and all of its
- *	 packet buffers are full.
+ * @note The interrupt flag is set on every n-th RX descriptor in the table,
+ *	 so if the number of descriptors is not a multiple of the coalescing
+ *	 threshold, the batch which crosses the end of the table is shorter.
  *
- * @returns the number of n_drop, < 0 on error
+ * @note this cannot be used together with routing or auto-drop mode
  */
 
-int grspw2_auto_drop_enable(struct grspw2_core_cfg *cfg, uint8_t n_drop)
+int32_t grspw2_rx_irq_enable(struct grspw2_core_cfg *cfg,
+			     uint32_t coalesce, uint32_t timeout_us)
 {
-	int ret;
-	uintptr_t idx;
-
-	struct grspw2_rx_desc_ring_elem *p_elem;
+	uint32_t i;
 
 
 	if (!cfg)
 		return -1;
 
-	if (cfg->auto_drop)
+	if (cfg->rx_irq.enabled)
 		return -1;
 
-	p_elem = grspw2_rx_desc_get_next_used(cfg);
+	if (cfg->auto_drop || cfg->route[0])
+		return -1;
 
-	/* clamp, we want to have at least one useable slot */
-	if ((uint32_t)n_drop >= cfg->rx_n_desc)
-		n_drop = (uint8_t)(cfg->rx_n_desc - 1);
-	cfg->n_drop = (int)n_drop;
+	if (!coalesce)
+		coalesce = 1;
 
-	/* set IE bit relative to current  head of the list */
-	idx = (uintptr_t)p_elem->desc - (uintptr_t)cfg->rx_desc_ring[0].desc;
-	idx /= sizeof(struct grspw2_rx_desc);
-	idx += cfg->n_drop;
-	if (idx >= cfg->rx_n_desc)
-		idx = idx - cfg->rx_n_desc;
+	if (coalesce > cfg->rx_n_desc)
+		coalesce = cfg->rx_n_desc;
 
+	cfg->rx_irq.coalesce   = coalesce;
+	cfg->rx_irq.timeout_us = timeout_us;
+	cfg->rx_irq.n          = grspw2_get_num_pkts_avail(cfg);
 
-	cfg->auto_drop = 1;
-	cfg->idx_drop = idx;
-	grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
+	for (i = coalesce - 1; i < cfg->rx_n_desc; i += coalesce)
+		grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[i]);
+
+	if (irq_request(cfg->core_irq, ISR_PRIORITY_NOW,
+			grspw2_rx_irq_call, (void *) cfg))
+		return -1;
+
+	cfg->rx_irq.enabled = 1;
 
-	ret = irq_request(cfg->core_irq, ISR_PRIORITY_NOW, grspw2_auto_drop_call, (void *)cfg);
 	grspw2_rx_interrupt_enable(cfg);
 
-	return ret;
+	return 0;
+}
+
+
+/**
+ * @brief disable interrupt-driven reception
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+int32_t grspw2_rx_irq_disable(struct grspw2_core_cfg *cfg)
+{
+	uint32_t i;
+
+
+	if (!cfg)
+		return -1;
+
+	if (!cfg->rx_irq.enabled)
+		return -1;
+
+	grspw2_rx_interrupt_disable(cfg);
+
+	for (i = 0; i < cfg->rx_n_desc; i++)
+		grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[i]);
+
+	cfg->rx_irq.enabled = 0;
+
+	return irq_free(cfg->core_irq, grspw2_rx_irq_call, (void *) cfg);
+}
+
+
+/**
+ * @brief wait for and retrieve a packet
+ *
+ * @param cfg the core configuration
+ * @param pkt the packet return buffer
+ * @param timeout_us the maximum time to wait for a packet, 0 to wait forever
+ *
+ * @returns the size of the packet, 0 on timeout
+ *
+ * @note If interrupt-driven reception is enabled, the caller yields the CPU
+ *	 until the interrupt handler signals a completed batch of packets or
+ *	 the coalescing timeout configured in grspw2_rx_irq_enable() expires,
+ *	 so the descriptor table is only inspected when there is something to
+ *	 fetch. Otherwise, the descriptor table is polled.
+ *
+ * @note If interrupt-driven reception is enabled, the RX interrupt is masked
+ *	 while a packet is fetched. Afterwards, the number of pending packets
+ *	 is taken from the descriptor table, so the reader keeps fetching until
+ *	 the table is empty and cannot miss a completion that would have been
+ *	 signalled in the meantime. In polling mode, the RX interrupt is not
+ *	 touched, as it may be in use by someone else.
+ */
+
+uint32_t grspw2_recv(struct grspw2_core_cfg *cfg, uint8_t *pkt,
+		     uint32_t timeout_us)
+{
+	uint32_t pkt_size;
+
+	ktime now;
+	ktime start;
+	ktime poll;
+
+
+	if (!cfg)
+		return 0;
+
+	if (!pkt)
+		return 0;
+
+	start = ktime_get();
+	poll  = start;
+
+	while (1) {
+
+		now = ktime_get();
+
+		if (!cfg->rx_irq.enabled || cfg->rx_irq.n ||
+		    (cfg->rx_irq.timeout_us &&
+		     ktime_us_delta(now, poll) >= cfg->rx_irq.timeout_us)) {
+
+			poll = now;
+
+			/* the interrupt handler walks the descriptor table,
+			 * so it must not run while we move descriptors
+			 */
+			if (cfg->rx_irq.enabled)
+				grspw2_rx_interrupt_disable(cfg);
+
+			pkt_size = grspw2_get_pkt(cfg, pkt);
+
+			/* packets completed while the interrupt was masked
+			 * were not signalled, so count what is left
+			 */
+			if (cfg->rx_irq.enabled) {
+				cfg->rx_irq.n = grspw2_get_num_pkts_avail(cfg);
+				grspw2_rx_interrupt_enable(cfg);
+			}
+
+			if (pkt_size)
+				return pkt_size;
+		}
+
+		if (timeout_us && ktime_us_delta(now, start) >= timeout_us)
+			return 0;
+
+		sched_yield();
+	}
+}
+
+
+/**
+ * @brief configure the spare buffer pool used for zero-copy reception
+ *
+ * @param pkt_buf the spare packet buffer memory
+ * @param pkt_size the size of a single packet buffer, must be at least the
+ *	  size of the packet buffers configured in grspw2_rx_desc_table_init()
+ * @param n_pkt the number of packet buffers in pkt_buf
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note the pool can only be configured once per core configuration and
+ *	 only after the RX descriptor table was initialised
+ */
+
+int32_t grspw2_rx_spare_pool_init(struct grspw2_core_cfg *cfg,
+				  uint8_t *pkt_buf, uint32_t pkt_size,
+				  uint32_t n_pkt)
+{
+	uint32_t i;
+
+
+	if (!cfg)
+		return -1;
+
+	if (!pkt_buf)
+		return -1;
+
+	if (!n_pkt)
+		return -1;
+
+	if (cfg->rx_spare.buf)
+		return -1;
+
+	/* the spare buffers replace the ring buffers in the descriptors */
+	if (!cfg->rx_n_desc || (pkt_size < cfg->ring.rx_mtu))
+		return -1;
+
+	/* the spare stack and the loaned buffers, of which there can be no
+	 * more than spares in total
+	 */
+	cfg->rx_spare.buf = kmalloc(2 * n_pkt * sizeof(uint32_t));
+	if (!cfg->rx_spare.buf)
+		return -1;
+
+	for (i = 0; i < n_pkt; i++)
+		cfg->rx_spare.buf[i] = (uint32_t) &pkt_buf[i * pkt_size];
+
+	cfg->rx_spare.n      = n_pkt;
+	cfg->rx_spare.n_max  = n_pkt;
+	cfg->rx_spare.loan   = &cfg->rx_spare.buf[n_pkt];
+	cfg->rx_spare.n_loan = 0;
+
+	return 0;
 }
 
 
 /**
- * @brief disable auto-drop of the oldest packet from the descriptor table
- *	  in situations where the table runs full
+ * @brief take a packet buffer off the list of loaned buffers
  *
- * @returns 0 on success, otherwise error
+ * @returns 0 on success, -1 if the buffer is not loaned
+ *
+ * @note buffers in the spare pool or installed in a descriptor are not
+ *	 loaned, so they can never be handed back twice
  */
 
-int grspw2_auto_drop_disable(struct grspw2_core_cfg *cfg)
+static int grspw2_rx_spare_unloan(struct grspw2_core_cfg *cfg, uint32_t addr)
 {
-	if (!cfg)
-		return -1;
+	uint32_t i;
 
-	if (!cfg->auto_drop)
-		return -1;
 
-	grspw2_rx_interrupt_disable(cfg);
+	for (i = 0; i < cfg->rx_spare.n_loan; i++) {
+		if (cfg->rx_spare.loan[i] == addr)
+			break;
+	}
 
-	cfg->auto_drop = 0;
+	if (i == cfg->rx_spare.n_loan)
+		return -1;
 
-	return irq_free(cfg->core_irq, grspw2_auto_drop_call, (void *)cfg);
+	cfg->rx_spare.loan[i] = cfg->rx_spare.loan[--cfg->rx_spare.n_loan];
+
+	return 0;
 }
 
 
 /**
- * @brief retrieve the size of the next packet
+ * @brief retrieve a packet without copying it
+ *
+ * @param[out] pkt_size the size of the packet
+ *
+ * @returns a pointer to the packet or NULL if no packet or no spare buffer
+ *	    was available
+ *
+ * @note The packet buffer of the next completed RX descriptor is handed to
+ *	 the caller and the descriptor is immediately re-added to the ring
+ *	 with a buffer from the spare pool. The buffer must be handed back via
+ *	 grspw2_return_pkt() once it is no longer in use. If the spare pool
+ *	 is exhausted, packets stay in the ring (and the link will eventually
+ *	 pause) until buffers are returned or the packets are fetched via
+ *	 grspw2_get_pkt().
  */
 
-uint32_t grspw2_get_next_pkt_size(struct grspw2_core_cfg *cfg)
+void *grspw2_loan_pkt(struct grspw2_core_cfg *cfg, uint32_t *pkt_size)
 {
-	uint32_t pkt_size;
+	void *pkt = NULL;
 
 	struct grspw2_rx_desc_ring_elem *p_elem;
 
 
-	p_elem = grspw2_rx_desc_get_next_used(cfg);
+	if (!cfg->rx_spare.n)
+		return NULL;
+
+	/* see grspw2_get_pkt() */
+	if (cfg->auto_drop)
+		grspw2_rx_interrupt_disable(cfg);
 
+	p_elem = grspw2_rx_desc_get_next_used(cfg);
 	if (!p_elem)
-		return 0;
+		goto exit;
 
 	/* still active */
 	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
-		return 0;
+		goto exit;
 
-	pkt_size = p_elem->desc->pkt_size - cfg->strip_hdr_bytes;
+	cfg->rx_bytes += p_elem->desc->pkt_size;
 
-	return pkt_size;
-}
+	if (pkt_size)
+		(*pkt_size) = p_elem->desc->pkt_size - cfg->strip_hdr_bytes;
+
+	/* replenish with a spare buffer */
+	pkt = (void *) (grspw2_rx_spare_swap(cfg, p_elem)
+			+ cfg->strip_hdr_bytes);
+
+	grspw2_rx_desc_readd(cfg, p_elem);
+
+	if (cfg->auto_drop)
+		grspw2_auto_drop_advance(cfg);
+
+exit:
+	if (cfg->auto_drop)
+		grspw2_rx_interrupt_enable(cfg);
 
+	return pkt;
+}
 
 
 /**
- * @brief retrieve a packet
+ * @brief hand a packet buffer retrieved via grspw2_loan_pkt() back to the
+ *	  driver
  *
- * @param pkt if the packet return buffer
- *	  if NULL, the size of the pending packet is returned
+ * @param pkt the packet pointer as returned by grspw2_loan_pkt()
+ *
+ * @returns 0 on success, -1 if the pointer is not a loaned packet buffer
  */
 
-uint32_t grspw2_get_pkt(struct grspw2_core_cfg *cfg, uint8_t *pkt)
+int32_t grspw2_return_pkt(struct grspw2_core_cfg *cfg, void *pkt)
 {
-	uint32_t pkt_size = 0;
+	uint32_t addr;
 
-	struct grspw2_rx_desc_ring_elem *p_elem;
 
+	if (!pkt)
+		return -1;
 
-	/*
-	 * XXX we have no locks at this time, so there is a non-zero possibility
-	 * of interference between the IRL and a user call when auto_drop is
-	 * enable
-	 * for now we just disable the RX interrupt here in case we are
-	 * preempted
-	 */
-	if (cfg->auto_drop)
-		grspw2_rx_interrupt_disable(cfg);
+	addr = (uint32_t) pkt - cfg->strip_hdr_bytes;
 
-	p_elem = grspw2_rx_desc_get_next_used(cfg);
-	if (!p_elem)
-		goto exit;
+	/* not one of ours or returned twice */
+	if (grspw2_rx_spare_unloan(cfg, addr))
+		return -1;
 
-	/* still active */
-	if (p_elem->desc->pkt_ctrl & GRSPW2_RX_DESC_EN)
-		goto exit;
+	cfg->rx_spare.buf[cfg->rx_spare.n++] = addr;
 
-	pkt_size = p_elem->desc->pkt_size - cfg->strip_hdr_bytes;
-	if (!pkt)
-		goto exit;
+	return 0;
+}
 
-	cfg->rx_bytes += p_elem->desc->pkt_size;
 
-	memcpy((void *) pkt,
-	       (void *) (p_elem->desc->pkt_addr + cfg->strip_hdr_bytes),
-	       pkt_size);
+/**
+ * @brief retrieve a packet as a processing task without copying it
+ *
+ * @param steps the number of processing steps to allocate for the task
+ * @param type an arbitrary type identifier of the task
+ * @param seq an arbitrary sequence number of the task
+ *
+ * @returns a processing task or NULL if no packet was available
+ *
+ * @note The packet buffer is loaned to the task via grspw2_loan_pkt(), the
+ *	 user's output node op function must hand the data buffer of the
+ *	 task back via grspw2_return_pkt() before it calls pt_destroy().
+ *	 The number of elements of the task is initialised to the packet size.
+ */
 
-	grspw2_rx_desc_readd(cfg, p_elem);
+struct proc_task *grspw2_get_pkt_task(struct grspw2_core_cfg *cfg,
+				      size_t steps, unsigned long type,
+				      unsigned long seq)
+{
+	void *pkt;
+	uint32_t pkt_size;
 
+	struct proc_task *t;
 
-	if (cfg->auto_drop) {
-		int idx;
 
-		/* we picked up one packet move the IE flag by one */
-		idx = cfg->idx_drop + 1;
-		if (idx >= cfg->rx_n_desc)
-			idx = idx - cfg->rx_n_desc;
+	pkt = grspw2_loan_pkt(cfg, &pkt_size);
+	if (!pkt)
+		return NULL;
 
-		grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[cfg->idx_drop]);
-		cfg->idx_drop = idx;
-		grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
+	t = pt_create(pkt, pkt_size, steps, type, seq);
+	if (!t) {
+		grspw2_return_pkt(cfg, pkt);
+		return NULL;
 	}
 
-exit:
-	if (cfg->auto_drop)
-		grspw2_rx_interrupt_enable(cfg);
+	pt_set_nmemb(t, pkt_size);
 
-	return pkt_size;
+	return t;
 }
 
+
 /**
  * @brief drop a packet
  * @return 1 if packet was dropped, 0 otherwise
@@ -2180,22 +4430,13 @@ uint32_t grspw2_drop_pkt(struct grspw2_core_cfg *cfg)
 		return 0;
 
 	cfg->rx_bytes += p_elem->desc->pkt_size;
+	cfg->stats.rx_dropped++;
 
 	grspw2_rx_desc_readd(cfg, p_elem);
 
 
 	if (cfg->auto_drop) {
-		int idx;
-
-		/* we picked up one packet move the IE flag by one */
-		idx = cfg->idx_drop + 1;
-		if (idx >= cfg->rx_n_desc)
-			idx = idx - cfg->rx_n_desc;
-
-		grspw2_rx_desc_clear_irq(&cfg->rx_desc_ring[cfg->idx_drop]);
-		cfg->idx_drop = idx;
-		grspw2_rx_desc_set_irq(&cfg->rx_desc_ring[idx]);
-
+		grspw2_auto_drop_advance(cfg);
 		grspw2_rx_interrupt_enable(cfg);
 	}
 
@@ -2231,6 +4472,129 @@ int32_t grspw2_add_pkt(struct grspw2_core_cfg *cfg,
 }
 
 
+/**
+ * @brief add a batch of packets
+ *
+ * @param cfg the core configuration
+ * @param iov an array of packet vectors
+ * @param n the number of packets in the array
+ *
+ * @returns the number of packets added, which may be less than n if the
+ *	    core ran out of TX descriptors, or -1 on error
+ *
+ * @note this is much cheaper than adding the packets individually, since
+ *	 descriptors are reclaimed, the cache is flushed and the core is notified
+ *	 only once per call
+ */
+
+int32_t grspw2_add_pkts(struct grspw2_core_cfg *cfg,
+			const struct grspw2_pkt_vec *iov, uint32_t n)
+{
+	uint32_t i;
+	int32_t ret;
+
+
+	if (!cfg)
+		return -1;
+
+	if (!iov)
+		return -1;
+
+	ret = grspw2_tx_desc_add_pkts(cfg, iov, n);
+
+	if (unlikely(ret < 0)) {
+		grspw2_handle_error(LOW);
+		return -1;
+	}
+
+	if (unlikely((uint32_t) ret < n)) {
+		cfg->stats.tx_desc_unavail += n - ret;
+		grspw2_handle_error(LOW);
+	}
+
+	for (i = 0; i < (uint32_t) ret; i++)
+		cfg->tx_bytes += iov[i].hdr_size + iov[i].data_size;
+
+	return ret;
+}
+
+
+/**
+ * @brief add a packet without copying it
+ *
+ * @param cfg the core configuration
+ * @param hdr the header buffer
+ * @param hdr_size the size of the header
+ * @param data the data buffer
+ * @param data_size the size of the data
+ * @param cookie an arbitrary reference passed to the tx_done callback
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note The core transmits directly from the supplied buffers, which must not
+ *	 be modified or released until the tx_done callback configured via
+ *	 grspw2_set_tx_done_callback() was executed for the cookie. Completed
+ *	 descriptors are reclaimed whenever a packet is added or when
+ *	 grspw2_tx_reclaim() is called.
+ */
+
+int32_t grspw2_add_pkt_ref(struct grspw2_core_cfg *cfg,
+			   const void *hdr,  uint32_t hdr_size,
+			   const void *data, uint32_t data_size,
+			   void *cookie)
+{
+	int32_t ret;
+
+
+	ret = grspw2_tx_desc_add_ref(cfg, false, hdr, hdr_size, 0,
+				     data, data_size, cookie, true);
+
+	if (unlikely(ret)) {
+		grspw2_handle_error(LOW);
+		return -1;
+	}
+
+	cfg->tx_bytes += hdr_size + data_size;
+
+	return 0;
+}
+
+
+/**
+ * @brief set the function to call when a packet added via
+ *	  grspw2_add_pkt_ref() was transmitted
+ *
+ * @param cfg the core configuration
+ * @param cb the callback, NULL to disable
+ * @param userdata an arbitrary pointer passed to the callback
+ *
+ * @note the callback is executed in the context of the caller of the
+ *	 function which reclaims the descriptor
+ */
+
+void grspw2_set_tx_done_callback(struct grspw2_core_cfg *cfg,
+				 grspw2_tx_done_t cb, void *userdata)
+{
+	cfg->tx_done.cb       = cb;
+	cfg->tx_done.userdata = userdata;
+}
+
+
+/**
+ * @brief reclaim all TX descriptors the core is done with
+ *
+ * @returns the number of descriptors reclaimed
+ *
+ * @note this executes the tx_done callback for all completed packets added
+ *	 via grspw2_add_pkt_ref()
+ */
+
+uint32_t grspw2_tx_reclaim(struct grspw2_core_cfg *cfg)
+{
+	return grspw2_tx_desc_move_free_all(cfg);
+}
+
+
 /**
  * @brief add an RMAP packet
  */
@@ -2280,6 +4644,170 @@ void grspw2_core_start(struct grspw2_core_cfg *cfg, int link_start, int auto_sta
 }
 
 
+/**
+ * @brief stop the DMA operation of a core
+ *
+ * @note Transmissions in progress are aborted, the link itself remains
+ *	 running. The descriptor rings must be set up again, e.g. via
+ *	 grspw2_core_alloc(), before the core is restarted.
+ */
+
+void grspw2_core_stop(struct grspw2_core_cfg *cfg)
+{
+	grspw2_dma_stop(cfg->regs, 0);
+}
+
+
+/**
+ * @brief check whether the DMA channel of a core is active
+ */
+
+static int grspw2_core_dma_active(struct grspw2_core_cfg *cfg)
+{
+	return ioread32be(&cfg->regs->dma[0].ctrl_status)
+	       & (GRSPW2_DMACONTROL_RE | GRSPW2_DMACONTROL_TE);
+}
+
+
+/**
+ * @brief allocate and set up the descriptor tables and buffers of a core
+ *
+ * @param cfg the core configuration, see grspw2_core_init()
+ * @param ring the ring geometry
+ *
+ * @returns 0 on success, -1 on error
+ *
+ * @note The memory is allocated as a single physically contiguous block,
+ *	 which replaces that of any previous call once it was set up. The
+ *	 core must not be started or must be stopped via grspw2_core_stop(),
+ *	 packets pending in the rings are lost. As the packet buffers are
+ *	 replaced, zero-copy reception, auto-drop, routing and
+ *	 interrupt-driven reception must not be configured. Start the core
+ *	 via grspw2_core_start() afterwards.
+ */
+
+int32_t grspw2_core_alloc(struct grspw2_core_cfg *cfg,
+			  const struct grspw2_ring_cfg *ring)
+{
+	uint8_t *mem;
+	uint8_t *tbl;
+
+	uint32_t rx_size;
+	uint32_t hdr_size;
+	uint32_t tx_size;
+
+
+	if (!cfg)
+		return -1;
+
+	if (!ring)
+		return -1;
+
+	if (!ring->rx_desc || (ring->rx_desc > GRSPW2_RX_DESCRIPTORS))
+		return -1;
+
+	if (!ring->tx_desc || (ring->tx_desc > GRSPW2_TX_DESCRIPTORS))
+		return -1;
+
+	if (!ring->rx_mtu || (ring->rx_mtu > GRSPW2_RX_MAX_LEN_MASK))
+		return -1;
+
+	if (!ring->tx_mtu || (ring->tx_mtu > GRSPW2_TX_DESC_DATA_SIZE_MASK))
+		return -1;
+
+	if (ring->tx_hdr_size > GRSPW2_TX_DESC_HDR_SIZE_MASK)
+		return -1;
+
+	if (grspw2_core_dma_active(cfg))
+		return -1;
+
+	if (cfg->rx_spare.buf || cfg->auto_drop || cfg->route[0]
+	    || cfg->rx_irq.enabled)
+		return -1;
+
+	/* word-aligned buffer sections; given the limits above, the total
+	 * does not exceed 32 bits
+	 */
+	rx_size  = (ring->rx_desc * ring->rx_mtu + 3) & ~0x3;
+	hdr_size = (ring->tx_desc * ring->tx_hdr_size + 3) & ~0x3;
+	tx_size  = ring->tx_desc * ring->tx_mtu;
+
+	/* both tables are aligned to their size */
+	mem = kpalloc(GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN
+		      + 2 * GRSPW2_DESCRIPTOR_TABLE_SIZE
+		      + rx_size + hdr_size + tx_size);
+	if (!mem)
+		return -1;
+
+	tbl = (uint8_t *) (((uint32_t) mem
+			    + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
+			   & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
+
+	if (grspw2_rx_desc_table_init(cfg, (uint32_t *) tbl,
+				      ring->rx_desc * GRSPW2_RX_DESC_SIZE,
+				      &tbl[2 * GRSPW2_DESCRIPTOR_TABLE_SIZE],
+				      ring->rx_mtu))
+		goto error;
+
+	if (grspw2_tx_desc_table_init(cfg, (uint32_t *)
+				      &tbl[GRSPW2_DESCRIPTOR_TABLE_SIZE],
+				      ring->tx_desc * GRSPW2_TX_DESC_SIZE,
+				      &tbl[2 * GRSPW2_DESCRIPTOR_TABLE_SIZE
+					   + rx_size],
+				      ring->tx_hdr_size,
+				      &tbl[2 * GRSPW2_DESCRIPTOR_TABLE_SIZE
+					   + rx_size + hdr_size],
+				      ring->tx_mtu))
+		goto error;
+
+	grspw2_set_mtu(cfg, ring->rx_mtu);
+
+	kfree(cfg->ring_mem);
+	cfg->ring_mem = mem;
+
+	return 0;
+
+error:
+	kfree(mem);
+	return -1;
+}
+
+
+/**
+ * @brief release the descriptor tables and buffers of a core
+ *
+ * @note the core must be stopped, see grspw2_core_stop()
+ */
+
+void grspw2_core_free(struct grspw2_core_cfg *cfg)
+{
+	if (!cfg)
+		return;
+
+	if (!cfg->ring_mem)
+		return;
+
+	if (grspw2_core_dma_active(cfg))
+		return;
+
+	iowrite32be(0x0, &cfg->regs->dma[0].tx_desc_table_addr);
+	iowrite32be(0x0, &cfg->regs->dma[0].rx_desc_table_addr);
+
+	INIT_LIST_HEAD(&cfg->rx_desc_ring_used);
+	INIT_LIST_HEAD(&cfg->rx_desc_ring_free);
+	INIT_LIST_HEAD(&cfg->tx_desc_ring_used);
+	INIT_LIST_HEAD(&cfg->tx_desc_ring_free);
+
+	cfg->rx_n_desc = 0;
+	cfg->tx_n_desc = 0;
+
+	memset(&cfg->ring, 0, sizeof(cfg->ring));
+
+	kfree(cfg->ring_mem);
+	cfg->ring_mem = NULL;
+}
+
+
 /**
  * @brief (re)initialise a grswp2 core
  */
@@ -2335,6 +4863,8 @@ int32_t grspw2_core_init(struct grspw2_core_cfg *cfg, uint32_t core_addr,
 	cfg->rx_bytes = 0;
 	cfg->tx_bytes = 0;
 
+	memset(&cfg->stats, 0, sizeof(cfg->stats));
+
 #ifdef CONFIG_SYSCTL
 	/* as sysctl does not provide a _remove() function, make
 	 * sure that we do not re-add the same object to the sysctl tree
@@ -20,6 +20,29 @@
  * Channels may be reserved for exclusive external use via
  * noc_dma_reserve_channel() and returned by noc_dma_release_channel().
  *
+ * Requested transfers are queued per priority level. Whenever a channel
+ * becomes available, the high priority queue is served first. In addition,
+ * CONFIG_NOC_DMA_HIGH_PRIO_CHANNELS channels are held back for high priority
+ * transfers, so a backlog of low priority bulk transfers cannot occupy all
+ * channels and delay a latency-critical transfer until one of them completes.
+ * The same restriction applies to channels reserved for external use.
+ *
+ * Non-contiguous data may be gathered or scattered via noc_dma_req_sg_xfer(),
+ * which takes an array of 2D segments. The segments are executed back-to-back
+ * on the same channel and occupy a single slot of the transfer queue. Since
+ * the NoC DMA cannot chain descriptors, the interrupt handler programs the
+ * next segment directly on completion of the previous one, the caller is
+ * notified only once all segments are complete.
+ *
+ * If CONFIG_NOC_DMA_DEFERRED_CALLBACKS is set, the interrupt handler only
+ * releases the channel of a completed transfer and immediately programs the
+ * next queued transfer, so the DMA engine is kept busy. The callback
+ * notification is passed to a kernel thread via a completion ring and
+ * executed there. Callbacks must hence not assume to be executed in interrupt
+ * context, nor in the order of completion relative to new transfer requests.
+ * The thread sleeps while the ring is empty and is woken by the interrupt
+ * handler, so it does not consume any CPU time while no transfers complete.
+ *
  *
  *
  * @note parameter limits are usually not checked, as they are implicit by type
@@ -39,12 +62,17 @@
 #include <kernel/sysctl.h>
 #include <kernel/types.h>
 #include <kernel/export.h>
+#include <kernel/kthread.h>
+#include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/time.h>
 
 
 #include <asm/irq.h>
 #include <kernel/irq.h>
 
 #include <asm-generic/io.h>
+#include <asm-generic/irqflags.h>
 #include <errno.h>
 #include <list.h>
 
@@ -57,6 +85,10 @@
 
 #define MSG "NOC DMA: "
 
+/* the cpu and round-robin priority of the callback thread */
+#define NOC_DMA_CB_CPU		0
+#define NOC_DMA_CB_PRIORITY	100
+
 /**
  * NoC DMA channel control register layout
  * @see MPPB datasheet v4.03, p64
@@ -165,7 +197,10 @@ static struct noc_dma_channels {
 
 static struct list_head	dma_channel_pool_head;
 static struct list_head	dma_transfer_pool_head;
-static struct list_head	dma_transfer_queue_head;
+static struct list_head	dma_transfer_queue_head[NOC_DMA_PRIORITIES];
+
+/* the number of channels in the pool */
+static unsigned int dma_channels_free;
 
 /* we could set this up at runtime, but what for? */
 static struct noc_dma_transfer dma_transfer_pool[NOC_DMA_TRANSFER_QUEUE_SIZE];
@@ -173,6 +208,28 @@ static struct noc_dma_transfer dma_transfer_pool[NOC_DMA_TRANSFER_QUEUE_SIZE];
 static struct noc_dma_channel_node dma_channel_pool[NOC_DMA_CHANNELS];
 
 
+#ifdef CONFIG_NOC_DMA_DEFERRED_CALLBACKS
+compile_time_assert(!(NOC_DMA_COMPLETION_RING_SIZE &
+		      (NOC_DMA_COMPLETION_RING_SIZE - 1)),
+		    NOC_DMA_COMPLETION_RING_SIZE_NOT_POWER_OF_TWO);
+
+/* a pending callback notification */
+struct noc_dma_completion {
+	int (*callback)(void *);
+	void *userdata;
+};
+
+/* written by the interrupt handler, read by the callback thread only */
+static struct {
+	struct noc_dma_completion ring[NOC_DMA_COMPLETION_RING_SIZE];
+	uint32_t head;
+	uint32_t tail;
+
+	struct task_struct *thread;
+} noc_dma_compl;
+#endif /* CONFIG_NOC_DMA_DEFERRED_CALLBACKS */
+
+
 #ifdef CONFIG_NOC_DMA_STATS_COLLECT
 static struct {
 	unsigned int transfers_queued;
@@ -181,9 +238,33 @@ static struct {
 
 	unsigned int bytes_requested;
 	unsigned int bytes_transferred;
+
+	unsigned int callbacks_deferred;
+	unsigned int callbacks_overrun;
+
+	/* queue wait times per priority level */
+	struct {
+		unsigned int transfers;
+		uint64_t wait_us;
+		unsigned int wait_max_us;
+	} prio[NOC_DMA_PRIORITIES];
 } noc_dma_stats;
 
 
+/**
+ * @brief get the average queue wait time of a priority level
+ */
+
+static unsigned int noc_dma_stats_wait_avg(enum noc_dma_priority p)
+{
+	if (!noc_dma_stats.prio[p].transfers)
+		return 0;
+
+	return (unsigned int) (noc_dma_stats.prio[p].wait_us /
+			       noc_dma_stats.prio[p].transfers);
+}
+
+
 
 __extension__
 static ssize_t noc_dma_show(struct sysobj *sobj __attribute__((unused)),
@@ -205,6 +286,24 @@ static ssize_t noc_dma_show(struct sysobj *sobj __attribute__((unused)),
 	if (!strcmp(sattr->name, "bytes_transferred"))
 		return sprintf(buf, "%d", noc_dma_stats.bytes_transferred);
 
+	if (!strcmp(sattr->name, "callbacks_deferred"))
+		return sprintf(buf, "%d", noc_dma_stats.callbacks_deferred);
+
+	if (!strcmp(sattr->name, "callbacks_overrun"))
+		return sprintf(buf, "%d", noc_dma_stats.callbacks_overrun);
+
+	if (!strcmp(sattr->name, "wait_avg_us_low"))
+		return sprintf(buf, "%d", noc_dma_stats_wait_avg(LOW));
+
+	if (!strcmp(sattr->name, "wait_max_us_low"))
+		return sprintf(buf, "%d", noc_dma_stats.prio[LOW].wait_max_us);
+
+	if (!strcmp(sattr->name, "wait_avg_us_high"))
+		return sprintf(buf, "%d", noc_dma_stats_wait_avg(HIGH));
+
+	if (!strcmp(sattr->name, "wait_max_us_high"))
+		return sprintf(buf, "%d", noc_dma_stats.prio[HIGH].wait_max_us);
+
 	return 0;
 }
 
@@ -219,6 +318,10 @@ static ssize_t noc_dma_store(struct sysobj *sobj __attribute__((unused)),
 		noc_dma_stats.transfers_completed = 0;
 		noc_dma_stats.bytes_requested     = 0;
 		noc_dma_stats.bytes_transferred   = 0;
+		noc_dma_stats.callbacks_deferred  = 0;
+		noc_dma_stats.callbacks_overrun   = 0;
+
+		bzero(noc_dma_stats.prio, sizeof(noc_dma_stats.prio));
 	}
 
 	return 0;
@@ -231,6 +334,12 @@ static struct sobj_attribute noc_dma_attr[] = {
 	__ATTR(transfers_completed, noc_dma_show, NULL),
 	__ATTR(bytes_requested,     noc_dma_show, NULL),
 	__ATTR(bytes_transferred,   noc_dma_show, NULL),
+	__ATTR(callbacks_deferred,  noc_dma_show, NULL),
+	__ATTR(callbacks_overrun,   noc_dma_show, NULL),
+	__ATTR(wait_avg_us_low,     noc_dma_show, NULL),
+	__ATTR(wait_max_us_low,     noc_dma_show, NULL),
+	__ATTR(wait_avg_us_high,    noc_dma_show, NULL),
+	__ATTR(wait_max_us_high,    noc_dma_show, NULL),
 	__ATTR(reset_stats,         NULL,         noc_dma_store)
 };
 
@@ -238,6 +347,8 @@ __extension__
 static struct sobj_attribute *noc_dma_attributes[] = {
 	&noc_dma_attr[0], &noc_dma_attr[1], &noc_dma_attr[2],
 	&noc_dma_attr[3], &noc_dma_attr[4], &noc_dma_attr[5],
+	&noc_dma_attr[6], &noc_dma_attr[7], &noc_dma_attr[8],
+	&noc_dma_attr[9], &noc_dma_attr[10], &noc_dma_attr[11],
 	NULL};
 
 #endif /* CONFIG_NOC_DMA_STATS_COLLECT */
@@ -435,6 +546,8 @@ static void noc_dma_release_channel_node(struct noc_dma_channel_node *c)
 	c->transfer = NULL;
 
 	list_add_tail(&c->node, &dma_channel_pool_head);
+
+	dma_channels_free++;
 }
 
 
@@ -448,6 +561,10 @@ static void noc_dma_release_transfer(struct noc_dma_transfer *t)
 	t->callback = NULL;
 	t->userdata = NULL;
 
+	t->sg     = NULL;
+	t->sg_n   = 0;
+	t->sg_idx = 0;
+
 	list_add_tail(&t->node, &dma_transfer_pool_head);
 
 }
@@ -487,11 +604,41 @@ static int noc_dma_execute_transfer(struct noc_dma_channel  *c,
 }
 
 
+/**
+ * @brief set up the current segment of a scatter-gather transfer
+ *
+ * @param t a struct noc_dma_transfer
+ */
+
+static void noc_dma_load_segment(struct noc_dma_transfer *t)
+{
+	struct noc_dma_sg *sg;
+
+
+	sg = &t->sg[t->sg_idx];
+
+	t->src = sg->src;
+	t->dst = sg->dst;
+
+	t->x_elem = sg->x_elem;
+	t->y_elem = sg->y_elem;
+
+	t->x_stride_src = sg->x_stride_src;
+	t->x_stride_dst = sg->x_stride_dst;
+
+	t->y_stride_src = sg->y_stride_src;
+	t->y_stride_dst = sg->y_stride_dst;
+}
+
+
 /**
  * @brief reserve a NoC DMA channel
  *
  * @param t	a pointer to a struct noc_dma_transfer
  *
+ * @note low priority transfers and external reservations (t == NULL) are
+ *	 not granted any of the last CONFIG_NOC_DMA_HIGH_PRIO_CHANNELS channels
+ *
  * @warning	channel will never be released when a transfer gets stuck, but
  * @todo	either rely on an (external) timer or write a timer management routine... (probably the best idea)
  * @todo	(if so, make it tickless...)
@@ -506,11 +653,18 @@ struct noc_dma_channel *noc_dma_request_channel(struct noc_dma_transfer *t)
 	if(unlikely(list_empty(&dma_channel_pool_head)))
 		return NULL;
 
+	if (!t || t->priority != HIGH) {
+		if (dma_channels_free <= NOC_DMA_HIGH_PRIO_CHANNELS)
+			return NULL;
+	}
+
 	c = list_entry((&dma_channel_pool_head)->next,
 		       struct noc_dma_channel_node, node);
 
 	list_del(&c->node);
 
+	dma_channels_free--;
+
 	/* link transfer to node of this DMA channel */
 	c->transfer = t;
 
@@ -521,13 +675,34 @@ struct noc_dma_channel *noc_dma_request_channel(struct noc_dma_transfer *t)
 }
 
 
+#ifdef CONFIG_NOC_DMA_STATS_COLLECT
 /**
- * @brief	program queued DMA transfers
- * @note will program transfers until all available DMA channels are in use
- *	 or queue is empty
+ * @brief update the queue wait time statistics of a transfer
  */
 
-static inline void noc_dma_program_transfer(void)
+static void noc_dma_stats_wait(struct noc_dma_transfer *t)
+{
+	unsigned int us;
+
+
+	us = (unsigned int) ktime_us_delta(ktime_get(), t->queued);
+
+	noc_dma_stats.prio[t->priority].transfers++;
+	noc_dma_stats.prio[t->priority].wait_us += us;
+
+	if (us > noc_dma_stats.prio[t->priority].wait_max_us)
+		noc_dma_stats.prio[t->priority].wait_max_us = us;
+}
+#endif /* CONFIG_NOC_DMA_STATS_COLLECT */
+
+
+/**
+ * @brief program queued DMA transfers of a priority level
+ *
+ * @param p the priority level of the queue
+ */
+
+static void noc_dma_program_queue(enum noc_dma_priority p)
 {
 	struct noc_dma_channel *chan;
 
@@ -535,12 +710,12 @@ static inline void noc_dma_program_transfer(void)
 	struct noc_dma_transfer *p_tmp;
 
 
-	if(list_empty(&dma_transfer_queue_head))
+	if(list_empty(&dma_transfer_queue_head[p]))
 		return;
 
 
 	list_for_each_entry_safe(p_elem, p_tmp,
-				 &dma_transfer_queue_head, node) {
+				 &dma_transfer_queue_head[p], node) {
 
 		chan = noc_dma_request_channel(p_elem);
 
@@ -549,34 +724,238 @@ static inline void noc_dma_program_transfer(void)
 
 		list_del(&p_elem->node);
 
-		noc_dma_execute_transfer(chan, p_elem);
-
 #ifdef CONFIG_NOC_DMA_STATS_COLLECT
+		noc_dma_stats_wait(p_elem);
 		noc_dma_stats.transfers_queued--;
 #endif
+		noc_dma_execute_transfer(chan, p_elem);
 	}
 }
 
 
 /**
- * @brief callback function for NoC DMA IRQs
+ * @brief	program queued DMA transfers
+ * @note will program transfers until all available DMA channels are in use
+ *	 or queues are empty, high priority transfers are programmed first
+ */
+
+static inline void noc_dma_program_transfer(void)
+{
+	noc_dma_program_queue(HIGH);
+	noc_dma_program_queue(LOW);
+}
+
+
+#ifdef CONFIG_NOC_DMA_DEFERRED_CALLBACKS
+/**
+ * @brief add a callback notification to the completion ring
  *
- * @param userdata userdata pointer supplied by the IRQ system
+ * @returns 0 on success, -EBUSY if the ring is full
+ *
+ * @note only the interrupt handler may call this
+ */
+
+static int noc_dma_completion_put(int (*callback)(void *), void *userdata)
+{
+	uint32_t head;
+
+	struct noc_dma_completion *cmp;
+
+
+	/* no thread to execute the callback */
+	if (!noc_dma_compl.thread)
+		return -EBUSY;
+
+	head = ioread32be(&noc_dma_compl.head);
+
+	if ((head - ioread32be(&noc_dma_compl.tail))
+	    >= NOC_DMA_COMPLETION_RING_SIZE)
+		return -EBUSY;
+
+	cmp = &noc_dma_compl.ring[head & (NOC_DMA_COMPLETION_RING_SIZE - 1)];
+
+	cmp->callback = callback;
+	cmp->userdata = userdata;
+
+	/* the entry must be visible before the head is published */
+	barrier();
+
+	iowrite32be(head + 1, &noc_dma_compl.head);
+
+	/* the head must be published before the thread state is checked */
+	barrier();
+
+	/* wake the callback thread if it went to sleep */
+	if (noc_dma_compl.thread->state == TASK_IDLE) {
+		noc_dma_compl.thread->state = TASK_RUN;
+		smp_send_reschedule(NOC_DMA_CB_CPU);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief remove the next callback notification from the completion ring
  *
- * @note will execute a caller-provideable callback notification function
+ * @param cmp a struct noc_dma_completion to copy the notification to
  *
- * @return always 0
+ * @returns 0 on success, -ENOENT if the ring is empty
  *
+ * @note only the callback thread may call this
+ */
+
+static int noc_dma_completion_get(struct noc_dma_completion *cmp)
+{
+	uint32_t tail;
+
+
+	tail = noc_dma_compl.tail;
+
+	if (tail == ioread32be(&noc_dma_compl.head))
+		return -ENOENT;
+
+	/* do not read the entry before the head */
+	barrier();
+
+	(*cmp) = noc_dma_compl.ring[tail & (NOC_DMA_COMPLETION_RING_SIZE - 1)];
+
+	/* the entry must be read before it is released to the producer */
+	barrier();
+
+	iowrite32be(tail + 1, &noc_dma_compl.tail);
+
+	return 0;
+}
+
+
+/**
+ * @brief put the callback thread to sleep until the next notification
  *
+ * @note the thread is marked idle before the ring is checked a final time;
+ *	 the interrupt handler publishes an entry before it checks the state,
+ *	 so a notification cannot get lost in between
+ */
+
+static void noc_dma_callback_thread_sleep(void)
+{
+	unsigned long flags;
+
+	struct task_struct *t = noc_dma_compl.thread;
+
+
+	flags = arch_local_irq_save();
+
+	t->state = TASK_IDLE;
+
+	/* the state must be set before the head is checked */
+	barrier();
+
+	if (noc_dma_compl.tail != ioread32be(&noc_dma_compl.head))
+		t->state = TASK_BUSY;
+
+	arch_local_irq_restore(flags);
+
+	schedule();
+}
+
+
+/**
+ * @brief the thread executing the user callbacks of completed transfers
  */
 
-/* XXX the user-supplied callbacks should not be executed in the ISR
- *     for obvious reasons. Need to fix that once we have threads.
+static int noc_dma_callback_thread(void *data)
+{
+	struct noc_dma_completion cmp;
+
+
+	while (1) {
+		while (!noc_dma_completion_get(&cmp))
+			cmp.callback(cmp.userdata);
+
+		noc_dma_callback_thread_sleep();
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief set up the callback thread
+ *
+ * @returns 0 on success, -ENOMEM if the thread could not be created
+ *
+ * @note the thread is bound to a single cpu, so it cannot be picked by
+ *	 another cpu when the interrupt handler wakes it while it is still
+ *	 about to go to sleep
  */
+
+static int noc_dma_callback_thread_setup(void)
+{
+	struct task_struct *t;
+
+
+	t = kthread_create(noc_dma_callback_thread, NULL,
+			   NOC_DMA_CB_CPU, "NOC_DMA_CB");
+	if (!t)
+		return -ENOMEM;
+
+	/* the thread only runs when woken, so it needs no reservation */
+	kthread_set_sched_rr(t, NOC_DMA_CB_PRIORITY);
+
+	noc_dma_compl.thread = t;
+
+	if (kthread_wake_up(t) < 0) {
+		noc_dma_compl.thread = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+#else
 #warning "NoC DMA: user callbacks are executed in interrupt mode"
+#endif /* CONFIG_NOC_DMA_DEFERRED_CALLBACKS */
+
+
+/**
+ * @brief execute or defer the callback notification of a completed transfer
+ */
+
+static void noc_dma_notify(int (*callback)(void *), void *userdata)
+{
+#ifdef CONFIG_NOC_DMA_DEFERRED_CALLBACKS
+	if (!noc_dma_completion_put(callback, userdata)) {
+#ifdef CONFIG_NOC_DMA_STATS_COLLECT
+		noc_dma_stats.callbacks_deferred++;
+#endif
+		return;
+	}
+
+#ifdef CONFIG_NOC_DMA_STATS_COLLECT
+	noc_dma_stats.callbacks_overrun++;
+#endif
+#endif /* CONFIG_NOC_DMA_DEFERRED_CALLBACKS */
+
+	callback(userdata);
+}
+
+
+/**
+ * @brief callback function for NoC DMA IRQs
+ *
+ * @param userdata userdata pointer supplied by the IRQ system
+ *
+ * @note will execute or defer a caller-provideable callback notification
+ *	 function after the next queued transfer was programmed
+ *
+ * @return always 0
+ */
 
 static irqreturn_t noc_dma_service_irq_handler(unsigned int irq, void *userdata)
 {
+	void *data;
+	int (*callback)(void *);
+
 	struct noc_dma_transfer *t;
 	struct noc_dma_channel_node  *c;
 
@@ -587,8 +966,15 @@ static irqreturn_t noc_dma_service_irq_handler(unsigned int irq, void *userdata)
 
 	t = c->transfer;
 
-	if (t->callback)
-		t->callback(t->userdata);
+	/* continue with the next segment on the same channel */
+	if (t->sg && (++t->sg_idx < t->sg_n)) {
+		noc_dma_load_segment(t);
+		noc_dma_execute_transfer(c->channel, t);
+		return 0;
+	}
+
+	callback = t->callback;
+	data     = t->userdata;
 
 	noc_dma_release_transfer(t);
 	noc_dma_release_channel_node(c);
@@ -596,9 +982,12 @@ static irqreturn_t noc_dma_service_irq_handler(unsigned int irq, void *userdata)
 #ifdef CONFIG_NOC_DMA_STATS_COLLECT
 	noc_dma_stats.transfers_completed++;
 #endif
-	/* activate queued */
+	/* activate queued first, so the channel does not idle */
 	noc_dma_program_transfer();
 
+	if (callback)
+		noc_dma_notify(callback, data);
+
 
 	return 0;
 }
@@ -610,12 +999,12 @@ static irqreturn_t noc_dma_service_irq_handler(unsigned int irq, void *userdata)
 
 static void noc_dma_register_transfer(struct noc_dma_transfer *t)
 {
-	list_add_tail(&t->node, &dma_transfer_queue_head);
-	noc_dma_program_transfer();
-
 #ifdef CONFIG_NOC_DMA_STATS_COLLECT
+	t->queued = ktime_get();
 	noc_dma_stats.transfers_queued++;
 #endif
+	list_add_tail(&t->node, &dma_transfer_queue_head[t->priority]);
+	noc_dma_program_transfer();
 }
 
 
@@ -657,7 +1046,8 @@ static int noc_dma_sysctl_setup(void)
 		return -ENOMEM;
 
 	sobj->sattr = noc_dma_attributes;
-	sysobj_add(sobj, NULL, driver_set, "noc_dma");
+	sysobj_add(sobj, NULL, sysset_from_path(NULL, "/sys/driver"),
+		   "noc_dma");
 
 	return 0;
 }
@@ -689,7 +1079,8 @@ static int noc_dma_init(void)
 
 	INIT_LIST_HEAD(&dma_channel_pool_head);
 	INIT_LIST_HEAD(&dma_transfer_pool_head);
-	INIT_LIST_HEAD(&dma_transfer_queue_head);
+	for (i = 0; i < NOC_DMA_PRIORITIES; i++)
+		INIT_LIST_HEAD(&dma_transfer_queue_head[i]);
 
 	for(i = 0; i < NOC_DMA_CHANNELS; i++) {
 
@@ -708,11 +1099,19 @@ static int noc_dma_init(void)
 			    &dma_channel_pool[i]);
 	}
 
+	dma_channels_free = NOC_DMA_CHANNELS;
+
 	for (i = 0; i < NOC_DMA_TRANSFER_QUEUE_SIZE; i++) {
 		list_add_tail(&dma_transfer_pool[i].node,
 			      &dma_transfer_pool_head);
 	}
 
+#ifdef CONFIG_NOC_DMA_DEFERRED_CALLBACKS
+	/* callbacks are executed in the interrupt handler if this fails */
+	if (noc_dma_callback_thread_setup())
+		pr_err(MSG "Cannot create callback thread\n");
+#endif
+
 #ifdef CONFIG_NOC_DMA_STATS_COLLECT
 	if (noc_dma_sysctl_setup())
 		return -1;
@@ -892,6 +1291,92 @@ int noc_dma_req_lin_xfer(void *src, void *dst,
 			 int (*callback)(void *), void *userdata)
 {
 	return noc_dma_req_xfer(src, dst, elem, 1, elem_size,
-				1, 1, 1, 1, LOW, mtu, callback, userdata);
+				1, 1, 1, 1, dma_priority, mtu,
+				callback, userdata);
 }
 EXPORT_SYMBOL(noc_dma_req_lin_xfer);
+
+
+/**
+ * @brief request a scatter-gather DMA transfer
+ *
+ * @param sg an array of transfer segments
+ * @param n the number of segments in the array
+ * @param size the element size (BYTE, HALFWORD, WORD, DOUBLEWORD)
+ *
+ * @param mtu the maximum transfer unit of a NoC packet
+ *
+ * @param callback a user-supplied callback function, executed once all
+ *		   segments were transferred
+ * @param userdata a pointer to arbitrary userdata, passed to callback function
+ *
+ * @returns 0 on success, -EINVAL on error, -EBUSY if the transfer queue is full
+ *
+ * @note the segment array is not copied, it must remain valid until the
+ *	 callback is executed
+ */
+
+int noc_dma_req_sg_xfer(struct noc_dma_sg *sg, size_t n,
+			enum noc_dma_elem_size elem_size,
+			enum noc_dma_priority dma_priority, uint16_t mtu,
+			int (*callback)(void *), void *userdata)
+{
+	size_t i;
+
+	struct noc_dma_transfer *t;
+
+
+	if (!sg)
+		return -EINVAL;
+
+	if (!n)
+		return -EINVAL;
+
+	for (i = 0; i < n; i++) {
+
+		if (!sg[i].src)
+			return -EINVAL;
+
+		if (!sg[i].dst)
+			return -EINVAL;
+
+		if (!sg[i].x_elem)
+			return -EINVAL;
+
+		if (!sg[i].y_elem)
+			return -EINVAL;
+
+		/* would fail mid-transfer, see noc_dma_init_transfer() */
+		if (((int) sg[i].dst & 0xF0000000) ==
+		    ((int) sg[i].src & 0xF0000000))
+			return -EINVAL;
+	}
+
+	t = noc_dma_get_transfer_slot();
+	if(!t)
+		return -EBUSY;
+
+	t->sg     = sg;
+	t->sg_n   = n;
+	t->sg_idx = 0;
+
+	noc_dma_load_segment(t);
+
+	t->elem_size = elem_size;
+
+	t->mtu = mtu;
+
+	/* transfers registered here will be auto-released */
+	t->irq_fwd = IN;
+
+	t->priority = dma_priority;
+
+	t->callback = callback;
+	t->userdata = userdata;
+
+	noc_dma_register_transfer(t);
+
+
+	return 0;
+}
+EXPORT_SYMBOL(noc_dma_req_sg_xfer);
@@ -151,6 +151,29 @@ static inline bool schedule_edf_can_execute(struct task_struct *tsk, int cpu, kt
 }
 
 
+#ifdef CONFIG_TIME_SYNC
+/**
+ * @brief align the release of a task to the grid of external ticks
+ *
+ * @param tsk a periodic task
+ * @param t the nominal release time
+ * @param next if true, return the first aligned release at or after t,
+ *	  otherwise the one nearest to t
+ *
+ * @note see time_sync_align()
+ */
+
+static ktime edf_tick_align(struct task_struct *tsk, ktime t, bool next)
+{
+	if (!tsk->attr.tick_sync)
+		return t;
+
+	return time_sync_align(t, tsk->attr.period, tsk->attr.tick_phase,
+			       next);
+}
+#endif /* CONFIG_TIME_SYNC */
+
+
 /**
  * @brief reinitialise a task
  */
@@ -170,6 +193,15 @@ static inline void schedule_edf_reinit_task(struct task_struct *tsk, ktime now)
 
 	new_wake = ktime_add(tsk->wakeup, tsk->attr.period);
 
+#ifdef CONFIG_TIME_SYNC
+	/* pull the release back in phase if the tick reference moved, but
+	 * never let it overlap with the current job
+	 */
+	new_wake = edf_tick_align(tsk, new_wake, false);
+	if (ktime_before(new_wake, tsk->deadline))
+		new_wake = ktime_add(new_wake, tsk->attr.period);
+#endif /* CONFIG_TIME_SYNC */
+
 	/* deadline missed earlier?
 	 * XXX need FDIR procedure for this situation: report and wind
 	 *     wakeup/deadline forward
@@ -923,6 +955,9 @@ static int edf_wake(struct task_struct *task, ktime now)
 	/* shift wakeup by minimum tick period */
 	wakeup         = ktime_add(wakeup, tick_get_period_min_ns());
 	task->wakeup   = ktime_add(wakeup, task->attr.period);
+#ifdef CONFIG_TIME_SYNC
+	task->wakeup   = edf_tick_align(task, task->wakeup, true);
+#endif /* CONFIG_TIME_SYNC */
 	task->deadline = ktime_add(task->wakeup, task->attr.deadline_rel);
 
 	/* reset runtime to full */
@@ -1057,6 +1092,35 @@ static int edf_check_sched_attr(struct sched_attr *attr)
 		goto error;
 	}
 
+	if (attr->tick_sync) {
+#ifdef CONFIG_TIME_SYNC
+		if (attr->period <= 0) {
+			pr_err(MSG "Cannot synchronise non-periodic EDF task "
+			       "to the time tick\n");
+			goto error;
+		}
+
+		if ((attr->tick_phase < 0)
+		    || (attr->tick_phase >= attr->period)) {
+			pr_err(MSG "Cannot schedule EDF task with tick phase "
+			       "%lld outside of PERIOD %lld\n",
+			       attr->tick_phase, attr->period);
+			goto error;
+		}
+
+		if (time_sync_check_period(attr->period)) {
+			pr_err(MSG "Cannot synchronise EDF task with PERIOD "
+			       "%lld to the time tick period %lld\n",
+			       attr->period, time_sync_get_period());
+			goto error;
+		}
+#else
+		pr_err(MSG "Cannot synchronise EDF task to the time tick, "
+		       "TIME_SYNC is not configured\n");
+		goto error;
+#endif /* CONFIG_TIME_SYNC */
+	}
+
 
 
 	return 0;
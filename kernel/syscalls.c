@@ -190,6 +190,15 @@ SYSCALL_DEFINE1(grspw2, struct grspw2_data *, spw)
 			return grspw2_auto_drop_enable(&spw_cfg[spw->link].spw, spw->n_drop);
 	case GRSPW2_OP_AUTO_DROP_DISABLE:
 			return grspw2_auto_drop_disable(&spw_cfg[spw->link].spw);
+	case GRSPW2_OP_ADD_PKTS:
+			return grspw2_add_pkts(&spw_cfg[spw->link].spw, spw->iov,
+					       spw->n_pkts);
+	case GRSPW2_OP_RECV:
+			return grspw2_recv(&spw_cfg[spw->link].spw, spw->pkt,
+					   spw->timeout_us);
+	case GRSPW2_OP_GET_PKTS:
+			return grspw2_get_pkts(&spw_cfg[spw->link].spw, spw->buf,
+					       spw->n_pkts);
 
 	default:
 			printk("SPW ERROR: unknown OP %d\n", spw->op);
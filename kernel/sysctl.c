@@ -541,7 +541,7 @@ struct sysobj *sysset_find_obj(struct sysset *sysset, const char *path)
 			/* we have an exact match and no more delimiters,
 			 * so maybe we were looking for a sysset (directory)
 			 */
-			if (!memchr(token, '/', SYSCTL_MAX_PATH_LEN))
+			if (!strchr(token, '/'))
 				return s;
 
 			sysset = container_of(s->child, struct sysset, sobj);
@@ -13,10 +13,32 @@
 #include <kernel/time.h>
 #include <kernel/export.h>
 
+#ifdef CONFIG_TIME_SYNC
+#include <compiler.h>
+#include <asm/spinlock.h>
+#include <asm-generic/irqflags.h>
+#endif /* CONFIG_TIME_SYNC */
+
 #define MSG "KTIME: "
 
 static struct timekeeper tk;
 
+#ifdef CONFIG_TIME_SYNC
+static struct spinlock time_sync_spinlock;
+
+/* limit of the total rate correction */
+#define TIME_SYNC_RATE_MAX_PPB	500000
+/* phase errors are removed over this many tick periods */
+#define TIME_SYNC_SLEW_TICKS	4
+/* drift estimate smoothing, i.e. a gain of 1/2^n per tick */
+#define TIME_SYNC_DRIFT_SHIFT	2
+/* a phase error above period/n resets the tick reference */
+#define TIME_SYNC_RESET_DIV	1000
+/* phase error threshold and number of ticks to consider the time locked */
+#define TIME_SYNC_LOCK_NS	10000
+#define TIME_SYNC_LOCK_TICKS	4
+#endif /* CONFIG_TIME_SYNC */
+
 
 /**
  * @brief returns the readout overhead of the uptime/ktime clock
@@ -390,6 +412,490 @@ inline ktime ms_to_ktime(const int64_t msec)
 
 
 
+#ifdef CONFIG_TIME_SYNC
+/**
+ * @brief apply the rate correction to an interval of the raw clock
+ *
+ * @param d the raw interval since the last update
+ * @param slew the raw interval over which the rate applies
+ * @param rate the rate correction in ppb
+ * @param drift the correction of the clock drift in ppb, which applies
+ *	  beyond the slew interval
+ *
+ * @returns the interval in kernel time
+ *
+ * @note The rate includes the removal of the phase error, which is meant to
+ *	 last only until the next tick. If no tick arrives, the kernel time
+ *	 continues at the rate of the drift correction instead.
+ */
+
+static ktime time_sync_delta(ktime d, ktime slew, int32_t rate, int32_t drift)
+{
+	if (d <= slew)
+		return d + (d / 1000) * rate / 1000000;
+
+	return slew + (slew / 1000) * rate / 1000000
+		+ (d - slew) + ((d - slew) / 1000) * drift / 1000000;
+}
+
+
+/**
+ * @brief convert a raw clock readout to the disciplined kernel time
+ *
+ * @note the rate correction is applied relative to the last update, so
+ *	 the kernel time is continuous and monotonic across updates
+ */
+
+static ktime time_sync_adjust(const ktime raw)
+{
+	uint32_t seq;
+
+	ktime d;
+	ktime ns;
+
+
+	do {
+		seq = tk.sync.seq;
+		barrier();
+
+		d  = raw - tk.sync.raw_base;
+		ns = tk.sync.base + time_sync_delta(d, tk.sync.slew,
+						    tk.sync.rate,
+						    tk.sync.drift);
+
+		barrier();
+	} while ((seq & 1) || (seq != tk.sync.seq));
+
+	return ns;
+}
+
+
+/**
+ * @brief read the raw clock, i.e. the undisciplined time since boot
+ */
+
+static ktime time_sync_get_raw(void)
+{
+	uint32_t sec;
+	uint32_t nsec;
+
+
+	tk.clock->read(&sec, &nsec);
+
+	return (ktime) sec * NSEC_PER_SEC + (ktime) nsec
+		+ (ktime) ktime_get_readout_overhead();
+}
+
+
+/**
+ * @brief begin an update of the time discipline parameters
+ */
+
+static unsigned long time_sync_update_begin(void)
+{
+	unsigned long flags;
+
+
+	flags = arch_local_irq_save();
+	spin_lock_raw(&time_sync_spinlock);
+
+	tk.sync.seq++;
+	barrier();
+
+	return flags;
+}
+
+
+/**
+ * @brief end an update of the time discipline parameters
+ */
+
+static void time_sync_update_end(unsigned long flags)
+{
+	barrier();
+	tk.sync.seq++;
+
+	spin_unlock(&time_sync_spinlock);
+	arch_local_irq_restore(flags);
+}
+
+
+/**
+ * @brief rebase the kernel time to a raw clock readout
+ *
+ * @note call only within an update
+ */
+
+static void time_sync_rebase(const ktime raw)
+{
+	ktime d;
+
+
+	d = raw - tk.sync.raw_base;
+
+	tk.sync.base    += time_sync_delta(d, tk.sync.slew, tk.sync.rate,
+					   tk.sync.drift);
+	tk.sync.raw_base = raw;
+
+	if (d < tk.sync.slew) {
+		tk.sync.slew -= d;
+	} else {
+		tk.sync.slew = 0;
+		tk.sync.rate = tk.sync.drift;
+	}
+}
+
+
+/**
+ * @brief clamp a rate correction to the permitted range
+ */
+
+static int32_t time_sync_clamp_rate(int64_t rate)
+{
+	if (rate > TIME_SYNC_RATE_MAX_PPB)
+		return TIME_SYNC_RATE_MAX_PPB;
+
+	if (rate < -TIME_SYNC_RATE_MAX_PPB)
+		return -TIME_SYNC_RATE_MAX_PPB;
+
+	return (int32_t) rate;
+}
+
+
+/**
+ * @brief set the tick reference to the current tick
+ *
+ * @note call only within an update
+ */
+
+static void time_sync_reset(const ktime raw)
+{
+	tk.sync.tick     = tk.sync.base;
+	tk.sync.tick_raw = raw;
+	tk.sync.err      = 0;
+	tk.sync.n_lock   = 0;
+	tk.sync.ticks    = 0;
+
+	/* the drift estimate remains valid, only the phase is lost */
+	tk.sync.rate     = tk.sync.drift;
+	tk.sync.slew     = 0;
+
+	tk.sync.resets++;
+}
+
+
+/**
+ * @brief enable the discipline of the kernel time to an external tick
+ *
+ * @param period the nominal period of the tick in nanoseconds, at least 1 ms
+ *
+ * @note the first call to time_sync_tick() after this sets the tick
+ *	 reference, the kernel time is never stepped
+ */
+
+void time_sync_enable(ktime period)
+{
+	unsigned long flags;
+
+
+	if (!tk.clock)
+		return;
+
+	if (period < (ktime) NSEC_PER_MSEC)
+		return;
+
+	flags = time_sync_update_begin();
+
+	time_sync_rebase(time_sync_get_raw());
+
+	tk.sync.period = period;
+	tk.sync.tick   = 0;
+	tk.sync.drift  = 0;
+	tk.sync.rate   = 0;
+	tk.sync.slew   = 0;
+	tk.sync.n_lock = 0;
+	tk.sync.ticks  = 0;
+	tk.sync.resets = 0;
+
+	time_sync_update_end(flags);
+}
+EXPORT_SYMBOL(time_sync_enable);
+
+
+/**
+ * @brief disable the discipline of the kernel time
+ *
+ * @note the kernel time continues at the rate of the raw clock from its
+ *	 current value
+ */
+
+void time_sync_disable(void)
+{
+	unsigned long flags;
+
+
+	if (!tk.clock)
+		return;
+
+	flags = time_sync_update_begin();
+
+	time_sync_rebase(time_sync_get_raw());
+
+	tk.sync.period = 0;
+	tk.sync.drift  = 0;
+	tk.sync.rate   = 0;
+	tk.sync.slew   = 0;
+	tk.sync.n_lock = 0;
+
+	time_sync_update_end(flags);
+}
+EXPORT_SYMBOL(time_sync_disable);
+
+
+/**
+ * @brief signal the reception of an external tick
+ *
+ * @param ticks the number of tick periods elapsed since the last call
+ *
+ * @note this is intended to be called from the interrupt which signals the
+ *	 tick, e.g. a SpaceWire tick-out; the number of elapsed periods is
+ *	 usually 1 but may be larger if a tick was not signalled
+ *
+ * The drift of the raw clock is estimated from the interval between two
+ * ticks, the rate of the kernel time is then set to compensate the drift
+ * and to remove the remaining phase error over TIME_SYNC_SLEW_TICKS periods.
+ * If no further tick arrives within these periods, the phase error was
+ * removed and the kernel time continues with the drift compensation only.
+ * If the phase error is too large to be slewed, e.g. because the tick
+ * source changed, the tick reference is reset to the current tick.
+ */
+
+void time_sync_tick(unsigned long ticks)
+{
+	ktime raw;
+	ktime nom;
+	ktime max;
+
+	int64_t err;
+	int64_t drift;
+	int64_t rate;
+
+	unsigned long flags;
+
+
+	if (!tk.clock)
+		return;
+
+	if (!tk.sync.period)
+		return;
+
+	if (!ticks)
+		return;
+
+	raw = time_sync_get_raw();
+
+	flags = time_sync_update_begin();
+
+	time_sync_rebase(raw);
+
+	if (!tk.sync.tick) {
+		time_sync_reset(raw);
+		goto exit;
+	}
+
+	nom = (ktime) ticks * tk.sync.period;
+	max = nom / TIME_SYNC_RESET_DIV;
+
+	tk.sync.tick += nom;
+	err = tk.sync.base - tk.sync.tick;
+
+	/* deviation of the raw clock from the nominal tick interval */
+	drift = raw - tk.sync.tick_raw - nom;
+
+	if ((err > max) || (err < -max) || (drift > max) || (drift < -max)) {
+		time_sync_reset(raw);
+		goto exit;
+	}
+
+	drift = -drift * 1000000 / (nom / 1000);
+
+	tk.sync.drift += (int32_t) ((drift - tk.sync.drift)
+				    >> TIME_SYNC_DRIFT_SHIFT);
+
+	rate = -err * 1000000 / (tk.sync.period * TIME_SYNC_SLEW_TICKS / 1000);
+
+	tk.sync.rate     = time_sync_clamp_rate(tk.sync.drift + rate);
+	tk.sync.slew     = tk.sync.period * TIME_SYNC_SLEW_TICKS;
+	tk.sync.tick_raw = raw;
+	tk.sync.err      = err;
+	tk.sync.ticks   += ticks;
+
+	if ((err < TIME_SYNC_LOCK_NS) && (err > -TIME_SYNC_LOCK_NS)) {
+		if (tk.sync.n_lock < TIME_SYNC_LOCK_TICKS)
+			tk.sync.n_lock++;
+	} else {
+		tk.sync.n_lock = 0;
+	}
+
+exit:
+	time_sync_update_end(flags);
+}
+EXPORT_SYMBOL(time_sync_tick);
+
+
+/**
+ * @brief check if the kernel time is locked to the external tick
+ */
+
+bool time_sync_locked(void)
+{
+	if (!tk.sync.period)
+		return false;
+
+	return tk.sync.n_lock >= TIME_SYNC_LOCK_TICKS;
+}
+EXPORT_SYMBOL(time_sync_locked);
+
+
+/**
+ * @brief get the nominal period of the external tick
+ *
+ * @returns the period in nanoseconds or 0 if the time discipline is disabled
+ */
+
+ktime time_sync_get_period(void)
+{
+	return tk.sync.period;
+}
+EXPORT_SYMBOL(time_sync_get_period);
+
+
+/**
+ * @brief get the kernel time of the next external tick
+ *
+ * @param t a kernel time
+ *
+ * @returns the expected time of the first tick at or after t, or t if no
+ *	    tick reference is set
+ */
+
+ktime time_sync_next_tick(ktime t)
+{
+	ktime d;
+	ktime tick;
+	ktime period;
+
+	uint32_t seq;
+
+
+	do {
+		seq = tk.sync.seq;
+		barrier();
+
+		period = tk.sync.period;
+		tick   = tk.sync.tick;
+
+		barrier();
+	} while ((seq & 1) || (seq != tk.sync.seq));
+
+	if (!period || !tick)
+		return t;
+
+	d = t - tick;
+
+	if (d <= 0)
+		return tick + (d / period) * period;
+
+	return tick + ((d + period - 1) / period) * period;
+}
+EXPORT_SYMBOL(time_sync_next_tick);
+
+
+/**
+ * @brief check if a period can be aligned to the external tick
+ *
+ * @param period the period in nanoseconds
+ *
+ * @returns 0 if the period divides or is a multiple of the tick period or if
+ *	    the time discipline is disabled, -EINVAL otherwise
+ *
+ * @note any other period would drift against the tick, so it cannot be kept
+ *	 in phase with it
+ */
+
+int time_sync_check_period(ktime period)
+{
+	ktime tick;
+
+
+	if (period <= 0)
+		return -EINVAL;
+
+	tick = tk.sync.period;
+	if (!tick)
+		return 0;
+
+	if (!(tick % period))
+		return 0;
+
+	if (!(period % tick))
+		return 0;
+
+	return -EINVAL;
+}
+EXPORT_SYMBOL(time_sync_check_period);
+
+
+/**
+ * @brief align a periodic event to the grid of external ticks
+ *
+ * @param t the nominal time of the event
+ * @param period the period of the event, see time_sync_check_period()
+ * @param phase the offset of the event to the tick, less than period
+ * @param next if true, return the first tick at or after t plus the phase,
+ *	  otherwise the point of the grid nearest to t
+ *
+ * @returns the aligned time, or t if there is no tick reference or the
+ *	    period cannot be aligned
+ *
+ * @note The grid is the tick edges plus the phase, subdivided by the period
+ *	 if the latter is shorter than the tick period. If the period is a
+ *	 multiple of the tick period, the event keeps its own subset of the
+ *	 ticks, as t is never moved by more than half a tick period.
+ */
+
+ktime time_sync_align(ktime t, ktime period, ktime phase, bool next)
+{
+	ktime o;
+	ktime tick;
+
+
+	if (!tk.sync.period)
+		return t;
+
+	if (time_sync_check_period(period))
+		return t;
+
+	t = ktime_sub(t, phase);
+
+	if (next)
+		return ktime_add(time_sync_next_tick(t), phase);
+
+	tick = time_sync_next_tick(ktime_sub(t, tk.sync.period / 2));
+
+	o = ktime_delta(t, tick) % period;
+	if (o < 0)
+		o += period;
+
+	if (o >= period / 2)
+		o -= period;
+
+	return ktime_add(ktime_sub(t, o), phase);
+}
+EXPORT_SYMBOL(time_sync_align);
+#endif /* CONFIG_TIME_SYNC */
+
+
 /**
  * @brief get current kernel time (== uptime)
  *
@@ -414,6 +920,9 @@ ktime ktime_get(void)
 
 	ns += (ktime) ktime_get_readout_overhead();
 
+#ifdef CONFIG_TIME_SYNC
+	ns = time_sync_adjust(ns);
+#endif /* CONFIG_TIME_SYNC */
 
 	return ns;
 }
@@ -68,6 +68,13 @@
  * noc_dma), which they may use to transfer memory contents to and from their
  * local tightly couple memory (TCM).
  *
+ * Along with the current task, a Xentium is also handed the next pending task
+ * of the node, so that the kernel may transfer its data into a second TCM bank
+ * while processing the current one (see dsp/xentium/lib/prefetch.c). On
+ * completion of the current task, the next task becomes the current one
+ * and a new one is taken from the node. If processing of the node is aborted,
+ * the next task is returned to the node.
+ *
  * The task of the host processor consists of command exchange and loading of
  * the Xentium kernel programs as needed. Typically, a nodes are scheduled for
  * processing in round-robin style given their current order, with the exception
@@ -99,6 +106,37 @@
  * xentium_config_output_node()
  *
  *
+ * Since Xentium programs are not relocatable, their images are loaded to the
+ * addresses they were linked to. Kernel images may hence overlap, e.g. if they
+ * are linked to a common base address to save memory. The run-time sections of
+ * every kernel are cached on load, so an image that was overwritten by an
+ * overlapping one is restored from the cache the next time its node is
+ * scheduled, rather than parsing the ELF binary again. An image is only
+ * replaced if none of the overlapping kernels are executing, otherwise the node
+ * is marked pending like any other node that must wait for a Xentium.
+ *
+ *
+ * Each Xentium is also handed a memory arena of CONFIG_XENTIUM_KMEM_ARENA_SIZE
+ * bytes, from which kernel programs serve their kmalloc() requests locally
+ * (see dsp/xentium/lib/kmem.c). Only if the arena is exhausted, memory is
+ * requested from the host via TASK_KMALLOC/TASK_KZALLOC.
+ *
+ *
+ * If CONFIG_XENTIUM_STATS_COLLECT is set, the driver records the usage of
+ * every Xentium and kernel program, i.e. kernel starts, processed tasks,
+ * mailbox round-trips, host allocation requests, bytes moved via DMA (as
+ * reported by the Xentium with every message, see dsp/xentium/lib/dma.c),
+ * busy and idle times and the time tasks wait in a node before they are handed
+ * to a Xentium. The statistics are published in /sys/driver/xentium as
+ * "xen<n>" for Xentiums and by op code for kernel programs. Busy and idle times
+ * are updated when a kernel program starts or exits.
+ *
+ *
+ * For testing and benchmarking without MPPB/SSDP hardware, the driver may be
+ * run on a Linux host against emulated Xentiums and NoC DMA, which execute
+ * natively compiled Xentium kernels, see tools/testing/unittest/xentium/
+ *
+ *
  * This is still a mess. TODOs are listed in order of priority
  *
  * TODO Resource locking is horrific atm, but (somewhat) works for now. We
@@ -110,10 +148,18 @@
  *	the actual task data is stored. Currently, this is not an issue, because
  *	the MPPB(v2) does not have an MMU, but the SSDP probably will.
  *
- * TODO At some point, we will want to add sysctl support to export statistics
- *      of processing node usage.
+ * If the number of pending tasks in a node reaches the critical level
+ * defined by its kernel, further idle Xentiums are assigned to the same node,
+ * each pulling tasks from the node independently. Since the kernel programs are
+ * not relocatable, all instances execute the same loaded kernel image, but work
+ * in the local memory of their own Xentium and with their own DMA channel.
+ * This is only done for kernels without permanent storage (i.e. a
+ * xen_kernel_cfg with a size of 0), as the storage of stateful kernels would be
+ * shared between instances. Since the tasks of parallel nodes may complete out
+ * of order, xentium_output_tasks() releases tasks by order of their sequence
+ * number.
  *
- * TODO For now, parallel nodes are not supported unless multiple kernels
+ * TODO Stateful kernels cannot run in parallel unless multiple kernels
  *	of the same type are loaded. We can fix that if we link the kernel
  *	object code ourselves, since xentium-clang cannot currently produce
  *	relocatable executables.
@@ -161,6 +207,12 @@
 
 #define XENTIUMS	2
 
+#ifdef CONFIG_XENTIUM_KMEM_ARENA_SIZE
+#define XEN_KMEM_ARENA_SIZE	CONFIG_XENTIUM_KMEM_ARENA_SIZE
+#else
+#define XEN_KMEM_ARENA_SIZE	0x10000
+#endif
+
 /* this is where we keep track of loaded kernels and Xentium activity */
 static struct {
 	struct proc_net *pn;
@@ -172,11 +224,22 @@ static struct {
 
 	int pt_pending;
 
+	int seq_ord;		/* output must be released in sequence order */
+	unsigned long seq_par;	/* highest seq handed to a parallel instance */
+
 	struct spinlock lock;
 
 	struct proc_tracker     *pt[XENTIUMS];
+	struct xen_msg_data    *msg[XENTIUMS];
 	struct xen_dev_mem     *dev[XENTIUMS];
 	struct noc_dma_channel *dma[XENTIUMS];
+	void                   *arena[XENTIUMS];
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	struct xen_kernel      *k[XENTIUMS];	/* the executing kernels */
+	struct xen_stats     stats[XENTIUMS];
+	struct sysset *sset;
+#endif /* CONFIG_XENTIUM_STATS_COLLECT */
 
 } _xen = {.dev  = {(struct xen_dev_mem *) (XEN_BASE_0 + XEN_DEV_OFFSET),
 		   (struct xen_dev_mem *) (XEN_BASE_1 + XEN_DEV_OFFSET)}
@@ -236,6 +299,83 @@ static int xen_node_is_processing(struct proc_tracker *pt)
 	return 0;
 }
 
+/**
+ * @brief check if a tracker node may be processed by an additional Xentium
+ *
+ * @return 1 if parallel processing is possible, 0 otherwise
+ *
+ * @note the storage of stateful kernels is not per-instance, so these are
+ *	 never run in parallel
+ */
+
+static int xen_node_is_parallel(struct proc_tracker *pt)
+{
+	size_t i;
+
+
+	if (!pt_track_level_critical(pt))
+		return 0;
+
+	for (i = 0; i < _xen.cnt; i++) {
+		if (_xen.cfg[i]->op_code != pt->op_code)
+			continue;
+
+		if (!_xen.cfg[i]->size)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief record the tasks of a node that is processed by multiple Xentiums
+ *
+ * @note tasks of parallel instances may complete out of order, so the
+ *	 output is released by sequence number until no task up to the
+ *	 highest sequence number handed to a parallel instance remains in the
+ *	 network, see xentium_output_tasks()
+ */
+
+static void xen_track_parallel(struct proc_tracker *pt)
+{
+	size_t i;
+	size_t n = 0;
+
+	struct xen_msg_data *m;
+
+
+	for (i = 0; i < ARRAY_SIZE(_xen.pt); i++) {
+		if (_xen.pt[i] == pt)
+			n++;
+	}
+
+	if (n < 2)
+		return;
+
+	if (!_xen.seq_ord)
+		_xen.seq_par = 0;
+
+	_xen.seq_ord = 1;
+
+	for (i = 0; i < ARRAY_SIZE(_xen.msg); i++) {
+
+		if (_xen.pt[i] != pt)
+			continue;
+
+		m = _xen.msg[i];
+		if (!m)
+			continue;
+
+		if (m->t && pt_get_seq(m->t) > _xen.seq_par)
+			_xen.seq_par = pt_get_seq(m->t);
+
+		if (m->t_next && pt_get_seq(m->t_next) > _xen.seq_par)
+			_xen.seq_par = pt_get_seq(m->t_next);
+	}
+}
+
+
 /**
  * @brief see if a task is pending
  *
@@ -404,6 +544,149 @@ static struct xen_kernel *xen_get_kernel(int idx)
 }
 
 
+/**
+ * @brief check if the images of two kernels occupy overlapping memory
+ */
+
+static int xen_kernel_overlap(struct xen_kernel *a, struct xen_kernel *b)
+{
+	return (a->lo < b->hi) && (b->lo < a->hi);
+}
+
+
+/**
+ * @brief check if a kernel is currently executed by any Xentium
+ *
+ * @param idx the index of the kernel
+ */
+
+static int xen_kernel_running(int idx)
+{
+	size_t i;
+
+
+	for (i = 0; i < ARRAY_SIZE(_xen.pt); i++) {
+
+		if (!_xen.pt[i])
+			continue;
+
+		if (_xen.pt[i]->op_code == _xen.cfg[idx]->op_code)
+			return 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief mark all kernels overlapping the image of a kernel as evicted
+ */
+
+static void xen_kernel_evict_overlapping(struct xen_kernel *x)
+{
+	size_t i;
+
+
+	for (i = 0; i < _xen.cnt; i++) {
+
+		if (_xen.x[i] == x)
+			continue;
+
+		if (!_xen.x[i]->resident)
+			continue;
+
+		if (!xen_kernel_overlap(x, _xen.x[i]))
+			continue;
+
+		pr_debug(MSG "Evicting kernel %s\n", _xen.cfg[i]->name);
+
+		_xen.x[i]->resident = 0;
+	}
+}
+
+
+/**
+ * @brief evict all kernels overlapping the image of a kernel, unless one of
+ *	  them is executing
+ *
+ * @returns 0 on success, -EBUSY if an overlapping kernel is executing
+ */
+
+static int xen_kernel_make_room(struct xen_kernel *x)
+{
+	size_t i;
+
+
+	/* we cannot swap out a kernel that is being executed */
+	for (i = 0; i < _xen.cnt; i++) {
+
+		if (_xen.x[i] == x)
+			continue;
+
+		if (!_xen.x[i]->resident)
+			continue;
+
+		if (!xen_kernel_overlap(x, _xen.x[i]))
+			continue;
+
+		if (xen_kernel_running(i))
+			return -EBUSY;
+	}
+
+	xen_kernel_evict_overlapping(x);
+
+	return 0;
+}
+
+
+/**
+ * @brief make sure the image of a kernel is in place
+ *
+ * @param idx the index of the kernel
+ *
+ * @returns 0 on success, -EBUSY if an overlapping kernel is executing,
+ *	    -EINVAL if the index is invalid
+ *
+ * @note the image is restored from the cached sections, so the ELF binary is
+ *	 not needed again
+ */
+
+static int xen_kernel_load_image(int idx)
+{
+	size_t i;
+
+	struct xen_kernel *x;
+	struct xen_kern_section *s;
+
+
+	x = xen_get_kernel(idx);
+	if (!x)
+		return -EINVAL;
+
+	if (x->resident)
+		return 0;
+
+	if (xen_kernel_make_room(x))
+		return -EBUSY;
+
+	pr_debug(MSG "Restoring kernel %s\n", _xen.cfg[idx]->name);
+
+	for (i = 0; i < x->num_sec; i++) {
+
+		s = &x->sec[i];
+
+		if (s->img)
+			memcpy((void *) s->addr, s->img, s->size);
+		else
+			bzero((void *) s->addr, s->size);
+	}
+
+	x->resident = 1;
+
+	return 0;
+}
+
+
 /**
  * @brief set the entry point mailbox to load a xentium program
  *
@@ -453,25 +736,389 @@ static struct xen_msg_data *xen_get_msg(struct xen_dev_mem *xen)
 	if (!xen)
 		return NULL;
 
-	return (struct xen_msg_data *) ioread32be(&xen->mbox[XEN_MSG_MBOX]);
+	return (struct xen_msg_data *) ioread32be(&xen->mbox[XEN_MSG_MBOX]);
+}
+
+
+/**
+ * @brief return the task that was handed to a Xentium ahead of time
+ *
+ * @param pt the tracker node the task was taken from
+ * @param m the data message of the Xentium
+ *
+ * @note the task is returned to the head of the node, so it is processed next
+ *	 and keeps its order relative to the other tasks of the node
+ */
+
+static void xen_put_back_next(struct proc_tracker *pt, struct xen_msg_data *m)
+{
+	if (!m->t_next)
+		return;
+
+	BUG_ON(pt_track_put_head(pt, m->t_next));
+
+	m->t_next = NULL;
+}
+
+
+/**
+ *
+ * @brief load and start a kernel with a particular op code
+ *
+ * @note this is the "op func" called by pn_process_next() we would use to start
+ *	 and wait for kernels to run if we had threads but until then we need to
+ *	 do our own step-by-step processing
+ */
+
+static int op_xen_schedule_kernel(unsigned long op_code, struct proc_task *t)
+{
+	pr_err(MSG "Not implemented\n");
+
+	return PN_TASK_SUCCESS;
+}
+
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+
+__extension__
+static ssize_t xen_stats_show(struct sysobj *sobj,
+			      struct sobj_attribute *sattr,
+			      char *buf)
+{
+	struct xen_stats *st;
+
+
+	st = container_of(sobj, struct xen_stats, sobj);
+
+	if (!strcmp(sattr->name, "starts"))
+		return sprintf(buf, "%lu", st->starts);
+
+	if (!strcmp(sattr->name, "tasks"))
+		return sprintf(buf, "%lu", st->tasks);
+
+	if (!strcmp(sattr->name, "cmds"))
+		return sprintf(buf, "%lu", st->cmds);
+
+	if (!strcmp(sattr->name, "host_allocs"))
+		return sprintf(buf, "%lu", st->allocs);
+
+	if (!strcmp(sattr->name, "dma_bytes"))
+		return sprintf(buf, "%llu", (unsigned long long) st->dma_bytes);
+
+	if (!strcmp(sattr->name, "busy_us"))
+		return sprintf(buf, "%lld", ktime_to_us(st->busy));
+
+	if (!strcmp(sattr->name, "idle_us"))
+		return sprintf(buf, "%lld", ktime_to_us(st->idle));
+
+	if (!strcmp(sattr->name, "wait_avg_us")) {
+		if (!st->dispatched)
+			return sprintf(buf, "0");
+		return sprintf(buf, "%lld", ktime_to_us(st->wait) /
+					    (int64_t) st->dispatched);
+	}
+
+	if (!strcmp(sattr->name, "wait_max_us"))
+		return sprintf(buf, "%lld", ktime_to_us(st->wait_max));
+
+	return 0;
+}
+
+
+__extension__
+static ssize_t xen_stats_store(struct sysobj *sobj,
+			       struct sobj_attribute *sattr,
+			       __attribute__((unused)) const char *buf,
+			       __attribute__((unused)) size_t len)
+{
+	struct xen_stats *st;
+
+
+	st = container_of(sobj, struct xen_stats, sobj);
+
+	if (!strcmp(sattr->name, "reset_stats")) {
+		st->starts     = 0;
+		st->tasks      = 0;
+		st->cmds       = 0;
+		st->allocs     = 0;
+		st->dispatched = 0;
+		st->dma_bytes  = 0;
+		st->busy       = 0;
+		st->idle       = 0;
+		st->wait       = 0;
+		st->wait_max   = 0;
+	}
+
+	return 0;
+}
+
+__extension__
+static struct sobj_attribute xen_stats_attr[] = {
+	__ATTR(starts,      xen_stats_show, NULL),
+	__ATTR(tasks,       xen_stats_show, NULL),
+	__ATTR(cmds,        xen_stats_show, NULL),
+	__ATTR(host_allocs, xen_stats_show, NULL),
+	__ATTR(dma_bytes,   xen_stats_show, NULL),
+	__ATTR(busy_us,     xen_stats_show, NULL),
+	__ATTR(wait_avg_us, xen_stats_show, NULL),
+	__ATTR(wait_max_us, xen_stats_show, NULL),
+	__ATTR(reset_stats, NULL,           xen_stats_store),
+	__ATTR(idle_us,     xen_stats_show, NULL),
+};
+
+/* kernel programs are never idle, they are just not executing */
+__extension__
+static struct sobj_attribute *xen_kernel_attributes[] = {
+	&xen_stats_attr[0], &xen_stats_attr[1], &xen_stats_attr[2],
+	&xen_stats_attr[3], &xen_stats_attr[4], &xen_stats_attr[5],
+	&xen_stats_attr[6], &xen_stats_attr[7], &xen_stats_attr[8],
+	NULL};
+
+__extension__
+static struct sobj_attribute *xen_attributes[] = {
+	&xen_stats_attr[0], &xen_stats_attr[1], &xen_stats_attr[2],
+	&xen_stats_attr[3], &xen_stats_attr[4], &xen_stats_attr[5],
+	&xen_stats_attr[6], &xen_stats_attr[7], &xen_stats_attr[8],
+	&xen_stats_attr[9],
+	NULL};
+
+
+/**
+ * @brief account for the start of a kernel program on a Xentium
+ *
+ * @param x_idx the index of the Xentium
+ * @param k the kernel program
+ */
+
+static void xen_stats_start(int x_idx, struct xen_kernel *k)
+{
+	ktime now;
+
+	struct xen_stats *st = &_xen.stats[x_idx];
+
+
+	now = ktime_get();
+
+	st->idle   += ktime_delta(now, st->t_state);
+	st->t_state = now;
+
+	st->starts++;
+	k->stats.starts++;
+
+	_xen.k[x_idx] = k;
+}
+
+
+/**
+ * @brief account for the end of a kernel program on a Xentium
+ *
+ * @param x_idx the index of the Xentium
+ */
+
+static void xen_stats_stop(int x_idx)
+{
+	ktime now;
+	ktime busy;
+
+	struct xen_stats *st = &_xen.stats[x_idx];
+
+
+	if (!_xen.k[x_idx])
+		return;
+
+	now  = ktime_get();
+	busy = ktime_delta(now, st->t_state);
+
+	st->busy   += busy;
+	st->t_state = now;
+
+	_xen.k[x_idx]->stats.busy += busy;
+
+	_xen.k[x_idx] = NULL;
+}
+
+
+/**
+ * @brief account for the time a task waited in its tracker before it was
+ *	  processed by a Xentium
+ *
+ * @param x_idx the index of the Xentium
+ * @param t the task, may be NULL
+ *
+ * @note the time of entry into a tracker is only recorded if
+ *	 CONFIG_PROC_NET_STATS_COLLECT is set
+ *
+ * @note a task handed over ahead of time is only accounted once it is
+ *	 processed, as it may still be returned to its tracker and be handed
+ *	 over again, see xen_put_back_next()
+ */
+
+static void xen_stats_wait(int x_idx, struct proc_task *t)
+{
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	ktime wait;
+
+	struct xen_stats *st = &_xen.stats[x_idx];
+	struct xen_stats *ks;
+
+
+	if (!t)
+		return;
+
+	if (!_xen.k[x_idx])
+		return;
+
+	ks = &_xen.k[x_idx]->stats;
+
+	wait = ktime_delta(ktime_get(), t->t_track);
+
+	st->wait += wait;
+	ks->wait += wait;
+
+	if (wait > st->wait_max)
+		st->wait_max = wait;
+
+	if (wait > ks->wait_max)
+		ks->wait_max = wait;
+
+	st->dispatched++;
+	ks->dispatched++;
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+}
+
+
+/**
+ * @brief account for a message received from a Xentium
+ *
+ * @param x_idx the index of the Xentium
+ * @param m the message
+ * @param cmd the command of the message
+ */
+
+static void xen_stats_msg(int x_idx, struct xen_msg_data *m, unsigned long cmd)
+{
+	unsigned long tasks  = 0;
+	unsigned long allocs = 0;
+	unsigned long bytes;
+
+	struct xen_stats *st = &_xen.stats[x_idx];
+	struct xen_stats *ks;
+
+
+	switch (cmd) {
+	case TASK_SUCCESS:
+	case TASK_STOP:
+	case TASK_DETACH:
+	case TASK_RESCHED:
+	case TASK_SORTSEQ:
+	case TASK_DESTROY:
+		tasks = 1;
+		break;
+	case TASK_DATA_REALLOC:
+	case TASK_KZALLOC:
+	case TASK_KMALLOC:
+	case TASK_KFREE:
+		allocs = 1;
+		break;
+	default:
+		break;
+	}
+
+	bytes = ioread32be(&m->dma_bytes);
+
+	st->cmds++;
+	st->tasks     += tasks;
+	st->allocs    += allocs;
+	st->dma_bytes += bytes;
+
+	if (!_xen.k[x_idx])
+		return;
+
+	ks = &_xen.k[x_idx]->stats;
+
+	ks->cmds++;
+	ks->tasks     += tasks;
+	ks->allocs    += allocs;
+	ks->dma_bytes += bytes;
+}
+
+
+/**
+ * @brief publish the statistics of a kernel program in the sysctl tree
+ *
+ * @param x the kernel program
+ * @param op_code the op code of the kernel program, used as object name
+ *
+ * @returns 0 on success, otherwise error
+ */
+
+static int xen_kernel_sysctl_add(struct xen_kernel *x, unsigned long op_code)
+{
+	int ret;
+
+	char *buf;
+
+
+	if (!_xen.sset)
+		return -ENODEV;
+
+	buf = kzalloc(32);
+	if (!buf)
+		return -ENOMEM;
+
+	snprintf(buf, 32, "%lx", op_code);
+
+	sysobj_init(&x->stats.sobj);
+	x->stats.sobj.sattr = xen_kernel_attributes;
+
+	/* the object references its name, so it is only released on error */
+	ret = sysobj_add(&x->stats.sobj, NULL, _xen.sset, buf);
+	if (ret)
+		kfree(buf);
+
+	return ret;
 }
 
 
 /**
+ * @brief sysctl node setup
  *
- * @brief load and start a kernel with a particular op code
- *
- * @note this is the "op func" called by pn_process_next() we would use to start
- *	 and wait for kernels to run if we had threads but until then we need to
- *	 do our own step-by-step processing
+ * @note the Xentiums are published as "xen<n>" in /sys/driver/xentium, along
+ *	 with the kernel programs, which are named by their op code
  */
 
-static int op_xen_schedule_kernel(unsigned long op_code, struct proc_task *t)
+static int xentium_sysctl_setup(void)
 {
-	pr_err(MSG "Not implemented\n");
+	size_t i;
 
-	return PN_TASK_SUCCESS;
+	char *buf;
+
+
+	_xen.sset = sysset_create_and_add("xentium", NULL,
+					  sysset_from_path(NULL, "/sys/driver"));
+	if (!_xen.sset)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(_xen.stats); i++) {
+
+		_xen.stats[i].t_state = ktime_get();
+
+		buf = kzalloc(16);
+		if (!buf)
+			return -ENOMEM;
+
+		snprintf(buf, 16, "xen%d", (int) i);
+
+		sysobj_init(&_xen.stats[i].sobj);
+		_xen.stats[i].sobj.sattr = xen_attributes;
+
+		sysobj_add(&_xen.stats[i].sobj, NULL, _xen.sset, buf);
+	}
+
+	return 0;
 }
+#endif /* CONFIG_XENTIUM_STATS_COLLECT */
+
 
 
 /**
@@ -483,6 +1130,7 @@ static int op_xen_schedule_kernel(unsigned long op_code, struct proc_task *t)
 
 static int xen_load_task(struct proc_tracker *pt)
 {
+	int ret;
 	int k_idx;
 	int x_idx;
 
@@ -514,6 +1162,9 @@ static int xen_load_task(struct proc_tracker *pt)
 		return -ENOENT;
 	}
 
+	/* hand over the next task ahead of time, so the kernel may prefetch */
+	m->t_next = pn_get_next_pending_task(pt);
+
 	/**
 	 * @note op code checks should also be done in the Xentium kernel,
 	 * if a non-matching task step ended up in the wrong kernel, it can
@@ -523,7 +1174,18 @@ static int xen_load_task(struct proc_tracker *pt)
 	op_code = pt_get_pend_step_op_code(m->t);
 
 	k_idx = xen_get_kernel_idx_with_op_code(op_code);
+
+	/* swap in the kernel image if it was evicted */
+	if (k_idx >= 0) {
+		ret = xen_kernel_load_image(k_idx);
+		if (ret)
+			k_idx = ret;
+	}
+
 	if (k_idx < 0) {
+		/* m->t precedes m->t_next, so it goes back to the head last */
+		xen_put_back_next(pt, m);
+		BUG_ON(pt_track_put_head(pt, m->t));
 		kfree(m);
 		return k_idx;
 	}
@@ -539,6 +1201,9 @@ static int xen_load_task(struct proc_tracker *pt)
 		    x_idx, k->ep, _xen.cfg[k_idx]->name);
 
 	xen_set_tracker(x_idx, pt);
+	_xen.msg[x_idx] = m;
+
+	xen_track_parallel(pt);
 
 	xen_set_ep(xen, k->ep);
 
@@ -546,6 +1211,16 @@ static int xen_load_task(struct proc_tracker *pt)
 
 	m->dma = _xen.dma[x_idx];
 
+	if (_xen.arena[x_idx]) {
+		m->arena      = _xen.arena[x_idx];
+		m->arena_size = XEN_KMEM_ARENA_SIZE;
+	}
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	xen_stats_start(x_idx, k);
+	xen_stats_wait(x_idx, m->t);
+#endif /* CONFIG_XENTIUM_STATS_COLLECT */
+
 	xen_set_cmd(xen, m);
 
 	return 0;
@@ -576,14 +1251,20 @@ void xentium_schedule_next_internal(void)
 		if (!pt)
 			goto unlock;
 
-		/* tracker node is already processing */
-		if (xen_node_is_processing(pt))
+		/* tracker node is already processing and may not be
+		 * processed in parallel
+		 */
+		if (xen_node_is_processing(pt) && !xen_node_is_parallel(pt))
 			continue;
 
 		/* try to load new node for processing */
 		ret = xen_load_task(pt);
 
 		switch (ret) {
+		case 0:
+			/* try to occupy the next idle Xentium */
+			xen_clear_tracker_pending();
+			continue;
 		case -EBUSY:
 			/* mark new task */
 			xen_set_tracker_pending();
@@ -626,7 +1307,12 @@ static void xen_handle_cmds(int x_idx, struct xen_msg_data *m, int pn_ret_code)
 	/* abort */
 	if (!ret) {
 		pr_debug(MSG "Task %x aborted.\n", pt->op_code);
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+		xen_stats_stop(x_idx);
+#endif
+		xen_put_back_next(pt, m);
 		kfree(m);
+		_xen.msg[x_idx] = NULL;
 		xen_set_tracker(x_idx, NULL);
 		return;
 	}
@@ -635,12 +1321,30 @@ static void xen_handle_cmds(int x_idx, struct xen_msg_data *m, int pn_ret_code)
 	if (xen_get_tracker_pending()) {
 		pr_debug(MSG "Pending tracker, commanding abort of %x\n",
 			 pt->op_code);
+		/* the task was passed on, don't keep a reference */
+		m->t = NULL;
+		xen_put_back_next(pt, m);
 		m->cmd = TASK_EXIT;
 		xen_set_cmd(xen, m);
 		return;
 	}
 
-	m->t = pn_get_next_pending_task(pt);
+	/* the next task was handed over ahead of time, if there was one */
+	m->t = m->t_next;
+
+	if (!m->t)
+		m->t = pn_get_next_pending_task(pt);
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	xen_stats_wait(x_idx, m->t);
+#endif
+
+	if (m->t)
+		m->t_next = pn_get_next_pending_task(pt);
+	else
+		m->t_next = NULL;
+
+	xen_track_parallel(pt);
 
 
 	if (!m->t) {
@@ -687,8 +1391,13 @@ static irqreturn_t xen_irq_handler(unsigned int irq, void *userdata)
 		return IRQ_HANDLED;
 	}
 
+	/* the task is NULL when a Xentium confirms TASK_EXIT */
 	pr_debug(MSG "Interrupt from Xentium %d, sequence number %d\n",
-	       x_idx, pt_get_seq(m->t));
+	       x_idx, m->t ? pt_get_seq(m->t) : 0);
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	xen_stats_msg(x_idx, m, ioread32be(&m->cmd));
+#endif
 
 	/* The mppb...argh */
 	switch (ioread32be(&m->cmd)) {
@@ -776,7 +1485,11 @@ static irqreturn_t xen_irq_handler(unsigned int irq, void *userdata)
 	case TASK_EXIT:
 		pr_debug(MSG "Task %x exiting.\n",
 			xen_get_tracker(x_idx)->op_code);
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+		xen_stats_stop(x_idx);
+#endif
 		kfree(m);
+		_xen.msg[x_idx] = NULL;
 		xen_set_tracker(x_idx, NULL);
 		break;
 
@@ -891,6 +1604,44 @@ int xentium_elf_header_check(Elf_Ehdr *ehdr)
 }
 
 
+/**
+ * @brief determine the memory range occupied by the image of a kernel
+ */
+
+static void xentium_kernel_extent(struct xen_kernel *x)
+{
+	unsigned int idx = 0;
+
+	Elf_Shdr *sec;
+
+
+	x->lo = ~0UL;
+	x->hi = 0;
+
+	while (1) {
+
+		idx = elf_find_shdr_alloc_idx(x->ehdr, idx + 1);
+
+		if (!idx)
+			break;
+
+		sec = elf_get_sec_by_idx(x->ehdr, idx);
+
+		if (!sec->sh_size)
+			continue;
+
+		if (sec->sh_addr < x->lo)
+			x->lo = sec->sh_addr;
+
+		if (sec->sh_addr + sec->sh_size > x->hi)
+			x->hi = sec->sh_addr + sec->sh_size;
+	}
+
+	if (x->lo > x->hi)
+		x->lo = x->hi = 0;
+}
+
+
 /**
  * @brief load a xentium kernel
  *
@@ -902,6 +1653,9 @@ int xentium_elf_header_check(Elf_Ehdr *ehdr)
  * me to take care of the Xentium's runtime wrapper code, which again would take
  * more time that I can currently spare, but this would be the preferred
  * solution.
+ *
+ * @returns 0 on success, -EBUSY if the image would overlap a kernel that is
+ *	    executing, -ENOMEM on error
  */
 
 static int xentium_load_kernel(struct xen_kernel *x)
@@ -919,6 +1673,12 @@ static int xentium_load_kernel(struct xen_kernel *x)
 	int i;
 
 
+	/* the image must not be copied over a kernel that is executing */
+	xentium_kernel_extent(x);
+
+	if (xen_kernel_make_room(x))
+		return -EBUSY;
+
 	pr_debug(MSG "\n"
 		 MSG "\n"
 		 MSG "Loading kernel run-time sections\n");
@@ -946,6 +1706,7 @@ static int xentium_load_kernel(struct xen_kernel *x)
 			continue;
 
 		s->size = sec->sh_size;
+		s->type = sec->sh_type;
 
 		src = elf_get_shstrtab_str(x->ehdr, idx);
 		s->name = kmalloc(strlen(src));
@@ -1003,6 +1764,53 @@ error:
 			kfree(x->sec[idx].name);
 
 	kfree(x->sec);
+	x->sec = NULL;
+
+	return -ENOMEM;
+}
+
+
+/**
+ * @brief cache the run-time sections of a loaded kernel
+ *
+ * @note this must be done after the kernel was configured, so the cached
+ *	 image contains the reference to the kernel's permanent storage
+ *
+ * @returns 0 on success, -ENOMEM on error
+ */
+
+static int xentium_cache_kernel(struct xen_kernel *x)
+{
+	size_t i;
+
+	struct xen_kern_section *s;
+
+
+	for (i = 0; i < x->num_sec; i++) {
+
+		s = &x->sec[i];
+
+		if (!s->size)
+			continue;
+
+		if (s->type & SHT_NOBITS)
+			continue;
+
+		/* the section is already byte-swapped for the Xentium DMA */
+		s->img = kmalloc(s->size);
+		if (!s->img)
+			goto error;
+
+		memcpy(s->img, (void *) s->addr, s->size);
+	}
+
+	return 0;
+
+error:
+	for (i = 0; i < x->num_sec; i++) {
+		kfree(x->sec[i].img);
+		x->sec[i].img = NULL;
+	}
 
 	return -ENOMEM;
 }
@@ -1104,52 +1912,18 @@ struct xen_kernel_cfg *xentium_config_kernel(struct xen_kernel *x)
 
 
 /**
- * @brief add a new xentium kernel
+ * @brief register a loaded kernel and create its processing node
  *
- * @param p the memory address where the ELF binary resides
+ * @param x the loaded kernel
+ * @param cfg the configuration of the kernel
  *
  * @returns -1 on error, 0 otherwise
  */
 
-int xentium_kernel_add(void *p)
+static int xentium_kernel_register(struct xen_kernel *x,
+				   struct xen_kernel_cfg *cfg)
 {
-	struct xen_kernel *x;
-
-	struct xen_kernel_cfg *cfg = NULL;
-	struct proc_tracker *pt    = NULL;
-
-
-	x = (struct xen_kernel *) kzalloc(sizeof(struct xen_kernel));
-	if (!x)
-		goto error;
-
-
-	/* the ELF binary starts with the ELF header */
-	x->ehdr = (Elf_Ehdr *) p;
-
-	pr_debug(MSG "Checking ELF header\n");
-
-
-
-	if (xentium_elf_header_check(x->ehdr))
-		goto error;
-
-	pr_debug(MSG "Setting up module configuration\n");
-
-	if (xentium_setup_kernel(x))
-		goto error;
-
-	if (xentium_load_kernel(x))
-		goto cleanup;
-
-
-	cfg = xentium_config_kernel(x);
-	if (!cfg)
-		goto cleanup;
-
-	x->ehdr = NULL;	/* not used anymore */
-
-
+	struct proc_tracker *pt;
 
 
 	pt = pt_track_create(op_xen_schedule_kernel,
@@ -1157,14 +1931,25 @@ int xentium_kernel_add(void *p)
 			     cfg->crit_buf_lvl);
 
 	if (!pt)
-		goto cleanup;
+		return -1;
 
-	if (pn_add_node(_xen.pn, pt))
-		goto cleanup;
+	if (pn_add_node(_xen.pn, pt)) {
+		pt_track_destroy(pt);
+		return -1;
+	}
+
+	/* overlapping images were evicted before this one was loaded */
+	x->resident = 1;
 
 	pr_debug(MSG "Added new Xentium kernel node with op code 0x%x\n",
 		 cfg->op_code);
 
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+	if (xen_kernel_sysctl_add(x, cfg->op_code))
+		pr_err(MSG "Cannot publish statistics of kernel 0x%lx\n",
+		       cfg->op_code);
+#endif
+
 
 	if (_xen.cnt == _xen.sz) {
 		_xen.x = krealloc(_xen.x,
@@ -1195,13 +1980,79 @@ int xentium_kernel_add(void *p)
 	_xen.cnt++;
 
 
+	return 0;
+}
+
+
+/**
+ * @brief add a new xentium kernel
+ *
+ * @param p the memory address where the ELF binary resides
+ *
+ * @returns -1 on error, 0 otherwise
+ */
+
+int xentium_kernel_add(void *p)
+{
+	size_t i;
+
+	struct xen_kernel *x;
+
+	struct xen_kernel_cfg *cfg = NULL;
+
+
+	x = (struct xen_kernel *) kzalloc(sizeof(struct xen_kernel));
+	if (!x)
+		goto error;
+
+
+	/* the ELF binary starts with the ELF header */
+	x->ehdr = (Elf_Ehdr *) p;
+
+	pr_debug(MSG "Checking ELF header\n");
+
+
+
+	if (xentium_elf_header_check(x->ehdr))
+		goto cleanup;
+
+	pr_debug(MSG "Setting up module configuration\n");
+
+	if (xentium_setup_kernel(x))
+		goto cleanup;
+
+	if (xentium_load_kernel(x))
+		goto cleanup;
+
+
+	cfg = xentium_config_kernel(x);
+	if (!cfg)
+		goto cleanup;
+
+	if (xentium_cache_kernel(x))
+		goto cleanup;
+
+	x->ehdr = NULL;	/* not used anymore */
+
+
+	if (xentium_kernel_register(x, cfg))
+		goto cleanup;
+
+
 	return 0;
 
 cleanup:
 	pr_err("cleanup\n");
+	if (x->sec) {
+		for (i = 0; i < x->num_sec; i++) {
+			kfree(x->sec[i].name);
+			kfree(x->sec[i].img);
+		}
+	}
+
+	kfree(x->sec);
 	kfree(x);
 	kfree(cfg);
-	pt_track_destroy(pt);
 #if 0
 	/* TODO */
 	xentium_kernel_unload(m);
@@ -1233,15 +2084,26 @@ EXPORT_SYMBOL(xentium_config_output_node);
 /**
  * @brief add a new task to the network
  *
- * @returns 0 on success, -EBUSY if new task cannot be added at this time
+ * @returns 0 on success, -EBUSY if new task cannot be added at this time,
+ *	    -EINVAL on error
+ *
+ * @note the caller retains ownership of the task if it was not added
  */
 
 int xentium_input_task(struct proc_task *t)
 {
+	int ret;
+
+
 	if (!spin_try_lock(&_xen.lock))
 		return -EBUSY;
 
-	pn_input_task(_xen.pn, t);
+	ret = pn_input_task(_xen.pn, t);
+	if (ret) {
+		spin_unlock(&_xen.lock);
+		return ret;
+	}
+
 	pn_process_inputs(_xen.pn);
 
 	spin_unlock(&_xen.lock);
@@ -1275,11 +2137,70 @@ EXPORT_SYMBOL(xentium_schedule_next);
  * @brief process the outputs of the network
  *
  * @note This is to be called by the user at their discretion.
+ *
+ * @note After a node was processed by multiple Xentiums in parallel, tasks are
+ *	 released by order of their sequence number, i.e. a task is held back
+ *	 while tasks with a lower sequence number are still being processed,
+ *	 until all tasks handed to a parallel instance have left the network.
+ *	 The output node op is executed with interrupts enabled.
  */
 
 void xentium_output_tasks(void)
 {
-	pn_process_outputs(_xen.pn);
+	size_t i;
+
+	uint32_t psr;
+
+	unsigned long seq;
+	unsigned long seq_lim = ~0UL;
+
+	struct xen_msg_data *m;
+
+	LIST_HEAD(list);
+
+
+	psr = spin_lock_save_irq();
+	spin_lock(&_xen.lock);
+
+	if (!_xen.seq_ord) {
+		pn_get_outputs(_xen.pn, &list);
+		goto unlock;
+	}
+
+	/* the tasks on the Xentiums are not tracked by the network */
+	for (i = 0; i < ARRAY_SIZE(_xen.msg); i++) {
+
+		m = _xen.msg[i];
+
+		if (!m)
+			continue;
+
+		if (m->t && pt_get_seq(m->t) < seq_lim)
+			seq_lim = pt_get_seq(m->t);
+
+		if (m->t_next && pt_get_seq(m->t_next) < seq_lim)
+			seq_lim = pt_get_seq(m->t_next);
+	}
+
+	if (!pn_get_seq_min(_xen.pn, &seq)) {
+		if (seq < seq_lim)
+			seq_lim = seq;
+	}
+
+	pn_get_outputs_seq(_xen.pn, seq_lim, &list);
+
+	/* all tasks of the parallel instances were released */
+	if (seq_lim > _xen.seq_par)
+		_xen.seq_ord = 0;
+
+unlock:
+	spin_unlock(&_xen.lock);
+	spin_lock_restore_irq(psr);
+
+	pn_process_output_list(_xen.pn, &list);
+
+	/* scheduling attempts fail while the lock is held */
+	xentium_schedule_next_internal();
 }
 EXPORT_SYMBOL(xentium_output_tasks);
 
@@ -1315,6 +2236,12 @@ static int xentium_init(void)
 			BUG_ON(!_xen.dma[i]);
 		}
 
+		/* kernels fall back to host allocations if this fails */
+		for (i = 0; i < ARRAY_SIZE(_xen.arena); i++) {
+			if (XEN_KMEM_ARENA_SIZE)
+				_xen.arena[i] = kmalloc(XEN_KMEM_ARENA_SIZE);
+		}
+
 		if (irq_request(LEON_WANT_EIRQ(XEN_0_EIRQ), ISR_PRIORITY_NOW,
 			    &xen_irq_handler, NULL)) {
 			pr_err(MSG "Cannot register interrupt handler!\n");
@@ -1324,6 +2251,11 @@ static int xentium_init(void)
 			    &xen_irq_handler, NULL)) {
 			pr_err(MSG "Cannot register interrupt handler!\n");
 		}
+
+#ifdef CONFIG_XENTIUM_STATS_COLLECT
+		if (xentium_sysctl_setup())
+			pr_err(MSG "Cannot publish statistics in sysctl tree\n");
+#endif
 	}
 
 	if (!_xen.pn)
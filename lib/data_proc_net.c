@@ -64,6 +64,14 @@
  * This may be used when the call to pt->op() needs special control.
  *
  *
+ * Nodes created with pt_track_create_batch() are processed in batches of up to
+ * the configured batch size of the tracker. The tasks are gathered from the
+ * tracker and handed to the batch operator in a single call, the per-task
+ * return codes are then evaluated in order. If any of the tasks signals
+ * an abort, the remaining tasks of the batch are still evaluated, but no
+ * further batch is gathered from the node.
+ *
+ *
  * Input and output nodes are special, they must be processed explicitly by
  * calling
  *
@@ -78,6 +86,44 @@
  * @endcode
  *
  * This allows the operator of the processing network to control the I/O rate.
+ * If nodes may complete tasks out of order, pn_process_outputs_seq() releases
+ * output tasks by order of their sequence number instead.
+ *
+ *
+ * Split nodes (pt_track_create_split()) and merge nodes
+ * (pt_track_create_merge()) may be used to process slices of a task in
+ * parallel. When the op function of a split node returns PN_TASK_SUCCESS (or
+ * PN_TASK_STOP), the task is split into a number of child tasks, which
+ * reference consecutive slices of the data buffer of the parent task without
+ * copying. The children are assigned the steps of the parent up to and
+ * including the step of the merge node and the sequence number of the parent.
+ * They are propagated through the network individually, while the parent is
+ * detached. Children are destroyed when they are forwarded to the merge node.
+ * Once all children have arrived, the parent is moved to the merge node and
+ * continues along its step list. If an op function returns PN_TASK_DESTROY
+ * for a child, the child counts as arrived, but the parent is destroyed as
+ * described for PN_TASK_DESTROY once all of its children have arrived, so
+ * the output node never sees a child task. Tasks with no elements, which do
+ * not have a step of the merge node, or which cannot be split due to lack of
+ * memory pass a split node as a whole.
+ *
+ * The children are merged when the return code of an op function is
+ * evaluated in pn_eval_task_status(), so this applies to any processing path,
+ * including batch nodes and nodes that are processed manually.
+ *
+ * @note detached parent tasks are not tracked by the network and will leak
+ *	 if the network is destroyed while child tasks are in flight
+ *
+ *
+ * The input node of a network may be replaced by a lock-free ring tracker via
+ * pn_create_input_ring(), so that tasks may be fed to the network from
+ * interrupt context without masking interrupts in the processing thread.
+ *
+ *
+ * If CONFIG_PROC_NET_STATS_COLLECT is set, the network records the execution
+ * time of op functions per node and the end-to-end latency of tasks from
+ * pn_input_task() to the output node. The statistics of all nodes of a network
+ * may be published in the sysctl tree via pn_sysctl_add().
  *
  * 
  * @example proc_chain_demo.c
@@ -86,6 +132,9 @@
 #include <kernel/printk.h>
 #include <kernel/kmem.h>
 #include <kernel/kernel.h>
+#include <kernel/string.h>
+#include <kernel/sysctl.h>
+#include <kernel/time.h>
 
 #include <errno.h>
 
@@ -113,6 +162,23 @@ static int pn_dummy_op(unsigned long op_code, struct proc_task *t)
 	return 0;
 }
 
+
+/**
+ * @brief check if a tracker was published in the sysctl tree
+ *
+ * @note such a tracker must not be destroyed, see pn_sysctl_add()
+ */
+
+static int pn_node_published(struct proc_tracker *pt)
+{
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	if (pt && pt->stats.sobj.sattr)
+		return 1;
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
+	return 0;
+}
+
 /**
  * @brief locate a tracker by op code
  *
@@ -136,6 +202,10 @@ static struct proc_tracker *pn_find_tracker(struct proc_net *pn,
 }
 
 
+static void pn_merge_task(struct proc_net *pn, struct proc_task *t,
+			  int failed);
+
+
 /**
  * @brief propagate a task to its next tracker node
  *
@@ -154,6 +224,12 @@ static int pn_task_to_next_node(struct proc_net *pn, struct proc_task *t)
 
 
 
+	/* the last step of a child task is that of its merge node */
+	if (t->parent && list_is_singular(&t->todo)) {
+		pn_merge_task(pn, t, 0);
+		return 0;
+	}
+
 	/* next steps's op code */
 	op = pt_get_pend_step_op_code(t);
 
@@ -172,7 +248,10 @@ static int pn_task_to_next_node(struct proc_net *pn, struct proc_task *t)
 		if (!pt_out) {
 			pr_crit("Error, no such op code, destroying task\n");
 
-			pt_destroy(t);
+			if (t->parent)
+				pn_merge_task(pn, t, 1);
+			else
+				pt_destroy(t);
 
 			return -1;
 		}
@@ -185,6 +264,169 @@ static int pn_task_to_next_node(struct proc_net *pn, struct proc_task *t)
 }
 
 
+/**
+ * @brief split a task into child tasks
+ *
+ * @param pn a struct proc_net
+ * @param pt a struct proc_tracker of node type PT_NODE_SPLIT
+ * @param t a struct proc_task
+ *
+ * @returns 0 if the task was split, -1 otherwise
+ *
+ * @note the elements of the parent are distributed as evenly as possible;
+ *	 if there are fewer elements than configured children, each child
+ *	 is assigned a single element
+ */
+
+static int pn_split_task(struct proc_net *pn, struct proc_tracker *pt,
+			 struct proc_task *t)
+{
+	size_t i;
+	size_t n;
+	size_t nmemb;
+	size_t steps;
+	size_t esize;
+	size_t offset = 0;
+
+	struct proc_step *s;
+	struct proc_task *c;
+	struct proc_task *p_tmp;
+	struct list_head children;
+
+
+	nmemb = pt_get_nmemb(t);
+	if (!nmemb)
+		return -1;
+
+	if (!pt_get_data(t))
+		return -1;
+
+	n = pt->n_split;
+	if (n > nmemb)
+		n = nmemb;
+
+	esize = pt_get_size(t) / nmemb;
+	steps = pt_count_pend_steps(t, pt->merge_op_code);
+
+	INIT_LIST_HEAD(&children);
+
+	for (i = 0; i < n; i++) {
+
+		c = pt_create((uint8_t *) pt_get_data(t) + offset * esize, 0,
+			      steps, pt_get_type(t), pt_get_seq(t));
+		if (!c)
+			goto cleanup;
+
+		list_add_tail(&c->node, &children);
+
+		if (pt_copy_pend_steps(c, t, pt->merge_op_code))
+			goto cleanup;
+
+		/* the children must end at the merge node */
+		if (list_empty(&c->todo))
+			goto cleanup;
+
+		s = list_last_entry(&c->todo, struct proc_step, node);
+		if (s->op_code != pt->merge_op_code)
+			goto cleanup;
+
+		/* the first (nmemb % n) children get one extra element */
+		pt_set_nmemb(c, nmemb / n + (i < (nmemb % n)));
+		pt_set_size(c, pt_get_nmemb(c) * esize);
+
+		c->parent = t;
+
+		offset += pt_get_nmemb(c);
+	}
+
+	t->n_child      = n;
+	t->n_child_done = 0;
+	t->n_child_err  = 0;
+
+	/* the parent is now detached until its children are merged */
+	pt_next_pend_step_done(t);
+
+	list_for_each_entry_safe(c, p_tmp, &children, node) {
+		list_del(&c->node);
+		pn_task_to_next_node(pn, c);
+	}
+
+	return 0;
+
+cleanup:
+	list_for_each_entry_safe(c, p_tmp, &children, node) {
+		list_del(&c->node);
+		pt_destroy(c);
+	}
+
+	return -1;
+}
+
+
+/**
+ * @brief merge a child task into its parent
+ *
+ * @param pn a struct proc_net
+ * @param t a child struct proc_task
+ * @param failed set if the child was not processed successfully
+ *
+ * @note The child is destroyed. Once all children have arrived, the parent is
+ *	 forwarded to the merge node or, if any of the children failed, it is
+ *	 destroyed as if its op function had returned PN_TASK_DESTROY.
+ */
+
+static void pn_merge_task(struct proc_net *pn, struct proc_task *t,
+			  int failed)
+{
+	unsigned long op;
+
+	struct proc_step *s;
+	struct proc_task *parent;
+
+
+	parent = t->parent;
+
+	op = 0;
+	if (!list_empty(&t->todo)) {
+		s  = list_last_entry(&t->todo, struct proc_step, node);
+		op = s->op_code;
+	}
+
+	pt_destroy(t);
+
+	if (failed)
+		parent->n_child_err++;
+
+	parent->n_child_done++;
+
+	if (parent->n_child_done < parent->n_child)
+		return;
+
+	failed = parent->n_child_err;
+
+	parent->n_child      = 0;
+	parent->n_child_done = 0;
+	parent->n_child_err  = 0;
+
+	if (failed) {
+		pt_set_nmemb(parent, 0);
+		pt_del_all_pending(parent);
+		pn_task_to_next_node(pn, parent);
+		return;
+	}
+
+	/* the steps up to the merge step were executed by the children */
+	while (pt_get_pend_step_op_code(parent)) {
+		if (pt_get_pend_step_op_code(parent) == op)
+			break;
+
+		pt_next_pend_step_done(parent);
+	}
+
+	pn_task_to_next_node(pn, parent);
+}
+
+
 /**
  * @brief move a tracker node to the top of the processing net queue
  *
@@ -321,6 +563,9 @@ int pn_eval_task_status(struct proc_net *pn, struct proc_tracker *pt,
 	case PN_TASK_SUCCESS:
 		/* move to next stage */
 		pr_debug(MSG "task successful\n");
+		if (pt->node_type == PT_NODE_SPLIT && !pn_split_task(pn, pt, t))
+			goto task_continue;
+
 		pt_next_pend_step_done(t);
 		pn_task_to_next_node(pn, t);
 		goto task_continue;
@@ -328,6 +573,9 @@ int pn_eval_task_status(struct proc_net *pn, struct proc_tracker *pt,
 	case PN_TASK_STOP:
 		/* success, but abort processing node  */
 		pr_debug(MSG "task processing stop\n");
+		if (pt->node_type == PT_NODE_SPLIT && !pn_split_task(pn, pt, t))
+			goto task_abort;
+
 		pt_next_pend_step_done(t);
 		pn_task_to_next_node(pn, t);
 		goto task_abort;
@@ -352,6 +600,14 @@ int pn_eval_task_status(struct proc_net *pn, struct proc_tracker *pt,
 
 	case PN_TASK_DESTROY:
 		pr_debug(MSG "destroy task\n");
+		/* the data of a child belongs to its parent, which is
+		 * destroyed instead once all of its children arrived
+		 */
+		if (t->parent) {
+			pn_merge_task(pn, t, 1);
+			goto task_continue;
+		}
+
 		/* something is wrong, destroy this task by clearing 
 		 * its member count and pending steps, so it is moved
 		 * directly to the output node, where it can be deallocated
@@ -377,6 +633,69 @@ task_abort:
 }
 
 
+/**
+ * @brief process tasks of a batch tracker node
+ *
+ * @param pn a struct proc_net
+ * @param pt a struct proc_tracker with a batched operator function
+ *
+ * @returns the number executed tasks for the tracker node
+ */
+
+static int pn_process_batch(struct proc_net *pn, struct proc_tracker *pt)
+{
+	int n;
+	int cnt = 0;
+	int cont = 1;
+
+	size_t i;
+	size_t len;
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	ktime start;
+#endif
+
+
+	while (cont) {
+
+		for (len = 0; len < pt->batch_size; len++) {
+			pt->batch[len] = pn_get_next_pending_task(pt);
+			if (!pt->batch[len])
+				break;
+		}
+
+		if (!len)
+			break;
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+		start = ktime_get();
+#endif
+		n = pt->op_batch(pt_get_pend_step_op_code(pt->batch[0]),
+				 pt->batch, len, pt->batch_ret);
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+		pt_track_stats_op_time(pt, start);
+#endif
+
+		if (n < 0)
+			n = 0;
+
+		/* tasks not processed by the op are rescheduled */
+		for (i = n; i < len; i++)
+			pt->batch_ret[i] = PN_TASK_RESCHED;
+
+		cnt += len;
+
+		for (i = 0; i < len; i++) {
+			if (!pn_eval_task_status(pn, pt, pt->batch[i],
+						 pt->batch_ret[i]))
+				cont = 0;
+		}
+	}
+
+	return cnt;
+}
+
+
 /**
  * @brief process tasks in the next tracker node that holds at least one task
  *
@@ -396,11 +715,18 @@ int pn_process_next(struct proc_net *pn)
 	struct proc_task *t = NULL;
 	struct proc_tracker *pt;
 
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	ktime start;
+#endif
+
 
 	pt = pn_get_next_pending_tracker(pn);
 	if (!pt)
 		return cnt;
 
+	if (pt_track_is_batch(pt))
+		return pn_process_batch(pn, pt);
+
 	while (1) {
 		t = pn_get_next_pending_task(pt);
 		if (!t)
@@ -408,7 +734,13 @@ int pn_process_next(struct proc_net *pn)
 
 		cnt++;
 
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+		start = ktime_get();
+#endif
 		ret = pt->op(pt_get_pend_step_op_code(t), t);
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+		pt_track_stats_op_time(pt, start);
+#endif
 
 		if (!pn_eval_task_status(pn, pt, t, ret))
 			break;
@@ -420,17 +752,24 @@ int pn_process_next(struct proc_net *pn)
 
 /**
  * @brief add a task to the input of the network
+ *
+ * @returns 0 on success, -EINVAL on error, -EBUSY if the input node is a ring
+ *	    and its lane is full
  */
 
-void pn_input_task(struct proc_net *pn, struct proc_task *t)
+int pn_input_task(struct proc_net *pn, struct proc_task *t)
 {
 	if (!pn)
-		return;
+		return -EINVAL;
 
 	if (!t)
-		return;
+		return -EINVAL;
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	t->t_in = ktime_get();
+#endif
 
-	BUG_ON(pt_track_put_force(pn->in, t));
+	return pt_track_put_force(pn->in, t);
 }
 
 
@@ -485,6 +824,29 @@ int pn_process_inputs(struct proc_net *pn)
 	return 0;
 }
 
+/**
+ * @brief execute the output node op on a task
+ */
+
+static void pn_output_task(struct proc_net *pn, struct proc_task *t)
+{
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	ktime start;
+
+	/* the op function will usually destroy the task */
+	pt_track_stats_latency(pn->out, t);
+	start = ktime_get();
+#endif
+	/* XXX maybe eval return code, e.g. for signalling abort of
+	 * current task node processing */
+	pn->out->op(PN_OP_NODE_OUT, t);
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	pt_track_stats_op_time(pn->out, start);
+#endif
+}
+
+
 /**
  * @brief process tasks in the output node
  *
@@ -512,9 +874,7 @@ int pn_process_outputs(struct proc_net *pn)
 		if (!t)
 			break;
 
-		/* XXX maybe eval return code, e.g. for signalling abort of
-		 * current task node processing */
-		pn->out->op(PN_OP_NODE_OUT, t);
+		pn_output_task(pn, t);
 		n++;
 	}
 
@@ -522,10 +882,202 @@ int pn_process_outputs(struct proc_net *pn)
 }
 
 
+/**
+ * @brief get the lowest sequence number of the tasks pending in the network
+ *
+ * @param pn a struct proc_net
+ * @param seq a pointer to store the lowest sequence number to
+ *
+ * @returns 0 on success, -ENOENT if no tasks are pending, -EINVAL on error
+ *
+ * @note the tasks in the output node are not considered
+ */
+
+int pn_get_seq_min(struct proc_net *pn, unsigned long *seq)
+{
+	int ret = -ENOENT;
+
+	unsigned long tmp;
+
+	struct proc_tracker *pt;
+
+
+	if (!pn)
+		return -EINVAL;
+
+	if (!seq)
+		return -EINVAL;
+
+	if (!pt_track_get_seq_min(pn->in, &tmp)) {
+		(*seq) = tmp;
+		ret = 0;
+	}
+
+	list_for_each_entry(pt, &pn->nodes, node) {
+
+		if (pt_track_get_seq_min(pt, &tmp))
+			continue;
+
+		if (ret || tmp < (*seq))
+			(*seq) = tmp;
+
+		ret = 0;
+	}
+
+	return ret;
+}
+
+
+/**
+ * @brief move all tasks in the output node to a list
+ *
+ * @param pn a struct proc_net
+ * @param list the list to append the tasks to
+ *
+ * @returns the number of tasks moved
+ *
+ * @note this allows the output node to be drained while the network is
+ *	 locked, and the output op to be executed via pn_process_output_list()
+ *	 once the lock was released
+ */
+
+int pn_get_outputs(struct proc_net *pn, struct list_head *list)
+{
+	int n = 0;
+
+	struct proc_task *t;
+
+
+	if (!pn)
+		return 0;
+
+	while (1) {
+		t = pt_track_get(pn->out);
+
+		if (!t)
+			break;
+
+		list_add_tail(&t->node, list);
+		n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief move the tasks in the output node that may be released in order of
+ *	  their sequence number to a list
+ *
+ * @param pn a struct proc_net
+ * @param seq_lim the lowest sequence number of any task that is currently
+ *		  processed outside of the network's trackers
+ * @param list the list to append the tasks to
+ *
+ * @returns the number of tasks moved
+ *
+ * @note see pn_process_outputs_seq()
+ */
+
+int pn_get_outputs_seq(struct proc_net *pn, unsigned long seq_lim,
+		       struct list_head *list)
+{
+	int n = 0;
+
+	unsigned long seq;
+
+	struct proc_task *t;
+
+
+	if (!pn)
+		return 0;
+
+	if (!pn_get_seq_min(pn, &seq)) {
+		if (seq < seq_lim)
+			seq_lim = seq;
+	}
+
+	pt_track_sort_seq(pn->out);
+
+	while (1) {
+		t = pt_track_peek(pn->out);
+
+		if (!t)
+			break;
+
+		if (pt_get_seq(t) > seq_lim)
+			break;
+
+		list_add_tail(&pt_track_get(pn->out)->node, list);
+		n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief execute the output node op on a list of tasks
+ *
+ * @param pn a struct proc_net
+ * @param list a list of tasks taken from the output node
+ *
+ * @returns number of output tasks processed
+ */
+
+int pn_process_output_list(struct proc_net *pn, struct list_head *list)
+{
+	int n = 0;
+
+	struct proc_task *t;
+	struct proc_task *tmp;
+
+
+	if (!pn)
+		return 0;
+
+	list_for_each_entry_safe(t, tmp, list, node) {
+		list_del(&t->node);
+		pn_output_task(pn, t);
+		n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief process tasks in the output node in order of their sequence number
+ *
+ * @param pn a struct proc_net
+ * @param seq_lim the lowest sequence number of any task that is currently
+ *		  processed outside of the network's trackers
+ *
+ * @returns number of output tasks processed
+ *
+ * @note Tasks are released only if no task with a lower sequence number
+ *	 remains in the network (or at seq_lim), so their original order is
+ *	 restored even if they were processed out of order, e.g. by parallel
+ *	 instances of a node. This assumes that the sequence numbers of tasks
+ *	 increase in the order they are fed to the network.
+ */
+
+int pn_process_outputs_seq(struct proc_net *pn, unsigned long seq_lim)
+{
+	LIST_HEAD(list);
+
+
+	pn_get_outputs_seq(pn, seq_lim, &list);
+
+	return pn_process_output_list(pn, &list);
+}
+
+
 /**
  * @brief create an output node of the network
  *
- * @returns 0 on success, -ENOMEM on alloc error, -EINVAL on NULL pn
+ * @returns 0 on success, -ENOMEM on alloc error, -EINVAL on NULL pn,
+ *	    -EBUSY if the network was published via pn_sysctl_add()
  *
  * @note this destroys the previous output node on success only, otherwise the
  *	 original node is left intact
@@ -540,6 +1092,9 @@ int pn_create_output_node(struct proc_net *pn, op_func_t op)
 	if (!pn)
 		return -EINVAL;
 
+	if (pn_node_published(pn->out))
+		return -EBUSY;
+
 	pt = pt_track_create(op, PN_OP_NODE_OUT, 1);
 
 	if (!pt)
@@ -554,6 +1109,49 @@ int pn_create_output_node(struct proc_net *pn, op_func_t op)
 }
 
 
+/**
+ * @brief replace the input node of the network by a lock-free ring tracker
+ *
+ * @param pn a struct proc_net
+ * @param ring_size the number of task slots per lane, must be a power of two
+ * @param n_lanes the number of producer lanes
+ *
+ * @returns 0 on success, -ENOMEM on alloc error, -EINVAL on error,
+ *	    -EBUSY if the current input node holds tasks or the network was
+ *	    published via pn_sysctl_add()
+ *
+ * @note this allows tasks to be added via pn_input_task() from interrupt
+ *	 context, while the network is processed by a thread, see
+ *	 pt_track_create_ring() for the constraints on producers
+ */
+
+int pn_create_input_ring(struct proc_net *pn, size_t ring_size, size_t n_lanes)
+{
+	struct proc_tracker *pt;
+
+
+	if (!pn)
+		return -EINVAL;
+
+	if (pt_track_tasks_pending(pn->in))
+		return -EBUSY;
+
+	if (pn_node_published(pn->in))
+		return -EBUSY;
+
+	pt = pt_track_create_ring(pn_dummy_op, PN_OP_NODE_IN, 1,
+				  ring_size, n_lanes);
+	if (!pt)
+		return -ENOMEM;
+
+	pt_track_destroy(pn->in);
+
+	pn->in = pt;
+
+	return 0;
+}
+
+
 /**
  * @brief add a tracker node to a processing network
  *
@@ -584,6 +1182,78 @@ int pn_add_node(struct proc_net *pn, struct proc_tracker *pt)
 }
 
 
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+#define PN_SYSCTL_STRING_SIZE 12
+
+/**
+ * @brief publish the statistics of all nodes of a network in the sysctl tree
+ *
+ * @param pn a struct proc_net
+ * @param name the name of the network
+ *
+ * @returns 0 on success, -EINVAL on invalid parameters, -ENOMEM on error
+ *
+ * @note this creates a sysset /sys/proc_net/<name> holding one object per
+ *	 node, named by the op code of the node in hex, the input and output
+ *	 nodes are named "in" and "out". Nodes added after this call are not
+ *	 published. Since sysctl objects cannot be removed, a network published
+ *	 to the sysctl tree must never be destroyed, nor can its input and
+ *	 output nodes be replaced afterwards.
+ */
+
+int pn_sysctl_add(struct proc_net *pn, const char *name)
+{
+	char *buf;
+
+	struct sysset *pn_set;
+	struct sysset *sset;
+	struct proc_tracker *pt;
+
+
+	if (!pn)
+		return -EINVAL;
+
+	if (!name)
+		return -EINVAL;
+
+	pn_set = sysset_from_path(NULL, "/sys/proc_net");
+	if (!pn_set) {
+		pn_set = sysset_create_and_add("proc_net", NULL, sysctl_root());
+		if (!pn_set)
+			return -ENOMEM;
+	}
+
+	sset = sysset_create_and_add(name, NULL, pn_set);
+	if (!sset)
+		return -ENOMEM;
+
+	if (pt_track_sysctl_add(pn->in, sset, "in"))
+		return -EINVAL;
+
+	if (pt_track_sysctl_add(pn->out, sset, "out"))
+		return -EINVAL;
+
+	list_for_each_entry(pt, &pn->nodes, node) {
+
+		buf = (char *) kzalloc(PN_SYSCTL_STRING_SIZE * sizeof(char));
+		if (!buf)
+			return -ENOMEM;
+
+		snprintf(buf, PN_SYSCTL_STRING_SIZE * sizeof(char), "%lx",
+			 pt->op_code);
+
+		/* the name is referenced by the sysctl object on success */
+		if (pt_track_sysctl_add(pt, sset, buf)) {
+			kfree(buf);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
+
 /**
  * @brief create a processing network with an input and output node
  *
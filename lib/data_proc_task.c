@@ -39,6 +39,10 @@
  * tasks of the same type are merged into a new task and the output depends on
  * a particular sequence of results of the previous operations depend.
  *
+ * A task may be split into child tasks, which reference slices of the data
+ * buffer of their parent task. The children carry a reference to their parent
+ * task, so they can be merged again (see @ref data_proc_net).
+ *
  */
 
 
@@ -284,6 +288,79 @@ int pt_add_step(struct proc_task *t,
 }
 
 
+/**
+ * @brief count the steps following the next pending processing step
+ *
+ * @param t a struct proc_task
+ * @param last the op code of the last step to count
+ *
+ * @returns the number of steps following the next pending step up to and
+ *	    including the first step with op code last, or all of the
+ *	    following steps if there is no such step
+ */
+
+size_t pt_count_pend_steps(struct proc_task *t, unsigned long last)
+{
+	size_t n = 0;
+
+	struct proc_step *p_elem;
+
+
+	list_for_each_entry(p_elem, &t->todo, node) {
+
+		/* skip the next pending step */
+		if (&p_elem->node == t->todo.next)
+			continue;
+
+		n++;
+		if (p_elem->op_code == last)
+			break;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief copy the steps following the next pending processing step of a task
+ *	  to the "todo" list of another task
+ *
+ * @param dst the struct proc_task to add the steps to
+ * @param src the struct proc_task to copy the steps from
+ * @param last the op code of the last step to copy
+ *
+ * @returns 0 on success, -ENOMEM if out of free processing steps in dst
+ *
+ * @note the op info of the steps is not copied, as it is owned by the source
+ *	 task; the steps of dst are assigned a NULL op info
+ */
+
+int pt_copy_pend_steps(struct proc_task *dst, struct proc_task *src,
+		       unsigned long last)
+{
+	int ret;
+
+	struct proc_step *p_elem;
+
+
+	list_for_each_entry(p_elem, &src->todo, node) {
+
+		/* skip the next pending step */
+		if (&p_elem->node == src->todo.next)
+			continue;
+
+		ret = pt_add_step(dst, p_elem->op_code, NULL);
+		if (ret)
+			return ret;
+
+		if (p_elem->op_code == last)
+			break;
+	}
+
+	return 0;
+}
+
+
 /**
  * @brief get the number of elements in the data buffer of a processing task
  *
@@ -28,17 +28,422 @@
  * manipulate the step list of the @ref data_proc_task and remove it from the
  * tracker.
  *
+ * Trackers created with pt_track_create_batch() are assigned a batched
+ * operator function instead. These are handed up to a configurable number of
+ * tasks in a single call, so the call overhead is amortised and operators
+ * may process many small tasks in a single pass. The user must evaluate
+ * the per-task return codes stored by the batch operator.
+ *
+ * Trackers created with pt_track_create_ring() do not link tasks into a list,
+ * but store them in bounded, lock-free single-producer/single-consumer rings,
+ * so that tasks may be added from interrupt context while a thread removes
+ * them, without having to mask interrupts or take a lock. A ring tracker
+ * has one or more lanes; a producer always adds to the lane of the CPU it
+ * executes on, so each CPU may run one producer, while a single consumer
+ * polls the lanes in round-robin order. As there is no compare-and-swap
+ * in the SPARC v8 instruction set, this is how multiple producers are
+ * supported. Task order is only preserved within a lane.
+ *
+ * The ring indices and slots are accessed with cache-bypassing loads and
+ * stores, a producer publishes a slot only after it has been written and a
+ * consumer releases a slot only after it has been read. A slot holds a task
+ * pointer, which is passed to the accessors as a native word rather than
+ * through a 32 bit cast, so the driver tests may run on 64 bit hosts.
+ *
+ * @note producers on the same CPU must not preempt one another, i.e. tasks
+ *	 added from thread context require interrupts to be masked if an ISR
+ *	 produces into the same tracker
+ * @note a ring tracker rejects tasks if the lane of the producer is full
+ *
  */
 
 #include <kernel/printk.h>
 #include <kernel/kmem.h>
 #include <kernel/log2.h>
 #include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/sysctl.h>
+#include <kernel/smp.h>
+#include <asm/io.h>
 #include <errno.h>
 
 #include <data_proc_tracker.h>
 
 
+/**
+ * @brief get the number of tasks in the lanes of a ring tracker
+ */
+
+static size_t pt_track_ring_used(struct proc_tracker *pt)
+{
+	size_t i;
+	size_t n = 0;
+
+	struct proc_tracker_ring *r;
+
+
+	for (i = 0; i < pt->n_lanes; i++) {
+		r = &pt->ring[i];
+		n += ioread32be(&r->head) - ioread32be(&r->tail);
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief get the number of tasks in a tracker
+ */
+
+static size_t pt_track_n_tasks(struct proc_tracker *pt)
+{
+	if (pt->ring)
+		return pt_track_ring_used(pt);
+
+	return pt->n_tasks;
+}
+
+
+/**
+ * @brief add a task to the lane of the calling CPU
+ *
+ * @returns 0 on success, -EBUSY if the lane is full
+ */
+
+static int pt_track_ring_put(struct proc_tracker *pt, struct proc_task *t)
+{
+	uint32_t head;
+
+	struct proc_tracker_ring *r;
+
+
+	r = &pt->ring[smp_cpu_id() % pt->n_lanes];
+
+	head = ioread32be(&r->head);
+
+	if ((head - ioread32be(&r->tail)) > r->mask)
+		return -EBUSY;
+
+	iowrite32be((unsigned long) t, &r->slot[head & r->mask]);
+
+	/* the slot must be visible before the head is published */
+	barrier();
+
+	iowrite32be(head + 1, &r->head);
+
+	return 0;
+}
+
+
+/**
+ * @brief locate the next non-empty lane of a ring tracker
+ *
+ * @returns the lane or NULL if all lanes are empty
+ *
+ * @note only the consumer may call this
+ */
+
+static struct proc_tracker_ring *pt_track_ring_next(struct proc_tracker *pt)
+{
+	size_t i;
+
+	struct proc_tracker_ring *r;
+
+
+	for (i = 0; i < pt->n_lanes; i++) {
+
+		r = &pt->ring[pt->lane_next];
+
+		if (r->tail != ioread32be(&r->head))
+			return r;
+
+		pt->lane_next = (pt->lane_next + 1) % pt->n_lanes;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief peek at the next task of a ring tracker
+ *
+ * @note only the consumer may call this
+ */
+
+static struct proc_task *pt_track_ring_peek(struct proc_tracker *pt)
+{
+	struct proc_tracker_ring *r;
+
+
+	r = pt_track_ring_next(pt);
+	if (!r)
+		return NULL;
+
+	/* do not read the slot before the head */
+	barrier();
+
+	return (struct proc_task *) ioread32be(&r->slot[r->tail & r->mask]);
+}
+
+
+/**
+ * @brief remove the next task from a ring tracker
+ *
+ * @note only the consumer may call this
+ */
+
+static struct proc_task *pt_track_ring_get(struct proc_tracker *pt)
+{
+	struct proc_task *t;
+	struct proc_tracker_ring *r;
+
+
+	r = pt_track_ring_next(pt);
+	if (!r)
+		return NULL;
+
+	barrier();
+
+	t = (struct proc_task *) ioread32be(&r->slot[r->tail & r->mask]);
+
+	/* the slot must be read before it is released to the producer */
+	barrier();
+
+	iowrite32be(r->tail + 1, &r->tail);
+
+	/* continue with the next lane */
+	pt->lane_next = (pt->lane_next + 1) % pt->n_lanes;
+
+	return t;
+}
+
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+
+__extension__
+static ssize_t pt_track_stats_show(struct sysobj *sobj,
+				   struct sobj_attribute *sattr,
+				   char *buf)
+{
+	struct proc_tracker *pt;
+	struct proc_tracker_stats *st;
+
+
+	st = container_of(sobj, struct proc_tracker_stats, sobj);
+	pt = container_of(st, struct proc_tracker, stats);
+
+	if (!strcmp(sattr->name, "tasks_in"))
+		return sprintf(buf, "%lu", st->tasks_in);
+
+	if (!strcmp(sattr->name, "tasks_out"))
+		return sprintf(buf, "%lu", st->tasks_out);
+
+	if (!strcmp(sattr->name, "n_tasks"))
+		return sprintf(buf, "%lu", (unsigned long) pt_track_n_tasks(pt));
+
+	if (!strcmp(sattr->name, "n_tasks_max"))
+		return sprintf(buf, "%lu", st->n_tasks_max);
+
+	if (!strcmp(sattr->name, "op_calls"))
+		return sprintf(buf, "%lu", st->op_calls);
+
+	if (!strcmp(sattr->name, "op_time_ns"))
+		return sprintf(buf, "%lld", st->op_time);
+
+	if (!strcmp(sattr->name, "lat_min_ns"))
+		return sprintf(buf, "%lld", st->lat_min);
+
+	if (!strcmp(sattr->name, "lat_max_ns"))
+		return sprintf(buf, "%lld", st->lat_max);
+
+	if (!strcmp(sattr->name, "lat_avg_ns")) {
+		if (!st->lat_cnt)
+			return sprintf(buf, "0");
+		return sprintf(buf, "%lld", st->lat_sum / (ktime) st->lat_cnt);
+	}
+
+	return 0;
+}
+
+
+__extension__
+static ssize_t pt_track_stats_store(struct sysobj *sobj,
+				    struct sobj_attribute *sattr,
+				    __attribute__((unused)) const char *buf,
+				    __attribute__((unused)) size_t len)
+{
+	struct proc_tracker_stats *st;
+
+
+	st = container_of(sobj, struct proc_tracker_stats, sobj);
+
+	if (!strcmp(sattr->name, "reset")) {
+		st->tasks_in    = 0;
+		st->tasks_out   = 0;
+		st->n_tasks_max = 0;
+		st->op_calls    = 0;
+		st->op_time     = 0;
+		st->lat_cnt     = 0;
+		st->lat_min     = 0;
+		st->lat_max     = 0;
+		st->lat_sum     = 0;
+	}
+
+	return 0;
+}
+
+__extension__
+static struct sobj_attribute tasks_in_attr = __ATTR(tasks_in,
+						    pt_track_stats_show,
+						    NULL);
+__extension__
+static struct sobj_attribute tasks_out_attr = __ATTR(tasks_out,
+						     pt_track_stats_show,
+						     NULL);
+__extension__
+static struct sobj_attribute n_tasks_attr = __ATTR(n_tasks,
+						   pt_track_stats_show,
+						   NULL);
+__extension__
+static struct sobj_attribute n_tasks_max_attr = __ATTR(n_tasks_max,
+						       pt_track_stats_show,
+						       NULL);
+__extension__
+static struct sobj_attribute op_calls_attr = __ATTR(op_calls,
+						    pt_track_stats_show,
+						    NULL);
+__extension__
+static struct sobj_attribute op_time_attr = __ATTR(op_time_ns,
+						   pt_track_stats_show,
+						   NULL);
+__extension__
+static struct sobj_attribute lat_min_attr = __ATTR(lat_min_ns,
+						   pt_track_stats_show,
+						   NULL);
+__extension__
+static struct sobj_attribute lat_max_attr = __ATTR(lat_max_ns,
+						   pt_track_stats_show,
+						   NULL);
+__extension__
+static struct sobj_attribute lat_avg_attr = __ATTR(lat_avg_ns,
+						   pt_track_stats_show,
+						   NULL);
+__extension__
+static struct sobj_attribute reset_attr = __ATTR(reset,
+						 NULL,
+						 pt_track_stats_store);
+
+__extension__
+static struct sobj_attribute *pt_track_attributes[] = {
+	&tasks_in_attr, &tasks_out_attr,
+	&n_tasks_attr, &n_tasks_max_attr,
+	&op_calls_attr, &op_time_attr,
+	&lat_min_attr, &lat_max_attr, &lat_avg_attr,
+	&reset_attr,
+	NULL};
+
+
+/**
+ * @brief update the maximum fill level of a tracker
+ */
+
+static void pt_track_stats_level(struct proc_tracker *pt)
+{
+	size_t n;
+
+
+	n = pt_track_n_tasks(pt);
+
+	if (n > pt->stats.n_tasks_max)
+		pt->stats.n_tasks_max = n;
+}
+
+
+/**
+ * @brief update the statistics of a tracker on task entry
+ */
+
+static void pt_track_stats_in(struct proc_tracker *pt)
+{
+	pt->stats.tasks_in++;
+
+	pt_track_stats_level(pt);
+}
+
+
+/**
+ * @brief account for the execution time of an op function call
+ *
+ * @param pt a struct proc_tracker
+ * @param start the time the op function was called
+ */
+
+void pt_track_stats_op_time(struct proc_tracker *pt, ktime start)
+{
+	pt->stats.op_calls++;
+	pt->stats.op_time += ktime_delta(ktime_get(), start);
+}
+
+
+/**
+ * @brief account for the end-to-end latency of a task
+ *
+ * @param pt a struct proc_tracker
+ * @param t a struct proc_task
+ */
+
+void pt_track_stats_latency(struct proc_tracker *pt, struct proc_task *t)
+{
+	ktime lat;
+
+
+	lat = ktime_delta(ktime_get(), t->t_in);
+
+	if (!pt->stats.lat_cnt || lat < pt->stats.lat_min)
+		pt->stats.lat_min = lat;
+
+	if (lat > pt->stats.lat_max)
+		pt->stats.lat_max = lat;
+
+	pt->stats.lat_sum += lat;
+	pt->stats.lat_cnt++;
+}
+
+
+/**
+ * @brief expose the statistics of a tracker in the sysctl tree
+ *
+ * @param pt a struct proc_tracker
+ * @param sset the sysset to add the tracker to
+ * @param name the name of the tracker object
+ *
+ * @returns 0 on success, -EINVAL on error
+ *
+ * @note sysctl objects cannot be removed, a tracker which has been added to
+ *	 the sysctl tree must hence never be destroyed
+ */
+
+int pt_track_sysctl_add(struct proc_tracker *pt, struct sysset *sset,
+			const char *name)
+{
+	if (!pt)
+		return -EINVAL;
+
+	if (!sset)
+		return -EINVAL;
+
+	/* already registered */
+	if (pt->stats.sobj.sattr)
+		return -EINVAL;
+
+	sysobj_init(&pt->stats.sobj);
+
+	pt->stats.sobj.sattr = pt_track_attributes;
+
+	return sysobj_add(&pt->stats.sobj, NULL, sset, name);
+}
+#endif /* CONFIG_PROC_NET_STATS_COLLECT */
+
 
 /**
  * @brief returns the op code of the tracker
@@ -64,7 +469,7 @@ unsigned long pt_track_get_op_code(struct proc_tracker *pt)
 
 int pt_track_level_critical(struct proc_tracker *pt)
 {
-	return (pt->n_tasks >= pt->n_tasks_crit);
+	return (pt_track_n_tasks(pt) >= pt->n_tasks_crit);
 }
 
 
@@ -78,7 +483,7 @@ int pt_track_level_critical(struct proc_tracker *pt)
 
 int pt_track_get_usage(struct proc_tracker *pt)
 {
-	return pt->n_tasks;
+	return pt_track_n_tasks(pt);
 }
 
 
@@ -92,7 +497,13 @@ int pt_track_get_usage(struct proc_tracker *pt)
 
 int pt_track_tasks_pending(struct proc_tracker *pt)
 {
-	if (pt && list_filled(&pt->tasks))
+	if (!pt)
+		return 0;
+
+	if (pt->ring)
+		return (pt_track_ring_used(pt) != 0);
+
+	if (list_filled(&pt->tasks))
 		return 1;
 
 	return 0;
@@ -106,7 +517,8 @@ int pt_track_tasks_pending(struct proc_tracker *pt)
  *
  * @param t a pointer to a task
  *
- * @returns 0 on success, -EINVAL on error
+ * @returns 0 on success, -EINVAL on error, -EBUSY if the tracker is a ring
+ *	    tracker and the ring is full
  *
  * @note if the pending step op code of the task does not match the op code of
  *	 the tracker, it is rejected
@@ -128,9 +540,22 @@ int pt_track_put(struct proc_tracker *pt, struct proc_task *t)
 	if (op != pt->op_code)
 		return -1;
 
-	list_add_tail(&t->node, &pt->tasks);
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	/* before the task is published to a ring consumer */
+	t->t_track = ktime_get();
+#endif
+
+	if (pt->ring) {
+		if (pt_track_ring_put(pt, t))
+			return -EBUSY;
+	} else {
+		list_add_tail(&t->node, &pt->tasks);
+		pt->n_tasks++;
+	}
 
-	pt->n_tasks++;
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	pt_track_stats_in(pt);
+#endif
 
 	return 0;
 }
@@ -143,7 +568,8 @@ int pt_track_put(struct proc_tracker *pt, struct proc_task *t)
  *
  * @param t a pointer to a task
  *
- * @returns 0 on success, -EINVAL on error
+ * @returns 0 on success, -EINVAL on error, -EBUSY if the tracker is a ring
+ *	    tracker and the ring is full
  *
  */
 
@@ -155,10 +581,72 @@ int pt_track_put_force(struct proc_tracker *pt, struct proc_task *t)
 	if (!t)
 		return -EINVAL;
 
-	list_add_tail(&t->node, &pt->tasks);
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	/* before the task is published to a ring consumer */
+	t->t_track = ktime_get();
+#endif
+
+	if (pt->ring) {
+		if (pt_track_ring_put(pt, t))
+			return -EBUSY;
+	} else {
+		list_add_tail(&t->node, &pt->tasks);
+		pt->n_tasks++;
+	}
+
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	pt_track_stats_in(pt);
+#endif
+
+	return 0;
+}
+
+
+/**
+ * @brief return a task to the head of a processing tracker
+ *
+ * @param pt a struct processing_tracker
+ *
+ * @param t a pointer to a task
+ *
+ * @returns 0 on success, -EINVAL on error or if the tracker is a ring tracker
+ *
+ * @note this is intended for tasks that were taken from the tracker, but could
+ *	 not be processed, so they are executed next and keep their order
+ *	 relative to the other tasks of the tracker; the task is not accounted
+ *	 as a new entry
+ */
+
+int pt_track_put_head(struct proc_tracker *pt, struct proc_task *t)
+{
+	unsigned long op;
+
+
+	if (!pt)
+		return -EINVAL;
+
+	if (!t)
+		return -EINVAL;
+
+	/* only the producer may add to a ring */
+	if (pt->ring)
+		return -EINVAL;
+
+	op = pt_get_pend_step_op_code(t);
+
+	if (op != pt->op_code)
+		return -1;
 
+	list_add(&t->node, &pt->tasks);
 	pt->n_tasks++;
 
+	/* the task already entered the tracker, so it keeps its time of entry
+	 * and is not counted again
+	 */
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	pt_track_stats_level(pt);
+#endif
+
 	return 0;
 }
 
@@ -176,6 +664,9 @@ int pt_track_pending(struct proc_tracker *pt)
 	if (!pt)
 		return 0;
 
+	if (pt->ring)
+		return (pt_track_ring_used(pt) != 0);
+
 	if (list_empty(&pt->tasks))
 		return 0;
 
@@ -197,21 +688,81 @@ struct proc_task *pt_track_get(struct proc_tracker *pt)
 	if (!pt)
 		return NULL;
 
-	if (list_empty(&pt->tasks))
-		return NULL;
+	if (pt->ring) {
+		t = pt_track_ring_get(pt);
+		if (!t)
+			return NULL;
+	} else {
+		if (list_empty(&pt->tasks))
+			return NULL;
 
+		t = list_entry(pt->tasks.next, struct proc_task, node);
 
-	t = list_entry(pt->tasks.next, struct proc_task, node);
+		list_del(&t->node);
 
-	list_del(&t->node);
+		pt->n_tasks--;
+	}
 
-	pt->n_tasks--;
+#ifdef CONFIG_PROC_NET_STATS_COLLECT
+	pt->stats.tasks_out++;
+#endif
 
 	return t;
 }
 
 
 
+/**
+ * @brief get the batch size of a processing tracker
+ *
+ * @param pt a struct proc_tracker
+ *
+ * @returns the maximum number of tasks per batch, 0 if not a batch tracker
+ */
+
+size_t pt_track_get_batch(struct proc_tracker *pt)
+{
+	if (!pt)
+		return 0;
+
+	return pt->batch_size;
+}
+
+
+/**
+ * @brief check if a tracker executes a batched operator function
+ *
+ * @param pt a struct proc_tracker
+ *
+ * @returns 1 if batched, 0 otherwise
+ */
+
+int pt_track_is_batch(struct proc_tracker *pt)
+{
+	if (pt && pt->op_batch)
+		return 1;
+
+	return 0;
+}
+
+
+/**
+ * @brief check if a tracker is backed by lock-free rings
+ *
+ * @param pt a struct proc_tracker
+ *
+ * @returns 1 if ring-backed, 0 otherwise
+ */
+
+int pt_track_is_ring(struct proc_tracker *pt)
+{
+	if (pt && pt->ring)
+		return 1;
+
+	return 0;
+}
+
+
 /**
  * @brief execute next item in processing tracker
  *
@@ -226,11 +777,22 @@ int pt_track_execute_next(struct proc_tracker *pt)
 	struct proc_task *t;
 
 
-	if (list_empty(&pt->tasks))
-		return -ENOEXEC;
+	if (pt->ring) {
+		t = pt_track_ring_peek(pt);
+		if (!t)
+			return -ENOEXEC;
+	} else {
+		if (list_empty(&pt->tasks))
+			return -ENOEXEC;
 
+		t = list_entry(pt->tasks.next, struct proc_task, node);
+	}
 
-	t = list_entry(pt->tasks.next, struct proc_task, node);
+	if (pt->op_batch) {
+		pt->batch[0] = t;
+		pt->op_batch(pt->op_code, pt->batch, 1, pt->batch_ret);
+		return pt->batch_ret[0];
+	}
 
 	return pt->op(pt->op_code, t);
 }
@@ -242,14 +804,170 @@ int pt_track_execute_next(struct proc_tracker *pt)
  * @brief sort the tasks by order of sequence number
  * @param pt a struct processing_tracker
  *
+ * @note this is a stable insertion sort, which is cheap for the typical case
+ *	 of a tracker where only a few tasks arrived out of order
+ *
+ * @note tasks in ring trackers cannot be reordered
  */
 
 void pt_track_sort_seq(struct proc_tracker *pt)
 {
-	printk("TODO: list_sort not implemented\n");
+	struct proc_task *t;
+	struct proc_task *p;
+	struct proc_task *tmp;
+
+	LIST_HEAD(sorted);
+
+
+	if (!pt)
+		return;
+
+	if (pt->ring)
+		return;
+
+	list_for_each_entry_safe(t, tmp, &pt->tasks, node) {
+
+		list_del(&t->node);
+
+		/* insert behind the last task with a lower or equal sequence
+		 * number, or at the head of the list if there is none
+		 */
+		list_for_each_entry_rev(p, &sorted, node) {
+			if (pt_get_seq(p) <= pt_get_seq(t))
+				break;
+		}
+
+		list_add(&t->node, &p->node);
+	}
+
+	/* move the sorted tasks back */
+	list_add(&pt->tasks, &sorted);
+	list_del(&sorted);
 }
 
 
+/**
+ * @brief get the lowest sequence number of the tasks in a tracker
+ *
+ * @param pt a struct processing_tracker
+ * @param seq a pointer to store the lowest sequence number to
+ *
+ * @returns 0 on success, -ENOENT if the tracker is empty, -EINVAL on error
+ *
+ * @note for ring trackers, only the consumer may call this
+ */
+
+int pt_track_get_seq_min(struct proc_tracker *pt, unsigned long *seq)
+{
+	size_t i;
+
+	int ret = -ENOENT;
+
+	uint32_t idx;
+	uint32_t head;
+
+	struct proc_task *t;
+	struct proc_tracker_ring *r;
+
+
+	if (!pt)
+		return -EINVAL;
+
+	if (!seq)
+		return -EINVAL;
+
+	if (!pt->ring) {
+		list_for_each_entry(t, &pt->tasks, node) {
+			if (ret || pt_get_seq(t) < (*seq))
+				(*seq) = pt_get_seq(t);
+			ret = 0;
+		}
+
+		return ret;
+	}
+
+	for (i = 0; i < pt->n_lanes; i++) {
+
+		r = &pt->ring[i];
+
+		head = ioread32be(&r->head);
+
+		barrier();
+
+		for (idx = r->tail; idx != head; idx++) {
+			t = (struct proc_task *)
+				ioread32be(&r->slot[idx & r->mask]);
+
+			if (ret || pt_get_seq(t) < (*seq))
+				(*seq) = pt_get_seq(t);
+			ret = 0;
+		}
+	}
+
+	return ret;
+}
+
+
+/**
+ * @brief look at the next item of a processing tracker without removing it
+ *
+ * @param pt a struct processing_tracker
+ *
+ * @return processing task item or NULL if empty
+ *
+ * @note for ring trackers, only the consumer may call this
+ */
+
+struct proc_task *pt_track_peek(struct proc_tracker *pt)
+{
+	if (!pt)
+		return NULL;
+
+	if (pt->ring)
+		return pt_track_ring_peek(pt);
+
+	if (list_empty(&pt->tasks))
+		return NULL;
+
+	return list_entry(pt->tasks.next, struct proc_task, node);
+}
+
+
+
+/**
+ * @brief allocate a processing tracker without an operator function
+ *
+ * @param op_code the identfier of this tracker
+ * @param tasks_crit the number of tasks after which the tracker is
+ *	  considered filled to a critical level, must be at least 1
+ *
+ * @return processing tracker or NULL on error
+ */
+
+static struct proc_tracker *pt_track_alloc(unsigned long op_code,
+					   size_t n_tasks_crit)
+{
+	struct proc_tracker *pt;
+
+
+	if (!n_tasks_crit)
+		return NULL;
+
+
+	pt = (struct proc_tracker *) kzalloc(sizeof(struct proc_tracker));
+
+	if (!pt)
+		return NULL;
+
+	pt->n_tasks_crit = n_tasks_crit;
+
+	pt->op_code = op_code;
+
+	INIT_LIST_HEAD(&pt->tasks);
+
+	return pt;
+}
+
 
 /**
  * @brief create a processing tracker
@@ -272,24 +990,221 @@ struct proc_tracker *pt_track_create(op_func_t op, unsigned long op_code,
 	if (!op)
 		return NULL;
 
-	if (!n_tasks_crit)
+	pt = pt_track_alloc(op_code, n_tasks_crit);
+	if (!pt)
 		return NULL;
 
+	pt->op = op;
+
+	return pt;
+}
+
+
+/**
+ * @brief create a processing tracker with a batched operator function
+ *
+ * @param op the batch function executing the op of this tracker
+ * @param op_code the identfier of this tracker
+ * @param tasks_crit the number of tasks after which the tracker is
+ *	  considered filled to a critical level, must be at least 1
+ * @param batch_size the maximum number of tasks handed to the batch function
+ *	  in a single call, must be at least 1
+ *
+ * @return processing tracker or NULL on error
+ */
+
+struct proc_tracker *pt_track_create_batch(op_batch_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit,
+					   size_t batch_size)
+{
+	struct proc_tracker *pt;
 
-	pt = (struct proc_tracker *) kzalloc(sizeof(struct proc_tracker));
 
+	if (!op)
+		return NULL;
+
+	if (!batch_size)
+		return NULL;
+
+	pt = pt_track_alloc(op_code, n_tasks_crit);
 	if (!pt)
 		return NULL;
 
-	pt->op = op;
+	pt->batch = (struct proc_task **) kmalloc(batch_size *
+						  sizeof(struct proc_task *));
+	if (!pt->batch)
+		goto cleanup;
 
-	pt->n_tasks_crit = n_tasks_crit;
+	pt->batch_ret = (int *) kmalloc(batch_size * sizeof(int));
+	if (!pt->batch_ret)
+		goto cleanup;
 
-	pt->op_code = op_code;
+	pt->op_batch = op;
+
+	pt->batch_size = batch_size;
+
+	return pt;
+
+cleanup:
+	pt_track_destroy(pt);
+
+	return NULL;
+}
+
+
+/**
+ * @brief create a split processing tracker
+ *
+ * @param op the function executing the op of this tracker on a task before
+ *	  it is split
+ * @param op_code the identfier of this tracker
+ * @param tasks_crit the number of tasks after which the tracker is
+ *	  considered filled to a critical level, must be at least 1
+ * @param n_split the number of child tasks to split a task into, must be
+ *	  at least 1
+ * @param merge_op_code the op code of the merge node which gathers the
+ *	  child tasks
+ *
+ * @return processing tracker or NULL on error
+ */
+
+struct proc_tracker *pt_track_create_split(op_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit,
+					   size_t n_split,
+					   unsigned long merge_op_code)
+{
+	struct proc_tracker *pt;
+
+
+	if (!n_split)
+		return NULL;
+
+	if (!merge_op_code)
+		return NULL;
+
+	pt = pt_track_create(op, op_code, n_tasks_crit);
+	if (!pt)
+		return NULL;
+
+	pt->node_type     = PT_NODE_SPLIT;
+	pt->n_split       = n_split;
+	pt->merge_op_code = merge_op_code;
+
+	return pt;
+}
+
+
+/**
+ * @brief create a merge processing tracker
+ *
+ * @param op the function executing the op of this tracker on a parent task
+ *	  once all of its children have been merged
+ * @param op_code the identfier of this tracker
+ * @param tasks_crit the number of tasks after which the tracker is
+ *	  considered filled to a critical level, must be at least 1
+ *
+ * @return processing tracker or NULL on error
+ */
+
+struct proc_tracker *pt_track_create_merge(op_func_t op,
+					   unsigned long op_code,
+					   size_t n_tasks_crit)
+{
+	struct proc_tracker *pt;
+
+
+	pt = pt_track_create(op, op_code, n_tasks_crit);
+	if (!pt)
+		return NULL;
+
+	pt->node_type = PT_NODE_MERGE;
+
+	return pt;
+}
+
+
+/**
+ * @brief get the node type of a processing tracker
+ *
+ * @param pt a struct proc_tracker
+ *
+ * @returns the node type
+ */
+
+int pt_track_get_node_type(struct proc_tracker *pt)
+{
+	return pt->node_type;
+}
+
+
+/**
+ * @brief create a processing tracker backed by lock-free task rings
+ *
+ * @param op the function executing the op of this tracker
+ * @param op_code the identfier of this tracker
+ * @param tasks_crit the number of tasks after which the tracker is
+ *	  considered filled to a critical level, must be at least 1
+ * @param ring_size the number of task slots per lane, must be a power of two
+ * @param n_lanes the number of producer lanes, usually the number of CPUs
+ *	  which add tasks to the tracker, must be at least 1
+ *
+ * @return processing tracker or NULL on error
+ */
+
+struct proc_tracker *pt_track_create_ring(op_func_t op,
+					  unsigned long op_code,
+					  size_t n_tasks_crit,
+					  size_t ring_size,
+					  size_t n_lanes)
+{
+	size_t i;
+
+	struct proc_tracker *pt;
 
-	INIT_LIST_HEAD(&pt->tasks);
+
+	if (!ring_size)
+		return NULL;
+
+	if (!is_power_of_2(ring_size))
+		return NULL;
+
+	if (!n_lanes)
+		return NULL;
+
+	pt = pt_track_create(op, op_code, n_tasks_crit);
+	if (!pt)
+		return NULL;
+
+	pt->ring = (struct proc_tracker_ring *)
+		   kzalloc(n_lanes * sizeof(struct proc_tracker_ring));
+	if (!pt->ring)
+		goto cleanup;
+
+	pt->n_lanes = n_lanes;
+
+	for (i = 0; i < n_lanes; i++) {
+		pt->ring[i].slot = (struct proc_task **)
+				   kmalloc(ring_size * sizeof(struct proc_task *));
+		if (!pt->ring[i].slot)
+			goto cleanup;
+
+		pt->ring[i].mask = ring_size - 1;
+	}
 
 	return pt;
+
+cleanup:
+	if (pt->ring) {
+		for (i = 0; i < n_lanes; i++)
+			kfree(pt->ring[i].slot);
+	}
+
+	kfree(pt->ring);
+	kfree(pt);
+
+	return NULL;
 }
 
 
@@ -301,17 +1216,28 @@ struct proc_tracker *pt_track_create(op_func_t op, unsigned long op_code,
 
 void pt_track_destroy(struct proc_tracker *pt)
 {
+	size_t i;
+
 	struct proc_task *t;
 
 
 	if (!pt)
 		return;
 
-	while (list_filled(&pt->tasks)) {
+	while (pt_track_tasks_pending(pt)) {
 		t = pt_track_get(pt);
 
 		pt_destroy(t);
 	}
 
+	if (pt->ring) {
+		for (i = 0; i < pt->n_lanes; i++)
+			kfree(pt->ring[i].slot);
+
+		kfree(pt->ring);
+	}
+
+	kfree(pt->batch);
+	kfree(pt->batch_ret);
 	kfree(pt);
 }
@@ -19,6 +19,19 @@ int32_t grspw2_add_pkt(uint8_t link,
 	return (int32_t) sys_grspw2((void *) &spw);
 }
 
+int32_t grspw2_add_pkts(uint8_t link, struct grspw2_pkt_vec *iov, uint32_t n)
+{
+	struct grspw2_data spw;
+
+
+	spw.op		  = GRSPW2_OP_ADD_PKTS;
+	spw.link	  = link;
+	spw.iov           = iov;
+	spw.n_pkts        = n;
+
+	return (int32_t) sys_grspw2((void *) &spw);
+}
+
 int32_t grspw2_add_rmap(uint8_t link,
 			void *hdr,  uint32_t hdr_size,
 			uint8_t non_crc_bytes,
@@ -85,6 +98,32 @@ uint32_t grspw2_get_pkt(uint8_t link, uint8_t *pkt)
 	return (uint32_t) sys_grspw2((void *) &spw);
 }
 
+uint32_t grspw2_recv(uint8_t link, uint8_t *pkt, uint32_t timeout_us)
+{
+	struct grspw2_data spw;
+
+
+	spw.op         = GRSPW2_OP_RECV;
+	spw.link       = link;
+	spw.pkt        = pkt;
+	spw.timeout_us = timeout_us;
+
+	return (uint32_t) sys_grspw2((void *) &spw);
+}
+
+int32_t grspw2_get_pkts(uint8_t link, struct grspw2_pkt_buf *buf, uint32_t n)
+{
+	struct grspw2_data spw;
+
+
+	spw.op     = GRSPW2_OP_GET_PKTS;
+	spw.link   = link;
+	spw.buf    = buf;
+	spw.n_pkts = n;
+
+	return (int32_t) sys_grspw2((void *) &spw);
+}
+
 int grspw2_get_next_pkt_eep(uint8_t link)
 {
 	struct grspw2_data spw;
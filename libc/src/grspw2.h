@@ -14,6 +14,24 @@
 #define GRSPW2_OP_GET_NEXT_PKT_EEP	7
 #define GRSPW2_OP_AUTO_DROP_ENABLE	8
 #define GRSPW2_OP_AUTO_DROP_DISABLE	9
+#define GRSPW2_OP_ADD_PKTS		10
+#define GRSPW2_OP_RECV			11
+#define GRSPW2_OP_GET_PKTS		12
+
+/* a packet to transmit, see grspw2_add_pkts() */
+struct grspw2_pkt_vec {
+	const void *hdr;
+	uint32_t    hdr_size;
+	const void *data;
+	uint32_t    data_size;
+};
+
+/* a packet receive buffer, see grspw2_get_pkts() */
+struct grspw2_pkt_buf {
+	uint8_t *pkt;
+	uint32_t size;	/* size of the buffer */
+	uint32_t len;	/* size of the received packet */
+};
 
 /* XXX to transfer */
 struct grspw2_data{
@@ -26,7 +44,11 @@ struct grspw2_data{
 	void *data;
 	uint32_t data_size;
 	uint8_t *pkt;
-	uint8_t n_drop
+	uint8_t n_drop;
+	struct grspw2_pkt_vec *iov;
+	uint32_t n_pkts;
+	uint32_t timeout_us;
+	struct grspw2_pkt_buf *buf;
 };
 
 
@@ -36,11 +58,14 @@ uint32_t grspw2_drop_pkt(uint8_t link);
 
 int32_t grspw2_add_pkt(uint8_t link, void *hdr,  uint32_t hdr_size,
 			void *data, uint32_t data_size);
+int32_t grspw2_add_pkts(uint8_t link, struct grspw2_pkt_vec *iov, uint32_t n);
 int32_t grspw2_add_rmap(uint8_t link, void *hdr,  uint32_t hdr_size,
 			uint8_t non_crc_bytes,
 			void *data, uint32_t data_size);
 
 uint32_t grspw2_get_pkt(uint8_t link, uint8_t *pkt);
+uint32_t grspw2_recv(uint8_t link, uint8_t *pkt, uint32_t timeout_us);
+int32_t grspw2_get_pkts(uint8_t link, struct grspw2_pkt_buf *buf, uint32_t n);
 
 int grspw2_get_next_pkt_eep(uint8_t link);
 
@@ -97,44 +97,22 @@ static void ariel_set_gr712_spw_clock(void)
 }
 
 
-static void spw_alloc_desc_table(struct spw_user_cfg *cfg, size_t tc_size, size_t tm_size, size_t hdr_size, size_t rx_desc, size_t tx_desc)
-{
-	uint32_t mem;
-
-
-	/*
-	 * malloc a rx and tx descriptor table buffer and align to
-	 * 1024 bytes (GR712UMRC, p. 111)
-	 *
-	 * dynamically allocate memory + 1K for alignment (worst case)
-	 * 1 buffer per dma channel (GR712 cores only implement one channel)
-	 *
-	 * NOTE: we don't care about calling free(), because this is a
-	 * bare-metal demo, so we just discard the original pointer
-	 */
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->rx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
+static const struct grspw2_ring_cfg spw_ring_obc = {
+	.rx_desc     = GRSPW2_RX_DESCRIPTORS,
+	.tx_desc     = GRSPW2_TX_DESCRIPTORS,
+	.rx_mtu      = ARIEL_MTU_TC,
+	.tx_mtu      = ARIEL_MTU_TM,
+	.tx_hdr_size = HDR_SIZE,
+};
 
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->tx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-
-	/* malloc rx and tx data buffers: decriptors * packet size */
-	cfg->rx_data = (uint8_t *) kpcalloc(1, rx_desc * tc_size);
-	cfg->tx_data = (uint8_t *) kpcalloc(1, tx_desc * tm_size);
-
-	cfg->tx_hdr = (uint8_t *) kpcalloc(1, tx_desc * hdr_size);
-}
+/* the DCU and debug links only route */
+static const struct grspw2_ring_cfg spw_ring_dcu = {
+	.rx_desc     = 10,
+	.tx_desc     = 10,
+	.rx_mtu      = ARIEL_MTU_DCU,
+	.tx_mtu      = ARIEL_MTU_DCU,
+	.tx_hdr_size = 0,
+};
 
 
 
@@ -155,17 +133,7 @@ static void spw_init_core_obc(struct spw_user_cfg *cfg)
 			 ARIEL_MTU_TC, GRSPW2_IRQ_CORE0,
 			 GR712_IRL1_AHBSTAT, STRIP_HDR_BYTES);
 
-	grspw2_rx_desc_table_init(&cfg->spw,
-				  cfg->rx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->rx_data,
-				  ARIEL_MTU_TC);
-
-	grspw2_tx_desc_table_init(&cfg->spw,
-				  cfg->tx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->tx_hdr, HDR_SIZE,
-				  cfg->tx_data, ARIEL_MTU_TM);
+	grspw2_core_alloc(&cfg->spw, &spw_ring_obc);
 }
 
 
@@ -186,17 +154,7 @@ static void spw_init_core_dcu(struct spw_user_cfg *cfg)
 			 ARIEL_MTU_TC, GRSPW2_IRQ_CORE2,
 			 GR712_IRL1_AHBSTAT, 0);
 
-	grspw2_rx_desc_table_init(&cfg->spw,
-				  cfg->rx_desc,
-				  GRSPW2_RX_DESC_SIZE * 10,
-				  cfg->rx_data,
-				  ARIEL_MTU_DCU);
-
-	grspw2_tx_desc_table_init(&cfg->spw,
-				  cfg->tx_desc,
-				  GRSPW2_TX_DESC_SIZE *  10,
-				  cfg->tx_hdr, 0,
-				  cfg->tx_data, ARIEL_MTU_DCU);
+	grspw2_core_alloc(&cfg->spw, &spw_ring_dcu);
 }
 
 
@@ -217,18 +175,7 @@ static void spw_init_core_debug(struct spw_user_cfg *cfg)
 			 ARIEL_MTU_TC, GRSPW2_IRQ_CORE4,
 			 GR712_IRL1_AHBSTAT, 0);
 
-	grspw2_rx_desc_table_init(&cfg->spw,
-				  cfg->rx_desc,
-				  GRSPW2_RX_DESC_SIZE * 10,
-				  cfg->rx_data,
-				  ARIEL_MTU_DCU);
-
-	grspw2_tx_desc_table_init(&cfg->spw,
-				  cfg->tx_desc,
-				  GRSPW2_TX_DESC_SIZE * 10,
-				  cfg->tx_hdr, 0,
-				  cfg->tx_data, ARIEL_MTU_DCU);
-
+	grspw2_core_alloc(&cfg->spw, &spw_ring_dcu);
 }
 
 
@@ -303,7 +250,6 @@ static int ariel_init(void)
 	void *addr;
 
 
-	spw_alloc_desc_table(&spw_cfg[0], ARIEL_MTU_TC, ARIEL_MTU_TM, HDR_SIZE, GRSPW2_RX_DESCRIPTORS, GRSPW2_TX_DESCRIPTORS);
 	spw_init_core_obc(&spw_cfg[0]);
 
 
@@ -312,9 +258,6 @@ static int ariel_init(void)
 	grspw2_tick_out_interrupt_enable(&spw_cfg[0].spw);
 
 	/* setup routing between dcu and debug link 5 */
-	spw_alloc_desc_table(&spw_cfg[2], ARIEL_MTU_DCU, ARIEL_MTU_DCU, 0, 10, 10);
-	spw_alloc_desc_table(&spw_cfg[4], ARIEL_MTU_DCU, ARIEL_MTU_DCU, 0, 10, 10);
-
 	spw_init_core_dcu(&spw_cfg[2]);
 	spw_init_core_debug(&spw_cfg[4]);
 
@@ -93,46 +93,13 @@ static void smile_set_gr712_spw_clock(void)
 }
 
 
-static void spw_alloc_obc(struct spw_user_cfg *cfg)
-{
-	uint32_t mem;
-
-
-	/*
-	 * malloc a rx and tx descriptor table buffer and align to
-	 * 1024 bytes (GR712UMRC, p. 111)
-	 *
-	 * dynamically allocate memory + 1K for alignment (worst case)
-	 * 1 buffer per dma channel (GR712 cores only implement one channel)
-	 *
-	 * NOTE: we don't care about calling free(), because this is a
-	 * bare-metal demo, so we just discard the original pointer
-	 */
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->rx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->tx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-
-	/* malloc rx and tx data buffers: decriptors * packet size */
-	cfg->rx_data = (uint8_t *) kpcalloc(1, GRSPW2_RX_DESCRIPTORS
-					    * GRSPW2_DEFAULT_MTU);
-	cfg->tx_data = (uint8_t *) kpcalloc(1, GRSPW2_TX_DESCRIPTORS
-					    * GRSPW2_DEFAULT_MTU);
-
-	cfg->tx_hdr = (uint8_t *) kpcalloc(1, GRSPW2_TX_DESCRIPTORS * HDR_SIZE);
-}
+static const struct grspw2_ring_cfg spw_ring_obc = {
+	.rx_desc     = GRSPW2_RX_DESCRIPTORS,
+	.tx_desc     = GRSPW2_TX_DESCRIPTORS,
+	.rx_mtu      = GRSPW2_DEFAULT_MTU,
+	.tx_mtu      = GRSPW2_DEFAULT_MTU,
+	.tx_hdr_size = HDR_SIZE,
+};
 
 
 
@@ -153,17 +120,7 @@ static void spw_init_core_obc(struct spw_user_cfg *cfg)
 			 GRSPW2_DEFAULT_MTU, GRSPW2_IRQ_CORE0,
 			 GR712_IRL1_AHBSTAT, STRIP_HDR_BYTES);
 
-	grspw2_rx_desc_table_init(&cfg->spw,
-				  cfg->rx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->rx_data,
-				  GRSPW2_DEFAULT_MTU);
-
-	grspw2_tx_desc_table_init(&cfg->spw,
-				  cfg->tx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->tx_hdr, HDR_SIZE,
-				  cfg->tx_data, GRSPW2_DEFAULT_MTU);
+	grspw2_core_alloc(&cfg->spw, &spw_ring_obc);
 }
 
 
@@ -171,46 +128,13 @@ static void spw_init_core_obc(struct spw_user_cfg *cfg)
  * so we increase the RX size
  */
 #define GRSPW2_FEE_RX_MTU	0x4004
-static void spw_alloc_fee(struct spw_user_cfg *cfg)
-{
-	uint32_t mem;
-
-
-	/*
-	 * malloc a rx and tx descriptor table buffer and align to
-	 * 1024 bytes (GR712UMRC, p. 111)
-	 *
-	 * dynamically allocate memory + 1K for alignment (worst case)
-	 * 1 buffer per dma channel (GR712 cores only implement one channel)
-	 *
-	 * NOTE: we don't care about calling free(), because this is a
-	 * bare-metal demo, so we just discard the original pointer
-	 */
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->rx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-
-	mem = (uint32_t) kpcalloc(1, GRSPW2_DESCRIPTOR_TABLE_SIZE
-				  + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-	cfg->tx_desc = (uint32_t *)
-		((mem + GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN)
-		 & ~GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN);
-
-
-	/* malloc rx and tx data buffers: decriptors * packet size */
-	cfg->rx_data = (uint8_t *) kpcalloc(1, GRSPW2_RX_DESCRIPTORS
-					    * GRSPW2_FEE_RX_MTU);
-	cfg->tx_data = (uint8_t *) kpcalloc(1, GRSPW2_TX_DESCRIPTORS
-					    * GRSPW2_DEFAULT_MTU);
-
-	cfg->tx_hdr = (uint8_t *) kpcalloc(1, GRSPW2_TX_DESCRIPTORS * HDR_SIZE);
-}
+static const struct grspw2_ring_cfg spw_ring_fee = {
+	.rx_desc     = GRSPW2_RX_DESCRIPTORS,
+	.tx_desc     = GRSPW2_TX_DESCRIPTORS,
+	.rx_mtu      = GRSPW2_FEE_RX_MTU,
+	.tx_mtu      = GRSPW2_DEFAULT_MTU,
+	.tx_hdr_size = HDR_SIZE,
+};
 /**
  * @brief perform basic initialisation of the spw core
  */
@@ -228,17 +152,7 @@ static void spw_init_core_fee(struct spw_user_cfg *cfg)
 			 GRSPW2_FEE_RX_MTU, GRSPW2_IRQ_CORE1,
 			 GR712_IRL1_AHBSTAT, 0);
 
-	grspw2_rx_desc_table_init(&cfg->spw,
-				  cfg->rx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->rx_data,
-				  GRSPW2_FEE_RX_MTU);
-
-	grspw2_tx_desc_table_init(&cfg->spw,
-				  cfg->tx_desc,
-				  GRSPW2_DESCRIPTOR_TABLE_SIZE,
-				  cfg->tx_hdr, HDR_SIZE,
-				  cfg->tx_data, GRSPW2_DEFAULT_MTU);
+	grspw2_core_alloc(&cfg->spw, &spw_ring_fee);
 	grspw2_set_promiscuous(&cfg->spw);
 }
 
@@ -299,14 +213,12 @@ static int smile_init(void)
 
 
 	/* XXX MEH, just hack this in for EMC test */
-	spw_alloc_obc(&spw_cfg[0]);
 	spw_init_core_obc(&spw_cfg[0]);
 
 	grspw2_core_start(&spw_cfg[0].spw, 0, 1);
 	grspw2_set_time_rx(&spw_cfg[0].spw);
 	grspw2_tick_out_interrupt_enable(&spw_cfg[0].spw);
 
-	spw_alloc_fee(&spw_cfg[1]);
 	spw_init_core_fee(&spw_cfg[1]);
 	grspw2_core_start(&spw_cfg[1].spw, 1, 1);
 
@@ -91,9 +91,56 @@ static void noc_dma_test_transfers(void)
 
 
 
+/**
+ * @brief execute transfer types 1-4 as a single scatter-gather transfer
+ */
+
+static void noc_dma_test_sg_transfer(void)
+{
+	int i;
+
+	unsigned long *src;
+	char *dst;
+
+	struct noc_dma_sg sg[4];
+
+	const uint16_t x_size = 16;
+	const uint16_t y_size = 19;
+
+
+	src = calloc(x_size * y_size, sizeof(unsigned long));
+	BUG_ON(!src);
+
+	dst = (char *) NOC_SCRATCH_BUFFER_BASE;
+
+	for (i = 0; i < (x_size * y_size); i++) {
+		src[i] = i + 1;
+		((unsigned long *) dst)[i] = 0;
+	}
+
+	/* type 1 */
+	sg[0] = (struct noc_dma_sg) {src, dst + 0x100, 16, 1, 2, 0, 1, 0};
+	/* type 2 */
+	sg[1] = (struct noc_dma_sg) {src, dst + 0x1C0, 6, 2, 1, 16, 1, 16};
+	/* type 3 */
+	sg[2] = (struct noc_dma_sg) {src, dst + 0x2C0, 4, 2, 1, 4, 16, 1};
+	/* type 4 */
+	sg[3] = (struct noc_dma_sg) {src, dst + 0x44C, 4, 4, 1, 4, -1, 4};
+
+	BUG_ON(noc_dma_req_sg_xfer(sg, ARRAY_SIZE(sg), WORD, LOW, 256,
+				   NULL, NULL));
+
+	printk("\n--- {DST SG} ---\n");
+	noc_dma_2d_print((unsigned long *) dst, x_size, y_size);
+
+	free(src);
+}
+
+
 int main(int argc, char **argv)
 {
 	noc_dma_test_transfers();
+	noc_dma_test_sg_transfer();
 
 	return 0;
 }
@@ -0,0 +1,33 @@
+/**
+ * @file   asm/io.h
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief host replacement of the register accessors
+ *
+ * The emulation runs in host byte order, so no swapping is done. All register
+ * accesses are passed to the GRSPW2 emulator, which implements the side
+ * effects of the registers (e.g. write-1-to-clear status bits) and starts
+ * the emulated DMA engine if the driver enables a DMA channel.
+ */
+
+#ifndef _ASM_IO_H_
+#define _ASM_IO_H_
+
+#include <kernel/types.h>
+#include <grspw2_emu.h>
+
+#define ioread32be(X)		grspw2_emu_ioread32be((X))
+
+#define iowrite32be(val, X)	grspw2_emu_iowrite32be((val), (X))
+
+#endif /* _ASM_IO_H_ */
@@ -0,0 +1,18 @@
+/**
+ * @file   asm/leon.h
+ * @ingroup mockups
+ *
+ * @brief host replacement of the LEON cache control
+ *
+ * @note the emulated DMA engine accesses memory through the host caches, so
+ *	 there is nothing to flush
+ */
+
+#ifndef _ASM_LEON_H_
+#define _ASM_LEON_H_
+
+static inline void leon3_flush_dcache(void)
+{
+}
+
+#endif /* _ASM_LEON_H_ */
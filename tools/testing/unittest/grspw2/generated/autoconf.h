@@ -0,0 +1,13 @@
+/**
+ * @file   generated/autoconf.h
+ * @ingroup mockups
+ *
+ * @brief the configuration options needed by the kernel headers
+ */
+
+#ifndef _GENERATED_AUTOCONF_H_
+#define _GENERATED_AUTOCONF_H_
+
+#define CONFIG_SMP_CPUS_MAX	1
+
+#endif /* _GENERATED_AUTOCONF_H_ */
@@ -0,0 +1,928 @@
+/**
+ * @file   grspw2_emu.c
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief a host emulation of the GRSPW2 SpaceWire core
+ *
+ * This emulates the register interface and the DMA engine of GRSPW2 cores
+ * (channel 0 only), so that the descriptor ring handling of the driver
+ * (kernel/grspw2.c) may be exercised and benchmarked on a Linux host:
+ *
+ *  - the register map of each core is a struct grspw2_regs in host memory;
+ *    all register accesses of the driver are passed through
+ *    grspw2_emu_ioread32be() and grspw2_emu_iowrite32be() (see asm/io.h),
+ *    which implement the write-1-to-clear status bits, the tick-in bit and
+ *    the DMA abort
+ *
+ *  - cores are connected back-to-back via grspw2_emu_connect(), a core may
+ *    be connected to itself for a loopback; the DMA engine is infinitely
+ *    fast and runs whenever the driver writes a register, i.e. a packet is
+ *    transferred from the TX descriptor of one core to the RX descriptor of
+ *    its peer as soon as both are enabled and the corresponding DMA channels
+ *    are active
+ *
+ *  - if no RX descriptor is available at the receiver, the transmission
+ *    stalls (the driver always enables "no spill" mode), packets exceeding
+ *    the maximum receive length are truncated and packets not addressed to
+ *    the receiver are discarded unless it is in promiscuous mode; the
+ *    hardware RMAP target is not emulated
+ *
+ *  - the RMAP CRC is appended to the header and data of TX descriptors
+ *    which request it; received packets with the RMAP protocol identifier
+ *    are checked and the header and data CRC error flags of the RX
+ *    descriptor set accordingly
+ *
+ *  - interrupts are latched and executed by grspw2_emu_irq_dispatch(), so
+ *    the test decides at which points the driver may be interrupted; a
+ *    handler is registered via irq_request() as usual
+ *
+ * The driver passes addresses through 32 bit descriptor fields and registers,
+ * so all memory which is handed to a core must be allocated via
+ * grspw2_emu_alloc(), which serves it from the low 4 GiB of the address space.
+ */
+
+#define _GNU_SOURCE
+
+/* kernel/time.h has its own difftime() */
+#define difftime libc_difftime
+#include <time.h>
+#undef difftime
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <kernel/irq.h>
+#include <kernel/printk.h>
+#include <grspw2.h>
+
+#include <grspw2_emu.h>
+
+
+#define GRSPW2_EMU_IRQS		64
+#define GRSPW2_EMU_IRQ_HANDLERS	4
+
+/* the size of the memory served by grspw2_emu_alloc() */
+#define GRSPW2_EMU_MEM_SIZE	(64 * 1024 * 1024)
+
+/* RMAP and RMAP CRC available, 1 DMA channel, 1 port */
+#define GRSPW2_EMU_CTRL_CAPS	(GRSPW2_CTRL_RA | GRSPW2_CTRL_RC)
+
+/* write-1-to-clear bits of the DMA control register */
+#define GRSPW2_EMU_DMACONTROL_W1C	(GRSPW2_DMACONTROL_PS		\
+					 | GRSPW2_DMACONTROL_PR		\
+					 | GRSPW2_DMACONTROL_TA		\
+					 | GRSPW2_DMACONTROL_RA)
+
+/* the descriptor selectors of the table address registers */
+#define GRSPW2_EMU_TX_DESCSEL_BIT	4
+#define GRSPW2_EMU_TX_DESCSEL_MASK	0x3F0
+#define GRSPW2_EMU_RX_DESCSEL_BIT	3
+#define GRSPW2_EMU_RX_DESCSEL_MASK	0x3F8
+#define GRSPW2_EMU_DESCBASE_MASK	0xFFFFFC00
+
+/* the number of descriptors in a 1 kiB table */
+#define GRSPW2_EMU_TX_DESC	\
+	(GRSPW2_DESCRIPTOR_TABLE_SIZE / GRSPW2_TX_DESC_SIZE)
+#define GRSPW2_EMU_RX_DESC	\
+	(GRSPW2_DESCRIPTOR_TABLE_SIZE / GRSPW2_RX_DESC_SIZE)
+
+
+/* the largest header of a TX descriptor, plus its CRC */
+#define GRSPW2_EMU_TX_HDR_MAX	(GRSPW2_TX_DESC_HDR_SIZE_MASK + 1)
+
+
+struct grspw2_emu_core {
+	struct grspw2_regs *regs;
+
+	struct grspw2_emu_core *peer;
+
+	int irq_pending;
+	int stalled;
+
+	struct grspw2_emu_stats stats;
+};
+
+static struct {
+	struct grspw2_emu_core core[GRSPW2_EMU_CORES];
+
+	struct {
+		irq_handler_t handler;
+		void *data;
+	} irq[GRSPW2_EMU_IRQS][GRSPW2_EMU_IRQ_HANDLERS];
+
+	uint8_t *mem;
+	size_t mem_used;
+
+	int running;
+} emu;
+
+
+/**
+ * @brief get a monotonic time stamp in nanoseconds
+ */
+
+uint64_t grspw2_emu_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief convert a 32 bit bus address to a pointer
+ */
+
+static void *grspw2_emu_ptr(uint32_t addr)
+{
+	return (void *) (uintptr_t) addr;
+}
+
+
+/**
+ * @brief allocate memory which can be addressed by an emulated core
+ *
+ * @param size the number of bytes to allocate
+ * @param align the alignment of the allocation, must be a power of two
+ *
+ * @returns a pointer to the zeroed memory or NULL on error
+ *
+ * @note memory is only released by grspw2_emu_exit()
+ */
+
+void *grspw2_emu_alloc(size_t size, size_t align)
+{
+	size_t offset;
+
+
+	if (!emu.mem)
+		return NULL;
+
+	if (!align)
+		align = 1;
+
+	offset = (emu.mem_used + align - 1) & ~(align - 1);
+
+	if (offset + size > GRSPW2_EMU_MEM_SIZE)
+		return NULL;
+
+	emu.mem_used = offset + size;
+
+	return memset(&emu.mem[offset], 0, size);
+}
+
+
+/**
+ * @brief check whether a pointer was served by grspw2_emu_alloc()
+ *
+ * @note such memory is never released
+ */
+
+int grspw2_emu_is_mem(const void *ptr)
+{
+	if (!emu.mem)
+		return 0;
+
+	return ((const uint8_t *) ptr >= emu.mem)
+		&& ((const uint8_t *) ptr < &emu.mem[GRSPW2_EMU_MEM_SIZE]);
+}
+
+
+/**
+ * @brief find the core owning a register address
+ */
+
+static struct grspw2_emu_core *grspw2_emu_find_core(const volatile void *addr)
+{
+	size_t i;
+
+	const volatile uint8_t *p = addr;
+	const uint8_t *regs;
+
+
+	for (i = 0; i < GRSPW2_EMU_CORES; i++) {
+
+		regs = (const uint8_t *) emu.core[i].regs;
+
+		if (!regs)
+			continue;
+
+		if (p >= regs && p < regs + sizeof(struct grspw2_regs))
+			return &emu.core[i];
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief latch an interrupt of a core
+ */
+
+static void grspw2_emu_raise_irq(struct grspw2_emu_core *c)
+{
+	c->irq_pending = 1;
+	c->stats.irqs++;
+}
+
+
+/**
+ * @brief check whether a packet is addressed to a core
+ */
+
+static int grspw2_emu_addr_match(struct grspw2_emu_core *c, uint8_t addr)
+{
+	uint32_t node;
+	uint32_t mask;
+
+
+	if (c->regs->ctrl & GRSPW2_CTRL_PM)
+		return 1;
+
+	node = c->regs->nodeaddr & GRSPW2_DEFAULT_ADDR_DEFADDR_BITS;
+	mask = (c->regs->nodeaddr & GRSPW2_DEFAULT_ADDR_DEFMASK) >> 8;
+
+	return !((addr ^ node) & ~mask & 0xFF);
+}
+
+
+/**
+ * @brief update an RMAP CRC-8
+ *
+ * @note the CRC over a sequence and its own CRC is zero
+ */
+
+uint8_t grspw2_emu_rmap_crc(uint8_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+	int j;
+	uint8_t c;
+
+	static uint8_t tbl[256];
+	static int tbl_init;
+
+
+	if (!tbl_init) {
+		for (i = 0; i < 256; i++) {
+			c = i;
+			for (j = 0; j < 8; j++)
+				c = (c & 0x1) ? (c >> 1) ^ 0xE0 : (c >> 1);
+			tbl[i] = c;
+		}
+		tbl_init = 1;
+	}
+
+	while (len--)
+		crc = tbl[crc ^ *buf++];
+
+	return crc;
+}
+
+
+/**
+ * @brief check the RMAP CRCs of a received packet
+ *
+ * @returns the header and data CRC error flags of the RX descriptor
+ */
+
+static uint32_t grspw2_emu_rmap_check(const uint8_t *pkt, uint32_t len)
+{
+	uint32_t hdr_len;
+	uint32_t flags = 0;
+
+
+	if (len < 3 || pkt[1] != GRSPW2_RMAP_PROTOCOL_ID)
+		return 0;
+
+	if (pkt[2] & GRSPW2_RMAP_INS_CMD)
+		hdr_len = GRSPW2_RMAP_CMD_HDR_SIZE
+			  + 4 * (pkt[2] & GRSPW2_RMAP_INS_RAL_MASK);
+	else if (pkt[2] & GRSPW2_RMAP_INS_WRITE)
+		hdr_len = GRSPW2_RMAP_WRITE_REPLY_SIZE + 1;
+	else
+		hdr_len = GRSPW2_RMAP_READ_REPLY_SIZE + 1;
+
+	/* a short header is left to the protocol handler */
+	if (len < hdr_len)
+		return 0;
+
+	if (grspw2_emu_rmap_crc(0, pkt, hdr_len))
+		flags |= GRSPW2_RX_DESC_HC;
+
+	if (len > hdr_len)
+		if (grspw2_emu_rmap_crc(0, pkt + hdr_len, len - hdr_len))
+			flags |= GRSPW2_RX_DESC_DC;
+
+	return flags;
+}
+
+
+/**
+ * @brief receive a packet into the next RX descriptor of a core
+ *
+ * @param trl an optional trailer following the data (i.e. the data CRC)
+ *
+ * @returns 0 if the packet was consumed, -1 if the transmission must stall
+ */
+
+static int grspw2_emu_rx(struct grspw2_emu_core *c,
+			 const uint8_t *hdr, uint32_t hdr_size,
+			 const uint8_t *data, uint32_t data_size,
+			 const uint8_t *trl, uint32_t trl_size)
+{
+	uint32_t n;
+	uint32_t off;
+	uint32_t sel;
+	uint32_t len;
+	uint32_t ctrl;
+	uint32_t max_len;
+
+	uint8_t *pkt;
+	struct grspw2_rx_desc *desc;
+	struct grspw2_dma_regs *dma;
+
+
+	dma = &c->regs->dma[0];
+
+	len = hdr_size + data_size + trl_size;
+	if (!len)
+		return 0;
+
+	if (!grspw2_emu_addr_match(c, hdr_size ? hdr[0] : data[0])) {
+		c->regs->status |= GRSPW2_STATUS_IA;
+		c->stats.rx_discarded++;
+		return 0;
+	}
+
+	if (!(dma->ctrl_status & GRSPW2_DMACONTROL_RE))
+		goto no_desc;
+
+	sel  = (dma->rx_desc_table_addr & GRSPW2_EMU_RX_DESCSEL_MASK)
+	       >> GRSPW2_EMU_RX_DESCSEL_BIT;
+	desc = grspw2_emu_ptr((dma->rx_desc_table_addr
+			       & GRSPW2_EMU_DESCBASE_MASK)
+			      + sel * GRSPW2_RX_DESC_SIZE);
+
+	ctrl = desc->pkt_ctrl;
+
+	if (!(ctrl & GRSPW2_RX_DESC_EN)) {
+		dma->ctrl_status &= ~GRSPW2_DMACONTROL_RD;
+		goto no_desc;
+	}
+
+	max_len = dma->rx_max_pkt_len & GRSPW2_RX_MAX_LEN_MASK;
+
+	ctrl &= GRSPW2_RX_DESC_WR | GRSPW2_RX_DESC_IE;
+
+	if (len > max_len) {
+		len   = max_len;
+		ctrl |= GRSPW2_RX_DESC_TR;
+		c->stats.rx_truncated++;
+	}
+
+	pkt = grspw2_emu_ptr(desc->pkt_addr);
+
+	n = hdr_size < len ? hdr_size : len;
+	if (n)
+		memcpy(pkt, hdr, n);
+	off = n;
+
+	n = data_size < (len - off) ? data_size : (len - off);
+	if (n)
+		memcpy(pkt + off, data, n);
+	off += n;
+
+	if (len - off)
+		memcpy(pkt + off, trl, len - off);
+
+	if (c->regs->ctrl & GRSPW2_CTRL_RC)
+		ctrl |= grspw2_emu_rmap_check(pkt, len);
+
+	/* the descriptor is handed back with the enable bit cleared */
+	desc->pkt_ctrl = ctrl | len;
+
+	dma->ctrl_status |= GRSPW2_DMACONTROL_PR;
+
+	if ((ctrl & GRSPW2_RX_DESC_IE)
+	    && (dma->ctrl_status & GRSPW2_DMACONTROL_RI))
+		grspw2_emu_raise_irq(c);
+
+	if ((ctrl & GRSPW2_RX_DESC_WR) || (sel + 1 >= GRSPW2_EMU_RX_DESC))
+		sel = 0;
+	else
+		sel++;
+
+	dma->rx_desc_table_addr = (dma->rx_desc_table_addr
+				   & ~GRSPW2_EMU_RX_DESCSEL_MASK)
+				  | (sel << GRSPW2_EMU_RX_DESCSEL_BIT);
+
+	c->stats.rx_pkts++;
+	c->stats.rx_bytes += len;
+
+	return 0;
+
+no_desc:
+	if (dma->ctrl_status & GRSPW2_DMACONTROL_NS)
+		return -1;
+
+	/* spill */
+	c->stats.rx_discarded++;
+
+	return 0;
+}
+
+
+/**
+ * @brief transmit the packets of the enabled TX descriptors of a core
+ *
+ * @returns the number of packets transmitted
+ */
+
+static unsigned int grspw2_emu_tx(struct grspw2_emu_core *c)
+{
+	unsigned int n = 0;
+
+	uint32_t sel;
+	uint32_t ctrl;
+	uint32_t skip;
+	uint32_t hdr_size;
+	uint32_t crc_size;
+
+	uint8_t *hdr;
+	uint8_t *data;
+	uint8_t data_crc = 0;
+	uint8_t hdr_buf[GRSPW2_EMU_TX_HDR_MAX];
+
+	struct grspw2_tx_desc *desc;
+	struct grspw2_dma_regs *dma;
+
+
+	dma = &c->regs->dma[0];
+
+	while (dma->ctrl_status & GRSPW2_DMACONTROL_TE) {
+
+		sel  = (dma->tx_desc_table_addr & GRSPW2_EMU_TX_DESCSEL_MASK)
+		       >> GRSPW2_EMU_TX_DESCSEL_BIT;
+		desc = grspw2_emu_ptr((dma->tx_desc_table_addr
+				       & GRSPW2_EMU_DESCBASE_MASK)
+				      + sel * GRSPW2_TX_DESC_SIZE);
+
+		ctrl = desc->pkt_ctrl;
+
+		/* the transmitter stops at the first disabled descriptor */
+		if (!(ctrl & GRSPW2_TX_DESC_EN)) {
+			dma->ctrl_status &= ~GRSPW2_DMACONTROL_TE;
+			break;
+		}
+
+		/* link not running */
+		if (!c->peer)
+			break;
+
+		hdr      = grspw2_emu_ptr(desc->hdr_addr);
+		data     = grspw2_emu_ptr(desc->data_addr);
+		hdr_size = desc->hdr_size;
+		crc_size = 0;
+
+		/* the CRC skips the leading non-CRC bytes of the header */
+		if (desc->append_header_crc && hdr_size) {
+			skip = desc->non_crc_bytes;
+			if (skip > hdr_size)
+				skip = hdr_size;
+
+			memcpy(hdr_buf, hdr, hdr_size);
+			hdr_buf[hdr_size] = grspw2_emu_rmap_crc(0, hdr + skip,
+								hdr_size
+								- skip);
+			hdr = hdr_buf;
+			hdr_size++;
+		}
+
+		if (desc->append_data_crc && desc->data_size) {
+			data_crc = grspw2_emu_rmap_crc(0, data,
+						       desc->data_size);
+			crc_size = 1;
+		}
+
+		if (grspw2_emu_rx(c->peer, hdr, hdr_size,
+				  data, desc->data_size,
+				  &data_crc, crc_size)) {
+			if (!c->stalled)
+				c->stats.stalls++;
+			c->stalled = 1;
+			break;
+		}
+
+		c->stalled = 0;
+
+		desc->pkt_ctrl = ctrl & ~GRSPW2_TX_DESC_EN;
+
+		dma->ctrl_status |= GRSPW2_DMACONTROL_PS;
+
+		if ((ctrl & GRSPW2_TX_DESC_IE)
+		    && (dma->ctrl_status & GRSPW2_DMACONTROL_TI))
+			grspw2_emu_raise_irq(c);
+
+		if ((ctrl & GRSPW2_TX_DESC_WR) || (sel + 1 >= GRSPW2_EMU_TX_DESC))
+			sel = 0;
+		else
+			sel++;
+
+		dma->tx_desc_table_addr = (dma->tx_desc_table_addr
+					   & ~GRSPW2_EMU_TX_DESCSEL_MASK)
+					  | (sel << GRSPW2_EMU_TX_DESCSEL_BIT);
+
+		c->stats.tx_pkts++;
+		c->stats.tx_bytes += hdr_size + desc->data_size + crc_size;
+
+		n++;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief run the DMA engines of all cores until no more packets are moved
+ */
+
+static void grspw2_emu_dma_run(void)
+{
+	size_t i;
+	unsigned int n;
+
+
+	do {
+		n = 0;
+
+		for (i = 0; i < GRSPW2_EMU_CORES; i++) {
+			if (emu.core[i].regs)
+				n += grspw2_emu_tx(&emu.core[i]);
+		}
+	} while (n);
+}
+
+
+/**
+ * @brief send a time code to the peer of a core
+ */
+
+static void grspw2_emu_tick_in(struct grspw2_emu_core *c)
+{
+	uint32_t time;
+
+	struct grspw2_regs *peer;
+
+
+	time = (c->regs->time + 1) & GRSPW2_TIME_TIMECNT;
+
+	c->regs->time = (c->regs->time & GRSPW2_TIME_TCTRL) | time;
+
+	if (!c->peer)
+		return;
+
+	peer = c->peer->regs;
+
+	if (!(peer->ctrl & GRSPW2_CTRL_TR))
+		return;
+
+	peer->time    = (peer->time & GRSPW2_TIME_TCTRL) | time;
+	peer->status |= GRSPW2_STATUS_TO;
+
+	if (peer->ctrl & GRSPW2_CTRL_TQ)
+		grspw2_emu_raise_irq(c->peer);
+}
+
+
+/**
+ * @brief read a register or memory location
+ */
+
+uint32_t grspw2_emu_ioread32be(const volatile void *addr)
+{
+	return *(const volatile uint32_t *) addr;
+}
+
+
+/**
+ * @brief write a register or memory location
+ */
+
+void grspw2_emu_iowrite32be(uint32_t val, volatile void *addr)
+{
+	struct grspw2_emu_core *c;
+	struct grspw2_regs *regs;
+	struct grspw2_dma_regs *dma;
+
+
+	c = grspw2_emu_find_core(addr);
+	if (!c) {
+		*(volatile uint32_t *) addr = val;
+		return;
+	}
+
+	regs = c->regs;
+	dma  = &regs->dma[0];
+
+	if (addr == &regs->ctrl) {
+
+		if (val & GRSPW2_CTRL_RS) {
+			memset(regs, 0, sizeof(struct grspw2_regs));
+			regs->ctrl = GRSPW2_EMU_CTRL_CAPS;
+			return;
+		}
+
+		regs->ctrl = (val & ~(GRSPW2_CTRL_TI | GRSPW2_EMU_CTRL_CAPS))
+			     | GRSPW2_EMU_CTRL_CAPS;
+
+		if (val & GRSPW2_CTRL_TI)
+			grspw2_emu_tick_in(c);
+
+	} else if (addr == &regs->status) {
+
+		regs->status &= ~(val & GRSPW2_STATUS_CLEAR_MASK);
+
+	} else if (addr == &dma->ctrl_status) {
+
+		dma->ctrl_status = (val & ~(GRSPW2_EMU_DMACONTROL_W1C
+					    | GRSPW2_DMACONTROL_AT
+					    | GRSPW2_DMACONTROL_RX))
+				   | (dma->ctrl_status & ~val
+				      & GRSPW2_EMU_DMACONTROL_W1C);
+
+		if (val & GRSPW2_DMACONTROL_AT)
+			dma->ctrl_status &= ~GRSPW2_DMACONTROL_TE;
+
+	} else {
+		*(volatile uint32_t *) addr = val;
+	}
+
+	grspw2_emu_dma_run();
+}
+
+
+/**
+ * @brief get the register base address of an emulated core
+ */
+
+uint32_t grspw2_emu_get_regs(int idx)
+{
+	if (idx < 0 || idx >= GRSPW2_EMU_CORES)
+		return 0;
+
+	return (uint32_t) (uintptr_t) emu.core[idx].regs;
+}
+
+
+/**
+ * @brief get the interrupt number of an emulated core
+ */
+
+unsigned int grspw2_emu_get_irq(int idx)
+{
+	return GRSPW2_IRQ_CORE0 + idx;
+}
+
+
+/**
+ * @brief connect the links of two cores
+ *
+ * @note a core may be connected to itself
+ *
+ * @returns 0 on success, otherwise error
+ */
+
+int grspw2_emu_connect(int a, int b)
+{
+	struct grspw2_emu_core *ca;
+	struct grspw2_emu_core *cb;
+
+
+	if (a < 0 || a >= GRSPW2_EMU_CORES)
+		return -EINVAL;
+
+	if (b < 0 || b >= GRSPW2_EMU_CORES)
+		return -EINVAL;
+
+	ca = &emu.core[a];
+	cb = &emu.core[b];
+
+	ca->peer = cb;
+	cb->peer = ca;
+
+	ca->regs->status = (ca->regs->status & ~GRSPW2_STATUS_LS)
+			   | (GRSPW2_STATUS_LS_RUN << GRSPW2_STATUS_LS_BIT);
+	cb->regs->status = (cb->regs->status & ~GRSPW2_STATUS_LS)
+			   | (GRSPW2_STATUS_LS_RUN << GRSPW2_STATUS_LS_BIT);
+
+	grspw2_emu_dma_run();
+
+	return 0;
+}
+
+
+/**
+ * @brief execute the handlers of all latched interrupts
+ *
+ * @returns the number of interrupts executed
+ */
+
+unsigned int grspw2_emu_irq_dispatch(void)
+{
+	size_t i;
+	size_t j;
+	unsigned int n = 0;
+	unsigned int irq;
+	unsigned int pending;
+
+
+	do {
+		pending = 0;
+
+		for (i = 0; i < GRSPW2_EMU_CORES; i++) {
+
+			if (!emu.core[i].irq_pending)
+				continue;
+
+			emu.core[i].irq_pending = 0;
+
+			irq = grspw2_emu_get_irq(i);
+
+			for (j = 0; j < GRSPW2_EMU_IRQ_HANDLERS; j++) {
+				if (emu.irq[irq][j].handler)
+					emu.irq[irq][j].handler(irq,
+							emu.irq[irq][j].data);
+			}
+
+			pending++;
+		}
+
+		n += pending;
+
+	} while (pending);
+
+	return n;
+}
+
+
+/**
+ * @brief get the statistics of an emulated core
+ */
+
+void grspw2_emu_get_stats(int idx, struct grspw2_emu_stats *st)
+{
+	if (idx < 0 || idx >= GRSPW2_EMU_CORES)
+		return;
+
+	memcpy(st, &emu.core[idx].stats, sizeof(struct grspw2_emu_stats));
+}
+
+
+/**
+ * @brief set up the emulated cores
+ *
+ * @returns 0 on success, otherwise error
+ */
+
+int grspw2_emu_init(void)
+{
+	size_t i;
+
+
+	if (emu.running)
+		return -EBUSY;
+
+	memset(&emu, 0, sizeof(emu));
+
+	emu.mem = mmap(NULL, GRSPW2_EMU_MEM_SIZE, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+	if (emu.mem == MAP_FAILED) {
+		emu.mem = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < GRSPW2_EMU_CORES; i++) {
+
+		emu.core[i].regs = grspw2_emu_alloc(sizeof(struct grspw2_regs),
+						    0x100);
+
+		emu.core[i].regs->ctrl = GRSPW2_EMU_CTRL_CAPS;
+	}
+
+	emu.running = 1;
+
+	return 0;
+}
+
+
+/**
+ * @brief release the emulated cores and all memory served to them
+ */
+
+void grspw2_emu_exit(void)
+{
+	if (!emu.running)
+		return;
+
+	munmap(emu.mem, GRSPW2_EMU_MEM_SIZE);
+
+	memset(&emu, 0, sizeof(emu));
+}
+
+
+/*
+ * platform functions used by the driver
+ */
+
+
+int irq_request(unsigned int irq,
+		__attribute__((unused)) enum isr_exec_priority priority,
+		irq_handler_t handler, void *data)
+{
+	size_t i;
+
+
+	if (irq >= GRSPW2_EMU_IRQS)
+		return -EINVAL;
+
+	for (i = 0; i < GRSPW2_EMU_IRQ_HANDLERS; i++) {
+
+		if (emu.irq[irq][i].handler)
+			continue;
+
+		emu.irq[irq][i].handler = handler;
+		emu.irq[irq][i].data    = data;
+
+		return 0;
+	}
+
+	return -EBUSY;
+}
+
+
+int irq_free(unsigned int irq, irq_handler_t handler, void *data)
+{
+	size_t i;
+
+
+	if (irq >= GRSPW2_EMU_IRQS)
+		return -EINVAL;
+
+	for (i = 0; i < GRSPW2_EMU_IRQ_HANDLERS; i++) {
+
+		if (emu.irq[irq][i].handler != handler)
+			continue;
+
+		if (emu.irq[irq][i].data != data)
+			continue;
+
+		emu.irq[irq][i].handler = NULL;
+		emu.irq[irq][i].data    = NULL;
+
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+
+/**
+ * @brief print messages up to warning level, strip the level header
+ */
+
+int printk(const char *fmt, ...)
+{
+	int ret;
+	va_list args;
+
+
+	if (fmt[0] == KERN_SOH_ASCII) {
+		if (fmt[1] > KERN_WARNING[1])
+			return 0;
+
+		fmt += 2;
+	}
+
+	va_start(args, fmt);
+	ret = vprintf(fmt, args);
+	va_end(args);
+
+	return ret;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file   grspw2_emu.h
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#ifndef GRSPW2_EMU_H
+#define GRSPW2_EMU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GRSPW2_EMU_CORES	6
+
+
+/**
+ * @brief the statistics of an emulated GRSPW2 core
+ */
+
+struct grspw2_emu_stats {
+	unsigned long tx_pkts;		/* packets sent */
+	unsigned long tx_bytes;		/* bytes sent */
+	unsigned long rx_pkts;		/* packets received */
+	unsigned long rx_bytes;		/* bytes received */
+	unsigned long rx_truncated;	/* packets exceeding the max. length */
+	unsigned long rx_discarded;	/* packets with a mismatching address */
+	unsigned long stalls;		/* transmissions held by the receiver */
+	unsigned long irqs;		/* interrupts raised */
+};
+
+
+int grspw2_emu_init(void);
+void grspw2_emu_exit(void);
+
+uint32_t grspw2_emu_get_regs(int idx);
+unsigned int grspw2_emu_get_irq(int idx);
+
+int grspw2_emu_connect(int a, int b);
+
+void *grspw2_emu_alloc(size_t size, size_t align);
+int grspw2_emu_is_mem(const void *ptr);
+
+unsigned int grspw2_emu_irq_dispatch(void);
+
+void grspw2_emu_get_stats(int idx, struct grspw2_emu_stats *st);
+
+uint64_t grspw2_emu_time_ns(void);
+
+uint8_t grspw2_emu_rmap_crc(uint8_t crc, const uint8_t *buf, uint32_t len);
+
+uint32_t grspw2_emu_ioread32be(const volatile void *addr);
+void grspw2_emu_iowrite32be(uint32_t val, volatile void *addr);
+
+#endif /* GRSPW2_EMU_H */
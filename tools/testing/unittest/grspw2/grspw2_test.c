@@ -0,0 +1,1398 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <kselftest.h>
+
+#include <grspw2_emu.h>
+
+/* include src file for static function testing */
+#include <grspw2.c>
+
+
+#define SPW_MTU		1024
+#define SPW_HDR_SIZE	32
+#define SPW_TBL_SIZE	GRSPW2_DESCRIPTOR_TABLE_SIZE
+
+#define SPW_RX_DESC	(SPW_TBL_SIZE / GRSPW2_RX_DESC_SIZE)
+#define SPW_TX_DESC	(SPW_TBL_SIZE / GRSPW2_TX_DESC_SIZE)
+
+/* the AHB error interrupts are never raised by the emulator */
+#define SPW_AHB_IRQ(x)	(40 + (x))
+
+#define SPW_NODE(x)	(0x20 + (x))
+
+#define BENCH_PKTS	200000
+#define BENCH_PKT_SIZE	256
+#define BENCH_BATCH	32
+
+
+static struct grspw2_core_cfg spw[GRSPW2_EMU_CORES];
+
+static unsigned long tx_done_cnt;
+static unsigned long tx_done_last;
+
+static uint32_t rmap_written_off;
+static uint32_t rmap_written_len;
+
+static unsigned long yield_cnt;
+
+
+/* needed dummy functions */
+
+void *kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void *kzalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+/* DMA-capable memory must be reachable by the emulated cores */
+void *kpalloc(size_t size)
+{
+	return grspw2_emu_alloc(size, 8);
+}
+
+void kfree(void *ptr)
+{
+	if (grspw2_emu_is_mem(ptr))
+		return;
+
+	free(ptr);
+}
+
+ktime ktime_get(void)
+{
+	return (ktime) grspw2_emu_time_ns();
+}
+
+int64_t ktime_us_delta(const ktime later, const ktime earlier)
+{
+	return (later - earlier) / 1000;
+}
+
+/* a yielding thread gives the emulated cores a chance to interrupt */
+void sched_yield(void)
+{
+	yield_cnt++;
+	grspw2_emu_irq_dispatch();
+}
+
+
+/**
+ * @brief set up an emulated core with a full set of descriptors
+ */
+
+static int spw_test_core_init(int idx)
+{
+	struct grspw2_core_cfg *cfg = &spw[idx];
+
+
+	if (grspw2_core_init(cfg, grspw2_emu_get_regs(idx), SPW_NODE(idx),
+			     10, 10, SPW_MTU, grspw2_emu_get_irq(idx),
+			     SPW_AHB_IRQ(idx), 0))
+		return -1;
+
+	if (grspw2_rx_desc_table_init(cfg,
+				      grspw2_emu_alloc(SPW_TBL_SIZE,
+						       SPW_TBL_SIZE),
+				      SPW_TBL_SIZE,
+				      grspw2_emu_alloc(SPW_RX_DESC * SPW_MTU, 4),
+				      SPW_MTU))
+		return -1;
+
+	if (grspw2_tx_desc_table_init(cfg,
+				      grspw2_emu_alloc(SPW_TBL_SIZE,
+						       SPW_TBL_SIZE),
+				      SPW_TBL_SIZE,
+				      grspw2_emu_alloc(SPW_TX_DESC
+						       * SPW_HDR_SIZE, 4),
+				      SPW_HDR_SIZE,
+				      grspw2_emu_alloc(SPW_TX_DESC * SPW_MTU, 4),
+				      SPW_MTU))
+		return -1;
+
+	grspw2_core_start(cfg, 1, 1);
+
+	return 0;
+}
+
+
+/**
+ * @brief fill a packet with a sequence number and a pattern
+ */
+
+static void spw_test_fill(uint8_t *buf, uint32_t size, uint8_t addr,
+			  uint32_t seq)
+{
+	uint32_t i;
+
+
+	buf[0] = addr;
+
+	for (i = 1; i < size; i++)
+		buf[i] = (seq + i) & 0xff;
+
+	if (size >= 8)
+		memcpy(&buf[4], &seq, sizeof(seq));
+}
+
+
+/**
+ * @brief get the sequence number of a packet
+ */
+
+static uint32_t spw_test_seq(const uint8_t *buf)
+{
+	uint32_t seq;
+
+
+	memcpy(&seq, &buf[4], sizeof(seq));
+
+	return seq;
+}
+
+
+/**
+ * @brief send a packet with a sequence number from one core to another
+ */
+
+static int32_t spw_test_send(int from, int to, uint32_t seq, uint32_t size)
+{
+	uint8_t buf[SPW_MTU];
+
+
+	spw_test_fill(buf, size, SPW_NODE(to), seq);
+
+	return grspw2_add_pkt(&spw[from], NULL, 0, buf, size);
+}
+
+
+/**
+ * @brief drop all pending packets of a core
+ */
+
+static void spw_test_drain(int idx)
+{
+	while (grspw2_drop_pkt(&spw[idx]));
+}
+
+
+static void spw_test_tx_done(struct grspw2_core_cfg *cfg,
+			     void *cookie, void *userdata)
+{
+	tx_done_cnt++;
+	tx_done_last = (unsigned long) cookie;
+}
+
+
+static void spw_test_rmap_written(struct grspw2_rmap_window *win,
+				  uint32_t offset, uint32_t len,
+				  void *userdata)
+{
+	rmap_written_off = offset;
+	rmap_written_len = len;
+}
+
+
+/**
+ * @brief build an RMAP command header from core 0 to core 1
+ *
+ * @param reply the reply address, 4 * ral bytes
+ *
+ * @returns the size of the header, excluding the CRC
+ */
+
+static uint32_t spw_test_rmap_cmd(uint8_t *hdr, uint8_t ins, uint8_t key,
+				  const uint8_t *reply, uint32_t ral,
+				  uint16_t tid, uint32_t addr, uint32_t len)
+{
+	uint8_t *p = hdr;
+
+
+	*p++ = SPW_NODE(1);
+	*p++ = GRSPW2_RMAP_PROTOCOL_ID;
+	*p++ = GRSPW2_RMAP_INS_CMD | ins | ral;
+	*p++ = key;
+
+	if (ral)
+		memcpy(p, reply, 4 * ral);
+	p += 4 * ral;
+
+	*p++ = SPW_NODE(0);
+	*p++ = tid >> 8;
+	*p++ = tid & 0xFF;
+	*p++ = 0;
+	*p++ = addr >> 24;
+	*p++ = addr >> 16;
+	*p++ = addr >>  8;
+	*p++ = addr;
+	*p++ = len >> 16;
+	*p++ = len >>  8;
+	*p++ = len;
+
+	return p - hdr;
+}
+
+
+/* tests */
+
+
+/*
+ * @test grspw2_init_test
+ */
+
+static void grspw2_init_test(void)
+{
+	int i;
+
+
+	KSFT_ASSERT(grspw2_emu_init() == 0);
+
+	for (i = 0; i < GRSPW2_EMU_CORES; i++)
+		KSFT_ASSERT(spw_test_core_init(i) == 0);
+
+	/* all RX descriptors are handed to the core */
+	KSFT_ASSERT(grspw2_get_num_free_rx_desc_avail(&spw[0]) == 0);
+	KSFT_ASSERT(grspw2_get_num_free_tx_desc_avail(&spw[0]) == SPW_TX_DESC);
+	KSFT_ASSERT(spw[0].rx_n_desc == SPW_RX_DESC);
+
+	KSFT_ASSERT((spw[1].regs->nodeaddr & 0xff) == SPW_NODE(1));
+	KSFT_ASSERT(spw[1].regs->dma[0].rx_max_pkt_len == SPW_MTU);
+	KSFT_ASSERT(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_RE);
+	KSFT_ASSERT(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_NS);
+
+	KSFT_ASSERT(grspw2_get_link_status(&spw[0])
+		    != GRSPW2_STATUS_LS_RUN);
+
+	for (i = 0; i < GRSPW2_EMU_CORES; i += 2)
+		KSFT_ASSERT(grspw2_emu_connect(i, i + 1) == 0);
+
+	KSFT_ASSERT(grspw2_get_link_status(&spw[0]) == GRSPW2_STATUS_LS_RUN);
+}
+
+
+/*
+ * @test grspw2_loopback_test
+ */
+
+static void grspw2_loopback_test(void)
+{
+	uint8_t hdr[SPW_HDR_SIZE];
+	uint8_t data[SPW_MTU];
+	uint8_t pkt[SPW_MTU];
+
+	struct grspw2_emu_stats st;
+
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 0);
+
+	/* header and data are sent as one packet */
+	spw_test_fill(hdr, sizeof(hdr), SPW_NODE(1), 1);
+	spw_test_fill(data, 100, 0xaa, 2);
+
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], hdr, sizeof(hdr), data, 100) == 0);
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 1);
+	KSFT_ASSERT(grspw2_get_next_pkt_size(&spw[1]) == sizeof(hdr) + 100);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == sizeof(hdr) + 100);
+	KSFT_ASSERT(!memcmp(pkt, hdr, sizeof(hdr)));
+	KSFT_ASSERT(!memcmp(&pkt[sizeof(hdr)], data, 100));
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == 0);
+
+	/* and the other way around */
+	KSFT_ASSERT(spw_test_send(1, 0, 3, 64) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 3);
+
+	/* not addressed to the receiver */
+	spw_test_fill(data, 64, SPW_NODE(4), 4);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 64) == 0);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 0);
+	KSFT_ASSERT(spw[1].regs->status & GRSPW2_STATUS_IA);
+
+	grspw2_emu_get_stats(1, &st);
+	KSFT_ASSERT(st.rx_discarded == 1);
+
+	/* exceeds the maximum receive length */
+	spw_test_fill(data, SPW_MTU, SPW_NODE(1), 5);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], hdr, 4, data, SPW_MTU) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == SPW_MTU);
+
+	grspw2_emu_get_stats(1, &st);
+	KSFT_ASSERT(st.rx_truncated == 1);
+}
+
+
+/*
+ * @test grspw2_ring_test
+ *
+ * @note move packets in bursts that do not divide the ring sizes, so the
+ *	 descriptor rings wrap at different positions
+ */
+
+static void grspw2_ring_test(void)
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t seq = 0;
+
+	uint8_t pkt[SPW_MTU];
+
+	struct grspw2_emu_stats st0;
+	struct grspw2_emu_stats st1;
+
+
+	grspw2_emu_get_stats(0, &st0);
+
+	for (i = 0; i < 50; i++) {
+
+		for (j = 0; j < 23; j++)
+			KSFT_ASSERT(spw_test_send(0, 1, seq + j, 32 + j) == 0);
+
+		KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 23);
+
+		for (j = 0; j < 23; j++) {
+			KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == 32 + j);
+			KSFT_ASSERT(spw_test_seq(pkt) == seq + j);
+		}
+
+		seq += 23;
+	}
+
+	grspw2_emu_get_stats(0, &st1);
+	KSFT_ASSERT(st1.tx_pkts - st0.tx_pkts == seq);
+	KSFT_ASSERT(grspw2_get_num_free_rx_desc_avail(&spw[1]) == 0);
+}
+
+
+/*
+ * @test grspw2_backpressure_test
+ */
+
+static void grspw2_backpressure_test(void)
+{
+	uint32_t n = 0;
+	uint32_t i;
+
+	uint8_t pkt[SPW_MTU];
+
+	struct grspw2_emu_stats st;
+
+
+	/* the receiver holds as many packets as it has RX descriptors, the
+	 * remainder stays in the TX descriptors of the sender
+	 */
+	while (!spw_test_send(0, 1, n, 64))
+		n++;
+
+	KSFT_ASSERT(n == SPW_RX_DESC + SPW_TX_DESC);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == SPW_RX_DESC);
+
+	grspw2_emu_get_stats(0, &st);
+	KSFT_ASSERT(st.stalls >= 1);
+
+	for (i = 0; i < n; i++) {
+		KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == 64);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+	}
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 0);
+	KSFT_ASSERT(grspw2_tx_reclaim(&spw[0]) == SPW_TX_DESC);
+}
+
+
+/*
+ * @test grspw2_batch_test
+ */
+
+static void grspw2_batch_test(void)
+{
+	uint32_t i;
+
+	uint8_t data[BENCH_BATCH][SPW_MTU];
+	uint8_t *pkt;
+
+	struct grspw2_pkt_vec iov[BENCH_BATCH];
+	struct grspw2_pkt_buf buf[BENCH_BATCH];
+
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		spw_test_fill(data[i], 64 + i, SPW_NODE(1), i);
+
+		iov[i].hdr       = NULL;
+		iov[i].hdr_size  = 0;
+		iov[i].data      = data[i];
+		iov[i].data_size = 64 + i;
+	}
+
+	KSFT_ASSERT(grspw2_add_pkts(&spw[0], iov, BENCH_BATCH) == BENCH_BATCH);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == BENCH_BATCH);
+
+	pkt = malloc(BENCH_BATCH * SPW_MTU);
+	KSFT_ASSERT_PTR_NOT_NULL(pkt);
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		buf[i].pkt  = &pkt[i * SPW_MTU];
+		buf[i].size = SPW_MTU;
+		buf[i].len  = 0;
+	}
+
+	/* stops at a packet that does not fit */
+	buf[10].size = 16;
+	KSFT_ASSERT(grspw2_get_pkts(&spw[1], buf, BENCH_BATCH) == 10);
+	buf[10].size = SPW_MTU;
+
+	KSFT_ASSERT(grspw2_get_pkts(&spw[1], &buf[10], BENCH_BATCH - 10)
+		    == BENCH_BATCH - 10);
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		KSFT_ASSERT(buf[i].len == 64 + i);
+		KSFT_ASSERT(!memcmp(buf[i].pkt, data[i], buf[i].len));
+	}
+
+	KSFT_ASSERT(grspw2_get_pkts(&spw[1], buf, BENCH_BATCH) == 0);
+
+	free(pkt);
+}
+
+
+/*
+ * @test grspw2_zero_copy_test
+ */
+
+static void grspw2_zero_copy_test(void)
+{
+	unsigned long i;
+
+	uint8_t *data;
+	uint8_t *pool;
+	uint8_t *pkt[4];
+	uint8_t buf[SPW_MTU];
+	uint32_t pkt_size;
+	uint32_t addr;
+
+
+	data = grspw2_emu_alloc(8 * 64, 4);
+	KSFT_ASSERT_PTR_NOT_NULL(data);
+
+	grspw2_set_tx_done_callback(&spw[0], spw_test_tx_done, NULL);
+
+	tx_done_cnt = 0;
+
+	for (i = 0; i < 8; i++) {
+		spw_test_fill(&data[i * 64], 64, SPW_NODE(1), i);
+		KSFT_ASSERT(grspw2_add_pkt_ref(&spw[0], NULL, 0,
+					       &data[i * 64], 64,
+					       (void *) (i + 1)) == 0);
+	}
+
+	/* the emulated transfers complete immediately, so each new packet
+	 * reclaims the one before, the last is released explicitly
+	 */
+	KSFT_ASSERT(tx_done_cnt == 7);
+	KSFT_ASSERT(grspw2_tx_reclaim(&spw[0]) == 1);
+	KSFT_ASSERT(tx_done_cnt == 8);
+	KSFT_ASSERT(tx_done_last == 8);
+
+	grspw2_set_tx_done_callback(&spw[0], NULL, NULL);
+
+	/* the received packets are loaned without copying */
+	pool = grspw2_emu_alloc(4 * SPW_MTU, 4);
+	KSFT_ASSERT(grspw2_rx_spare_pool_init(&spw[1], pool, SPW_MTU - 1, 4)
+		    == -1);
+	KSFT_ASSERT(grspw2_rx_spare_pool_init(&spw[1], pool, SPW_MTU, 4) == 0);
+
+	for (i = 0; i < 4; i++) {
+		pkt[i] = grspw2_loan_pkt(&spw[1], &pkt_size);
+		KSFT_ASSERT_PTR_NOT_NULL(pkt[i]);
+		KSFT_ASSERT(pkt_size == 64);
+		KSFT_ASSERT(spw_test_seq(pkt[i]) == i);
+	}
+
+	/* spare pool exhausted */
+	KSFT_ASSERT_PTR_NULL(grspw2_loan_pkt(&spw[1], &pkt_size));
+
+	/* foreign and misaligned buffers are refused */
+	KSFT_ASSERT(grspw2_return_pkt(&spw[1], buf) == -1);
+	KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[0] + 1) == -1);
+
+	/* as are the buffers the descriptors still receive into */
+	for (i = 0; i < SPW_RX_DESC; i++) {
+		addr = spw[1].rx_desc_ring[i].desc->pkt_addr
+		       + spw[1].strip_hdr_bytes;
+		KSFT_ASSERT(grspw2_return_pkt(&spw[1], (void *) addr) == -1);
+	}
+
+	for (i = 0; i < 4; i++)
+		KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[i]) == 0);
+
+	for (i = 4; i < 8; i++) {
+		pkt[0] = grspw2_loan_pkt(&spw[1], &pkt_size);
+		KSFT_ASSERT_PTR_NOT_NULL(pkt[0]);
+		KSFT_ASSERT(spw_test_seq(pkt[0]) == i);
+		KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[0]) == 0);
+	}
+
+	/* as is a buffer returned twice */
+	for (i = 0; i < 2; i++) {
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+		pkt[i] = grspw2_loan_pkt(&spw[1], &pkt_size);
+		KSFT_ASSERT_PTR_NOT_NULL(pkt[i]);
+	}
+
+	KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[0]) == 0);
+	KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[0]) == -1);
+	KSFT_ASSERT(grspw2_return_pkt(&spw[1], pkt[1]) == 0);
+
+	KSFT_ASSERT(spw[1].rx_spare.n == spw[1].rx_spare.n_max);
+
+	/* the ring still works with the swapped buffers */
+	for (i = 0; i < 2 * SPW_RX_DESC; i++) {
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+		KSFT_ASSERT(grspw2_get_pkt(&spw[1], buf) == 64);
+		KSFT_ASSERT(spw_test_seq(buf) == i);
+	}
+}
+
+
+/*
+ * @test grspw2_rx_irq_test
+ */
+
+static void grspw2_rx_irq_test(void)
+{
+	uint32_t i;
+
+	uint8_t pkt[SPW_MTU];
+	uint8_t data[10][SPW_MTU];
+
+	struct grspw2_pkt_buf buf[10];
+
+	struct grspw2_emu_stats st0;
+	struct grspw2_emu_stats st1;
+
+
+	spw_test_drain(1);
+
+	KSFT_ASSERT(grspw2_rx_irq_enable(&spw[1], 8, 0) == 0);
+	KSFT_ASSERT(grspw2_rx_irq_enable(&spw[1], 8, 0) == -1);
+
+	grspw2_emu_get_stats(1, &st0);
+
+	for (i = 0; i < 20; i++)
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+
+	/* one interrupt per 8 packets */
+	grspw2_emu_get_stats(1, &st1);
+	KSFT_ASSERT(st1.irqs - st0.irqs == 2);
+
+	KSFT_ASSERT(spw[1].rx_irq.n == 0);
+	KSFT_ASSERT(grspw2_emu_irq_dispatch() == 1);
+	KSFT_ASSERT(spw[1].rx_irq.n == 20);
+
+	for (i = 0; i < 20; i++) {
+		KSFT_ASSERT(grspw2_recv(&spw[1], pkt, 1000) == 64);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+	}
+
+	KSFT_ASSERT(spw[1].rx_irq.n == 0);
+
+	/* times out */
+	KSFT_ASSERT(grspw2_recv(&spw[1], pkt, 1000) == 0);
+
+	/* fetching from a full table lets the stalled sender complete more
+	 * packets while the interrupt is masked, these are picked up without
+	 * waiting for another interrupt
+	 */
+	for (i = 0; i < SPW_RX_DESC + 8; i++)
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+
+	KSFT_ASSERT(grspw2_emu_irq_dispatch() == 1);
+	KSFT_ASSERT(spw[1].rx_irq.n == SPW_RX_DESC);
+
+	yield_cnt = 0;
+
+	for (i = 0; i < SPW_RX_DESC + 8; i++) {
+		KSFT_ASSERT(grspw2_recv(&spw[1], pkt, 1000) == 64);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+	}
+
+	KSFT_ASSERT(yield_cnt == 0);
+	KSFT_ASSERT(spw[1].rx_irq.n == 0);
+	KSFT_ASSERT(grspw2_emu_irq_dispatch() == 0);
+
+	grspw2_tx_reclaim(&spw[0]);
+
+	/* a partial batch is picked up after the coalescing timeout */
+	KSFT_ASSERT(grspw2_rx_irq_disable(&spw[1]) == 0);
+	KSFT_ASSERT(grspw2_rx_irq_enable(&spw[1], 8, 100) == 0);
+
+	KSFT_ASSERT(spw_test_send(0, 1, 42, 64) == 0);
+	KSFT_ASSERT(grspw2_emu_irq_dispatch() == 0);
+	KSFT_ASSERT(grspw2_recv(&spw[1], pkt, 0) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 42);
+
+	KSFT_ASSERT(grspw2_rx_irq_disable(&spw[1]) == 0);
+
+	/* a batch fetch updates the number of pending packets */
+	KSFT_ASSERT(grspw2_rx_irq_enable(&spw[1], 8, 0) == 0);
+
+	for (i = 0; i < 10; i++) {
+		buf[i].pkt  = data[i];
+		buf[i].size = SPW_MTU;
+		buf[i].len  = 0;
+	}
+
+	for (i = 0; i < 20; i++)
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+
+	KSFT_ASSERT(grspw2_emu_irq_dispatch() == 1);
+	KSFT_ASSERT(spw[1].rx_irq.n == 20);
+
+	KSFT_ASSERT(grspw2_get_pkts(&spw[1], buf, 10) == 10);
+	KSFT_ASSERT(spw[1].rx_irq.n == 10);
+	KSFT_ASSERT(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_RI);
+
+	KSFT_ASSERT(grspw2_get_pkts(&spw[1], buf, 10) == 10);
+	KSFT_ASSERT(spw[1].rx_irq.n == 0);
+	KSFT_ASSERT(spw_test_seq(buf[9].pkt) == 19);
+
+	KSFT_ASSERT(grspw2_rx_irq_disable(&spw[1]) == 0);
+
+	grspw2_tx_reclaim(&spw[0]);
+
+	/* polling does not mask an RX interrupt enabled by someone else */
+	grspw2_rx_interrupt_enable(&spw[1]);
+
+	KSFT_ASSERT(spw_test_send(0, 1, 43, 64) == 0);
+	KSFT_ASSERT(grspw2_recv(&spw[1], pkt, 1000) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 43);
+	KSFT_ASSERT(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_RI);
+
+	grspw2_rx_interrupt_disable(&spw[1]);
+}
+
+
+/*
+ * @test grspw2_auto_drop_test
+ */
+
+static void grspw2_auto_drop_test(void)
+{
+	uint32_t i;
+	uint32_t n = 0;
+	uint32_t seq = 0;
+
+	uint8_t pkt[SPW_MTU];
+
+	struct grspw2_emu_stats st0;
+	struct grspw2_emu_stats st1;
+
+
+	spw_test_drain(1);
+	grspw2_tx_reclaim(&spw[0]);
+
+	grspw2_emu_get_stats(0, &st0);
+
+	KSFT_ASSERT(grspw2_auto_drop_enable(&spw[1], 16) == 0);
+
+	/* the receiver is never read, the oldest packets are dropped */
+	for (i = 0; i < 1000; i++) {
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+		grspw2_emu_irq_dispatch();
+	}
+
+	grspw2_emu_get_stats(0, &st1);
+	KSFT_ASSERT(st1.tx_pkts - st0.tx_pkts == 1000);
+
+	KSFT_ASSERT(grspw2_auto_drop_disable(&spw[1]) == 0);
+
+	while (grspw2_get_pkt(&spw[1], pkt)) {
+		KSFT_ASSERT(!n || spw_test_seq(pkt) == seq + 1);
+		seq = spw_test_seq(pkt);
+		n++;
+	}
+
+	KSFT_ASSERT(n > 0);
+	KSFT_ASSERT(n < SPW_RX_DESC);
+	KSFT_ASSERT(seq == 999);
+}
+
+
+/*
+ * @test grspw2_stats_test
+ */
+
+static void grspw2_stats_test(void)
+{
+	uint32_t i;
+	uint32_t n = 0;
+
+	uint8_t pkt[SPW_MTU];
+
+
+	spw_test_drain(1);
+	grspw2_tx_reclaim(&spw[0]);
+
+	memset(&spw[0].stats, 0, sizeof(spw[0].stats));
+	memset(&spw[1].stats, 0, sizeof(spw[1].stats));
+
+	for (i = 0; i < 10; i++)
+		KSFT_ASSERT(spw_test_send(0, 1, i, 64) == 0);
+
+	KSFT_ASSERT(spw[0].stats.tx_pkts == 10);
+	KSFT_ASSERT(spw[0].stats.tx_desc_hwm == 1);
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 10);
+	KSFT_ASSERT(spw[1].stats.rx_desc_hwm == 10);
+
+	KSFT_ASSERT(grspw2_drop_pkt(&spw[1]) == 1);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == 64);
+	KSFT_ASSERT(spw[1].stats.rx_pkts == 2);
+	KSFT_ASSERT(spw[1].stats.rx_dropped == 1);
+
+	spw_test_drain(1);
+	KSFT_ASSERT(spw[1].stats.rx_pkts == 10);
+	KSFT_ASSERT(spw[1].stats.rx_dropped == 9);
+
+	/* exceeds the maximum receive length */
+	KSFT_ASSERT(spw_test_send(0, 1, 10, SPW_MTU) == 0);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], pkt, 16, pkt, SPW_MTU) == 0);
+	spw_test_drain(1);
+	KSFT_ASSERT(spw[1].stats.rx_truncated == 1);
+
+	/* the TX ring fills up once the receiver is full */
+	while (!spw_test_send(0, 1, n, 64))
+		n++;
+
+	KSFT_ASSERT(spw[0].stats.tx_desc_unavail == 1);
+	KSFT_ASSERT(spw[0].stats.tx_desc_hwm == SPW_TX_DESC);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == SPW_RX_DESC);
+	KSFT_ASSERT(spw[1].stats.rx_desc_hwm == SPW_RX_DESC);
+
+	spw_test_drain(1);
+	spw_test_drain(1);
+	grspw2_tx_reclaim(&spw[0]);
+
+	/* link errors, the emulator does not raise these on its own */
+	spw[1].regs->status |= GRSPW2_STATUS_IA | GRSPW2_STATUS_CE
+			       | GRSPW2_STATUS_PE | GRSPW2_STATUS_TO;
+
+	grspw2_link_error(0, &spw[1]);
+
+	KSFT_ASSERT(spw[1].stats.err_invalid_addr == 1);
+	KSFT_ASSERT(spw[1].stats.err_credit == 1);
+	KSFT_ASSERT(spw[1].stats.err_parity == 1);
+	KSFT_ASSERT(spw[1].stats.err_escape == 0);
+	KSFT_ASSERT(spw[1].stats.err_disconnect == 0);
+	KSFT_ASSERT(!(spw[1].regs->status & GRSPW2_STATUS_CE));
+
+	grspw2_link_error(0, &spw[1]);
+	KSFT_ASSERT(spw[1].stats.err_credit == 1);
+}
+
+
+/*
+ * @test grspw2_rmap_test
+ */
+
+static void grspw2_rmap_test(void)
+{
+	uint32_t i;
+	uint32_t n;
+
+	uint8_t hdr[SPW_HDR_SIZE];
+	uint8_t data[16];
+	uint8_t pkt[SPW_MTU];
+	uint8_t reply[4] = {0, 0, 0x05, 0x06};
+
+	uint8_t *mem;
+
+	struct grspw2_rmap_target *tgt;
+
+	const uint8_t wr = GRSPW2_RMAP_INS_WRITE | GRSPW2_RMAP_INS_VERIFY
+			   | GRSPW2_RMAP_INS_REPLY | GRSPW2_RMAP_INS_INC;
+	const uint8_t rd = GRSPW2_RMAP_INS_REPLY | GRSPW2_RMAP_INS_INC;
+	const uint8_t rmw = GRSPW2_RMAP_INS_VERIFY | GRSPW2_RMAP_INS_REPLY
+			    | GRSPW2_RMAP_INS_INC;
+
+
+	spw_test_drain(0);
+	spw_test_drain(1);
+
+	/* the reply headers are sent by reference */
+	tgt = grspw2_emu_alloc(sizeof(struct grspw2_rmap_target), 4);
+	mem = grspw2_emu_alloc(64, 4);
+	KSFT_ASSERT_PTR_NOT_NULL(tgt);
+	KSFT_ASSERT_PTR_NOT_NULL(mem);
+
+	memset(mem, 0, 64);
+
+	KSFT_ASSERT(grspw2_rmap_target_init(tgt, &spw[1], SPW_NODE(1),
+					    0x20) == 0);
+	KSFT_ASSERT(grspw2_rmap_target_add_window(tgt, 0, 0x1000, mem, 64,
+						  GRSPW2_RMAP_ACC_READ
+						  | GRSPW2_RMAP_ACC_WRITE
+						  | GRSPW2_RMAP_ACC_RMW,
+						  spw_test_rmap_written,
+						  NULL) == 0);
+	KSFT_ASSERT(grspw2_rmap_target_add_window(tgt, 0, 0xFFFFFFF0, mem,
+						  64, GRSPW2_RMAP_ACC_READ,
+						  NULL, NULL) == -1);
+
+	for (i = 0; i < 8; i++)
+		data[i] = i + 1;
+
+	/* write */
+	n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, 0x1234, 0x1008, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(memcmp(&mem[8], data, 8) == 0);
+	KSFT_ASSERT(rmap_written_off == 8);
+	KSFT_ASSERT(rmap_written_len == 8);
+	KSFT_ASSERT(tgt->writes == 1);
+
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+	KSFT_ASSERT(pkt[0] == SPW_NODE(0));
+	KSFT_ASSERT(pkt[1] == GRSPW2_RMAP_PROTOCOL_ID);
+	KSFT_ASSERT(pkt[2] == (wr & ~GRSPW2_RMAP_INS_CMD));
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_SUCCESS);
+	KSFT_ASSERT(pkt[4] == SPW_NODE(1));
+	KSFT_ASSERT(pkt[5] == 0x12 && pkt[6] == 0x34);
+	KSFT_ASSERT(grspw2_emu_rmap_crc(0, pkt, 8) == 0);
+
+	/* read, the data is sent from the window */
+	n = spw_test_rmap_cmd(hdr, rd, 0x20, NULL, 0, 1, 0x1008, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, NULL, 0) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(tgt->reads == 1);
+
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 12 + 8 + 1);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_SUCCESS);
+	KSFT_ASSERT(pkt[10] == 8);
+	KSFT_ASSERT(grspw2_emu_rmap_crc(0, pkt, 12) == 0);
+	KSFT_ASSERT(memcmp(&pkt[12], data, 8) == 0);
+	KSFT_ASSERT(grspw2_emu_rmap_crc(0, &pkt[12], 9) == 0);
+
+	/* read-modify-write, the original data is returned */
+	memcpy(&data[8], "\xF0\xF0\xF0\xF0\x0F\x0F\x0F\x0F", 8);
+	data[12] = 0xFF;
+	data[13] = 0xFF;
+	data[14] = 0x00;
+	data[15] = 0x00;
+
+	n = spw_test_rmap_cmd(hdr, rmw, 0x20, NULL, 0, 2, 0x1008, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, &data[8], 8) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(tgt->rmws == 1);
+	KSFT_ASSERT(mem[8] == 0xF0 && mem[9] == 0xF0);
+	KSFT_ASSERT(mem[10] == 3 && mem[11] == 4);
+	KSFT_ASSERT(rmap_written_len == 4);
+
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 12 + 4 + 1);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_SUCCESS);
+	KSFT_ASSERT(memcmp(&pkt[12], data, 4) == 0);
+	KSFT_ASSERT(grspw2_emu_rmap_crc(0, &pkt[12], 5) == 0);
+
+	/* bad key */
+	n = spw_test_rmap_cmd(hdr, wr, 0x21, NULL, 0, 3, 0x1000, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(mem[0] == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_ERR_KEY);
+
+	/* outside of the window */
+	n = spw_test_rmap_cmd(hdr, rd, 0x20, NULL, 0, 4, 0x1038, 16);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, NULL, 0) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 12);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_ERR_AUTH);
+	KSFT_ASSERT(pkt[10] == 0);
+
+	/* RMW of more than 4 bytes */
+	n = spw_test_rmap_cmd(hdr, rmw, 0x20, NULL, 0, 5, 0x1000, 10);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 10) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 12);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_ERR_RMW_LEN);
+
+	KSFT_ASSERT(tgt->errors == 3);
+
+	/* corrupt data CRC, assembled by hand */
+	n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, 6, 0x1000, 8);
+	hdr[n] = grspw2_emu_rmap_crc(0, hdr, n);
+	memcpy(pkt, data, 8);
+	pkt[8] = grspw2_emu_rmap_crc(0, data, 8) ^ 0x1;
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], hdr, n + 1, pkt, 9) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(mem[0] == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+	KSFT_ASSERT(pkt[3] == GRSPW2_RMAP_ERR_DATA_CRC);
+
+	/* corrupt header CRC, dropped without a reply */
+	n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, 7, 0x1000, 8);
+	hdr[n] = grspw2_emu_rmap_crc(0, hdr, n) ^ 0x1;
+	pkt[8] = grspw2_emu_rmap_crc(0, data, 8);
+	memcpy(pkt, data, 8);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], hdr, n + 1, pkt, 9) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(tgt->discarded == 1);
+	KSFT_ASSERT(mem[0] == 0);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[0]) == 0);
+
+	/* other traffic stops processing and stays in order */
+	KSFT_ASSERT(spw_test_send(0, 1, 42, 64) == 0);
+	n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, 8, 0x1000, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[1], pkt) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 42);
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(memcmp(mem, data, 8) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+
+	/* a reply address with leading zeros and a path, the path bytes
+	 * are not covered by the header CRC
+	 */
+	grspw2_set_promiscuous(&spw[0]);
+
+	n = spw_test_rmap_cmd(hdr, wr, 0x20, reply, 1, 9, 0x1000, 8);
+	KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+	KSFT_ASSERT(grspw2_rmap_target_poll(tgt) == 1);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 2 + 8);
+	KSFT_ASSERT(pkt[0] == 0x05 && pkt[1] == 0x06);
+	KSFT_ASSERT(pkt[2] == SPW_NODE(0));
+	KSFT_ASSERT(grspw2_emu_rmap_crc(0, &pkt[2], 8) == 0);
+
+	grspw2_unset_promiscuous(&spw[0]);
+
+	/* interrupt mode */
+	KSFT_ASSERT(grspw2_rmap_target_enable_irq(tgt) == 0);
+
+	for (i = 0; i < 100; i++) {
+
+		data[0] = i;
+
+		n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, i, 0x1000, 8);
+		KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+		grspw2_emu_irq_dispatch();
+
+		KSFT_ASSERT(mem[0] == i);
+		KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+		KSFT_ASSERT(pkt[6] == i);
+	}
+
+	/* the replies are not picked up, so the target stalls on its TX
+	 * ring and resumes once a reply was sent
+	 */
+	for (i = 0; i < SPW_RX_DESC + SPW_TX_DESC + 16; i++) {
+
+		n = spw_test_rmap_cmd(hdr, wr, 0x20, NULL, 0, i, 0x1000, 8);
+		KSFT_ASSERT(grspw2_add_rmap(&spw[0], hdr, n, 0, data, 8) == 0);
+
+		grspw2_emu_irq_dispatch();
+	}
+
+	KSFT_ASSERT(tgt->stalled > 0);
+	KSFT_ASSERT(tgt->waiting);
+
+	for (i = 0; i < SPW_RX_DESC + SPW_TX_DESC + 16; i++) {
+		KSFT_ASSERT(grspw2_get_pkt(&spw[0], pkt) == 8);
+		KSFT_ASSERT(((pkt[5] << 8) | pkt[6]) == i);
+		grspw2_emu_irq_dispatch();
+	}
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[1]) == 0);
+	KSFT_ASSERT(!tgt->waiting);
+	KSFT_ASSERT(!(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_TI));
+
+	KSFT_ASSERT(grspw2_rmap_target_disable_irq(tgt) == 0);
+	KSFT_ASSERT(tgt->writes == 103 + SPW_RX_DESC + SPW_TX_DESC + 16);
+
+	/* the replies do not execute the tx_done callback */
+	grspw2_set_tx_done_callback(&spw[1], spw_test_tx_done, NULL);
+	tx_done_cnt = 0;
+
+	grspw2_tx_reclaim(&spw[1]);
+	KSFT_ASSERT(tx_done_cnt == 0);
+
+	grspw2_set_tx_done_callback(&spw[1], NULL, NULL);
+}
+
+
+/*
+ * @test grspw2_ring_cfg_test
+ */
+
+static void grspw2_ring_cfg_test(void)
+{
+	uint32_t i;
+
+	uint8_t pkt[SPW_MTU];
+
+	struct grspw2_ring_cfg ring;
+	struct grspw2_ring_cfg orig;
+
+
+	orig = spw[3].ring;
+
+	KSFT_ASSERT(orig.rx_desc == SPW_RX_DESC);
+	KSFT_ASSERT(orig.tx_desc == SPW_TX_DESC);
+	KSFT_ASSERT(orig.rx_mtu == SPW_MTU);
+	KSFT_ASSERT(orig.tx_mtu == SPW_MTU);
+	KSFT_ASSERT(orig.tx_hdr_size == SPW_HDR_SIZE);
+
+	ring.rx_desc     = 16;
+	ring.tx_desc     = 4;
+	ring.rx_mtu      = 256;
+	ring.tx_mtu      = 128;
+	ring.tx_hdr_size = 4;
+
+	/* the cores are running */
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &ring) == -1);
+
+	grspw2_core_stop(&spw[2]);
+	grspw2_core_stop(&spw[3]);
+
+	ring.rx_desc = SPW_RX_DESC + 1;
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &ring) == -1);
+	ring.rx_desc = 16;
+
+	ring.tx_hdr_size = 256;
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &ring) == -1);
+	ring.tx_hdr_size = 4;
+
+	KSFT_ASSERT(grspw2_core_alloc(&spw[2], &ring) == 0);
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &ring) == 0);
+
+	KSFT_ASSERT(spw[3].rx_n_desc == 16);
+	KSFT_ASSERT(spw[3].tx_n_desc == 4);
+	KSFT_ASSERT(spw[3].regs->dma[0].rx_max_pkt_len == 256);
+	KSFT_ASSERT(!(spw[3].regs->dma[0].rx_desc_table_addr
+		      & GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN));
+	KSFT_ASSERT(!(spw[3].regs->dma[0].tx_desc_table_addr
+		      & GRSPW2_DESCRIPTOR_TABLE_MEM_BLOCK_ALIGN));
+
+	grspw2_core_start(&spw[2], 1, 1);
+	grspw2_core_start(&spw[3], 1, 1);
+
+	/* exceeds the TX buffers */
+	KSFT_ASSERT(spw_test_send(2, 3, 0, 129) == -1);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[2], pkt, 5, pkt, 64) == -1);
+
+	/* the RX ring fills up, then the TX ring */
+	for (i = 0; i < 16 + 4; i++)
+		KSFT_ASSERT(spw_test_send(2, 3, i, 128) == 0);
+
+	KSFT_ASSERT(spw_test_send(2, 3, i, 128) == -1);
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[3]) == 16);
+
+	for (i = 0; i < 16 + 4; i++) {
+		KSFT_ASSERT(grspw2_get_pkt(&spw[3], pkt) == 128);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+	}
+
+	/* a deeper RX ring, as the sysctl attributes would set it */
+	ring = spw[3].ring;
+	ring.rx_desc = 32;
+	ring.rx_mtu  = 512;
+
+	grspw2_core_stop(&spw[3]);
+
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &ring) == 0);
+	KSFT_ASSERT(spw[3].rx_n_desc == 32);
+	KSFT_ASSERT(spw[3].ring.tx_desc == 4);
+
+	/* restore the original geometry */
+	grspw2_core_stop(&spw[2]);
+
+	KSFT_ASSERT(grspw2_core_alloc(&spw[2], &orig) == 0);
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &orig) == 0);
+
+	grspw2_core_start(&spw[2], 1, 1);
+	grspw2_core_start(&spw[3], 1, 1);
+
+	KSFT_ASSERT(spw_test_send(3, 2, 1, SPW_MTU) == 0);
+	KSFT_ASSERT(grspw2_get_pkt(&spw[2], pkt) == SPW_MTU);
+	KSFT_ASSERT(spw_test_seq(pkt) == 1);
+
+	grspw2_core_free(&spw[3]);
+	KSFT_ASSERT(spw[3].ring_mem);
+	grspw2_core_stop(&spw[3]);
+	grspw2_core_free(&spw[3]);
+	KSFT_ASSERT(!spw[3].ring_mem);
+	KSFT_ASSERT(!spw[3].rx_n_desc);
+
+	KSFT_ASSERT(grspw2_core_alloc(&spw[3], &orig) == 0);
+	grspw2_core_start(&spw[3], 1, 1);
+}
+
+
+/*
+ * @test grspw2_router_test
+ */
+
+static void grspw2_router_test(void)
+{
+	uint32_t i;
+	uint32_t irq;
+	uint32_t stalled;
+
+	uint8_t data[SPW_MTU];
+	uint8_t pkt[SPW_MTU];
+
+	static struct grspw2_router rt;
+
+
+	spw_test_drain(1);
+
+	grspw2_router_init(&rt);
+
+	/* core 0 is attached to port 1, core 2 to port 2, core 4 to port 3,
+	 * port 1 forwards without copying, using the spare pool set up in
+	 * grspw2_zero_copy_test()
+	 */
+	KSFT_ASSERT(grspw2_router_add_port(&rt, &spw[1]) == 1);
+	KSFT_ASSERT(grspw2_router_add_port(&rt, &spw[3]) == 2);
+	KSFT_ASSERT(grspw2_router_add_port(&rt, &spw[5]) == 3);
+
+	KSFT_ASSERT(grspw2_router_set_route(&rt, SPW_NODE(4), 3, 0) == 0);
+	KSFT_ASSERT(grspw2_router_set_route(&rt, 0x60, 2, 1) == 0);
+	KSFT_ASSERT(grspw2_router_set_route(&rt, 10, 2, 1) == -1);
+
+	/* path address, deleted by the router */
+	data[0] = 2;
+	spw_test_fill(&data[1], 64, SPW_NODE(2), 1);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 65) == 0);
+
+	/* logical address, kept */
+	spw_test_fill(data, 64, SPW_NODE(4), 2);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 64) == 0);
+
+	/* logical address, deleted */
+	data[0] = 0x60;
+	spw_test_fill(&data[1], 64, SPW_NODE(2), 3);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 65) == 0);
+
+	/* unrouted */
+	spw_test_fill(data, 64, 0x61, 4);
+	KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 64) == 0);
+
+	KSFT_ASSERT(grspw2_router_poll(&rt) == 3);
+	KSFT_ASSERT(rt.routed == 3);
+	KSFT_ASSERT(rt.dropped == 1);
+
+	KSFT_ASSERT(grspw2_get_pkt(&spw[2], pkt) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 1);
+	KSFT_ASSERT(pkt[0] == SPW_NODE(2));
+	KSFT_ASSERT(grspw2_get_pkt(&spw[2], pkt) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 3);
+
+	KSFT_ASSERT(grspw2_get_pkt(&spw[4], pkt) == 64);
+	KSFT_ASSERT(spw_test_seq(pkt) == 2);
+	KSFT_ASSERT(pkt[0] == SPW_NODE(4));
+
+	/* a port interrupt that cannot be registered reverts all ports */
+	irq = spw[5].core_irq;
+	spw[5].core_irq = ~0U;
+
+	KSFT_ASSERT(grspw2_router_enable_irq(&rt) == -1);
+	KSFT_ASSERT(!rt.irq);
+	KSFT_ASSERT(!(spw[1].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_RI));
+	KSFT_ASSERT(!(spw[3].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_RI));
+
+	spw[5].core_irq = irq;
+
+	/* the same in interrupt mode */
+	KSFT_ASSERT(grspw2_router_enable_irq(&rt) == 0);
+
+	for (i = 0; i < 100; i++) {
+
+		spw_test_fill(data, 64, SPW_NODE(4), i);
+		KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 64) == 0);
+
+		grspw2_emu_irq_dispatch();
+
+		KSFT_ASSERT(grspw2_get_pkt(&spw[4], pkt) == 64);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+	}
+
+	/* the loaned buffers return to the spare pool on TX completion */
+	grspw2_tx_reclaim(&spw[3]);
+	grspw2_tx_reclaim(&spw[5]);
+	KSFT_ASSERT(spw[1].rx_spare.n == spw[1].rx_spare.n_max);
+
+	/* backpressure: the output port is not drained, the excess packets
+	 * are held in the input port
+	 */
+	for (i = 0; i < SPW_RX_DESC + SPW_TX_DESC + 16; i++) {
+		spw_test_fill(data, 64, SPW_NODE(4), i);
+		KSFT_ASSERT(grspw2_add_pkt(&spw[0], NULL, 0, data, 64) == 0);
+		grspw2_emu_irq_dispatch();
+	}
+
+	KSFT_ASSERT(rt.stalled > 0);
+	KSFT_ASSERT(rt.port[2].waiting == 1);
+
+	/* the stall is counted once, not on every further packet */
+	stalled = rt.stalled;
+
+	KSFT_ASSERT(grspw2_router_poll(&rt) == 0);
+	KSFT_ASSERT(rt.stalled == stalled);
+
+	/* routing resumes on TX completion of the output port */
+	for (i = 0; i < SPW_RX_DESC + SPW_TX_DESC + 16; i++) {
+		KSFT_ASSERT(grspw2_get_pkt(&spw[4], pkt) == 64);
+		KSFT_ASSERT(spw_test_seq(pkt) == i);
+		grspw2_emu_irq_dispatch();
+	}
+
+	KSFT_ASSERT(grspw2_get_num_pkts_avail(&spw[4]) == 0);
+	KSFT_ASSERT(rt.port[2].waiting == 0);
+
+	/* the TX interrupt is only enabled while an input is stalled */
+	KSFT_ASSERT(!(spw[5].regs->dma[0].ctrl_status & GRSPW2_DMACONTROL_TI));
+
+	KSFT_ASSERT(grspw2_router_disable_irq(&rt) == 0);
+}
+
+
+/*
+ * @test grspw2_benchmark
+ *
+ * @note this reports the driver overhead per packet for individual and
+ *	 batched transfers, there is nothing to verify
+ */
+
+static void grspw2_benchmark(void)
+{
+	uint32_t i;
+	uint32_t j;
+
+	uint64_t t0, t1, t2;
+
+	uint8_t *pkt;
+	uint8_t data[BENCH_PKT_SIZE];
+
+	struct grspw2_pkt_vec iov[BENCH_BATCH];
+	struct grspw2_pkt_buf buf[BENCH_BATCH];
+
+
+	spw_test_drain(1);
+
+	pkt = malloc(BENCH_BATCH * SPW_MTU);
+	KSFT_ASSERT_PTR_NOT_NULL(pkt);
+
+	/* not an RMAP protocol identifier, the emulator would check the CRC */
+	spw_test_fill(data, BENCH_PKT_SIZE, SPW_NODE(1), 1);
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		iov[i].hdr       = NULL;
+		iov[i].hdr_size  = 0;
+		iov[i].data      = data;
+		iov[i].data_size = BENCH_PKT_SIZE;
+
+		buf[i].pkt  = &pkt[i * SPW_MTU];
+		buf[i].size = SPW_MTU;
+	}
+
+	t0 = grspw2_emu_time_ns();
+
+	for (i = 0; i < BENCH_PKTS; i++) {
+		grspw2_add_pkt(&spw[0], NULL, 0, data, BENCH_PKT_SIZE);
+		grspw2_get_pkt(&spw[1], pkt);
+	}
+
+	t1 = grspw2_emu_time_ns();
+
+	for (i = 0; i < BENCH_PKTS; i += BENCH_BATCH) {
+		grspw2_add_pkts(&spw[0], iov, BENCH_BATCH);
+
+		j = 0;
+		while (j < BENCH_BATCH)
+			j += grspw2_get_pkts(&spw[1], buf, BENCH_BATCH - j);
+	}
+
+	t2 = grspw2_emu_time_ns();
+
+	printf("\t\tsingle: %llu ns/pkt, batched: %llu ns/pkt\n",
+	       (unsigned long long) (t1 - t0) / BENCH_PKTS,
+	       (unsigned long long) (t2 - t1) / BENCH_PKTS);
+
+	free(pkt);
+}
+
+
+int main(int argc, char **argv)
+{
+
+	printf("Testing GRSPW2 driver\n\n");
+
+	KSFT_RUN_TEST("grspw2 init",
+		      grspw2_init_test);
+
+	KSFT_RUN_TEST("grspw2 loopback",
+		      grspw2_loopback_test);
+
+	KSFT_RUN_TEST("grspw2 descriptor rings",
+		      grspw2_ring_test);
+
+	KSFT_RUN_TEST("grspw2 backpressure",
+		      grspw2_backpressure_test);
+
+	KSFT_RUN_TEST("grspw2 batched transfers",
+		      grspw2_batch_test);
+
+	KSFT_RUN_TEST("grspw2 zero-copy",
+		      grspw2_zero_copy_test);
+
+	KSFT_RUN_TEST("grspw2 rx interrupts",
+		      grspw2_rx_irq_test);
+
+	KSFT_RUN_TEST("grspw2 auto-drop",
+		      grspw2_auto_drop_test);
+
+	KSFT_RUN_TEST("grspw2 statistics",
+		      grspw2_stats_test);
+
+	KSFT_RUN_TEST("grspw2 rmap target",
+		      grspw2_rmap_test);
+
+	KSFT_RUN_TEST("grspw2 ring configuration",
+		      grspw2_ring_cfg_test);
+
+	KSFT_RUN_TEST("grspw2 benchmark",
+		      grspw2_benchmark);
+
+	KSFT_RUN_TEST("grspw2 router",
+		      grspw2_router_test);
+
+	grspw2_emu_exit();
+
+	printf("GRSPW2 test complete:\n");
+
+	ksft_print_cnts();
+
+	return ksft_exit_pass();
+}
@@ -0,0 +1,41 @@
+/**
+ * @file   asm/io.h
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief host replacement of the memory accessors
+ *
+ * The ring trackers store task pointers in native words, so accesses to
+ * objects of native word size are done at native width and the library may
+ * be run on LP64 hosts.
+ */
+
+#ifndef _ASM_IO_H_
+#define _ASM_IO_H_
+
+#include <kernel/types.h>
+
+#define __pn_native(X)	(sizeof(*(X)) == sizeof(unsigned long))
+
+#define ioread32be(X)							\
+	(__pn_native(X) ? *(const volatile unsigned long *) (X)		\
+			: *(const volatile uint32_t *) (X))
+
+#define iowrite32be(val, X)						\
+	do {								\
+		if (__pn_native(X))					\
+			*(volatile unsigned long *) (X) = (val);	\
+		else							\
+			*(volatile uint32_t *) (X) = (val);		\
+	} while (0)
+
+#endif /* _ASM_IO_H_ */
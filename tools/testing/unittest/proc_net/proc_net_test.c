@@ -0,0 +1,498 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <kselftest.h>
+
+#include <data_proc_net.h>
+
+
+#define OP_SPLIT	0x10
+#define OP_WORK		0x20
+#define OP_MERGE	0x30
+#define OP_FINAL	0x40
+
+#define N_ELEM		100
+#define N_SPLIT		4
+
+#define WORK_BATCH	3
+
+#define INPUT_RING	4
+
+
+static uint32_t data[N_ELEM];
+
+static unsigned long work_cnt;
+static unsigned long merge_cnt;
+static unsigned long final_cnt;
+static unsigned long out_cnt;
+static unsigned long out_child;
+static size_t out_nmemb;
+
+/* the element offset of the child task that fails in the work node */
+static long work_fail = -1;
+
+
+/* needed dummy functions */
+
+void *kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void *kzalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+void *kcalloc(size_t nmemb, size_t size)
+{
+	return calloc(nmemb, size);
+}
+
+void *krealloc(void *ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+void kfree(void *ptr)
+{
+	free(ptr);
+}
+
+int smp_cpu_id(void)
+{
+	return 0;
+}
+
+void machine_halt(void)
+{
+	abort();
+}
+
+
+static int op_pass(unsigned long op_code, struct proc_task *t)
+{
+	return PN_TASK_SUCCESS;
+}
+
+
+static int op_work(unsigned long op_code, struct proc_task *t)
+{
+	size_t i;
+
+	uint32_t *p;
+
+
+	work_cnt++;
+
+	p = pt_get_data(t);
+
+	if ((p - data) == work_fail)
+		return PN_TASK_DESTROY;
+
+	for (i = 0; i < pt_get_nmemb(t); i++)
+		p[i]++;
+
+	return PN_TASK_SUCCESS;
+}
+
+
+static int op_work_batch(unsigned long op_code, struct proc_task **t,
+			 size_t n, int *ret)
+{
+	size_t i;
+
+
+	for (i = 0; i < n; i++)
+		ret[i] = op_work(op_code, t[i]);
+
+	return n;
+}
+
+
+static int op_merge(unsigned long op_code, struct proc_task *t)
+{
+	merge_cnt++;
+
+	/* only ever executed on the parent */
+	KSFT_ASSERT(t->parent == NULL);
+	KSFT_ASSERT(pt_get_nmemb(t) == N_ELEM);
+
+	return PN_TASK_SUCCESS;
+}
+
+
+static int op_final(unsigned long op_code, struct proc_task *t)
+{
+	final_cnt++;
+
+	return PN_TASK_SUCCESS;
+}
+
+
+static int op_output(unsigned long op_code, struct proc_task *t)
+{
+	out_cnt++;
+
+	if (t->parent)
+		out_child++;
+
+	out_nmemb = pt_get_nmemb(t);
+
+	pt_destroy(t);
+
+	return PN_TASK_SUCCESS;
+}
+
+
+/**
+ * @brief create a network with a split node, a work node, a merge node and a
+ *	  final node
+ */
+
+static struct proc_net *pn_test_create(int batch)
+{
+	struct proc_net *pn;
+	struct proc_tracker *pt;
+
+
+	pn = pn_create();
+	KSFT_ASSERT_PTR_NOT_NULL(pn);
+
+	KSFT_ASSERT(pn_create_output_node(pn, op_output) == 0);
+
+	pt = pt_track_create_split(op_pass, OP_SPLIT, 1, N_SPLIT, OP_MERGE);
+	KSFT_ASSERT(pn_add_node(pn, pt) == 0);
+
+	if (batch)
+		pt = pt_track_create_batch(op_work_batch, OP_WORK, 1,
+					   WORK_BATCH);
+	else
+		pt = pt_track_create(op_work, OP_WORK, 1);
+
+	KSFT_ASSERT(pn_add_node(pn, pt) == 0);
+
+	pt = pt_track_create_merge(op_merge, OP_MERGE, 1);
+	KSFT_ASSERT(pn_add_node(pn, pt) == 0);
+
+	pt = pt_track_create(op_final, OP_FINAL, 1);
+	KSFT_ASSERT(pn_add_node(pn, pt) == 0);
+
+	memset(data, 0, sizeof(data));
+
+	work_cnt  = 0;
+	merge_cnt = 0;
+	final_cnt = 0;
+	out_cnt   = 0;
+	out_child = 0;
+	out_nmemb = 0;
+
+	return pn;
+}
+
+
+/**
+ * @brief feed a task with the given steps into the network and process it
+ */
+
+static void pn_test_run(struct proc_net *pn, int merge)
+{
+	struct proc_task *t;
+
+
+	t = pt_create(data, sizeof(data), 4, 0, 7);
+	KSFT_ASSERT_PTR_NOT_NULL(t);
+
+	pt_set_nmemb(t, N_ELEM);
+
+	KSFT_ASSERT(pt_add_step(t, OP_SPLIT, NULL) == 0);
+	KSFT_ASSERT(pt_add_step(t, OP_WORK, NULL) == 0);
+
+	if (merge)
+		KSFT_ASSERT(pt_add_step(t, OP_MERGE, NULL) == 0);
+
+	KSFT_ASSERT(pt_add_step(t, OP_FINAL, NULL) == 0);
+
+	KSFT_ASSERT(pn_input_task(pn, t) == 0);
+	KSFT_ASSERT(pn_process_inputs(pn) == 0);
+
+	while (pn_process_next(pn));
+
+	pn_process_outputs(pn);
+}
+
+
+/**
+ * @brief check that every element was processed exactly once
+ */
+
+static int pn_test_data_ok(void)
+{
+	size_t i;
+
+
+	for (i = 0; i < N_ELEM; i++) {
+		if (data[i] != 1)
+			return 0;
+	}
+
+	return 1;
+}
+
+
+/*
+ * @test pn_split_merge_test
+ */
+
+static void pn_split_merge_test(void)
+{
+	struct proc_net *pn;
+
+
+	pn = pn_test_create(0);
+
+	pn_test_run(pn, 1);
+
+	KSFT_ASSERT(work_cnt  == N_SPLIT);
+	KSFT_ASSERT(merge_cnt == 1);
+	KSFT_ASSERT(final_cnt == 1);
+	KSFT_ASSERT(out_cnt   == 1);
+	KSFT_ASSERT(out_child == 0);
+	KSFT_ASSERT(out_nmemb == N_ELEM);
+	KSFT_ASSERT(pn_test_data_ok());
+
+	pn_destroy(pn);
+}
+
+
+/*
+ * @test pn_split_merge_batch_test
+ */
+
+static void pn_split_merge_batch_test(void)
+{
+	struct proc_net *pn;
+
+
+	pn = pn_test_create(1);
+
+	pn_test_run(pn, 1);
+
+	KSFT_ASSERT(work_cnt  == N_SPLIT);
+	KSFT_ASSERT(merge_cnt == 1);
+	KSFT_ASSERT(final_cnt == 1);
+	KSFT_ASSERT(out_cnt   == 1);
+	KSFT_ASSERT(out_child == 0);
+	KSFT_ASSERT(out_nmemb == N_ELEM);
+	KSFT_ASSERT(pn_test_data_ok());
+
+	pn_destroy(pn);
+}
+
+
+/*
+ * @test pn_split_destroy_test
+ */
+
+static void pn_split_destroy_test(void)
+{
+	int batch;
+
+	struct proc_net *pn;
+
+
+	for (batch = 0; batch < 2; batch++) {
+
+		pn = pn_test_create(batch);
+
+		/* the second child fails */
+		work_fail = N_ELEM / N_SPLIT;
+
+		pn_test_run(pn, 1);
+
+		work_fail = -1;
+
+		/* the parent is destroyed, no child reaches the output */
+		KSFT_ASSERT(work_cnt  == N_SPLIT);
+		KSFT_ASSERT(merge_cnt == 0);
+		KSFT_ASSERT(final_cnt == 0);
+		KSFT_ASSERT(out_cnt   == 1);
+		KSFT_ASSERT(out_child == 0);
+		KSFT_ASSERT(out_nmemb == 0);
+
+		pn_destroy(pn);
+	}
+}
+
+
+/*
+ * @test pn_split_no_merge_test
+ */
+
+static void pn_split_no_merge_test(void)
+{
+	struct proc_net *pn;
+
+
+	pn = pn_test_create(0);
+
+	/* without a merge step, the task passes the split node as a whole */
+	pn_test_run(pn, 0);
+
+	KSFT_ASSERT(work_cnt  == 1);
+	KSFT_ASSERT(merge_cnt == 0);
+	KSFT_ASSERT(final_cnt == 1);
+	KSFT_ASSERT(out_cnt   == 1);
+	KSFT_ASSERT(out_nmemb == N_ELEM);
+	KSFT_ASSERT(pn_test_data_ok());
+
+	pn_destroy(pn);
+}
+
+
+/*
+ * @test pn_input_ring_test
+ */
+
+static void pn_input_ring_test(void)
+{
+	size_t i;
+
+	struct proc_net *pn;
+	struct proc_task *t[INPUT_RING + 2];
+
+
+	pn = pn_test_create(0);
+
+	for (i = 0; i < ARRAY_SIZE(t); i++) {
+		t[i] = pt_create(&data[i], sizeof(uint32_t), 4, 0, i);
+		KSFT_ASSERT_PTR_NOT_NULL(t[i]);
+
+		pt_set_nmemb(t[i], 1);
+
+		KSFT_ASSERT(pt_add_step(t[i], OP_WORK, NULL) == 0);
+		KSFT_ASSERT(pt_add_step(t[i], OP_FINAL, NULL) == 0);
+	}
+
+	/* the input node may not be replaced while it holds tasks */
+	KSFT_ASSERT(pn_input_task(pn, t[0]) == 0);
+	KSFT_ASSERT(pn_create_input_ring(pn, INPUT_RING, 1) == -EBUSY);
+
+	KSFT_ASSERT(pn_process_inputs(pn) == 0);
+
+	KSFT_ASSERT(pn_create_input_ring(pn, INPUT_RING, 1) == 0);
+
+	for (i = 1; i <= INPUT_RING; i++)
+		KSFT_ASSERT(pn_input_task(pn, t[i]) == 0);
+
+	/* the lane is full, the task may be added once the ring was drained */
+	KSFT_ASSERT(pn_input_task(pn, t[i]) == -EBUSY);
+
+	KSFT_ASSERT(pn_process_inputs(pn) == 0);
+
+	KSFT_ASSERT(pn_input_task(pn, t[i]) == 0);
+
+	KSFT_ASSERT(pn_process_inputs(pn) == 0);
+
+	while (pn_process_next(pn));
+
+	pn_process_outputs(pn);
+
+	KSFT_ASSERT(work_cnt  == ARRAY_SIZE(t));
+	KSFT_ASSERT(final_cnt == ARRAY_SIZE(t));
+	KSFT_ASSERT(out_cnt   == ARRAY_SIZE(t));
+
+	for (i = 0; i < ARRAY_SIZE(t); i++)
+		KSFT_ASSERT(data[i] == 1);
+
+	pn_destroy(pn);
+}
+
+
+/*
+ * @test pt_track_put_head_test
+ */
+
+static void pt_track_put_head_test(void)
+{
+	size_t i;
+
+	struct proc_tracker *pt;
+	struct proc_task *t[3];
+
+
+	pt = pt_track_create(op_work, OP_WORK, 1);
+	KSFT_ASSERT_PTR_NOT_NULL(pt);
+
+	for (i = 0; i < ARRAY_SIZE(t); i++) {
+		t[i] = pt_create(NULL, 0, 1, 0, i);
+		KSFT_ASSERT_PTR_NOT_NULL(t[i]);
+		KSFT_ASSERT(pt_add_step(t[i], OP_WORK, NULL) == 0);
+		KSFT_ASSERT(pt_track_put(pt, t[i]) == 0);
+	}
+
+	/* take the first two, then return them in reverse */
+	KSFT_ASSERT(pt_track_get(pt) == t[0]);
+	KSFT_ASSERT(pt_track_get(pt) == t[1]);
+
+	KSFT_ASSERT(pt_track_put_head(pt, t[1]) == 0);
+	KSFT_ASSERT(pt_track_put_head(pt, t[0]) == 0);
+
+	for (i = 0; i < ARRAY_SIZE(t); i++)
+		KSFT_ASSERT(pt_track_get(pt) == t[i]);
+
+	KSFT_ASSERT(pt_track_get(pt) == NULL);
+
+	for (i = 0; i < ARRAY_SIZE(t); i++)
+		pt_destroy(t[i]);
+
+	pt_track_destroy(pt);
+
+	/* ring trackers may only be added to by their producers */
+	pt = pt_track_create_ring(op_work, OP_WORK, 1, INPUT_RING, 1);
+	KSFT_ASSERT_PTR_NOT_NULL(pt);
+
+	t[0] = pt_create(NULL, 0, 1, 0, 0);
+	KSFT_ASSERT_PTR_NOT_NULL(t[0]);
+	KSFT_ASSERT(pt_add_step(t[0], OP_WORK, NULL) == 0);
+
+	KSFT_ASSERT(pt_track_put_head(pt, t[0]) == -EINVAL);
+
+	pt_destroy(t[0]);
+	pt_track_destroy(pt);
+}
+
+
+int main(int argc, char **argv)
+{
+
+	printf("Testing data processing network\n\n");
+
+	KSFT_RUN_TEST("split and merge",
+		      pn_split_merge_test);
+
+	KSFT_RUN_TEST("split and merge via batch node",
+		      pn_split_merge_batch_test);
+
+	KSFT_RUN_TEST("destroyed child task",
+		      pn_split_destroy_test);
+
+	KSFT_RUN_TEST("split without merge step",
+		      pn_split_no_merge_test);
+
+	KSFT_RUN_TEST("ring input node",
+		      pn_input_ring_test);
+
+	KSFT_RUN_TEST("return tasks to tracker head",
+		      pt_track_put_head_test);
+
+	printf("Data processing network test complete:\n");
+
+	ksft_print_cnts();
+
+	return ksft_exit_pass();
+}
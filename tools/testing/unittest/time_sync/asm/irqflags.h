@@ -0,0 +1,12 @@
+/**
+ * @file   asm/irqflags.h
+ * @ingroup mockups
+ *
+ * @brief host replacement of the SPARC interrupt flags, the functions
+ *	  declared in asm-generic/irqflags.h are provided by the test
+ */
+
+#ifndef _ASM_IRQFLAGS_H_
+#define _ASM_IRQFLAGS_H_
+
+#endif /* _ASM_IRQFLAGS_H_ */
@@ -0,0 +1,30 @@
+/**
+ * @file   asm/spinlock.h
+ * @ingroup mockups
+ *
+ * @brief host replacement of the SPARC spin locks
+ *
+ * @note the time discipline is updated from the test's only thread, so a
+ *	 plain flag is sufficient here
+ */
+
+#ifndef _ASM_SPINLOCK_H_
+#define _ASM_SPINLOCK_H_
+
+#include <kernel/types.h>
+
+struct spinlock {
+	volatile int lock;
+};
+
+static inline void spin_lock_raw(struct spinlock *lock)
+{
+	lock->lock = 1;
+}
+
+static inline void spin_unlock(struct spinlock *lock)
+{
+	lock->lock = 0;
+}
+
+#endif /* _ASM_SPINLOCK_H_ */
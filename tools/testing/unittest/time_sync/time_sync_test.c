@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <kselftest.h>
+
+/* include the source to access the static timekeeper */
+#include <time.c>
+
+
+/* the nominal tick period */
+#define TICK		100000000LL
+
+/* the raw clock runs fast by 1/CLK_FAST, i.e. 100 ppm */
+#define CLK_FAST	10000LL
+
+
+/* the raw clock readout in nanoseconds */
+static ktime raw_ns;
+
+
+/* needed dummy functions */
+
+unsigned long arch_local_irq_save(void)
+{
+	return 0;
+}
+
+void arch_local_irq_restore(unsigned long flags)
+{
+}
+
+void machine_halt(void)
+{
+	abort();
+}
+
+
+/* mock clock source */
+
+static void clk_read(uint32_t *seconds, uint32_t *nanoseconds)
+{
+	(*seconds)     = (uint32_t) (raw_ns / NSEC_PER_SEC);
+	(*nanoseconds) = (uint32_t) (raw_ns % NSEC_PER_SEC);
+}
+
+static struct clocksource clk = {
+	.read = clk_read,
+};
+
+
+/**
+ * @brief signal a tick at a true time in nanoseconds
+ */
+
+static void tick_at(ktime t)
+{
+	raw_ns = t + t / CLK_FAST;
+
+	time_sync_tick(1);
+}
+
+
+/**
+ * @test time_sync_lock_test
+ */
+
+static void time_sync_lock_test(void)
+{
+	int i;
+
+
+	time_init(&clk);
+	time_sync_enable(TICK);
+
+	KSFT_ASSERT(time_sync_get_period() == TICK);
+	KSFT_ASSERT(!time_sync_locked());
+
+	for (i = 1; i <= 32; i++)
+		tick_at(i * TICK);
+
+	KSFT_ASSERT(time_sync_locked());
+	KSFT_ASSERT(tk.sync.resets == 1);
+
+	/* the raw clock is 100 ppm fast */
+	KSFT_ASSERT(tk.sync.drift < -99000);
+	KSFT_ASSERT(tk.sync.drift > -101000);
+
+	/* the kernel time is in phase with the tick */
+	KSFT_ASSERT(ktime_get() - tk.sync.tick <  TIME_SYNC_LOCK_NS);
+	KSFT_ASSERT(ktime_get() - tk.sync.tick > -TIME_SYNC_LOCK_NS);
+}
+
+
+/**
+ * @test time_sync_no_tick_test
+ *
+ * @brief the phase error is slewed for TIME_SYNC_SLEW_TICKS periods only if
+ *	  no further tick arrives
+ */
+
+static void time_sync_no_tick_test(void)
+{
+	int i;
+
+	ktime r0;
+	ktime t0;
+	ktime t1;
+	ktime last;
+
+	int32_t rate;
+	int32_t drift;
+
+
+	/* a late tick leaves a phase error to slew */
+	tick_at(33 * TICK + 20000);
+
+	KSFT_ASSERT(tk.sync.resets == 1);
+
+	r0    = tk.sync.tick_raw;
+	rate  = tk.sync.rate;
+	drift = tk.sync.drift;
+
+	KSFT_ASSERT(rate != drift);
+
+	/* within the slew interval, the rate applies */
+	raw_ns = r0 + TICK;
+	t0 = ktime_get();
+	raw_ns = r0 + 2 * TICK;
+	t1 = ktime_get();
+
+	KSFT_ASSERT(t1 - t0 - TICK - (TICK / 1000) * rate / 1000000 <= 1);
+	KSFT_ASSERT(t1 - t0 - TICK - (TICK / 1000) * rate / 1000000 >= -1);
+
+	/* beyond, the kernel time continues with the drift compensation */
+	raw_ns = r0 + 10 * TICK;
+	t0 = ktime_get();
+	raw_ns = r0 + 11 * TICK;
+	t1 = ktime_get();
+
+	KSFT_ASSERT(t1 - t0 - TICK - (TICK / 1000) * drift / 1000000 <= 1);
+	KSFT_ASSERT(t1 - t0 - TICK - (TICK / 1000) * drift / 1000000 >= -1);
+
+	/* the kernel time is monotonic across the end of the slew interval */
+	raw_ns = r0;
+	last = ktime_get();
+
+	for (i = 1; i <= 8 * TIME_SYNC_SLEW_TICKS; i++) {
+		raw_ns = r0 + i * TICK / 4;
+		KSFT_ASSERT(ktime_get() > last);
+		last = ktime_get();
+	}
+
+	/* a rebase beyond the slew interval drops the phase correction */
+	time_sync_rebase(raw_ns);
+
+	KSFT_ASSERT(tk.sync.slew == 0);
+	KSFT_ASSERT(tk.sync.rate == drift);
+	KSFT_ASSERT(ktime_get() == last);
+
+	/* the tick resumes with the elapsed periods without a reset */
+	raw_ns = 42 * TICK + 42 * TICK / CLK_FAST;
+	time_sync_tick(9);
+
+	KSFT_ASSERT(tk.sync.resets == 1);
+	KSFT_ASSERT(tk.sync.slew == TIME_SYNC_SLEW_TICKS * TICK);
+}
+
+
+/**
+ * @test time_sync_align_test
+ */
+
+static void time_sync_align_test(void)
+{
+	int i;
+
+	ktime t;
+	ktime ref;
+
+
+	/* periods which divide or are a multiple of the tick period */
+	KSFT_ASSERT(time_sync_check_period(TICK) == 0);
+	KSFT_ASSERT(time_sync_check_period(TICK / 2) == 0);
+	KSFT_ASSERT(time_sync_check_period(TICK * 2) == 0);
+
+	/* e.g. 1.5 s with a 1 s tick would not keep its period */
+	KSFT_ASSERT(time_sync_check_period(TICK * 3 / 2) == -EINVAL);
+	KSFT_ASSERT(time_sync_check_period(TICK * 3 / 10) == -EINVAL);
+	KSFT_ASSERT(time_sync_check_period(0) == -EINVAL);
+
+	ref = tk.sync.tick;
+
+	/* such a period is left alone */
+	t = ref + 12345;
+	KSFT_ASSERT(time_sync_align(t, TICK * 3 / 2, 0, false) == t);
+	KSFT_ASSERT(time_sync_align(t, TICK * 3 / 2, 0, true)  == t);
+
+	/* first tick plus phase at or after t */
+	KSFT_ASSERT(time_sync_align(ref + TICK / 10, TICK / 2, TICK / 20, true)
+		    == ref + TICK + TICK / 20);
+
+	/* nearest point of the subdivided grid */
+	KSFT_ASSERT(time_sync_align(ref + 3 * TICK + TICK * 57 / 100,
+				    TICK / 2, TICK / 20, false)
+		    == ref + 3 * TICK + TICK * 55 / 100);
+
+	/* a multiple of the tick period keeps its own subset of ticks */
+	KSFT_ASSERT(time_sync_align(ref + 3 * TICK - TICK / 50,
+				    2 * TICK, 0, false) == ref + 3 * TICK);
+	KSFT_ASSERT(time_sync_align(ref + 4 * TICK + TICK / 50,
+				    2 * TICK, 0, false) == ref + 4 * TICK);
+
+	/* successive releases stay on the grid */
+	t = time_sync_align(ref + 7, TICK / 4, 0, false);
+	KSFT_ASSERT(t == ref);
+
+	for (i = 1; i <= 16; i++) {
+		t = time_sync_align(ktime_add(t, TICK / 4), TICK / 4, 0, false);
+		KSFT_ASSERT(t == ref + i * TICK / 4);
+	}
+
+	/* without the time discipline, anything goes */
+	time_sync_disable();
+
+	KSFT_ASSERT(time_sync_check_period(TICK * 3 / 2) == 0);
+	KSFT_ASSERT(time_sync_align(ref + 7, TICK / 4, 0, false) == ref + 7);
+}
+
+
+int main(int argc, char **argv)
+{
+
+	printf("Testing time discipline\n\n");
+
+	KSFT_RUN_TEST("lock to the tick",
+		      time_sync_lock_test);
+
+	KSFT_RUN_TEST("missing ticks",
+		      time_sync_no_tick_test);
+
+	KSFT_RUN_TEST("alignment to the tick",
+		      time_sync_align_test);
+
+	printf("Time discipline test complete:\n");
+
+	ksft_print_cnts();
+
+	return ksft_exit_pass();
+}
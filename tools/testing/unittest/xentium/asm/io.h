@@ -0,0 +1,63 @@
+/**
+ * @file   asm/io.h
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief host replacement of the register accessors
+ *
+ * The emulation runs in host byte order, so no swapping is done. As the
+ * driver passes pointers through 32 bit registers (e.g. the Xentium mailboxes)
+ * that are native words on the target, accesses to objects of native word
+ * size are done at native width, so the driver may be run on LP64 hosts.
+ * All writes are forwarded to the Xentium emulator, so that mailbox writes of
+ * the driver may be detected by the emulated devices.
+ */
+
+#ifndef _ASM_IO_H_
+#define _ASM_IO_H_
+
+#include <kernel/types.h>
+
+void xen_emu_io_notify(volatile void *addr);
+
+#define __xen_emu_native(X)	(sizeof(*(X)) == sizeof(unsigned long))
+
+#define ioread8(X)	(*(const volatile uint8_t *) (X))
+
+#define ioread16be(X)	(*(const volatile uint16_t *) (X))
+
+#define ioread32be(X)							\
+	(__xen_emu_native(X) ? *(const volatile unsigned long *) (X)	\
+			     : *(const volatile uint32_t *) (X))
+
+#define iowrite8(val, X)						\
+	do {								\
+		*(volatile uint8_t *) (X) = (val);			\
+		xen_emu_io_notify((X));					\
+	} while (0)
+
+#define iowrite16be(val, X)						\
+	do {								\
+		*(volatile uint16_t *) (X) = (val);			\
+		xen_emu_io_notify((X));					\
+	} while (0)
+
+#define iowrite32be(val, X)						\
+	do {								\
+		if (__xen_emu_native(X))				\
+			*(volatile unsigned long *) (X) = (val);	\
+		else							\
+			*(volatile uint32_t *) (X) = (val);		\
+		xen_emu_io_notify((X));					\
+	} while (0)
+
+#endif /* _ASM_IO_H_ */
@@ -0,0 +1,14 @@
+/**
+ * @file   asm/irq.h
+ * @ingroup mockups
+ *
+ * @brief host replacement of the SPARC interrupt definitions
+ */
+
+#ifndef _ASM_IRQ_H_
+#define _ASM_IRQ_H_
+
+#define LEON_WANT_EIRQ(x) (x)
+#define LEON_REAL_EIRQ(x) (x)
+
+#endif /* _ASM_IRQ_H_ */
@@ -0,0 +1,67 @@
+/**
+ * @file   asm/spinlock.h
+ * @ingroup mockups
+ *
+ * @brief host replacement of the SPARC spin locks
+ *
+ * @note interrupts of the Xentium emulator are serialised with the driver
+ *	 calls of a test, so a plain flag is sufficient here
+ */
+
+#ifndef _ASM_SPINLOCK_H_
+#define _ASM_SPINLOCK_H_
+
+#include <kernel/types.h>
+
+#define __SPINLOCK
+struct spinlock {
+	volatile int lock;
+};
+
+#define __spin_lock_save_irq __spin_lock_save_irq
+static inline uint32_t spin_lock_save_irq(void)
+{
+	return 0;
+}
+
+#define __spin_lock_restore_irq __spin_lock_restore_irq
+static inline void spin_lock_restore_irq(__attribute__((unused)) uint32_t psr)
+{
+}
+
+#define __spin_try_lock __spin_try_lock
+static inline int spin_try_lock(struct spinlock *lock)
+{
+	if (lock->lock)
+		return 0;
+
+	lock->lock = 1;
+
+	return 1;
+}
+
+#define __spin_lock __spin_lock
+static inline void spin_lock(struct spinlock *lock)
+{
+	lock->lock = 1;
+}
+
+#define __spin_is_locked __spin_is_locked
+static inline int spin_is_locked(struct spinlock *lock)
+{
+	return lock->lock;
+}
+
+#define __spin_unlock_wait __spin_unlock_wait
+static inline void spin_unlock_wait(__attribute__((unused))
+				    struct spinlock *lock)
+{
+}
+
+#define __spin_unlock __spin_unlock
+static inline void spin_unlock(struct spinlock *lock)
+{
+	lock->lock = 0;
+}
+
+#endif /* _ASM_SPINLOCK_H_ */
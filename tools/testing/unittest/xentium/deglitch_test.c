@@ -0,0 +1,359 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <kselftest.h>
+
+#include <xen_emu.h>
+
+/* include src file for static function testing */
+#define main			xen_deglitch_main
+#define _xen_kernel_param	xen_deglitch_param
+#include <deglitch/xen_deglitch.c>
+#undef main
+
+
+#define MAX_ELEM	(2 * XEN_TCM_BANK_SIZE / sizeof(int))
+
+#define BENCH_RUNS	5000
+
+#define SIGCLIP		3
+
+
+/* needed dummy functions */
+
+void *kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void *kzalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+void *kcalloc(size_t nmemb, size_t size)
+{
+	return calloc(nmemb, size);
+}
+
+void *krealloc(void *ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+void kfree(void *ptr)
+{
+	free(ptr);
+}
+
+
+/* the previous implementation of the filter, used as the benchmark baseline */
+
+static int old_median3(int a, int b, int c)
+{
+        int t;
+
+        if (a > b) {
+                t = a;
+                a = b;
+                b = t;
+
+        } else if (b > c) {
+                t = b;
+                b = c;
+                c = t;
+
+        } else if (a > b) {
+                t = a;
+                a = b;
+                b = t;
+        }
+
+        return b;
+}
+
+static int old_abs(int a)
+{
+	if (a >= 0)
+		return a;
+
+	return -a;
+}
+
+static void old_median3filter(volatile int *in, int *out, size_t len,
+			      unsigned int threshold)
+{
+	int i, m;
+
+
+	out[0] = in[0];
+
+	for (i = 1; i < (len-1); i++) {
+
+		m = old_median3(in[i-1], in[i], in[i+1]);
+
+		if (old_abs(m - in[i]) > threshold)
+			out[i] = m;
+		else
+			out[i] = in[i];
+	}
+
+	out[len-1] = in[len-1];
+}
+
+static int old_get_int_L1_residual(volatile int *in, size_t len)
+{
+	size_t i;
+
+	int tmp;
+	int mean = 0;
+	unsigned int residual = 0;
+
+
+	for (i = 0; i < len; i++)
+		mean += in[i];
+
+	mean /= len;
+
+	for (i = 0; i < len; i++) {
+		tmp = (in[i] - mean);
+		residual += old_abs(tmp);
+	}
+
+
+	return residual / len;
+}
+
+static void old_median_filter_clipped(volatile int *in, int *out, size_t len,
+				      unsigned int clip)
+{
+	old_median3filter(in, out, len, clip * old_get_int_L1_residual(in, len));
+}
+
+
+/**
+ * @brief a straightforward reference of the deglitch filter
+ */
+
+static int ref_cmp(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+static void ref_median_filter_clipped(int *in, int *out, size_t len,
+				      unsigned int clip)
+{
+	size_t i;
+
+	int v[3];
+	int mean = 0;
+	unsigned int res = 0;
+
+
+	for (i = 0; i < len; i++)
+		mean += in[i];
+
+	mean /= (int) len;
+
+	for (i = 0; i < len; i++)
+		res += abs(in[i] - mean);
+
+	res = clip * (res / len);
+
+	for (i = 0; i < len; i++) {
+
+		out[i] = in[i];
+
+		if (!i || i == len - 1)
+			continue;
+
+		memcpy(v, &in[i - 1], sizeof(v));
+		qsort(v, 3, sizeof(int), ref_cmp);
+
+		if ((unsigned int) abs(v[1] - in[i]) > res)
+			out[i] = v[1];
+	}
+}
+
+
+/**
+ * @brief the deglitch filter as executed by process_task(), minus the DMA
+ */
+
+static void median_filter_clipped(int *in, int *out, size_t len,
+				  unsigned int clip)
+{
+	int mean;
+
+
+	mean = get_int_sum(in, len) / (int) len;
+
+	median3filter(in, out, 0, len, len,
+		      clip * get_int_L1_residual(in, len, mean));
+}
+
+
+/**
+ * @brief create a noisy ramp with some glitches
+ */
+
+static void create_data(int *p, size_t len)
+{
+	size_t i;
+
+
+	for (i = 0; i < len; i++)
+		p[i] = 1000 + i * 4 + (rand() % 16) - 8;
+
+	for (i = 0; i < len / 50; i++)
+		p[rand() % len] += (rand() % 2) ? 5000 : -5000;
+}
+
+
+/* tests */
+
+
+/*
+ * @test deglitch_median3_test
+ */
+
+static void deglitch_median3_test(void)
+{
+	size_t i;
+
+	const int v[][3] = {{1, 2, 3}, {1, 3, 2}, {2, 1, 3},
+			    {2, 3, 1}, {3, 1, 2}, {3, 2, 1}};
+
+
+	for (i = 0; i < ARRAY_SIZE(v); i++)
+		KSFT_ASSERT(median3(v[i][0], v[i][1], v[i][2]) == 2);
+
+	KSFT_ASSERT(median3(5, 5, 1) == 5);
+	KSFT_ASSERT(median3(-4, 7, -4) == -4);
+
+	KSFT_ASSERT(iabs(-7) == 7);
+	KSFT_ASSERT(iabs(7) == 7);
+	KSFT_ASSERT(iabs(0) == 0);
+}
+
+
+/*
+ * @test deglitch_filter_test
+ */
+
+static void deglitch_filter_test(void)
+{
+	size_t i;
+
+	int *in;
+	int *out;
+	int *ref;
+
+	const size_t len[] = {1, 2, 3, 64, 1000, TILE_ELEM + 1, MAX_ELEM};
+
+
+	in  = malloc(MAX_ELEM * sizeof(int));
+	out = malloc(MAX_ELEM * sizeof(int));
+	ref = malloc(MAX_ELEM * sizeof(int));
+
+	KSFT_ASSERT_PTR_NOT_NULL(in);
+	KSFT_ASSERT_PTR_NOT_NULL(out);
+	KSFT_ASSERT_PTR_NOT_NULL(ref);
+
+	for (i = 0; i < ARRAY_SIZE(len); i++) {
+
+		create_data(in, len[i]);
+
+		median_filter_clipped(in, out, len[i], SIGCLIP);
+		ref_median_filter_clipped(in, ref, len[i], SIGCLIP);
+
+		KSFT_ASSERT(!memcmp(out, ref, len[i] * sizeof(int)));
+	}
+
+	/* tiles must give the same result as a single pass */
+	create_data(in, MAX_ELEM);
+	ref_median_filter_clipped(in, ref, MAX_ELEM, SIGCLIP);
+
+	for (i = 0; i < MAX_ELEM; i += TILE_ELEM)
+		median3filter(in, out, i, i + TILE_ELEM, MAX_ELEM,
+			      SIGCLIP * get_int_L1_residual(in, MAX_ELEM,
+				get_int_sum(in, MAX_ELEM) / (int) MAX_ELEM));
+
+	KSFT_ASSERT(!memcmp(out, ref, MAX_ELEM * sizeof(int)));
+
+	free(in);
+	free(out);
+	free(ref);
+}
+
+
+/*
+ * @test deglitch_benchmark
+ *
+ * @note this reports the throughput of the previous and the current filter
+ *	 implementation, there is nothing to verify
+ */
+
+static void deglitch_benchmark(void)
+{
+	size_t i;
+
+	int *in;
+	int *out;
+
+	uint64_t t0, t1, t2;
+
+
+	in  = malloc(MAX_ELEM * sizeof(int));
+	out = malloc(MAX_ELEM * sizeof(int));
+
+	KSFT_ASSERT_PTR_NOT_NULL(in);
+	KSFT_ASSERT_PTR_NOT_NULL(out);
+
+	create_data(in, MAX_ELEM);
+
+	t0 = xen_emu_time_ns();
+
+	for (i = 0; i < BENCH_RUNS; i++)
+		old_median_filter_clipped(in, out, MAX_ELEM, SIGCLIP);
+
+	t1 = xen_emu_time_ns();
+
+	for (i = 0; i < BENCH_RUNS; i++)
+		median_filter_clipped(in, out, MAX_ELEM, SIGCLIP);
+
+	t2 = xen_emu_time_ns();
+
+	printf("\t\tprevious: %llu ps/elem, current: %llu ps/elem\n",
+	       (unsigned long long) (t1 - t0) / (BENCH_RUNS * MAX_ELEM / 1000),
+	       (unsigned long long) (t2 - t1) / (BENCH_RUNS * MAX_ELEM / 1000));
+
+	free(in);
+	free(out);
+}
+
+
+int main(int argc, char **argv)
+{
+
+	printf("Testing Xentium deglitch kernel\n\n");
+
+	KSFT_RUN_TEST("deglitch median3",
+		      deglitch_median3_test);
+
+	KSFT_RUN_TEST("deglitch filter",
+		      deglitch_filter_test);
+
+	KSFT_RUN_TEST("deglitch benchmark",
+		      deglitch_benchmark);
+
+	printf("Deglitch test complete:\n");
+
+	ksft_print_cnts();
+
+	return ksft_exit_pass();
+}
@@ -0,0 +1,26 @@
+/**
+ * @file   kernel/xentium_dev.h
+ * @ingroup mockups
+ *
+ * @brief redirects the Xentium-local device and TCM memory of natively
+ *	  compiled Xentium kernels to the emulated device of the calling thread
+ */
+
+#ifndef _XEN_EMU_XENTIUM_DEV_H_
+#define _XEN_EMU_XENTIUM_DEV_H_
+
+#define xen_dev_local	__xen_emu_dev_local_unused
+#define xen_tcm_local	__xen_emu_tcm_local_unused
+
+#include_next <kernel/xentium_dev.h>
+
+#undef xen_dev_local
+#undef xen_tcm_local
+
+struct xen_dev_mem *xen_emu_get_dev_local(void);
+struct xen_tcm *xen_emu_get_tcm_local(void);
+
+#define xen_dev_local	xen_emu_get_dev_local()
+#define xen_tcm_local	xen_emu_get_tcm_local()
+
+#endif /* _XEN_EMU_XENTIUM_DEV_H_ */
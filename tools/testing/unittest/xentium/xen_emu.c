@@ -0,0 +1,772 @@
+/**
+ * @file   xen_emu.c
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief a host emulation of the Xentium DSPs and the NoC DMA
+ *
+ * This emulates the parts of the MPPB/SSDP platform used by the Xentium
+ * driver (kernel/xentium.c), so that the offload scheduling pipeline may be
+ * exercised and benchmarked on a Linux host:
+ *
+ *  - each Xentium is a host thread with an emulated device memory
+ *    (struct xen_dev_mem) and TCM; a write of the driver to the command
+ *    mailbox starts the kernel program at the address in the entry point
+ *    mailbox, if the device is idle
+ *
+ *  - Xentium kernel programs (dsp/xentium/kernel/) are compiled natively,
+ *    this file replaces the Xentium-side runtime (dsp/xentium/lib/xen.c and
+ *    dsp/xentium/lib/dma.c) and maps the entry points of the programs to
+ *    their main() functions (see xen_emu_kernel_add()); the Xentium-side
+ *    allocator (dsp/xentium/lib/kmem.c) is used as is, but its functions are
+ *    prefixed with xen_, so they do not collide with those of the host
+ *
+ *  - a Xentium signalling the host executes the interrupt handler registered
+ *    via irq_request() in the context of its thread; interrupts are
+ *    serialised and may be masked by the test via xen_emu_irq_disable(), so
+ *    the driver sees the same exclusion as on a single-CPU target
+ *
+ *  - the NoC DMA moves data via memcpy() and busy-waits for the duration of
+ *    a transfer, which is computed from a configurable setup latency and
+ *    bandwidth (see xen_emu_dma_set_timing()); a transfer started in the
+ *    background completes immediately, but the channel stays busy for the
+ *    duration of the transfer
+ *
+ * A 2D transfer element (x, y) is located at offset
+ * y * y_stride + x * x_stride (in units of elements) from the source or
+ * destination address, i.e. the y stride is the distance between the first
+ * elements of two rows, as the transfers of samples/noc_dma/noc_dma_demo.c
+ * and the rampfit kernel assume. A linear transfer is a single row with an x
+ * stride of 1.
+ */
+
+#define _GNU_SOURCE
+
+/* kernel/time.h has its own difftime() */
+#define difftime libc_difftime
+#include <time.h>
+#undef difftime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <kernel/irq.h>
+#include <kernel/reboot.h>
+#include <kernel/smp.h>
+#include <kernel/kernel_levels.h>
+#include <noc_dma.h>
+
+#include <xen.h>
+#include <dma.h>
+
+#include <xen_emu.h>
+
+
+#define XEN_EMU_KERNELS	16
+#define XEN_EMU_IRQS	64
+
+/* default NoC DMA timing */
+#define XEN_EMU_DMA_LATENCY_NS		500
+#define XEN_EMU_DMA_BYTES_PER_US	400
+
+
+struct noc_dma_channel {
+	int reserved;
+	uint64_t t_done;	/* the time the channel becomes idle */
+	struct xen_emu_dma_stats stats;
+};
+
+struct xen_emu_dev {
+	struct xen_dev_mem mem;
+	struct xen_tcm tcm;
+
+	int idx;
+	int cmd_pending;
+	uint64_t t_run;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	struct xen_emu_dev_stats stats;
+};
+
+static struct {
+	struct xen_emu_dev dev[XEN_EMU_DEVICES];
+	struct noc_dma_channel dma[XEN_EMU_DMA_CHANNELS];
+
+	struct {
+		unsigned long ep;
+		int (*entry)(void);
+	} kernel[XEN_EMU_KERNELS];
+	size_t n_kernels;
+
+	struct {
+		irq_handler_t handler;
+		void *data;
+	} irq[XEN_EMU_IRQS];
+
+	unsigned int eirq_base;
+	pthread_mutex_t irq_lock;
+
+	unsigned long dma_latency_ns;
+	unsigned long dma_bytes_per_us;
+
+	int running;
+} emu = {
+	.dma_latency_ns   = XEN_EMU_DMA_LATENCY_NS,
+	.dma_bytes_per_us = XEN_EMU_DMA_BYTES_PER_US,
+};
+
+/* the emulated Xentium executing in the calling thread */
+static __thread struct xen_emu_dev *xen_emu_cur;
+
+
+/**
+ * @brief get a monotonic time stamp in nanoseconds
+ */
+
+uint64_t xen_emu_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+static void xen_emu_unlock(void *lock)
+{
+	pthread_mutex_unlock((pthread_mutex_t *) lock);
+}
+
+
+/**
+ * @brief wait for a command mailbox write of the host and consume it
+ */
+
+static void xen_emu_wait_cmd_pending(struct xen_emu_dev *dev)
+{
+	pthread_mutex_lock(&dev->lock);
+	pthread_cleanup_push(xen_emu_unlock, &dev->lock);
+
+	while (!dev->cmd_pending)
+		pthread_cond_wait(&dev->cond, &dev->lock);
+
+	dev->cmd_pending = 0;
+
+	pthread_cleanup_pop(1);
+}
+
+
+/**
+ * @brief look up the kernel program at an entry point
+ */
+
+static int (*xen_emu_find_kernel(unsigned long ep))(void)
+{
+	size_t i;
+
+	for (i = 0; i < emu.n_kernels; i++) {
+		if (emu.kernel[i].ep == ep)
+			return emu.kernel[i].entry;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief the emulated Xentium
+ *
+ * @note the command that starts a program is consumed by the program itself
+ *	 via xen_wait_cmd(), so we only peek at the pending flag here
+ */
+
+static void *xen_emu_dev_thread(void *arg)
+{
+	int (*entry)(void);
+
+	struct xen_emu_dev *dev = (struct xen_emu_dev *) arg;
+
+
+	xen_emu_cur = dev;
+
+	while (1) {
+		pthread_mutex_lock(&dev->lock);
+		pthread_cleanup_push(xen_emu_unlock, &dev->lock);
+
+		while (!dev->cmd_pending)
+			pthread_cond_wait(&dev->cond, &dev->lock);
+
+		pthread_cleanup_pop(1);
+
+		entry = xen_emu_find_kernel(dev->mem.mbox[XEN_EP_MBOX]);
+		if (!entry) {
+			fprintf(stderr, "XEN EMU: no kernel at entry point "
+				"%lx, dropping command\n",
+				dev->mem.mbox[XEN_EP_MBOX]);
+			xen_emu_wait_cmd_pending(dev);
+			continue;
+		}
+
+		dev->stats.starts++;
+
+		entry();
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief notify the emulator of a register write
+ */
+
+void xen_emu_io_notify(volatile void *addr)
+{
+	size_t i;
+
+	struct xen_emu_dev *dev;
+
+
+	for (i = 0; i < XEN_EMU_DEVICES; i++) {
+
+		dev = &emu.dev[i];
+
+		if (addr != &dev->mem.mbox[XEN_CMD_MBOX])
+			continue;
+
+		pthread_mutex_lock(&dev->lock);
+		dev->cmd_pending = 1;
+		pthread_cond_signal(&dev->cond);
+		pthread_mutex_unlock(&dev->lock);
+
+		return;
+	}
+}
+
+
+/**
+ * @brief get the emulated device memory of a Xentium
+ */
+
+struct xen_dev_mem *xen_emu_get_dev(int idx)
+{
+	if (idx < 0 || idx >= XEN_EMU_DEVICES)
+		return NULL;
+
+	return &emu.dev[idx].mem;
+}
+
+
+/**
+ * @brief add a natively compiled kernel program at an entry point
+ *
+ * @returns 0 on success, -ENOMEM if the table is full, -EINVAL on error
+ */
+
+int xen_emu_kernel_add(unsigned long ep, int (*entry)(void))
+{
+	if (!entry)
+		return -EINVAL;
+
+	if (emu.n_kernels == XEN_EMU_KERNELS)
+		return -ENOMEM;
+
+	emu.kernel[emu.n_kernels].ep    = ep;
+	emu.kernel[emu.n_kernels].entry = entry;
+
+	emu.n_kernels++;
+
+	return 0;
+}
+
+
+/**
+ * @brief configure the timing of the NoC DMA
+ *
+ * @param latency_ns the setup time of a transfer
+ * @param bytes_per_us the transfer bandwidth, 0 for infinite
+ */
+
+void xen_emu_dma_set_timing(unsigned long latency_ns,
+			    unsigned long bytes_per_us)
+{
+	emu.dma_latency_ns   = latency_ns;
+	emu.dma_bytes_per_us = bytes_per_us;
+}
+
+
+/**
+ * @brief mask interrupts of the emulated Xentiums
+ *
+ * @note call this around driver functions that would otherwise race with
+ *	 the interrupt handler
+ */
+
+void xen_emu_irq_disable(void)
+{
+	pthread_mutex_lock(&emu.irq_lock);
+}
+
+
+/**
+ * @brief unmask interrupts of the emulated Xentiums
+ */
+
+void xen_emu_irq_enable(void)
+{
+	pthread_mutex_unlock(&emu.irq_lock);
+}
+
+
+void xen_emu_get_dev_stats(int idx, struct xen_emu_dev_stats *st)
+{
+	if (idx < 0 || idx >= XEN_EMU_DEVICES)
+		return;
+
+	xen_emu_irq_disable();
+	memcpy(st, &emu.dev[idx].stats, sizeof(*st));
+	xen_emu_irq_enable();
+}
+
+
+void xen_emu_get_dma_stats(int idx, struct xen_emu_dma_stats *st)
+{
+	if (idx < 0 || idx >= XEN_EMU_DMA_CHANNELS)
+		return;
+
+	xen_emu_irq_disable();
+	memcpy(st, &emu.dma[idx].stats, sizeof(*st));
+	xen_emu_irq_enable();
+}
+
+
+/**
+ * @brief start the emulated Xentiums
+ *
+ * @param eirq_base the interrupt number of the first Xentium
+ *
+ * @returns 0 on success, otherwise error
+ */
+
+int xen_emu_init(unsigned int eirq_base)
+{
+	size_t i;
+
+	struct xen_emu_dev *dev;
+
+
+	if (emu.running)
+		return -EBUSY;
+
+	if (eirq_base + XEN_EMU_DEVICES > XEN_EMU_IRQS)
+		return -EINVAL;
+
+	emu.eirq_base = eirq_base;
+
+	pthread_mutex_init(&emu.irq_lock, NULL);
+
+	for (i = 0; i < XEN_EMU_DEVICES; i++) {
+
+		dev = &emu.dev[i];
+
+		memset(dev, 0, sizeof(*dev));
+
+		dev->idx = i;
+
+		pthread_mutex_init(&dev->lock, NULL);
+		pthread_cond_init(&dev->cond, NULL);
+
+		if (pthread_create(&dev->thread, NULL,
+				   xen_emu_dev_thread, dev))
+			return -ENOMEM;
+	}
+
+	emu.running = 1;
+
+	return 0;
+}
+
+
+/**
+ * @brief stop the emulated Xentiums
+ */
+
+void xen_emu_exit(void)
+{
+	size_t i;
+
+
+	if (!emu.running)
+		return;
+
+	for (i = 0; i < XEN_EMU_DEVICES; i++) {
+		pthread_cancel(emu.dev[i].thread);
+		pthread_join(emu.dev[i].thread, NULL);
+	}
+
+	emu.running = 0;
+}
+
+
+/*
+ * platform functions used by the driver
+ */
+
+
+int irq_request(unsigned int irq,
+		__attribute__((unused)) enum isr_exec_priority priority,
+		irq_handler_t handler, void *data)
+{
+	if (irq >= XEN_EMU_IRQS)
+		return -EINVAL;
+
+	if (emu.irq[irq].handler)
+		return -EBUSY;
+
+	emu.irq[irq].handler = handler;
+	emu.irq[irq].data    = data;
+
+	return 0;
+}
+
+
+struct noc_dma_channel *noc_dma_reserve_channel(void)
+{
+	size_t i;
+
+	for (i = 0; i < XEN_EMU_DMA_CHANNELS; i++) {
+		if (!emu.dma[i].reserved) {
+			emu.dma[i].reserved = 1;
+			return &emu.dma[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+void noc_dma_release_channel(struct noc_dma_channel *c)
+{
+	if (c)
+		c->reserved = 0;
+}
+
+
+void machine_halt(void)
+{
+	abort();
+}
+
+
+int smp_cpu_id(void)
+{
+	return 0;
+}
+
+
+/**
+ * @brief print messages up to warning level, strip the level header
+ */
+
+int printk(const char *fmt, ...)
+{
+	int ret;
+	va_list args;
+
+
+	if (fmt[0] == KERN_SOH_ASCII) {
+		if (fmt[1] > KERN_WARNING[1])
+			return 0;
+
+		fmt += 2;
+	}
+
+	va_start(args, fmt);
+	ret = vprintf(fmt, args);
+	va_end(args);
+
+	return ret;
+}
+
+
+/*
+ * Xentium-side runtime
+ */
+
+
+struct xen_dev_mem *xen_emu_get_dev_local(void)
+{
+	return &xen_emu_cur->mem;
+}
+
+
+struct xen_tcm *xen_emu_get_tcm_local(void)
+{
+	return &xen_emu_cur->tcm;
+}
+
+
+void xen_signal_host(void)
+{
+	unsigned int irq;
+
+	struct xen_emu_dev *dev = xen_emu_cur;
+
+
+	irq = emu.eirq_base + dev->idx;
+
+	pthread_mutex_lock(&emu.irq_lock);
+
+	dev->mem.msg_irq = 1;
+	dev->stats.irqs++;
+
+	if (emu.irq[irq].handler)
+		emu.irq[irq].handler(irq, emu.irq[irq].data);
+
+	dev->mem.msg_irq = 0;
+
+	pthread_mutex_unlock(&emu.irq_lock);
+}
+
+
+void xen_set_mail(size_t mbox, unsigned long msg)
+{
+	if (mbox >= XEN_MAILBOXES)
+		return;
+
+	xen_emu_cur->mem.mbox[mbox] = msg;
+}
+
+
+unsigned long xen_get_mail(size_t mbox)
+{
+	if (mbox < XEN_MAILBOXES)
+		return xen_emu_cur->mem.mbox[mbox];
+
+	return 0;
+}
+
+
+struct xen_msg_data *xen_wait_cmd(void)
+{
+	struct xen_emu_dev *dev = xen_emu_cur;
+
+	struct xen_msg_data *m;
+
+
+	xen_emu_wait_cmd_pending(dev);
+
+	dev->stats.cmds++;
+	dev->t_run = xen_emu_time_ns();
+
+	m = (struct xen_msg_data *) xen_get_mail(XEN_CMD_MBOX);
+
+	/* the first command of a kernel program carries the kmem arena */
+	xen_kmem_init(m);
+
+	/* DMA transfers are counted from here to the next message */
+	m->dma_bytes = 0;
+
+	return m;
+}
+
+
+void xen_send_msg(struct xen_msg_data *m)
+{
+	struct xen_emu_dev *dev = xen_emu_cur;
+
+
+	dev->stats.busy_ns += xen_emu_time_ns() - dev->t_run;
+
+	xen_set_mail(XEN_MSG_MBOX, (unsigned long) m);
+	xen_signal_host();
+}
+
+
+void xen_wait_timer(__attribute__((unused)) int timer,
+		    __attribute__((unused)) unsigned long cycles)
+{
+}
+
+
+void xen_wait_dma(void)
+{
+}
+
+
+void *xen_get_base_addr(size_t idx)
+{
+	if (idx >= XEN_EMU_DEVICES)
+		return NULL;
+
+	return &emu.dev[idx].tcm;
+}
+
+
+/**
+ * @brief mark a channel busy for the duration of a transfer
+ */
+
+static void xen_emu_dma_busy(struct noc_dma_channel *c, size_t bytes)
+{
+	uint64_t ns;
+
+	struct xen_msg_data *m = NULL;
+
+
+	ns = emu.dma_latency_ns;
+
+	if (emu.dma_bytes_per_us)
+		ns += (uint64_t) bytes * 1000 / emu.dma_bytes_per_us;
+
+	c->t_done = xen_emu_time_ns() + ns;
+
+	c->stats.xfers++;
+	c->stats.bytes   += bytes;
+	c->stats.busy_ns += ns;
+
+	/* like the Xentium library, count in the current command message */
+	if (xen_emu_cur)
+		m = (struct xen_msg_data *) xen_get_mail(XEN_CMD_MBOX);
+
+	if (m)
+		m->dma_bytes += bytes;
+}
+
+
+void xen_noc_dma_wait(struct noc_dma_channel *c)
+{
+	uint64_t t0;
+
+
+	t0 = xen_emu_time_ns();
+
+	if (t0 >= c->t_done)
+		return;
+
+	while (xen_emu_time_ns() < c->t_done);
+
+	if (xen_emu_cur)
+		xen_emu_cur->stats.dma_wait_ns += xen_emu_time_ns() - t0;
+}
+
+
+/**
+ * @brief perform a transfer and mark the channel busy for its duration
+ */
+
+static int xen_emu_dma_xfer(struct noc_dma_channel *c,
+			    void *src, void *dst, uint16_t x_elem, uint16_t y_elem,
+			    enum noc_dma_elem_size elem_size,
+			    int16_t x_stride_src, int16_t x_stride_dst,
+			    int16_t y_stride_src, int16_t y_stride_dst)
+{
+	size_t x, y;
+	size_t sz;
+
+	char *s = (char *) src;
+	char *d = (char *) dst;
+
+
+	if (!c)
+		return -EINVAL;
+
+	if (!src)
+		return -EINVAL;
+
+	if (!dst)
+		return -EINVAL;
+
+	if (!x_elem)
+		return -EINVAL;
+
+	if (!y_elem)
+		return -EINVAL;
+
+	sz = 1 << elem_size;
+
+	for (y = 0; y < y_elem; y++) {
+		for (x = 0; x < x_elem; x++) {
+			memcpy(d + ((long) y * y_stride_dst
+				    + (long) x * x_stride_dst) * sz,
+			       s + ((long) y * y_stride_src
+				    + (long) x * x_stride_src) * sz,
+			       sz);
+		}
+	}
+
+	xen_emu_dma_busy(c, sz * x_elem * y_elem);
+
+	return 0;
+}
+
+
+int xen_noc_dma_req_xfer(struct noc_dma_channel *c,
+			 void *src, void *dst, uint16_t x_elem, uint16_t y_elem,
+			 enum noc_dma_elem_size elem_size,
+			 int16_t x_stride_src, int16_t x_stride_dst,
+			 int16_t y_stride_src, int16_t y_stride_dst,
+			 __attribute__((unused)) enum noc_dma_priority dma_priority,
+			 __attribute__((unused)) uint16_t mtu)
+{
+	int ret;
+
+
+	if (!c)
+		return -EINVAL;
+
+	xen_noc_dma_wait(c);
+
+	ret = xen_emu_dma_xfer(c, src, dst, x_elem, y_elem, elem_size,
+			       x_stride_src, x_stride_dst,
+			       y_stride_src, y_stride_dst);
+	if (ret)
+		return ret;
+
+	xen_noc_dma_wait(c);
+
+	return 0;
+}
+
+
+int xen_noc_dma_start_lin_xfer(struct noc_dma_channel *c,
+			       void *src, void *dst,
+			       uint16_t elem, enum noc_dma_elem_size elem_size,
+			       __attribute__((unused))
+			       enum noc_dma_priority dma_priority,
+			       __attribute__((unused)) uint16_t mtu)
+{
+	if (!c)
+		return -EINVAL;
+
+	xen_noc_dma_wait(c);
+
+	return xen_emu_dma_xfer(c, src, dst, elem, 1, elem_size, 1, 1, 1, 1);
+}
+
+
+int xen_noc_dma_req_lin_xfer(struct noc_dma_channel *c,
+			     void *src, void *dst,
+			     uint16_t elem, enum noc_dma_elem_size elem_size,
+			     enum noc_dma_priority dma_priority, uint16_t mtu)
+{
+	return xen_noc_dma_req_xfer(c, src, dst, elem, 1, elem_size,
+				    1, 1, 1, 1, dma_priority, mtu);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file   xen_emu.h
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#ifndef XEN_EMU_H
+#define XEN_EMU_H
+
+#include <stdint.h>
+#include <kernel/xentium_dev.h>
+
+#define XEN_EMU_DEVICES		2
+#define XEN_EMU_DMA_CHANNELS	8
+
+
+/**
+ * @brief the statistics of an emulated Xentium
+ */
+
+struct xen_emu_dev_stats {
+	unsigned long starts;		/* kernel program starts */
+	unsigned long cmds;		/* commands received */
+	unsigned long irqs;		/* interrupts raised */
+	uint64_t busy_ns;		/* time spent executing kernels */
+	uint64_t dma_wait_ns;		/* time spent waiting for DMA */
+};
+
+
+/**
+ * @brief the statistics of an emulated NoC DMA channel
+ */
+
+struct xen_emu_dma_stats {
+	unsigned long xfers;		/* number of transfers */
+	uint64_t bytes;			/* bytes transferred */
+	uint64_t busy_ns;		/* time spent transferring */
+};
+
+
+int xen_emu_init(unsigned int eirq_base);
+void xen_emu_exit(void);
+
+int xen_emu_kernel_add(unsigned long ep, int (*entry)(void));
+
+struct xen_dev_mem *xen_emu_get_dev(int idx);
+
+void xen_emu_dma_set_timing(unsigned long latency_ns,
+			    unsigned long bytes_per_us);
+
+void xen_emu_irq_disable(void);
+void xen_emu_irq_enable(void);
+
+void xen_emu_get_dev_stats(int idx, struct xen_emu_dev_stats *st);
+void xen_emu_get_dma_stats(int idx, struct xen_emu_dma_stats *st);
+
+uint64_t xen_emu_time_ns(void);
+
+#endif /* XEN_EMU_H */
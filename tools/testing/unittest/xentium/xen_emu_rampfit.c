@@ -0,0 +1,65 @@
+/**
+ * @file   xen_emu_rampfit.c
+ * @ingroup mockups
+ *
+ * @copyright GPLv2
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * @brief host replacement of the Xentium assembly ramp fit
+ *
+ * This is the C equivalent given with dsp/xentium/kernel/rampfit/
+ * xen_asm_rampfit.S, but it reads the samples from the two TCM banks the
+ * rampfit kernel de-interleaves them into, i.e. even samples from the first,
+ * odd samples from the second bank.
+ */
+
+#include <stdint.h>
+
+
+int FastIntFixedRampFitBuffer(int32_t *bank1, int32_t *bank2,
+			      unsigned int n_samples, unsigned int ramplen,
+			      int32_t *slopes)
+{
+	unsigned int i;
+	unsigned int r = 0;
+	unsigned int pos = 0;
+
+	int32_t Sy;
+	int32_t Sxy;
+	int32_t value;
+
+	const int32_t ampl = (int32_t) ramplen;
+
+
+	while (pos + ramplen <= n_samples) {
+
+		Sy  = 0;
+		Sxy = 0;
+
+		/* equation starts with 1 */
+		for (i = 1; i <= ramplen; i++) {
+
+			if (pos & 1)
+				value = bank2[pos >> 1];
+			else
+				value = bank1[pos >> 1];
+
+			pos++;
+
+			Sy  += value;
+			Sxy += (int32_t) i * value;
+		}
+
+		/* denomination has to be done outside */
+		slopes[r++] = ampl * Sxy - ((ampl * ((ampl + 1) * Sy)) >> 1);
+	}
+
+	return r;
+}
@@ -0,0 +1,992 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <kselftest.h>
+
+#include <xen_emu.h>
+#include <xentium_demo.h>
+
+/* the Xentium-side runtime, for the kmem kernel program */
+#include <xen.h>
+#include <dma.h>
+
+/* include src file for static function testing */
+#include <sysctl.c>
+#include <xentium.c>
+
+
+#define DEGLITCH_OP_CODE	0xbadc0ded
+#define DUMMY_OP_CODE		0xdeadbeef
+#define RAMPFIT_OP_CODE		0x00bada55
+#define STACK_OP_CODE		0x1fedbeef
+
+/* arbitrary entry points of the emulated kernel programs */
+#define DUMMY_EP		0x1000
+#define DEGLITCH_EP		0x2000
+#define KMEM_EP			0x3000
+#define RAMPFIT_EP		0x4000
+#define STACK_EP		0x5000
+
+#define KMEM_OP_CODE		0xa110c
+#define KMEM_ALLOCS		4
+
+#define TASK_ELEM		64
+
+/* the slope of a unit ramp as computed by the rampfit kernel, i.e.
+ * L^2 * (L^2 - 1) / 12 for a ramp length L
+ */
+#define RAMP_LEN		4
+#define RAMP_SLOPE		20
+
+#define STACK_FRAMES		2
+
+#define TIMEOUT_US		(10 * 1000 * 1000)
+
+/* the natively compiled Xentium kernel programs */
+int xen_dummy_main(void);
+int xen_deglitch_main(void);
+int xen_rampfit_main(void);
+int xen_stack_main(void);
+extern struct xen_kernel_cfg xen_dummy_param;
+extern struct xen_kernel_cfg xen_deglitch_param;
+extern struct xen_kernel_cfg xen_rampfit_param;
+extern struct xen_kernel_cfg xen_stack_param;
+
+
+/* the op code of the kernel the tasks currently pass through */
+static unsigned long test_op;
+
+static unsigned long tasks_out;
+static unsigned long tasks_stacked;
+static unsigned long tasks_bad;
+static unsigned long tasks_unordered;
+static unsigned long seq_last;
+static unsigned long parallel_seen;
+
+/* the number of deglitch kernel instances currently executing */
+static int deglitch_running;
+
+/* the Xentium-side allocator (dsp/xentium/lib/kmem.c) */
+void *xen_kmalloc(size_t size);
+void *xen_kzalloc(size_t size);
+void xen_kfree(void *ptr);
+
+static int kmem_running;
+static unsigned long kmem_bad;
+static unsigned long kmem_host;
+
+static struct xen_kernel_cfg xen_kmem_param = {
+	.name = "kmem", .op_code = KMEM_OP_CODE, .crit_buf_lvl = 1,
+};
+
+
+/* needed dummy functions */
+
+void *kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void *kzalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+void *kcalloc(size_t nmemb, size_t size)
+{
+	return calloc(nmemb, size);
+}
+
+void *krealloc(void *ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+void kfree(void *ptr)
+{
+	free(ptr);
+}
+
+ktime ktime_get(void)
+{
+	return (ktime) xen_emu_time_ns();
+}
+
+int64_t ktime_delta(const ktime later, const ktime earlier)
+{
+	return later - earlier;
+}
+
+int64_t ktime_to_us(const ktime t)
+{
+	return t / 1000;
+}
+
+
+/**
+ * @brief the deglitch kernel program, counts instances running in parallel
+ *
+ * @note the emulated Xentiums execute in their own threads, so this detects
+ *	 any overlap, not only those that coincide with the polling loop
+ */
+
+static int xen_test_deglitch_main(void)
+{
+	int ret;
+
+
+	if (__sync_add_and_fetch(&deglitch_running, 1) > 1)
+		__sync_add_and_fetch(&parallel_seen, 1);
+
+	ret = xen_deglitch_main();
+
+	__sync_sub_and_fetch(&deglitch_running, 1);
+
+	return ret;
+}
+
+
+/**
+ * @brief process a task in the kmem kernel program
+ *
+ * @note the buffers are filled with a pattern unique to the task and checked
+ *	 after the (slow) DMA transfer, so allocator state shared with another
+ *	 instance is detected; the last allocation exceeds the arena and must be
+ *	 served by the host
+ */
+
+static void xen_test_kmem_task(struct xen_msg_data *m)
+{
+	size_t i;
+	size_t j;
+	size_t sz[KMEM_ALLOCS];
+
+	int *p;
+	int *buf[KMEM_ALLOCS];
+
+
+	p = pt_get_data(m->t);
+
+	for (i = 0; i < KMEM_ALLOCS; i++) {
+
+		sz[i] = (i + 1) * TASK_ELEM;
+
+		if (i == KMEM_ALLOCS - 1)
+			sz[i] = XEN_KMEM_ARENA_SIZE / sizeof(int);
+
+		buf[i] = xen_kzalloc(sz[i] * sizeof(int));
+		if (!buf[i]) {
+			__sync_add_and_fetch(&kmem_bad, 1);
+			m->cmd = TASK_DESTROY;
+			return;
+		}
+
+		if ((char *) buf[i] < (char *) m->arena ||
+		    (char *) buf[i] >= (char *) m->arena + m->arena_size)
+			__sync_add_and_fetch(&kmem_host, 1);
+
+		for (j = 0; j < sz[i]; j++) {
+			if (buf[i][j])
+				__sync_add_and_fetch(&kmem_bad, 1);
+
+			buf[i][j] = pt_get_seq(m->t) + j;
+		}
+	}
+
+	xen_noc_dma_req_lin_xfer(m->dma, p, buf[0], TASK_ELEM, WORD, LOW, 256);
+
+	for (i = 0; i < KMEM_ALLOCS; i++) {
+		for (j = 0; j < sz[i]; j++) {
+			if (buf[i][j] != (int) (pt_get_seq(m->t) + j)) {
+				__sync_add_and_fetch(&kmem_bad, 1);
+				break;
+			}
+		}
+	}
+
+	xen_noc_dma_req_lin_xfer(m->dma, buf[0], p, TASK_ELEM, WORD, LOW, 256);
+
+	/* release out of order, so chunks are merged in both directions */
+	xen_kfree(buf[1]);
+	xen_kfree(buf[3]);
+	xen_kfree(buf[0]);
+	xen_kfree(buf[2]);
+
+	m->cmd = TASK_SUCCESS;
+}
+
+
+/**
+ * @brief a kernel program that allocates via the Xentium-side allocator
+ */
+
+static int xen_test_kmem_main(void)
+{
+	struct xen_msg_data *m;
+
+
+	if (__sync_add_and_fetch(&kmem_running, 1) > 1)
+		__sync_add_and_fetch(&parallel_seen, 1);
+
+	while (1) {
+		m = xen_wait_cmd();
+
+		if (m->cmd == TASK_EXIT) {
+			xen_send_msg(m);
+			break;
+		}
+
+		xen_test_kmem_task(m);
+
+		xen_send_msg(m);
+	}
+
+	__sync_sub_and_fetch(&kmem_running, 1);
+
+	return 0;
+}
+
+
+/**
+ * @brief register a natively compiled kernel program with the driver
+ *
+ * @note this replaces the ELF loading part of xentium_kernel_add()
+ */
+
+static int xen_test_kernel_add(struct xen_kernel_cfg *param,
+			       int (*entry)(void), unsigned long ep)
+{
+	struct xen_kernel *x;
+	struct xen_kernel_cfg *cfg;
+
+
+	x = kzalloc(sizeof(struct xen_kernel));
+	if (!x)
+		return -1;
+
+	cfg = kzalloc(sizeof(struct xen_kernel_cfg));
+	if (!cfg)
+		return -1;
+
+	memcpy(cfg, param, sizeof(struct xen_kernel_cfg));
+
+	if (cfg->size) {
+		cfg->data = kzalloc(cfg->size);
+		param->data = cfg->data;
+	}
+
+	x->ep = ep;
+
+	if (xen_emu_kernel_add(ep, entry))
+		return -1;
+
+	return xentium_kernel_register(x, cfg);
+}
+
+
+/**
+ * @brief check the data of a task that passed through the kernel under test
+ *
+ * @returns 0 if the data are as expected, -1 otherwise
+ */
+
+static int xen_test_check_data(struct proc_task *t)
+{
+	size_t i;
+
+	int *p;
+
+	unsigned long seq;
+
+
+	p   = pt_get_data(t);
+	seq = pt_get_seq(t);
+
+	switch (test_op) {
+	case RAMPFIT_OP_CODE:
+		if (pt_get_nmemb(t) != TASK_ELEM / RAMP_LEN)
+			return -1;
+
+		for (i = 0; i < TASK_ELEM / RAMP_LEN; i++) {
+			if (p[i] != RAMP_SLOPE)
+				return -1;
+		}
+
+		return 0;
+
+	case STACK_OP_CODE:
+		/* the tasks stacked onto the last one are emptied */
+		if (!pt_get_nmemb(t))
+			return 0;
+
+		if (seq != STACK_FRAMES - 1)
+			return -1;
+
+		for (i = 0; i < TASK_ELEM; i++) {
+			if (p[i] != (int) (seq * STACK_FRAMES / 2
+					   + STACK_FRAMES * i))
+				return -1;
+		}
+
+		tasks_stacked++;
+
+		return 0;
+
+	default:
+		/* a ramp passes the deglitch filter unchanged */
+		for (i = 0; i < TASK_ELEM; i++) {
+			if (p[i] != (int) (seq + i))
+				return -1;
+		}
+
+		return 0;
+	}
+}
+
+
+/**
+ * @brief the output node, verifies and releases tasks
+ */
+
+static int xen_test_op_output(unsigned long op_code, struct proc_task *t)
+{
+	if (xen_test_check_data(t))
+		tasks_bad++;
+
+	if (tasks_out && pt_get_seq(t) < seq_last)
+		tasks_unordered++;
+
+	seq_last = pt_get_seq(t);
+
+	tasks_out++;
+
+	kfree(pt_get_data(t));
+	pt_destroy(t);
+
+	return PN_TASK_SUCCESS;
+}
+
+
+/**
+ * @brief create the op info of a kernel
+ */
+
+static void *xen_test_create_op_info(unsigned long op)
+{
+	struct ramp_op_info *ramp;
+	struct stack_op_info *stack;
+	struct deglitch_op_info *deglitch;
+
+
+	switch (op) {
+	case RAMPFIT_OP_CODE:
+		ramp = kmalloc(sizeof(struct ramp_op_info));
+		if (ramp)
+			ramp->ramplen = RAMP_LEN;
+		return ramp;
+
+	case STACK_OP_CODE:
+		stack = kmalloc(sizeof(struct stack_op_info));
+		if (stack)
+			stack->stackframes = STACK_FRAMES;
+		return stack;
+
+	default:
+		deglitch = kmalloc(sizeof(struct deglitch_op_info));
+		if (deglitch)
+			deglitch->sigclip = 3;
+		return deglitch;
+	}
+}
+
+
+/**
+ * @brief create a task that passes through a kernel and the dummy kernel
+ */
+
+static struct proc_task *xen_test_create_task(unsigned long seq,
+					      unsigned long op)
+{
+	size_t i;
+
+	int *p;
+
+	void *info;
+
+	struct proc_task *t;
+
+
+	p = kmalloc(TASK_ELEM * sizeof(int));
+	if (!p)
+		return NULL;
+
+	/* released by pt_destroy() */
+	info = xen_test_create_op_info(op);
+	if (!info) {
+		kfree(p);
+		return NULL;
+	}
+
+	/* the ramps differ per task, so mixed up buffers are detected */
+	for (i = 0; i < TASK_ELEM; i++)
+		p[i] = seq + i;
+
+	t = pt_create(p, TASK_ELEM * sizeof(int), 2, 0, seq);
+	if (!t) {
+		kfree(info);
+		kfree(p);
+		return NULL;
+	}
+
+	pt_set_nmemb(t, TASK_ELEM);
+
+	pt_add_step(t, op, info);
+	pt_add_step(t, DUMMY_OP_CODE, NULL);
+
+	return t;
+}
+
+
+/**
+ * @brief feed tasks to the network and wait for them to arrive at the output
+ *
+ * @returns the time in ns it took to process all tasks or 0 on timeout
+ */
+
+static uint64_t xen_test_run_op(unsigned long n, unsigned long op)
+{
+	unsigned long i;
+	unsigned long us = 0;
+
+	uint64_t start;
+
+	struct proc_task *t;
+
+
+	test_op = op;
+
+	tasks_out = 0;
+	tasks_bad = 0;
+	tasks_unordered = 0;
+	parallel_seen = 0;
+
+	start = xen_emu_time_ns();
+
+	for (i = 0; i < n; i++) {
+
+		t = xen_test_create_task(i, op);
+		if (!t)
+			return 0;
+
+		while (1) {
+			xen_emu_irq_disable();
+			if (!xentium_input_task(t)) {
+				xen_emu_irq_enable();
+				break;
+			}
+			xen_emu_irq_enable();
+		}
+	}
+
+	while (tasks_out < n) {
+
+		xen_emu_irq_disable();
+		xentium_output_tasks();
+		xentium_schedule_next();
+		xen_emu_irq_enable();
+
+		if (us++ > TIMEOUT_US)
+			return 0;
+
+		usleep(1);
+	}
+
+	return xen_emu_time_ns() - start;
+}
+
+
+/**
+ * @brief run tasks through the deglitch and dummy kernels
+ */
+
+static uint64_t xen_test_run(unsigned long n)
+{
+	return xen_test_run_op(n, DEGLITCH_OP_CODE);
+}
+
+
+/* tests */
+
+
+/*
+ * @test xentium_init_test
+ */
+
+static void xentium_init_test(void)
+{
+	size_t i;
+
+
+	KSFT_ASSERT(sysctl_init() == 0);
+
+	KSFT_ASSERT(xen_emu_init(XEN_0_EIRQ) == 0);
+
+	/* redirect the driver to the emulated devices */
+	for (i = 0; i < ARRAY_SIZE(_xen.dev); i++) {
+		_xen.dev[i] = xen_emu_get_dev(i);
+		KSFT_ASSERT_PTR_NOT_NULL(_xen.dev[i]);
+	}
+
+	KSFT_ASSERT(xentium_init() == 0);
+	KSFT_ASSERT_PTR_NOT_NULL(_xen.pn);
+
+	KSFT_ASSERT(xentium_config_output_node(xen_test_op_output) == 0);
+}
+
+
+/*
+ * @test xentium_kernel_register_test
+ */
+
+static void xentium_kernel_register_test(void)
+{
+	KSFT_ASSERT(xen_test_kernel_add(&xen_dummy_param,
+					xen_dummy_main, DUMMY_EP) == 0);
+
+	KSFT_ASSERT(xen_test_kernel_add(&xen_deglitch_param,
+					xen_test_deglitch_main,
+					DEGLITCH_EP) == 0);
+
+	KSFT_ASSERT(_xen.cnt == 2);
+
+	KSFT_ASSERT(xen_get_kernel_idx_with_op_code(DUMMY_OP_CODE) == 0);
+	KSFT_ASSERT(xen_get_kernel_idx_with_op_code(DEGLITCH_OP_CODE) == 1);
+	KSFT_ASSERT(xen_get_kernel_idx_with_op_code(0) == -ENOENT);
+}
+
+
+/*
+ * @test xentium_single_task_test
+ */
+
+static void xentium_single_task_test(void)
+{
+	KSFT_ASSERT(xen_test_run(1) != 0);
+	KSFT_ASSERT(tasks_out == 1);
+	KSFT_ASSERT(tasks_bad == 0);
+}
+
+
+/*
+ * @test xentium_many_tasks_test
+ */
+
+static void xentium_many_tasks_test(void)
+{
+	KSFT_ASSERT(xen_test_run(256) != 0);
+	KSFT_ASSERT(tasks_out == 256);
+	KSFT_ASSERT(tasks_bad == 0);
+	KSFT_ASSERT(tasks_unordered == 0);
+}
+
+
+/**
+ * @brief read a statistics attribute from the sysctl tree
+ */
+
+static long long xen_test_stat(const char *path, const char *attr)
+{
+	char buf[32] = "-1";
+
+
+	sysobj_show_attr(sysset_find_obj(NULL, path), attr, buf);
+
+	return atoll(buf);
+}
+
+
+/**
+ * @brief reset the statistics of a sysctl object
+ */
+
+static void xen_test_stat_reset(const char *path)
+{
+	sysobj_store_attr(sysset_find_obj(NULL, path), "reset_stats", "1", 1);
+}
+
+
+/*
+ * @test xentium_stats_test
+ *
+ * @note every task passes through both kernels, the deglitch kernel moves
+ *	 the data of each task in and out of its Xentium via DMA
+ */
+
+static void xentium_stats_test(void)
+{
+	size_t i;
+
+	long long tasks = 0;
+
+	const char *xen[]  = {"/sys/driver/xentium/xen0",
+			      "/sys/driver/xentium/xen1"};
+	const char *dummy    = "/sys/driver/xentium/deadbeef";
+	const char *deglitch = "/sys/driver/xentium/badc0ded";
+
+
+	for (i = 0; i < ARRAY_SIZE(xen); i++)
+		xen_test_stat_reset(xen[i]);
+
+	xen_test_stat_reset(dummy);
+	xen_test_stat_reset(deglitch);
+
+	KSFT_ASSERT(xen_test_stat(dummy, "tasks") == 0);
+
+	KSFT_ASSERT(xen_test_run(64) != 0);
+	KSFT_ASSERT(tasks_out == 64);
+
+	for (i = 0; i < ARRAY_SIZE(xen); i++) {
+		tasks += xen_test_stat(xen[i], "tasks");
+		KSFT_ASSERT(xen_test_stat(xen[i], "cmds") >=
+			    xen_test_stat(xen[i], "tasks"));
+	}
+
+	KSFT_ASSERT(tasks == 2 * 64);
+
+	KSFT_ASSERT(xen_test_stat(dummy, "tasks") == 64);
+	KSFT_ASSERT(xen_test_stat(deglitch, "tasks") == 64);
+
+	KSFT_ASSERT(xen_test_stat(dummy, "starts") > 0);
+	KSFT_ASSERT(xen_test_stat(deglitch, "starts") > 0);
+
+	/* tasks that were put back are only accounted once they are processed */
+	KSFT_ASSERT(xen_test_stat(deglitch, "wait_avg_us") >= 0);
+	KSFT_ASSERT(xen_test_stat(deglitch, "wait_max_us") >=
+		    xen_test_stat(deglitch, "wait_avg_us"));
+	KSFT_ASSERT(_xen.x[1]->stats.dispatched == 64);
+
+	KSFT_ASSERT(xen_test_stat(deglitch, "dma_bytes") >=
+		    2 * 64 * TASK_ELEM * sizeof(int));
+
+	KSFT_ASSERT(xen_test_stat(dummy, "dma_bytes") >=
+		    2 * 64 * TASK_ELEM * sizeof(int));
+
+	KSFT_ASSERT(xen_test_stat(deglitch, "busy_us") >= 0);
+	KSFT_ASSERT(_xen.x[1]->stats.busy > 0);
+
+	/* kernels do not have an idle time */
+	KSFT_ASSERT(xen_test_stat(deglitch, "idle_us") == -1);
+	KSFT_ASSERT(xen_test_stat(xen[0], "idle_us") >= 0);
+
+	/* all kernel programs exited */
+	KSFT_ASSERT(!_xen.k[0] && !_xen.k[1]);
+}
+
+
+/*
+ * @test xentium_parallel_node_test
+ *
+ * @note the deglitch kernel is stateless and has a low critical level, so
+ *	 a large backlog must be processed by both Xentiums in parallel, while
+ *	 the output order is preserved
+ */
+
+static void xentium_parallel_node_test(void)
+{
+	xen_emu_dma_set_timing(500, 100);
+
+	KSFT_ASSERT(xen_test_run(512) != 0);
+	KSFT_ASSERT(tasks_out == 512);
+	KSFT_ASSERT(tasks_bad == 0);
+	KSFT_ASSERT(tasks_unordered == 0);
+	KSFT_ASSERT(parallel_seen != 0);
+
+	xen_emu_dma_set_timing(0, 0);
+}
+
+
+/*
+ * @test xentium_kmem_test
+ *
+ * @note the kmem kernel is stateless, so it is executed by both Xentiums in
+ *	 parallel, each with the arena of its own Xentium
+ */
+
+static void xentium_kmem_test(void)
+{
+	KSFT_ASSERT(xen_test_kernel_add(&xen_kmem_param,
+					xen_test_kmem_main, KMEM_EP) == 0);
+
+	kmem_bad  = 0;
+	kmem_host = 0;
+
+	xen_emu_dma_set_timing(500, 100);
+
+	KSFT_ASSERT(xen_test_run_op(256, KMEM_OP_CODE) != 0);
+	KSFT_ASSERT(tasks_out == 256);
+	KSFT_ASSERT(tasks_bad == 0);
+	KSFT_ASSERT(tasks_unordered == 0);
+	KSFT_ASSERT(parallel_seen != 0);
+
+	KSFT_ASSERT(kmem_bad == 0);
+	KSFT_ASSERT(kmem_host == 256);
+
+	xen_emu_dma_set_timing(0, 0);
+}
+
+
+/*
+ * @test xentium_rampfit_test
+ *
+ * @note each task holds unit ramps, which are de-interleaved into two TCM
+ *	 banks by a 2D DMA transfer and replaced by their slopes
+ */
+
+static void xentium_rampfit_test(void)
+{
+	KSFT_ASSERT(xen_test_kernel_add(&xen_rampfit_param,
+					xen_rampfit_main, RAMPFIT_EP) == 0);
+
+	KSFT_ASSERT(xen_test_run_op(64, RAMPFIT_OP_CODE) != 0);
+	KSFT_ASSERT(tasks_out == 64);
+	KSFT_ASSERT(tasks_bad == 0);
+}
+
+
+/*
+ * @test xentium_stack_test
+ *
+ * @note the stack kernel detaches tasks into its storage until the last
+ *	 frame arrives, which is shared by all of its instances, so the frames
+ *	 are fed one stack at a time
+ */
+
+static void xentium_stack_test(void)
+{
+	size_t i;
+
+
+	KSFT_ASSERT(xen_test_kernel_add(&xen_stack_param,
+					xen_stack_main, STACK_EP) == 0);
+
+	tasks_stacked = 0;
+
+	for (i = 0; i < 8; i++) {
+		KSFT_ASSERT(xen_test_run_op(STACK_FRAMES, STACK_OP_CODE) != 0);
+		KSFT_ASSERT(tasks_out == STACK_FRAMES);
+		KSFT_ASSERT(tasks_bad == 0);
+	}
+
+	KSFT_ASSERT(tasks_stacked == 8);
+}
+
+
+/*
+ * @test xentium_kernel_cache_test
+ *
+ * @note two kernels with overlapping images are registered, the image of the
+ *	 second one must not be loaded while the first one is executing, the
+ *	 image of the first one must be restored from the cache when it is
+ *	 needed again, but only if the second one is not executing
+ */
+
+static void xentium_kernel_cache_test(void)
+{
+	int a;
+	int b;
+
+	struct proc_tracker *pt;
+
+	static uint32_t mem[16];
+	static uint32_t img_a[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	static uint32_t img_b[8] = {9, 9, 9, 9, 9, 9, 9, 9};
+
+	static struct xen_kern_section sec_a[2];
+	static struct xen_kern_section sec_b[1];
+
+	static struct xen_kernel x_a;
+	static struct xen_kernel x_b;
+
+	static struct xen_kernel_cfg cfg_a = {.name = "a", .op_code = 0xa,
+						 .crit_buf_lvl = 1};
+	static struct xen_kernel_cfg cfg_b = {.name = "b", .op_code = 0xb,
+						 .crit_buf_lvl = 1};
+
+
+	/* a: 8 words of text, 8 words of bss */
+	sec_a[0] = (struct xen_kern_section) {.addr = (unsigned long) &mem[0],
+					      .size = sizeof(img_a)};
+	sec_a[1] = (struct xen_kern_section) {.addr = (unsigned long) &mem[8],
+					      .size = sizeof(img_a),
+					      .type = SHT_NOBITS};
+
+	/* b overlaps the bss of a */
+	sec_b[0] = (struct xen_kern_section) {.addr = (unsigned long) &mem[8],
+					      .size = sizeof(img_b)};
+
+	x_a.sec = sec_a;
+	x_a.num_sec = ARRAY_SIZE(sec_a);
+	x_a.lo = (unsigned long) &mem[0];
+	x_a.hi = (unsigned long) &mem[16];
+
+	x_b.sec = sec_b;
+	x_b.num_sec = ARRAY_SIZE(sec_b);
+	x_b.lo = (unsigned long) &mem[8];
+	x_b.hi = (unsigned long) &mem[16];
+
+	KSFT_ASSERT(xen_kernel_make_room(&x_a) == 0);
+	memcpy(mem, img_a, sizeof(img_a));
+	KSFT_ASSERT(xentium_cache_kernel(&x_a) == 0);
+	KSFT_ASSERT(xentium_kernel_register(&x_a, &cfg_a) == 0);
+	KSFT_ASSERT(x_a.resident);
+
+	a = xen_get_kernel_idx_with_op_code(0xa);
+	KSFT_ASSERT(a >= 0);
+
+	/* a is executing, b cannot be loaded over it */
+	pt = pt_track_create(op_xen_schedule_kernel, 0xa, 1);
+	KSFT_ASSERT_PTR_NOT_NULL(pt);
+
+	xen_set_tracker(0, pt);
+	KSFT_ASSERT(xen_kernel_make_room(&x_b) == -EBUSY);
+	KSFT_ASSERT(x_a.resident);
+	xen_set_tracker(0, NULL);
+	pt_track_destroy(pt);
+
+	KSFT_ASSERT(xen_kernel_make_room(&x_b) == 0);
+	KSFT_ASSERT(!x_a.resident);
+	memcpy(&mem[8], img_b, sizeof(img_b));
+	KSFT_ASSERT(xentium_cache_kernel(&x_b) == 0);
+	KSFT_ASSERT(xentium_kernel_register(&x_b, &cfg_b) == 0);
+	KSFT_ASSERT(x_b.resident);
+	KSFT_ASSERT(!x_a.resident);
+
+	b = xen_get_kernel_idx_with_op_code(0xb);
+	KSFT_ASSERT(b >= 0);
+
+	/* b is executing, a cannot be swapped in */
+	pt = pt_track_create(op_xen_schedule_kernel, 0xb, 1);
+	KSFT_ASSERT_PTR_NOT_NULL(pt);
+
+	xen_set_tracker(0, pt);
+	KSFT_ASSERT(xen_kernel_load_image(a) == -EBUSY);
+	KSFT_ASSERT(!x_a.resident);
+	xen_set_tracker(0, NULL);
+
+	/* mess up the text of a, it must be restored */
+	mem[0] = 0;
+
+	KSFT_ASSERT(xen_kernel_load_image(a) == 0);
+	KSFT_ASSERT(x_a.resident);
+	KSFT_ASSERT(!x_b.resident);
+	KSFT_ASSERT(!memcmp(mem, img_a, sizeof(img_a)));
+	KSFT_ASSERT(mem[8] == 0);
+
+	KSFT_ASSERT(xen_kernel_load_image(b) == 0);
+	KSFT_ASSERT(!x_a.resident);
+	KSFT_ASSERT(!memcmp(&mem[8], img_b, sizeof(img_b)));
+
+	pt_track_destroy(pt);
+}
+
+
+/*
+ * @test xentium_benchmark
+ *
+ * @note this reports the throughput of the offload pipeline for different
+ *	 NoC DMA timings, there is nothing to verify except completion
+ */
+
+static void xentium_benchmark(void)
+{
+	size_t i;
+
+	uint64_t ns;
+
+	struct xen_emu_dev_stats ds;
+	struct xen_emu_dma_stats ms;
+
+	const unsigned long n = 1024;
+	const unsigned long bw[] = {0, 1000, 100};
+
+
+	for (i = 0; i < ARRAY_SIZE(bw); i++) {
+
+		xen_emu_dma_set_timing(500, bw[i]);
+
+		ns = xen_test_run(n);
+		KSFT_ASSERT(ns != 0);
+		KSFT_ASSERT(tasks_out == n);
+
+		printf("\t\tDMA %4lu B/us: %lu tasks in %llu us, %llu ns/task\n",
+		       bw[i], n, (unsigned long long) ns / 1000,
+		       (unsigned long long) ns / n);
+	}
+
+	for (i = 0; i < XEN_EMU_DEVICES; i++) {
+		xen_emu_get_dev_stats(i, &ds);
+		xen_emu_get_dma_stats(i, &ms);
+
+		printf("\t\tXentium %lu: %lu starts, %lu cmds, %lu irqs, "
+		       "busy %llu us, DMA wait %llu us, "
+		       "DMA %lu xfers, %llu bytes, busy %llu us\n",
+		       (unsigned long) i, ds.starts, ds.cmds, ds.irqs,
+		       (unsigned long long) ds.busy_ns / 1000,
+		       (unsigned long long) ds.dma_wait_ns / 1000,
+		       ms.xfers, (unsigned long long) ms.bytes,
+		       (unsigned long long) ms.busy_ns / 1000);
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+
+	printf("Testing Xentium driver on emulated devices\n\n");
+
+	KSFT_RUN_TEST("xentium init",
+		      xentium_init_test);
+
+	KSFT_RUN_TEST("xentium kernel register",
+		      xentium_kernel_register_test);
+
+	KSFT_RUN_TEST("xentium single task",
+		      xentium_single_task_test);
+
+	KSFT_RUN_TEST("xentium many tasks",
+		      xentium_many_tasks_test);
+
+	KSFT_RUN_TEST("xentium statistics",
+		      xentium_stats_test);
+
+	KSFT_RUN_TEST("xentium parallel node",
+		      xentium_parallel_node_test);
+
+	KSFT_RUN_TEST("xentium kmem arena",
+		      xentium_kmem_test);
+
+	KSFT_RUN_TEST("xentium rampfit kernel",
+		      xentium_rampfit_test);
+
+	KSFT_RUN_TEST("xentium stack kernel",
+		      xentium_stack_test);
+
+	KSFT_RUN_TEST("xentium kernel cache",
+		      xentium_kernel_cache_test);
+
+	KSFT_RUN_TEST("xentium benchmark",
+		      xentium_benchmark);
+
+	xen_emu_exit();
+
+	printf("Xentium test complete:\n");
+
+	ksft_print_cnts();
+
+	return ksft_exit_pass();
+}